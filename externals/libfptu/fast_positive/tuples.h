@@ -1975,6 +1975,27 @@ FPTU_API int tuple2json(const fptu_ro &tuple, std::ostream &stream,
                         fptu_value2enum_func value2enum,
                         const fptu_json_options options = fptu_json_default);
 
+/* Сериализует JSON-представление кортежа, дописывая текст в конец строки out.
+ *
+ * В отличии от прочих вариантов, текст формируется непосредственно в растущем
+ * непрерывном буфере, без выталкивания порций через fptu_emit_func, а для
+ * трансляции тегов в символические имена используется заранее подготовленная
+ * таблица names, индексируемая номерами колонок, без обратных вызовов
+ * tag2name для каждого поля. Для колонок за пределами names_count или с
+ * нулевым указателем в таблице выводятся числовые идентификаторы, а для
+ * пустых строк поле пропускается (аналогично tag2name).
+ *
+ * Назначение параметров indent, depth, schema_ctx и value2enum
+ * см в описании функции fptu_tuple2json().
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTU_API int tuple2json(const fptu_ro &tuple, std::string &out,
+                        const string_view &indent, unsigned depth,
+                        const char *const *names, size_t names_count,
+                        const void *schema_ctx = nullptr,
+                        fptu_value2enum_func value2enum = nullptr,
+                        const fptu_json_options options = fptu_json_default);
+
 /* Сериализует JSON-представление кортежа в std::string и возвращает результат.
  *
  * Назначение параметров indent, depth, schema_ctx, tag2name и value2enum
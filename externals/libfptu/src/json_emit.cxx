@@ -62,22 +62,34 @@ namespace {
 struct emitter {
   void *const output_ctx;
   const fptu_emit_func output;
+  /* Растущий непрерывный буфер: если задан, то текст дописывается
+   * непосредственно в него, без обратных вызовов output. */
+  std::string *const sink;
   const string_view indent_str;
 
   unsigned depth;
-  unsigned fill;
-  char buffer[42];
+  size_t fill, capacity;
+  char *buffer;
   fptu_error err;
   bool indented;
+  char inplace[42];
 
   emitter(fptu_emit_func output, void *output_ctx, const string_view &indent,
           unsigned depth)
-      : output_ctx(output_ctx), output(output), indent_str(indent),
-        depth(depth), fill(0), err(FPTU_SUCCESS), indented(false) {}
+      : output_ctx(output_ctx), output(output), sink(nullptr),
+        indent_str(indent), depth(depth), fill(0), capacity(sizeof(inplace)),
+        buffer(inplace), err(FPTU_SUCCESS), indented(false) {}
+  emitter(std::string &sink, const string_view &indent, unsigned depth)
+      : output_ctx(nullptr), output(nullptr), sink(&sink), indent_str(indent),
+        depth(depth), fill(sink.size()), capacity(0), buffer(nullptr),
+        err(FPTU_SUCCESS), indented(false) {
+    grow(sizeof(inplace));
+  }
   emitter(const emitter &) = delete;
   emitter &operator=(const emitter &) = delete;
 
   fptu_error flush();
+  void grow(size_t space);
   fptu_error push(size_t length, const char *text);
   void push(const string_view &str) { push(str.length(), str.data()); }
   void push(const char byte);
@@ -98,11 +110,11 @@ struct emitter {
 
   template <typename... Args>
   void format(size_t max_width, const char *format, Args... args) {
-    assert(max_width > 0 && max_width < sizeof(buffer));
+    assert(max_width > 0 && max_width < sizeof(inplace));
     const int n = snprintf(wanna(max_width), max_width, format, args...);
     assert(n > 0 && n < (int)max_width);
     fill += std::max(0, n) /* paranoia for glibc < 2.0.6 */;
-    assert(fill < sizeof(buffer) - 1);
+    assert(fill < capacity);
   }
 };
 #ifdef _MSC_VER
@@ -110,8 +122,13 @@ struct emitter {
 #endif
 
 fptu_error emitter::flush() {
-  assert(fill <= sizeof(buffer));
-  if (likely(fill)) {
+  assert(fill <= capacity);
+  if (sink) {
+    /* отрезаем неиспользованный резерв */
+    sink->resize(fill);
+    buffer = &(*sink)[0];
+    capacity = fill;
+  } else if (likely(fill)) {
     if (likely(err == FPTU_SUCCESS))
       err = (fptu_error)output(output_ctx, buffer, fill);
     fill = 0;
@@ -119,6 +136,15 @@ fptu_error emitter::flush() {
   return err;
 }
 
+void emitter::grow(size_t space) {
+  assert(sink != nullptr);
+  /* Резервируем место порциями, а геометрический рост ёмкости обеспечивает
+   * сам std::string. Так обнуляется только действительно добавляемый хвост. */
+  sink->resize(fill + std::max(space + 1, size_t(256)));
+  buffer = &(*sink)[0];
+  capacity = sink->size();
+}
+
 void emitter::space() {
   // assume no spaces are required if no indentation
   if (!indent_str.empty())
@@ -149,17 +175,22 @@ void emitter::indent(void) {
 
 fptu_error emitter::push(size_t length, const char *text) {
   assert(strnlen(text, length) == length);
-  assert(fill < sizeof(buffer));
-  if (likely(length < sizeof(buffer))) {
+  assert(fill < capacity);
+  if (sink) {
+    if (unlikely(length >= capacity - fill))
+      grow(length);
+    memcpy(buffer + fill, text, length);
+    fill += length;
+  } else if (likely(length < capacity)) {
     if (likely(length > 0)) {
-      const size_t space = sizeof(buffer) - fill;
+      const size_t space = capacity - fill;
       const size_t chunk = (length > space) ? space : length;
       memcpy(buffer + fill, text, chunk);
-      fill += (unsigned)chunk;
-      if (fill == sizeof(buffer)) {
+      fill += chunk;
+      if (fill == capacity) {
         flush();
-        fill = (unsigned)(length - chunk);
-        assert(fill < sizeof(buffer));
+        fill = length - chunk;
+        assert(fill < capacity);
         memcpy(buffer, text + chunk, fill);
       } else {
         assert(chunk == length);
@@ -174,17 +205,25 @@ fptu_error emitter::push(size_t length, const char *text) {
 }
 
 void emitter::push(const char byte) {
-  assert(fill < sizeof(buffer));
+  assert(fill < capacity);
   buffer[fill] = byte;
-  if (++fill == sizeof(buffer))
-    flush();
+  if (unlikely(++fill == capacity)) {
+    if (sink)
+      grow(1);
+    else
+      flush();
+  }
 }
 
 char *emitter::wanna(size_t space) {
-  assert(fill < sizeof(buffer));
-  assert(space < sizeof(buffer));
-  if (space >= sizeof(buffer) - fill)
-    flush();
+  assert(fill < capacity);
+  assert(space < sizeof(inplace));
+  if (space >= capacity - fill) {
+    if (sink)
+      grow(space);
+    else
+      flush();
+  }
   return buffer + fill;
 }
 
@@ -195,7 +234,7 @@ void emitter::number(uint32_t u32) {
   char *const begin = wanna(10);
   char *const end = erthink::u2a(u32, begin);
   assert(end > begin && end <= begin + 10);
-  fill += static_cast<unsigned>(end - begin);
+  fill += static_cast<size_t>(end - begin);
 }
 
 void emitter::number(int32_t i32) {
@@ -203,7 +242,7 @@ void emitter::number(int32_t i32) {
   char *const begin = wanna(11);
   char *const end = erthink::i2a(i32, begin);
   assert(end > begin && end <= begin + 10);
-  fill += static_cast<unsigned>(end - begin);
+  fill += static_cast<size_t>(end - begin);
 }
 
 void emitter::number(uint64_t u64) {
@@ -211,7 +250,7 @@ void emitter::number(uint64_t u64) {
   char *const begin = wanna(20);
   char *const end = erthink::u2a(u64, begin);
   assert(end > begin && end <= begin + 20);
-  fill += static_cast<unsigned>(end - begin);
+  fill += static_cast<size_t>(end - begin);
 }
 
 void emitter::number(int64_t i64) {
@@ -219,7 +258,7 @@ void emitter::number(int64_t i64) {
   char *const begin = wanna(20);
   char *const end = erthink::i2a(i64, begin);
   assert(end > begin && end <= begin + 20);
-  fill += static_cast<unsigned>(end - begin);
+  fill += static_cast<size_t>(end - begin);
 }
 
 void emitter::number(double value) {
@@ -227,7 +266,7 @@ void emitter::number(double value) {
   char *const begin = wanna(24);
   char *const end = erthink::d2a_accurate(value, begin);
   assert(end > begin && end <= begin + 32);
-  fill += static_cast<unsigned>(end - begin);
+  fill += static_cast<size_t>(end - begin);
 }
 
 //----------------------------------------------------------------------------
@@ -245,6 +284,10 @@ struct json : public emitter {
   const fptu_tag2name_func tag2name;
   const fptu_value2enum_func value2enum;
   const fptu_json_options options;
+  /* Предварительно подготовленная таблица имен, индексируемая номерами
+   * колонок. Если задана, то используется вместо обратного вызова tag2name. */
+  const char *const *const names;
+  const size_t names_count;
 
   enum { ObjectName_colnum = 0, ObjectValue_colnum = 1 };
 
@@ -252,10 +295,25 @@ struct json : public emitter {
        unsigned depth, const void *schema_ctx, fptu_tag2name_func tag2name,
        fptu_value2enum_func value2enum, const fptu_json_options options)
       : emitter(output, output_ctx, indent, depth), schema_ctx(schema_ctx),
-        tag2name(tag2name), value2enum(value2enum), options(options) {}
+        tag2name(tag2name), value2enum(value2enum), options(options),
+        names(nullptr), names_count(0) {}
+  json(std::string &sink, const string_view &indent, unsigned depth,
+       const char *const *names, size_t names_count, const void *schema_ctx,
+       fptu_value2enum_func value2enum, const fptu_json_options options)
+      : emitter(sink, indent, depth), schema_ctx(schema_ctx), tag2name(nullptr),
+        value2enum(value2enum), options(options), names(names),
+        names_count(names_count) {}
   json(const json &) = delete;
   json &operator=(const json &) = delete;
 
+  const char *tag_name(unsigned tag) const {
+    if (names) {
+      const unsigned colnum = fptu_get_colnum(tag);
+      return likely(colnum < names_count) ? names[colnum] : nullptr;
+    }
+    return tag2name ? tag2name(schema_ctx, tag) : nullptr;
+  }
+
   bool is_json5() const {
     return (options & fptu_json_disable_JSON5) ? false : true;
   }
@@ -486,8 +544,8 @@ void json::value_dateime(const fptu_time &value) {
       erthink::grisu::fractional_printer printer(ptr, ptr + reserve_space);
       erthink::grisu::convert(
           printer, erthink::grisu::diy_fp::fixedpoint(value.fractional, -32));
-      fill += unsigned(printer.finalize_and_get().second - ptr);
-      assert(fill < sizeof(buffer));
+      fill += size_t(printer.finalize_and_get().second - ptr);
+      assert(fill < capacity);
     }
     push('"');
   } else
@@ -696,7 +754,7 @@ void json::tuple(const fptu_ro &tuple) {
     if (bitmask.test_and_set(i->tag))
       continue;
 
-    const char *name = tag2name ? tag2name(schema_ctx, i->tag) : nullptr;
+    const char *name = tag_name(i->tag);
     if (name && unlikely(*name == '\0')) {
       // пропускаем скрытое поле
       continue;
@@ -806,6 +864,17 @@ int tuple2json(const fptu_ro &tuple, fptu_emit_func output, void *output_ctx,
   return out.flush();
 }
 
+int tuple2json(const fptu_ro &tuple, std::string &out,
+               const string_view &indent, unsigned depth,
+               const char *const *names, size_t names_count,
+               const void *schema_ctx, fptu_value2enum_func value2enum,
+               const fptu_json_options options) {
+  json sink(out, indent, depth, names, names_count, schema_ctx, value2enum,
+            options);
+  sink.tuple(tuple);
+  return sink.flush();
+}
+
 static int emit2stream(void *emiter_ctx, const char *text, size_t length) {
   assert(strnlen(text, length) == length);
   std::ostream *stream = static_cast<std::ostream *>(emiter_ctx);
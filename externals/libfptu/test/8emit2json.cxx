@@ -1029,6 +1029,60 @@ TEST(SchemaDict, SchemaOfSchema) {
 
 //------------------------------------------------------------------------------
 
+static const char *const names4colnum[] = {"zero", "one", nullptr, "",
+                                           "four", "five"};
+
+static const char *names_table_tag2name(const void *schema_ctx, unsigned tag) {
+  (void)schema_ctx;
+  const unsigned colnum = fptu_get_colnum(tag);
+  return (colnum < FPT_ARRAY_LENGTH(names4colnum)) ? names4colnum[colnum]
+                                                    : nullptr;
+}
+
+TEST(Emit, NamesTableIntoString) {
+  fptu::tuple_ptr pt(fptu_rw::create(67, 12345));
+  ASSERT_NE(nullptr, pt.get());
+
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint32(pt.get(), 0, 42));
+  EXPECT_EQ(FPTU_OK, fptu_insert_int64(pt.get(), 1, -1234567890123));
+  EXPECT_EQ(FPTU_OK, fptu_insert_fp64(pt.get(), 2, 3.1415926535897932));
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint64(pt.get(), 3, 1) /* hidden */);
+  const std::string long_string(777, '#');
+  EXPECT_EQ(FPTU_OK, fptu_insert_string(pt.get(), 4, long_string));
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint64(pt.get(), 5, 18446744073709551614u));
+  EXPECT_EQ(FPTU_OK, fptu_insert_int32(pt.get(), 6, -42));
+  EXPECT_EQ(FPTU_OK, fptu_insert_string(pt.get(), 1, "\"quoted\"\n"));
+  ASSERT_STREQ(nullptr, fptu::check(pt.get()));
+
+  for (const char *indent : {(const char *)nullptr, "  "}) {
+    const std::string reference = fptu::tuple2json(
+        fptu_take_noshrink(pt.get()), indent, 0, nullptr, names_table_tag2name,
+        nullptr);
+
+    // результат должен дописываться в конец строки
+    std::string fast("prefix");
+    EXPECT_EQ(FPTU_OK,
+              fptu::tuple2json(fptu_take_noshrink(pt.get()), fast, indent, 0,
+                               names4colnum, FPT_ARRAY_LENGTH(names4colnum)));
+    EXPECT_EQ("prefix" + reference, fast);
+
+    // повторный вывод в ту же строку
+    EXPECT_EQ(FPTU_OK,
+              fptu::tuple2json(fptu_take_noshrink(pt.get()), fast, indent, 0,
+                               names4colnum, FPT_ARRAY_LENGTH(names4colnum)));
+    EXPECT_EQ("prefix" + reference + reference, fast);
+  }
+
+  std::string json;
+  EXPECT_EQ(FPTU_OK, fptu::tuple2json(fptu_take_noshrink(pt.get()), json,
+                                      nullptr, 0, names4colnum, 2));
+  EXPECT_EQ(std::string::npos, json.find("four"));
+  const unsigned tag4 = fptu::make_tag(4, fptu_cstr);
+  EXPECT_NE(std::string::npos, json.find(fptu::format("\"@%u\"", tag4)));
+}
+
+//------------------------------------------------------------------------------
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
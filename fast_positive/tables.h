@@ -238,7 +238,11 @@ enum fpta_bits {
    *
    * Ограничение можно немного "подвинуть" за счет производительности,
    * но нельзя убрать полностью. Также будет рассмотрен вариант перехода
-   * на 128-битный хэш. */
+   * на 128-битный хэш.
+   *
+   * Для отдельных индексов строк и бинарных данных ограничение можно
+   * увеличить вплоть до допустимого libmdbx размера ключа, сохраняя длинные
+   * ключи точно и без хэширования, см. fpta_describe_key_length(). */
   fpta_max_keylen = 64 * 1 - 8,
 
   /* Размер буфера достаточный для размещения любого ключа во внутреннем
@@ -246,6 +250,12 @@ enum fpta_bits {
    * fpta_get_column2buffer() для формирование fpta_value составной колонки. */
   fpta_keybuf_len = fpta_max_keylen + 8 + sizeof(void *) + sizeof(size_t),
 
+  /* Максимальное кол-во префиксов в словаре для сжатия ключей индекса
+   * и максимальная длина одного префикса в байтах,
+   * см. fpta_describe_key_prefixes(). */
+  fpta_max_key_prefixes = 127,
+  fpta_max_key_prefix_length = 32,
+
   /* Минимальная длина имени/идентификатора */
   fpta_name_len_min = 1,
   /* Максимальная длина имени/идентификатора */
@@ -366,6 +376,7 @@ enum fpta_error {
   FPTA_EBUSY = 170 /* ERROR_BUSY */,
   FPTA_ENAME = 123 /* ERROR_INVALID_NAME */,
   FPTA_EFLAG = 186 /* ERROR_INVALID_FLAG_NUMBER */,
+  FPTA_ETIMEDOUT = 1460 /* ERROR_TIMEOUT */,
 #else
   FPTA_ENOMEM = ENOMEM /* Out of Memory (POSIX) */,
   FPTA_ENOIMP = ENOSYS /* Function not implemented (POSIX) */,
@@ -391,6 +402,7 @@ enum fpta_error {
 #else
   FPTA_EFLAG = FPTA_EINVAL,
 #endif
+  FPTA_ETIMEDOUT = ETIMEDOUT /* Connection timed out (POSIX) */,
 #endif
 
   /************************************************* MDBX's error codes ***/
@@ -894,11 +906,11 @@ typedef enum fpta_durability {
              * Достаточно быстрый режим, но с риском потери последних
              * изменений при аварии.
              *
-             * FIXME: Скорректировать описание после перехода на версию libmdbx
-             * с "догоняющей" фиксацией.
-             *
-             * Периодически формируются сильные точки фиксации. В случае
-             * системной аварии могут быть потеряны последние транзакции.
+             * Сильные точки фиксации формируются только при явной
+             * синхронизации и при закрытии БД. В случае системной аварии
+             * могут быть потеряны последние транзакции, причем их количество
+             * ничем не ограничено. Для ограничения отставания последней
+             * сильной точки следует использовать режим fpta_async.
              *
              * Производительность по записи в основном определяется
              * скоростью диска, порядка 50K TPS для SSD. */
@@ -919,6 +931,20 @@ typedef enum fpta_durability {
              * Производительность по записи в основном определяется скоростью
              * CPU и RAM (более 100K TPS). */
   ,
+
+  fpta_async /* Асинхронный режим с "догоняющей" фиксацией.
+              * Пишущие транзакции фиксируются без ожидания записи на диск,
+              * как в режиме fpta_lazy, а внутренний фоновый поток формирует
+              * сильные точки фиксации так, чтобы отставание последней из них
+              * от последней зафиксированной транзакции не превышало заданных
+              * посредством fpta_db_async_lag() пределов по объему и времени.
+              *
+              * В случае системной аварии могут быть потеряны только
+              * транзакции в пределах этого отставания.
+              *
+              * Производительность по записи в основном определяется
+              * скоростью CPU и RAM, а не задержками диска. */
+  ,
 } fpta_durability;
 
 /* Дополнительные флаги для оптимизации работы БД.
@@ -1079,6 +1105,22 @@ typedef struct fpta_db_stat {
   fpta_regime_flags regime_flags; /* актуальный режим работы с учетом всех
                                      работающих с БД проецссов */
   bool alterable_schema /* возможность изменять схему БД в текущем процессе */;
+
+  struct {
+    uint64_t capacity; /* количество элементов, 0 если кэш выключен */
+    uint64_t hits;     /* количество попаданий */
+    uint64_t misses;   /* количество промахов */
+    uint64_t evictions; /* количество замещений ранее заполненных элементов */
+  } row_cache /* статистика кэша строк, см fpta_db_row_cache() */;
+
+  struct {
+    uint64_t lag_bytes; /* допустимый объём несинхронизированных изменений */
+    uint32_t lag_period_seconds16dot16; /* допустимое время с момента последней
+                                           синхронизации в 1/65536 секунды */
+    uint64_t flushes; /* количество выполненных фоновых синхронизаций */
+    int last_error;   /* результат последней фоновой синхронизации */
+  } async /* состояние фоновой синхронизации в режиме fpta_async, текущее
+             отставание см. в unsync_volume и since_sync_seconds16dot16 */;
 } fpta_db_stat_t;
 
 /* Возвращает информацию о БД, включая геометрию.
@@ -1140,6 +1182,138 @@ static inline int fpta_db_open_existing(const char *path,
  * В случае успеха возвращает ноль, иначе код ошибки. */
 FPTA_API int fpta_db_close(fpta_db *db);
 
+/* Пределы отставания сильной точки фиксации по-умолчанию для режима
+ * fpta_async, см. fpta_db_async_lag(). */
+enum fpta_async_defaults {
+  fpta_async_lag_bytes_default = 16 << 20,
+  fpta_async_lag_milliseconds_default = 500
+};
+
+/* Задает пределы отставания последней сильной точки фиксации от последней
+ * зафиксированной транзакции для БД открытой в режиме fpta_async.
+ *
+ * Фоновый поток формирует сильную точку фиксации, как только объём
+ * несинхронизированных с диском изменений достигнет lag_bytes, либо
+ * с момента предыдущей синхронизации пройдет lag_milliseconds. Нулевое
+ * значение отключает соответствующий критерий, но хотя-бы один из них
+ * должен быть задан. Проверка выполняется периодически, поэтому пределы
+ * соблюдаются приблизительно, с точностью до четверти lag_milliseconds
+ * (но не более 100 миллисекунд).
+ *
+ * Для БД открытой в других режимах возвращает FPTA_EFLAG.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_db_async_lag(fpta_db *db, size_t lag_bytes,
+                               unsigned lag_milliseconds);
+
+/* Ожидает сохранения на диске версии данных version, полученной посредством
+ * fpta_transaction_end_ex() или fpta_transaction_versions().
+ *
+ * Функция позволяет получить гарантию сохранности изменений выборочно, только
+ * для тех транзакций, которым это действительно требуется, при открытии БД
+ * в режимах fpta_lazy, fpta_weak или fpta_async. Версия считается сохраненной,
+ * когда её покрывает сильная точка фиксации. Если такой точки еще нет, то
+ * один из ожидающих потоков выполняет синхронизацию с диском, а остальные
+ * ждут её завершения. Таким образом, одновременные ожидания объединяются
+ * в одну операцию записи на диск.
+ *
+ * Аргумент timeout_milliseconds ограничивает время ожидания синхронизации,
+ * выполняемой другим потоком, при его исчерпании возвращается FPTA_ETIMEDOUT.
+ * Синхронизация, начатая текущим потоком, по таймауту не прерывается.
+ *
+ * В режиме fpta_weak полученная гарантия действует только до последующих
+ * фиксаций, так как в этом режиме сильные точки фиксации стираются.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_db_wait_durable(fpta_db *db, uint64_t version,
+                                  unsigned timeout_milliseconds);
+
+/* Включает, изменяет размер или выключает кэш строк для точечных чтений
+ * по первичному ключу посредством fpta_get().
+ *
+ * Кэш ограничен по размеру, хранит указатели на строки внутри БД (без
+ * копирования) и используется только транзакциями чтения. Элементы кэша
+ * сопоставляются с версией таблицы в MVCC-снимке читающей транзакции, поэтому
+ * фиксация любой транзакции изменяющей таблицу неявно инвалидирует все
+ * закэшированные строки этой таблицы. Точечные чтения по уникальному
+ * вторичному индексу также используют кэш на этапе поиска по первичному ключу.
+ *
+ * Аргумент max_rows задает желаемое количество элементов кэша, которое
+ * округляется вверх до степени двойки, а нулевое значение выключает кэш.
+ * Статистика попаданий доступна через fpta_db_info(). Кэш организован
+ * с прямым отображением, поэтому выигрыш по сравнению с поиском в B-дереве
+ * достигается при количестве элементов в несколько раз больше рабочего
+ * набора строк, иначе большая часть обращений приходится на вытесненные
+ * элементы и кэш только добавляет накладные расходы.
+ *
+ * ВАЖНО: Функция не является потоко-безопасной по отношению к другим
+ *        операциям с БД и должна вызываться при отсутствии транзакций.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_db_row_cache(fpta_db *db, size_t max_rows);
+
+/* Точки измерения задержек (латентности) операций, см. fpta_db_latency(). */
+typedef enum fpta_latency_point {
+  fpta_latency_begin /* fpta_transaction_begin() */,
+  fpta_latency_commit /* фиксация пишущей транзакции в fpta_transaction_end()
+                       * без учета времени синхронизации с диском */,
+  fpta_latency_sync /* синхронизация с диском при фиксации транзакции */,
+  fpta_latency_put /* fpta_put() и производные */,
+  fpta_latency_get /* fpta_get() и производные */,
+  fpta_latency_cursor_open /* fpta_cursor_open() */,
+  fpta_latency_cursor_move /* fpta_cursor_move() */,
+  fpta_latency_points_count
+} fpta_latency_point;
+
+/* Гистограмма задержек с логарифмической шкалой в стиле HDR: каждая
+ * степень двойки разбита на 8 равных интервалов, что дает погрешность
+ * не более 12.5%. Нижняя граница интервала в наносекундах возвращается
+ * функцией fpta_latency_bucket_lower(), а значения превышающие
+ * верхнюю границу шкалы (около 17 секунд) учитываются в последнем
+ * интервале. */
+enum { fpta_latency_buckets = 256 };
+typedef struct fpta_latency_histogram {
+  uint64_t count /* общее количество измерений */;
+  uint64_t total_ns /* суммарное время */;
+  uint64_t max_ns /* максимальное значение */;
+  uint64_t buckets[fpta_latency_buckets];
+} fpta_latency_histogram;
+
+/* Включает или выключает сбор гистограмм задержек для операций с БД.
+ *
+ * Гистограммы ведутся посегментно для разных потоков без блокировок,
+ * а при выключенном сборе накладные расходы сводятся к проверке одного
+ * флажка. Память под гистограммы выделяется при первом включении и
+ * освобождается при закрытии БД, а накопленные значения сохраняются
+ * при выключении сбора.
+ *
+ * Время синхронизации с диском при фиксации пишущих транзакций измеряется
+ * самой libmdbx (см. mdbx_txn_commit_ex()) с точностью около 15 мкс,
+ * поэтому сбор не меняет порядок фиксации и синхронизации. В режимах без
+ * синхронизации при фиксации её время оказывается близким к нулю.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_db_latency(fpta_db *db, bool enable);
+
+/* Обнуляет накопленные гистограммы задержек.
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_db_latency_reset(fpta_db *db);
+
+/* Возвращает накопленную гистограмму задержек для заданной точки измерения.
+ * Если сбор ни разу не включался, то возвращается пустая гистограмма.
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_db_latency_histogram(fpta_db *db, fpta_latency_point point,
+                                       fpta_latency_histogram *histogram);
+
+/* Возвращает нижнюю границу интервала гистограммы в наносекундах. */
+FPTA_API uint64_t fpta_latency_bucket_lower(unsigned bucket);
+
+/* Возвращает оценку квантиля (например 0.99 для p99) по гистограмме,
+ * т.е. верхнюю границу интервала в который попадает квантиль, но не более
+ * максимального значения. Для пустой гистограммы возвращает ноль. */
+FPTA_API uint64_t fpta_latency_quantile(const fpta_latency_histogram *histogram,
+                                        double quantile);
+
 /* Доступ к функционалу/API libmdbx (опорного движка libmdbx).
  *
  * Непрозрачные (opacity) структуры уровня libmdbx и функции
@@ -1291,6 +1465,24 @@ FPTA_API int fpta_transaction_begin(fpta_db *db, fpta_level level,
  *
  * В случае успеха возвращает ноль, иначе код ошибки. */
 FPTA_API int fpta_transaction_end(fpta_txn *txn, bool abort);
+
+/* Завершение транзакции с получением версии данных.
+ *
+ * Аналогично fpta_transaction_end(), но дополнительно возвращает
+ * в опциональный аргумент version версию данных (номер транзакции в терминах
+ * libmdbx), которая соответствует результату завершения транзакции:
+ *  - для зафиксированной пишущей транзакции это версия сформированного ею
+ *    снимка БД, т.е. значение, которое можно передать в fpta_db_wait_durable()
+ *    для ожидания сохранения изменений на диск;
+ *  - для читающей транзакции это версия прочитанного снимка.
+ *
+ * Для отмененной пишущей транзакции, а также при ошибке, в version
+ * возвращается ноль.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_transaction_end_ex(fpta_txn *txn, bool abort,
+                                     uint64_t *version);
+
 static __inline int fpta_transaction_commit(fpta_txn *txn) {
   return fpta_transaction_end(txn, false);
 }
@@ -1368,6 +1560,88 @@ FPTA_API int fpta_transaction_restart(fpta_txn *txn);
 FPTA_API int fpta_transaction_versions(fpta_txn *txn, uint64_t *db_version,
                                        uint64_t *schema_version);
 
+//----------------------------------------------------------------------------
+/* Групповая фиксация (group commit).
+ *
+ * При режиме fpta_sync каждое завершение пишущей транзакции сопровождается
+ * отдельной синхронизацией с диском, что ограничивает количество транзакций
+ * в секунду несколькими сотнями. Групповая фиксация позволяет множеству
+ * потоков передавать небольшие порции изменений в виде функций обратного
+ * вызова, которые выполняются одним фоновым потоком-писателем в рамках общей
+ * пишущей транзакции, фиксируемой однократно для всей группы.
+ *
+ * Каждая переданная функция получает пишущую транзакцию (уровня fpta_write) и
+ * свой аргумент, а по завершении группы отправитель получает собственный код
+ * результата:
+ *  - код ошибки возвращенный самой функцией, если она завершилась неудачно,
+ *    при этом сделанные ею изменения отменяются и не влияют на остальные
+ *    функции группы;
+ *  - код результата фиксации транзакции, т.е. ноль при успешной фиксации.
+ *
+ * ВАЖНО: Для изоляции неудачных функций изменения отменяются посредством
+ * отмены транзакции и повторного выполнения всех ранее успешных функций
+ * группы в новой транзакции, т.е. каждый раз от состояния БД до начала
+ * группы. Поэтому одна и та же функция может быть выполнена несколько раз
+ * и должна быть детерминированной: при повторном выполнении в том же
+ * состоянии БД делать те же изменения и возвращать тот же результат.
+ * Также функция не должна иметь побочных эффектов вне переданной
+ * транзакции (включая изменения собственного аргумента), не должна
+ * завершать транзакцию и использовать её после возврата управления.
+ *
+ * Если функция, успешно выполненная в первый раз, завершается неудачно при
+ * повторном выполнении, то она исключается из группы без применения её
+ * изменений, а отправитель получает FPTA_EOOPS.
+ *
+ * Количество повторных выполнений ограничено: после нескольких неудачных
+ * функций в одной группе уже выполненная часть группы фиксируется отдельной
+ * транзакцией, а оставшиеся функции выполняются в следующей. Таким образом,
+ * каждая функция выполняется не более нескольких раз, а затраты на изоляцию
+ * неудач растут линейно, а не квадратично. */
+typedef struct fpta_group_commit fpta_group_commit;
+typedef struct fpta_commit_ticket fpta_commit_ticket;
+typedef int (*fpta_group_commit_func)(fpta_txn *txn, void *arg);
+
+/* Создает экземпляр групповой фиксации и запускает поток-писатель.
+ *
+ * Аргумент max_batch ограничивает количество функций, объединяемых в одну
+ * транзакцию, ноль означает значение по-умолчанию.
+ *
+ * Экземпляр должен быть разрушен посредством fpta_group_commit_close()
+ * до закрытия БД.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_group_commit_open(fpta_db *db, size_t max_batch,
+                                    fpta_group_commit **pgc);
+
+/* Завершает групповую фиксацию: дожидается выполнения всех уже переданных
+ * функций, останавливает поток-писатель и разрушает экземпляр. До вызова
+ * все полученные квитанции должны быть обработаны посредством
+ * fpta_group_commit_wait().
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_group_commit_close(fpta_group_commit *gc);
+
+/* Передает функцию для выполнения в составе очередной группы, не дожидаясь
+ * её выполнения. Результат следует получить посредством вызова
+ * fpta_group_commit_wait() для возвращенной в ticket квитанции.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_group_commit_submit(fpta_group_commit *gc,
+                                      fpta_group_commit_func func, void *arg,
+                                      fpta_commit_ticket **ticket);
+
+/* Дожидается фиксации группы, в состав которой вошла функция, и разрушает
+ * квитанцию.
+ *
+ * Возвращает собственный код результата функции, см. описание выше. */
+FPTA_API int fpta_group_commit_wait(fpta_commit_ticket *ticket);
+
+/* Передает функцию и дожидается её выполнения, т.е. аналогична
+ * последовательным вызовам fpta_group_commit_submit() и
+ * fpta_group_commit_wait(). */
+FPTA_API int fpta_group_commit_execute(fpta_group_commit *gc,
+                                       fpta_group_commit_func func, void *arg);
+
 //----------------------------------------------------------------------------
 /* Управление схемой:
  *  - Под управлением схемой в libfpta подразумевается её изменение,
@@ -1612,6 +1886,9 @@ typedef struct fpta_column_set {
       ;
   fpta_shove_t shoves[fpta_max_cols] /* Упакованные описатели колонок. */;
   uint16_t composites[fpta_max_cols] /* Информация о составных колонках */;
+  void *options_ptr /* Указатель на внутренние данные с дополнительными
+                       опциями индексов, в том числе словарями префиксов */
+      ;
 } fpta_column_set;
 
 /* Вспомогательная функция, проверяет корректность имени */
@@ -1693,6 +1970,105 @@ FPTA_API int fpta_describe_composite_index_va(const char *composite_name,
                                               const char *second,
                                               const char *third, ...);
 
+/* Вспомогательная функция для включения сжатия ключей индекса.
+ *
+ * Задает для упорядоченного индекса колонки column_name статический словарь
+ * префиксов, посредством которого ключи сжимаются с сохранением порядка
+ * сортировки. Колонка уже должна быть добавлена в column_set, иметь
+ * упорядоченный индекс с обычным (obverse) порядком сравнения и тип
+ * fptu_cstr или fptu_opaque, либо быть составной колонкой.
+ *
+ * Если ключ начинается с одного из префиксов словаря, то в индекс вместо
+ * префикса попадает однобайтовый тег. Остальные ключи дополняются таким же
+ * тегом, но сохраняются полностью. Значения тегов упорядочены как и сами
+ * префиксы, поэтому порядок ключей и все поиски по диапазонам сохраняются.
+ * Таким образом, для значений с длинными общими началами (пути в URL,
+ * идентификаторы арендаторов в составных ключах и т.п.) в страницу индекса
+ * помещается больше ключей, а дерево становится ниже.
+ *
+ * Для составных колонок префиксы сопоставляются со значением первой из
+ * образующих колонок, а для nullable-колонок с самим значением (без
+ * внутреннего префикса not-null). Префиксы должны иметь длину от 1 до
+ * fpta_max_key_prefix_length байт, их количество не может превышать
+ * fpta_max_key_prefixes, а один префикс не может быть началом другого.
+ *
+ * ВАЖНО: При сжатии ключей точно сохраняются только первые fpta_max_keylen-1
+ * байт значения, а остаток заменяется хэшем. Кроме этого, для колонок со
+ * словарем fpta_cursor_key() и подобные функции возвращают значения ключей
+ * в виде fpta_shoved, которые можно использовать для поиска и задания
+ * диапазонов, но нельзя интерпретировать непосредственно.
+ *
+ * Словарь сохраняется в схеме таблицы и не может быть изменен после её
+ * создания. Таблицы со словарями не поддерживаются предыдущими версиями
+ * libfpta, которые будут считать такую схему поврежденной.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_describe_key_prefixes(const char *column_name,
+                                        fpta_column_set *column_set,
+                                        const char *const prefixes_array[],
+                                        size_t prefixes_count);
+
+/* Задает для индекса колонки собственное ограничение длины ключа.
+ *
+ * По-умолчанию длинные ключи упорядоченных индексов подрезаются до
+ * fpta_max_keylen байт с дополнением хэшем остатка, что нарушает порядок
+ * сортировки таких ключей и требует дополнительной проверки строк при
+ * поиске. После вызова этой функции ключи индекса колонки длиной
+ * до max_keylen байт сохраняются в индексе точно как есть, без подрезки
+ * и копирования, а значения большей длины отвергаются с ошибкой
+ * FPTA_DATALEN_MISMATCH как при вставке строк, так и при поиске.
+ *
+ * Допускается только для упорядоченных (прямых или реверсивных) индексов
+ * колонок типа fptu_cstr или fptu_opaque без признака nullable, а также
+ * без словаря префиксов (см. fpta_describe_key_prefixes()). Значение
+ * max_keylen должно быть больше fpta_max_keylen и не превышать
+ * допустимый libmdbx размер ключа для текущего размера страницы БД,
+ * см. mdbx_env_get_maxkeysize_ex(). Последнее проверяется при создании
+ * таблицы функцией fpta_table_create().
+ *
+ * Ограничение сохраняется в схеме таблицы и не может быть изменено после её
+ * создания. Такие таблицы не поддерживаются предыдущими версиями libfpta,
+ * которые будут считать схему поврежденной.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_describe_key_length(const char *column_name,
+                                      fpta_column_set *column_set,
+                                      size_t max_keylen);
+
+/* Задает хранение уникального неупорядоченного вторичного индекса колонки
+ * в виде расширяемой хэш-таблицы (extendible hashing) вместо B-дерева
+ * ключей.
+ *
+ * Записи такого индекса группируются в корзины по хэшу ключа, а каталог
+ * ссылается на корзины непосредственно номерами страниц БД. Поэтому
+ * точечный поиск читает корень каталога, его сегмент и одну корзину без
+ * спуска по B-дереву, т.е. не зависит от количества строк в таблице.
+ * Переполненная корзина расщепляется при вставке в неё, а каталог при
+ * необходимости удваивается. Однако каждое изменение индекса перезаписывает
+ * корзину целиком, а при первом изменении корзины в транзакции и ссылку
+ * на неё в каталоге, поэтому вставка и удаление медленнее, чем в B-дереве
+ * ключей.
+ *
+ * Курсор по такому индексу (только с fpta_unsorted) перебирает строки
+ * в порядке первичного ключа, поэтому fpta_cursor_key() возвращает
+ * значения первичного ключа, а границы диапазона в виде значения колонки
+ * заменяются значением первичного ключа строки с этим значением
+ * (либо дают пустую выборку при отсутствии такой строки). Аналогично
+ * fpta_estimate() оценивает диапазон по первичному индексу.
+ *
+ * Допускается только для уникальных неупорядоченных вторичных индексов,
+ * а номер колонки в отсортированной схеме таблицы должен быть меньше 64.
+ * Последнее проверяется при создании таблицы функцией fpta_table_create().
+ *
+ * Опция сохраняется в схеме таблицы и не может быть изменена после её
+ * создания. Схемы таких таблиц имеют отдельную сигнатуру, по которой
+ * предыдущие версии libfpta, в том числе поддерживающие другие опции
+ * индексов, отвергают их, считая схему поврежденной.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_describe_hash_index(const char *column_name,
+                                      fpta_column_set *column_set);
+
 /* Инициализирует column_set перед заполнением посредством
  * fpta_column_describe(). */
 FPTA_API void fpta_column_set_init(fpta_column_set *column_set);
@@ -1949,6 +2325,39 @@ FPTA_API int fpta_table_sequence(fpta_txn *txn, fpta_name *table_id,
 FPTA_API int fpta_table_clear(fpta_txn *txn, fpta_name *table_id,
                               bool reset_sequence);
 
+/* Перебирает строки таблицы, которые могли быть изменены после заданной
+ * версии данных, т.е. после фиксации транзакции с номером since_version
+ * (см. fpta_transaction_end_ex() и fpta_table_stat::mod_txnid).
+ *
+ * Функция опирается на то, что страницы B-дерева в libmdbx копируются при
+ * изменении (copy-on-write) вместе со всем путем от корня и помечаются
+ * номером изменившей их транзакции. Поэтому поддеревья, страницы которых не
+ * изменялись после since_version, пропускаются без чтения, а затраты
+ * пропорциональны объему изменений, а не размеру таблицы.
+ *
+ * Каждая строка из измененных листовых страниц первичного индекса передается
+ * функтору visitor вместе с параметрами visitor_context и visitor_arg "как
+ * есть". Функтор может прервать перебор, вернув ненулевое значение, которое
+ * тогда будет возвращено в качестве результата. Опциональный параметр count
+ * получает количество строк переданных функтору.
+ *
+ * ВАЖНО: Точность ограничена гранулярностью страниц, поэтому функтору
+ * передаются ВСЕ строки измененных страниц, в том числе неизменные соседи
+ * измененных строк, а также строки затронутые перебалансировкой дерева.
+ * Кроме этого, удаленные строки НЕ передаются, так как их уже нет в таблице.
+ * Для получения точного перечня изменений следует использовать журнал
+ * изменений, см. fpta_db_changelog().
+ *
+ * Аргумент table_id перед первым использованием должен быть инициализирован
+ * посредством fpta_table_init(). Однако, предварительный вызов
+ * fpta_name_refresh() не обязателен.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_table_changes_since(
+    fpta_txn *txn, fpta_name *table_id, uint64_t since_version, size_t *count,
+    int (*visitor)(const fptu_ro *row, void *context, void *arg),
+    void *visitor_context, void *visitor_arg);
+
 /* Расширенная информация о таблице, включая оценочные значения стоимости
  * операций поиска и обновления, как для таблицы в целом, так и для каждого
  * индекса.
@@ -2272,6 +2681,34 @@ FPTA_API const char *fpta_schema2json_value2enum(const void *schema_ctx,
  * не была инициализирована или уже разрушена. */
 FPTA_API int fpta_schema_destroy(fpta_schema_info *info);
 
+/* Таблица символических имен колонок таблицы для быстрой сериализации строк
+ * в JSON, см. fpta_table_export_json().
+ *
+ * Строится однократно по описанию схемы, полученному от fpta_schema_fetch(),
+ * после чего может многократно использоваться без повторных обращений
+ * к словарю схемы. Экземпляр не зависит от fpta_schema_info и может
+ * использоваться после его разрушения, а также из разных потоков. */
+typedef struct fpta_json_names fpta_json_names;
+
+/* Строит таблицу имен колонок для таблицы table_id.
+ *
+ * Аргумент table_id должен быть получен из fpta_schema_info::tables_names,
+ * либо предварительно обновлен посредством fpta_name_refresh() в контексте
+ * той же (или более ранней) версии схемы, что и info.
+ *
+ * По завершению использования таблица имен должна быть разрушена посредством
+ * fpta_json_names_destroy(), в противном случае будет утечка памяти.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_json_names_build(const fpta_schema_info *info,
+                                   const fpta_name *table_id,
+                                   fpta_json_names **names);
+
+/* Деструктор fpta_json_names.
+ * В случае успеха возвращает ноль, либо FPTA_EINVAL если переданный экземпляр
+ * не был инициализирован или уже разрушен. */
+FPTA_API int fpta_json_names_destroy(fpta_json_names *names);
+
 //----------------------------------------------------------------------------
 /* Управление фильтрами. */
 
@@ -2620,6 +3057,45 @@ FPTA_API int fpta_cursor_info(fpta_cursor *cursor, fpta_cursor_stat *stat);
  * В случае успеха возвращает ноль, иначе код ошибки. */
 FPTA_API int fpta_cursor_reset_accounting(fpta_cursor *cursor);
 
+/* Элемент снимка счетчиков операций БД, см. fpta_db_metrics(). */
+typedef struct fpta_metrics_item {
+  fpta_shove_t table_shove /* значение fpta_name::shove для таблицы */;
+  fpta_shove_t index_shove /* значение fpta_name::shove для колонки
+                            * индекса после актуализации идентификатора */;
+  fpta_cursor_stat stat /* накопленные счетчики операций */;
+} fpta_metrics_item;
+
+/* Возвращает снимок счетчиков операций в разрезе таблиц и индексов.
+ *
+ * Счетчики ведутся постоянно для всех транзакций и потоков работающих с БД
+ * через заданный экземпляр fpta_db. Учитываются как операции курсоров
+ * (при закрытии курсора и при сбросе его статистики), так и операции без
+ * курсоров: fpta_get() и производные, fpta_put() и производные, а также
+ * fpta_delete(). Операции изменения учитываются по первичному индексу
+ * таблицы, а точечные чтения по индексу использованной колонки. Для получения
+ * сводных значений по таблице следует просуммировать элементы с одинаковым
+ * table_shove.
+ *
+ * Количество одновременно учитываемых пар (таблица, индекс) ограничено
+ * несколькими сотнями. Операции с парами, не поместившимися в каталог,
+ * учитываются в элементе "прочие" с нулевыми table_shove и index_shove,
+ * который присутствует в снимке только при ненулевых счетчиках. Счетчики
+ * удаленных таблиц сбрасываются, а занятые ими места в каталоге
+ * освобождаются при фиксации транзакции, удалившей таблицу.
+ *
+ * На входе count задает размер массива items, а на выходе количество
+ * элементов снимка. Если размера массива недостаточно, то заполняются только
+ * первые элементы и возвращается FPTA_DATALEN_MISMATCH, а в count требуемый
+ * размер. Таким образом, при нулевом count можно узнать требуемый размер.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_db_metrics(fpta_db *db, fpta_metrics_item *items,
+                             size_t *count);
+
+/* Обнуляет счетчики операций БД, см. fpta_db_metrics().
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_db_metrics_reset(fpta_db *db);
+
 /* Реализует применение паттерна "visitor" к выборке из таблицы.
  *
  * Используя параметры txn, column_id, range_from, range_to, filter и op
@@ -2681,6 +3157,92 @@ int fpta_apply_visitor(
     size_t *count, int (*visitor)(const fptu_ro *row, void *context, void *arg),
     void *visitor_context, void *visitor_arg);
 
+/* Выгружает строки из диапазона курсора в формате NDJSON, т.е. по одному
+ * JSON-объекту на строку текста.
+ *
+ * Назначение параметров txn, column_id, range_from, range_to, filter и op
+ * аналогично fpta_cursor_open(). Для трансляции номеров колонок в имена
+ * используется таблица names, предварительно подготовленная посредством
+ * fpta_json_names_build(). Сериализация производится без обратных вызовов для
+ * каждого поля непосредственно в промежуточный буфер, содержимое которого
+ * выталкивается в функцию output порциями около 64 Кб.
+ *
+ * Если схема таблицы была изменена после построения names, то возвращается
+ * FPTA_SCHEMA_CHANGED. Если names построена для другой таблицы, то
+ * возвращается FPTA_EINVAL.
+ *
+ * При ненулевом count в него будет записано количество выгруженных строк.
+ *
+ * В случае успеха, в том числе при отсутствии строк в выборке, возвращает
+ * ноль, иначе код ошибки, включая ненулевой результат полученный от output. */
+FPTA_API int fpta_table_export_json(fpta_txn *txn, fpta_name *column_id,
+                                    fpta_value range_from,
+                                    fpta_value range_to, fpta_filter *filter,
+                                    fpta_cursor_options op,
+                                    const fpta_json_names *names,
+                                    fptu_emit_func output, void *output_ctx,
+                                    size_t *count);
+
+/* Функция ввода для fpta_table_restore(), которая должна поместить в buffer
+ * ровно length байт из входного потока. В случае успеха должна возвращать
+ * ноль, иначе код ошибки, в том числе FPTA_NODATA при преждевременном
+ * достижении конца потока. */
+typedef int (*fpta_input_func)(void *input_ctx, void *buffer, size_t length);
+
+/* Выгружает все строки таблицы в компактном двоичном формате.
+ *
+ * Выгрузка начинается с заголовка, содержащего описание схемы таблицы
+ * (shove всех колонок и составных индексов, а также опции индексов, заданные
+ * посредством fpta_describe_key_prefixes(), fpta_describe_key_length()
+ * и fpta_describe_hash_index()), за которым следуют кадры со
+ * строками в порядке первичного индекса. Каждая строка представлена длиной
+ * и кортежем fptu "как есть", без какого-либо преобразования. Заголовок
+ * и каждый кадр размером около 64 Кб передаются в функцию output отдельными
+ * порциями, что позволяет направлять выгрузку непосредственно в канал (pipe)
+ * или сокет. Завершается выгрузка пустым кадром.
+ *
+ * Числа в заголовке и кадрах записываются в порядке little-endian, однако
+ * кортежи fptu сохраняются в представлении текущей платформы. Поэтому формат
+ * предназначен для резервного копирования и переноса таблиц между БД, но не
+ * для обмена данными между платформами с разным порядком байт. Выгрузка
+ * производится в рамках транзакции txn, поэтому различные таблицы могут
+ * выгружаться параллельно в читающих транзакциях разных потоков.
+ *
+ * При ненулевом count в него будет записано количество выгруженных строк.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки, включая ненулевой
+ * результат полученный от output. */
+FPTA_API int fpta_table_dump(fpta_txn *txn, fpta_name *table_id,
+                             fptu_emit_func output, void *output_ctx,
+                             size_t *count);
+
+/* Загружает строки в таблицу из выгрузки сделанной fpta_table_dump().
+ *
+ * Целевая таблица должна быть пустой и иметь совпадающие колонки, индексы
+ * и их опции, но может иметь другое имя. Иначе возвращается FPTA_EEXIST или
+ * FPTA_SCHEMA_CHANGED соответственно, до каких-либо изменений в БД. Данные
+ * читаются последовательно посредством функции input, поэтому могут
+ * поступать непосредственно из канала (pipe) или сокета.
+ *
+ * Так как строки в выгрузке следуют в порядке первичного индекса, то они
+ * добавляются в конец дерева посредством MDBX_APPEND, без поиска места для
+ * вставки. Вторичные индексы строятся пакетно после загрузки всех строк:
+ * пары ключей накапливаются в памяти, сортируются и также добавляются в конец
+ * деревьев. Поэтому требуется дополнительная память, пропорциональная
+ * суммарному размеру ключей вторичных индексов.
+ *
+ * Загрузка производится в рамках пишущей транзакции txn. При возникновении
+ * ошибки после начала изменения данных транзакция будет отменена.
+ *
+ * При ненулевом count в него будет записано количество загруженных строк.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки, включая ненулевой
+ * результат полученный от input. Для поврежденной или некорректной выгрузки
+ * возвращается FPTA_EVALUE. */
+FPTA_API int fpta_table_restore(fpta_txn *txn, fpta_name *table_id,
+                                fpta_input_func input, void *input_ctx,
+                                size_t *count);
+
 /* Проверяет наличие за курсором данных.
  *
  * Отсутствие данных означает, что нет возможности их прочитать, изменить
@@ -2838,6 +3400,62 @@ FPTA_API int fpta_cursor_key(fpta_cursor *cursor, fpta_value *key);
 FPTA_API int fpta_get(fpta_txn *txn, fpta_name *column_id,
                       const fpta_value *column_value, fptu_ro *row);
 
+/* Пакетный вариант fpta_get() для набора из count значений.
+ *
+ * Значения нормализуются в ключи и упорядочиваются в порядке индекса, после
+ * чего поиск выполняется последовательным проходом одним курсором. Для
+ * вторичного индекса аналогично выполняется второй проход по первичному
+ * ключу. Это заметно дешевле count независимых вызовов fpta_get(), так как
+ * для близких ключей не требуется спуск от корня B-дерева.
+ *
+ * Результаты возвращаются в порядке исходных значений: в rows[i] строка для
+ * column_values[i], в errors[i] код результата для этого значения, например
+ * FPTA_NOTFOUND если строка не найдена или FPTA_ETYPE при несоответствии
+ * типа значения. Повторяющиеся значения допустимы.
+ *
+ * Возвращает ноль если все строки найдены, первый (в порядке исходных
+ * значений) ненулевой код из errors[] при отсутствии части строк, либо код
+ * ошибки не связанной с отдельными значениями. */
+FPTA_API int fpta_get_many(fpta_txn *txn, fpta_name *column_id,
+                           const fpta_value column_values[], size_t count,
+                           fptu_ro rows[], int errors[]);
+
+/* Подготовленный (привязанный к колонке) дескриптор для точечных чтений,
+ * см. fpta_prepare_get() и fpta_get_prepared(). */
+typedef struct fpta_prepared_get fpta_prepared_get;
+
+/* Создает подготовленный дескриптор для многократных точечных чтений по
+ * заданной колонке.
+ *
+ * В отличие от fpta_get(), при каждом вызове которой повторяется проверка
+ * и актуализация column_id, а также поиск dbi-хендлов, в подготовленном
+ * дескрипторе всё это выполняется однократно. Повторная привязка производится
+ * автоматически, только при изменении версии схемы (schema_tsn).
+ *
+ * Указанная посредством column_id колонка должна иметь индекс с контролем
+ * уникальности. Экземпляр column_id (и соответствующей таблицы) используется
+ * дескриптором, поэтому не должен разрушаться до fpta_prepared_get_destroy().
+ *
+ * Дескриптор может использоваться в разных транзакциях, но не одновременно
+ * из нескольких потоков.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_prepare_get(fpta_txn *txn, fpta_name *column_id,
+                              fpta_prepared_get **prepared);
+
+/* Возвращает одну строку с соответствующим значением в привязанной
+ * к подготовленному дескриптору колонке. Семантика и возвращаемые коды
+ * аналогичны fpta_get().
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_get_prepared(fpta_txn *txn, fpta_prepared_get *prepared,
+                               const fpta_value *column_value, fptu_ro *row);
+
+/* Разрушает подготовленный дескриптор.
+ * В случае успеха возвращает ноль, либо FPTA_EINVAL если переданный экземпляр
+ * не был инициализирован или уже разрушен. */
+FPTA_API int fpta_prepared_get_destroy(fpta_prepared_get *prepared);
+
 /* Опции при помещении или обновлении данных, т.е. для fpta_put(). */
 typedef enum fpta_put_options {
   /* Вставить новую запись, т.е. не обновлять существующую.
@@ -3100,6 +3718,48 @@ static __inline int fpta_probe_and_upsert_row(fpta_txn *txn,
   return fpta_probe_and_put(txn, table_id, row_value, fpta_upsert);
 }
 
+/* Пакетная вставка и/или обновление строк таблицы.
+ *
+ * Выполняет для count строк из массива rows действие, аналогичное
+ * fpta_put() с заданным op (fpta_insert, fpta_update или fpta_upsert),
+ * но поддержка вторичных индексов производится для всего пакета сразу:
+ *  - ключи вторичных индексов формируются и упорядочиваются параллельно
+ *    рабочими потоками, по одному индексу на поток;
+ *  - затем изменения вносятся последовательно, индекс за индексом в порядке
+ *    возрастания ключей, а строки таблицы - в порядке первичного ключа.
+ * Упорядоченное внесение изменений улучшает локальность обращений к
+ * страницам b-tree и сокращает кол-во их расщеплений, что существенно
+ * для таблиц с большим кол-вом вторичных индексов.
+ *
+ * Все проверки (наличие строк для fpta_update и их отсутствие для
+ * fpta_insert, non-nullable колонки, уникальность вторичных индексов, в том
+ * числе между строками самого пакета) выполняются до внесения каких-либо
+ * изменений, поэтому при их нарушении возвращается ошибка без прерывания
+ * транзакции. Ошибки при последующем внесении изменений, как и в fpta_put(),
+ * приводят к прерыванию транзакции.
+ *
+ * Строки обрабатываются последовательно посредством fpta_put() в порядке
+ * следования в пакете, если первичный ключ таблицы не уникален, в пакете
+ * есть строки с одинаковым значением первичного ключа, либо пакет меньше
+ * 4096 строк и рабочие потоки не используются (без них упорядочивание
+ * небольшого пакета не окупается). В этом случае проверки выполняются для
+ * каждой строки отдельно, и если ошибка возникает после внесения части
+ * строк пакета, то транзакция прерывается.
+ *
+ * Аргумент threads задает максимальное кол-во потоков, включая
+ * вызывающий, 0 означает кол-во аппаратных потоков. Для небольших пакетов
+ * дополнительные потоки не используются. Рабочие потоки не обращаются к
+ * транзакции, все операции с БД выполняются вызывающим потоком.
+ *
+ * Аргумент table_id перед первым использованием должен
+ * быть инициализированы посредством fpta_table_init().
+ * Предварительный вызов fpta_name_refresh() не обязателен.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_put_batch(fpta_txn *txn, fpta_name *table_id,
+                            const fptu_ro *rows, size_t count,
+                            fpta_put_options op, unsigned threads);
+
 /* Удаляет указанную строку таблицы. При удалении одиночных строк функция
  * дешевле в сравнении с открытием курсора.
  *
@@ -3110,6 +3770,97 @@ static __inline int fpta_probe_and_upsert_row(fpta_txn *txn,
  * В случае успеха возвращает ноль, иначе код ошибки. */
 FPTA_API int fpta_delete(fpta_txn *txn, fpta_name *table_id, fptu_ro row_value);
 
+//----------------------------------------------------------------------------
+/* Журнал изменений (change data capture).
+ *
+ * При включении посредством fpta_db_changelog() каждое изменение строк,
+ * выполняемое функциями fpta_put(), fpta_delete(), fpta_cursor_update(),
+ * fpta_cursor_delete() и fpta_cursor_inplace(), а также очистка таблицы
+ * посредством fpta_table_clear(), дополнительно фиксируется в служебной
+ * таблице-журнале в рамках той же пишущей транзакции.
+ *
+ * Каждая запись журнала содержит версию данных (db_version) транзакции,
+ * порядковый номер изменения внутри транзакции, идентификатор таблицы,
+ * вид изменения, значение первичного ключа и, опционально, новое значение
+ * строки. Записи упорядочены по версии и номеру, поэтому потребитель может
+ * читать журнал "хвостом", запоминая версию последней полностью обработанной
+ * транзакции и продолжая чтение после неё в следующих читающих транзакциях.
+ *
+ * Журнал хранится в БД и доступен всем процессам, но включение записи
+ * действует только для экземпляра fpta_db, в котором была вызвана
+ * fpta_db_changelog(). */
+
+/* Вид изменения в записи журнала. */
+typedef enum fpta_change_kind {
+  fpta_change_upsert = 1 /* вставка или обновление строки */,
+  fpta_change_delete = 2 /* удаление строки */,
+  fpta_change_clear = 3 /* очистка всей таблицы, значение ключа пустое */
+} fpta_change_kind;
+
+/* Запись журнала изменений. */
+typedef struct fpta_change {
+  uint64_t db_version /* версия данных транзакции, внесшей изменение */;
+  uint32_t seq /* порядковый номер изменения внутри транзакции */;
+  fpta_change_kind kind /* вид изменения */;
+  fpta_shove_t table_shove /* идентификатор таблицы, совпадает с полем
+                              shove у fpta_name таблицы */
+      ;
+  fpta_value pk /* значение первичного ключа в том виде, в котором его
+                   возвращает fpta_cursor_key() */
+      ;
+  fptu_ro row /* новое значение строки для fpta_change_upsert, если запись
+                 строк включена, иначе пустое */
+      ;
+} fpta_change;
+
+/* Включает, изменяет параметры или выключает запись журнала изменений.
+ *
+ * Аргумент max_records ограничивает количество хранимых в журнале записей,
+ * при превышении которого самые старые записи удаляются в ходе пишущих
+ * транзакций. Нулевое значение выключает запись журнала, но не удаляет
+ * уже накопленные записи. Аргумент with_rows определяет сохранение новых
+ * значений строк в записях вида fpta_change_upsert.
+ *
+ * Функция не является потокобезопасной по отношению к другим операциям с БД
+ * и должна вызываться при отсутствии пишущих транзакций.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_db_changelog(fpta_db *db, size_t max_records,
+                               bool with_rows);
+
+typedef struct fpta_changelog_cursor fpta_changelog_cursor;
+
+/* Открывает курсор для чтения журнала изменений, начиная с первой записи
+ * транзакции с версией больше after_version. Нулевое значение after_version
+ * позволяет читать журнал с самой старой сохранившейся записи.
+ *
+ * Курсор действителен до завершения транзакции и должен быть закрыт
+ * посредством fpta_changelog_close() до её завершения.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_changelog_open(fpta_txn *txn, uint64_t after_version,
+                                 fpta_changelog_cursor **cursor);
+
+/* Читает очередную запись журнала изменений.
+ *
+ * Указатели внутри change действительны до завершения транзакции.
+ *
+ * В случае успеха возвращает ноль, FPTA_NODATA при отсутствии записей,
+ * иначе код ошибки. */
+FPTA_API int fpta_changelog_next(fpta_changelog_cursor *cursor,
+                                 fpta_change *change);
+
+/* Закрывает курсор журнала изменений.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_changelog_close(fpta_changelog_cursor *cursor);
+
+/* Удаляет из журнала все записи транзакций с версией не больше upto_version,
+ * например после их обработки всеми потребителями.
+ *
+ * В случае успеха возвращает ноль, иначе код ошибки. */
+FPTA_API int fpta_changelog_truncate(fpta_txn *txn, uint64_t upto_version);
+
 //----------------------------------------------------------------------------
 /* Манипуляция данными через курсоры. */
 
@@ -3203,6 +3954,13 @@ FPTA_API int fpta_cursor_delete(fpta_cursor *cursor);
  *    также исключая крайние точки. При этом коэффициент сглаживания вычисляется
  *    как "2 в степени N", где N - переданное значение.
  *
+ * Умножение и деление не изменяют отсутствующее (NIL) значение колонки,
+ * а деление на ноль считается ошибкой FPTA_EVALUE. Для fpta_bes отсутствие
+ * значения трактуется как начало ряда, т.е. колонке присваивается аргумент.
+ * Результат всех операций ограничивается диапазоном типа колонки с учетом
+ * designated empty (плавающая точка насыщается до бесконечности), а для
+ * целочисленных колонок округляется к нулю (для fpta_bes - к ближайшему).
+ *
  * Возвращаемое значение:
  *  - FPTA_SUCCESS (ноль) если значение колонки было успешно обновлено.
  *  - FPTA_NODATA (-1) если значение не изменилось и не было ошибок.
@@ -3211,6 +3969,63 @@ FPTA_API int fpta_cursor_inplace(fpta_cursor *cursor, fpta_name *column_id,
                                  const fpta_inplace op, const fpta_value value,
                                  ...);
 
+/* Пакетно обновляет значение колонки во всех строках выборки, выполняя
+ * бинарную операцию c аргументом и текущим значением, аналогично
+ * fpta_cursor_inplace().
+ *
+ * Назначение параметров txn, column_id, range_from, range_to и filter
+ * аналогично fpta_cursor_open(). Аргумент target_column идентифицирует
+ * целевую колонку и не может совпадать с column_id, а параметры op и value
+ * (а также дополнительный параметр для fpta_bes) аналогичны
+ * fpta_cursor_inplace().
+ *
+ * Как правило, все строки обрабатываются за один проход внутреннего курсора.
+ * Однако, если индекс column_id допускает дубликаты, а изменение требует
+ * сопровождения индексов, то обновление может переместить строку внутри
+ * multi-value. Поэтому в этом случае сначала собираются копии изменяемых
+ * строк, а затем курсор устанавливается на каждую из них. Если целевая
+ * колонка не входит ни в один индекс (в том числе составной), а первичный
+ * индекс уникален, то обновляется только строка в основной таблице, без
+ * сопровождения вторичных индексов. При этом если колонка уже присутствует
+ * в строке, то значение изменяется в копии строки без её пересборки, а
+ * libmdbx перезаписывает данные непосредственно в странице.
+ *
+ * Строки, значение в которых не изменилось, пропускаются. При ненулевом
+ * count в него будет записано количество измененных строк.
+ *
+ * В случае успеха, в том числе при отсутствии строк в выборке, возвращает
+ * ноль, иначе код ошибки. */
+FPTA_API int fpta_inplace_range(fpta_txn *txn, fpta_name *column_id,
+                                fpta_value range_from, fpta_value range_to,
+                                fpta_filter *filter, fpta_name *target_column,
+                                const fpta_inplace op, const fpta_value value,
+                                size_t *count, ...);
+
+/* Обновляет значение колонки в строке с заданным значением первичного ключа,
+ * выполняя бинарную операцию c аргументом и текущим значением, аналогично
+ * fpta_cursor_inplace(), но без открытия курсора.
+ *
+ * Аргумент pk_column идентифицирует колонку первичного ключа, который должен
+ * быть уникальным, а key_value задает значение ключа. Аргумент target_column
+ * идентифицирует целевую колонку, а параметры op и value (а также
+ * дополнительный параметр для fpta_bes) аналогичны fpta_cursor_inplace().
+ *
+ * Если целевая колонка не входит ни в один индекс (в том числе составной)
+ * и уже присутствует в строке, то выполняется единственный поиск по B-дереву,
+ * а значение изменяется непосредственно в грязной странице без пересборки
+ * кортежа. Иначе строка обновляется целиком с сопровождением индексов.
+ *
+ * Возвращаемое значение:
+ *  - FPTA_SUCCESS (ноль) если значение колонки было успешно обновлено.
+ *  - FPTA_NODATA (-1) если значение не изменилось и не было ошибок.
+ *  - FPTA_NOTFOUND если строка с заданным ключом не найдена.
+ *  - Иначе код ошибки. */
+FPTA_API int fpta_inplace_by_key(fpta_txn *txn, fpta_name *pk_column,
+                                 const fpta_value *key_value,
+                                 fpta_name *target_column,
+                                 const fpta_inplace op, const fpta_value value,
+                                 ...);
+
 //----------------------------------------------------------------------------
 /* Манипуляция данными внутри строк. */
 
@@ -3299,6 +4114,13 @@ static __inline int fpta_get_column4key(fptu_ro row, const fpta_name *column_id,
  *    также исключая крайние точки. При этом коэффициент сглаживания вычисляется
  *    как "2 в степени N", где N - переданное значение.
  *
+ * Умножение и деление не изменяют отсутствующее (NIL) значение колонки,
+ * а деление на ноль считается ошибкой FPTA_EVALUE. Для fpta_bes отсутствие
+ * значения трактуется как начало ряда, т.е. колонке присваивается аргумент.
+ * Результат всех операций ограничивается диапазоном типа колонки с учетом
+ * designated empty (плавающая точка насыщается до бесконечности), а для
+ * целочисленных колонок округляется к нулю (для fpta_bes - к ближайшему).
+ *
  * Возвращаемое значение:
  *  - FPTA_SUCCESS (ноль) если значение колонки было успешно обновлено.
  *  - FPTA_NODATA (-1) если значение не изменилось и не было ошибок.
@@ -3319,6 +4141,9 @@ FPTA_API fptu_lge __fpta_filter_cmp(const fptu_field *pf,
 FPTA_API int __fpta_index_value2key(fpta_shove_t shove, const fpta_value *value,
                                     void *key);
 FPTA_API const void *__fpta_index_shove2comparator(fpta_shove_t shove);
+FPTA_API int __fpta_composite_row2key_legacy(fptu_ro row,
+                                             const fpta_name *column_id,
+                                             fpta_value4key *value4key);
 #endif /* FPTA_ENABLE_TESTS */
 
 static __inline bool fpta_is_under_valgrind(void) {
@@ -3477,6 +4302,11 @@ schema2json(const fpta_schema_info *info,
             const string_view &indent = string_view(),
             const fptu_json_options options = fptu_json_sort_Tags);
 
+/* Формирует текстовое представление гистограмм задержек, по одной строке
+ * на каждую точку измерения: количество, среднее, квантили p50, p90, p99,
+ * p999 и максимум в микросекундах. */
+FPTA_API int latency2text(fpta_db *db, std::string &text);
+
 } // namespace fpta
 
 #endif /* __cplusplus */
@@ -249,6 +249,62 @@ static cxx11_constexpr bool fpta_is_intersected(const void *left_begin,
   return !(left_begin >= right_end || right_begin >= left_end);
 }
 
+/* Словарь префиксов для сжатия ключей индекса, в том виде как он хранится
+ * в образе схемы таблицы (см. fpta_describe_key_prefixes). Префиксы
+ * упорядочены и не вложены друг в друга, а offsets[count] задает суммарную
+ * длину всех префиксов. */
+struct fpta_key_prefixes {
+  uint16_t count;
+  uint16_t offsets[1 /* count + 1 */];
+
+  const uint8_t *bytes() const {
+    return (const uint8_t *)&offsets[count + 1];
+  }
+  const uint8_t *prefix(size_t i) const { return bytes() + offsets[i]; }
+  size_t length(size_t i) const { return offsets[i + 1] - offsets[i]; }
+  int compare(size_t i, const uint8_t *key, size_t key_length) const {
+    const size_t prefix_length = length(i);
+    const int diff =
+        memcmp(prefix(i), key, std::min(prefix_length, key_length));
+    return diff ? diff
+                : int(prefix_length > key_length) -
+                      int(prefix_length < key_length);
+  }
+
+  static size_t items(size_t count, size_t bytes) {
+    return 1 + count + 1 + (bytes + 1) / 2;
+  }
+};
+
+enum fpta_internals {
+  /* используем некорретный для индекса набор флагов, чтобы в fpta_name
+   * отличать таблицу от колонки, у таблицы в internal будет fpta_ftable. */
+  fpta_flag_table = fpta_index_fsecondary,
+  fpta_dbi_cache_size = 6619 /* простое число ближайшее
+                              * к golten_ratio * fpta_max_dbi = 6627.467 */
+  ,
+  fpta_row_cache_max = 1 << 24 /* предел размера кэша строк */,
+  FTPA_SCHEMA_SIGNATURE = 1636722823,
+  FTPA_SCHEMA_CHECKSEED = 67413473,
+  /* сигнатура схем с дополнительными опциями индексов после описаний
+   * составных колонок, которые не поддерживаются предыдущими версиями */
+  FTPA_SCHEMA_SIGNATURE_OPTIONS = 1760873621,
+  /* сигнатура схем с хэш-индексами, опции которых размещаются так же,
+   * как при FTPA_SCHEMA_SIGNATURE_OPTIONS, но отличная от неё, чтобы
+   * предыдущие версии отвергали такие схемы по сигнатуре */
+  FTPA_SCHEMA_SIGNATURE_HASHED = 1913645773,
+  fpta_schema_option_key_prefixes = 1,
+  fpta_schema_option_key_length = 2,
+  fpta_schema_option_hash_index = 3,
+  fpta_shoved_keylen = fpta_max_keylen + 8,
+  fpta_row_fields_cached = 64 /* см. fpta_row_fields */,
+  fpta_notnil_prefix_byte = 42,
+  fpta_notnil_prefix_length = 1
+};
+
+struct fpta_key;
+struct fpta_composite_encoder;
+
 struct fpta_table_schema final {
   fpta_shove_t _key;
   unsigned _cache_hints[fpta_max_cols]; /* подсказки для кэша дескрипторов */
@@ -304,6 +360,52 @@ struct fpta_table_schema final {
     return FPTA_SUCCESS;
   }
 
+  /* подготовленные при загрузке схемы кодировщики составных ключей,
+   * размещены параллельно описаниям составных колонок */
+  const fpta_composite_encoder *_composite_encoders;
+
+  /* кодировщик-заголовок составной колонки, за которым следуют
+   * кодировщики её элементов, см. fpta_composite_row2key() */
+  inline const fpta_composite_encoder *
+  composite_encoders(size_t number) const;
+
+  const fpta_key_prefixes *const *_key_prefixes;
+  const composite_item_t *_key_limits;
+
+  /* словарь префиксов для сжатия ключей индекса, либо nullptr */
+  const fpta_key_prefixes *key_prefixes(size_t number) const {
+    assert(number < _stored.count);
+    return likely(_key_prefixes == nullptr) ? nullptr : _key_prefixes[number];
+  }
+
+  /* ограничение длины точно сохраняемых ключей индекса,
+   * см. fpta_describe_key_length() */
+  size_t key_limit(size_t number) const {
+    assert(number < _stored.count);
+    return likely(_key_limits == nullptr) ? size_t(fpta_max_keylen)
+                                          : _key_limits[number];
+  }
+
+  /* маска номеров (меньших 64) колонок, индексы которых хранятся
+   * в виде линейной хэш-таблицы, см. fpta_describe_hash_index() */
+  uint64_t _hash_indexes;
+
+  bool is_hash_index(size_t number) const {
+    assert(number < _stored.count);
+    return number < 64 && (_hash_indexes >> number) & 1;
+  }
+
+  /* зависимости вторичных индексов от колонок: для каждой из первых
+   * fpta_row_fields_cached колонок маска номеров индексов (меньших 64),
+   * ключи которых формируются из её значения. Последний элемент
+   * объединяет индексы, зависящие от остальных колонок. */
+  uint64_t _dependents[fpta_row_fields_cached + 1];
+
+  uint64_t column_dependents(size_t number) const {
+    assert(number < _stored.count);
+    return _dependents[std::min(number, size_t(fpta_row_fields_cached))];
+  }
+
   cxx11_constexpr bool has_secondary() const {
     return column_count() > 1 && fpta_index_is_secondary(column_shove(1));
   }
@@ -311,19 +413,16 @@ struct fpta_table_schema final {
   fpta_table_stored_schema _stored; /* must be last field (dynamic size) */
 };
 
-enum fpta_internals {
-  /* используем некорретный для индекса набор флагов, чтобы в fpta_name
-   * отличать таблицу от колонки, у таблицы в internal будет fpta_ftable. */
-  fpta_flag_table = fpta_index_fsecondary,
-  fpta_dbi_cache_size = 6619 /* простое число ближайшее
-                              * к golten_ratio * fpta_max_dbi = 6627.467 */
-  ,
-  FTPA_SCHEMA_SIGNATURE = 1636722823,
-  FTPA_SCHEMA_CHECKSEED = 67413473,
-  fpta_shoved_keylen = fpta_max_keylen + 8,
-  fpta_notnil_prefix_byte = 42,
-  fpta_notnil_prefix_length = 1
-};
+static __inline bool fpta_schema_signature_valid(uint32_t signature) {
+  return signature == FTPA_SCHEMA_SIGNATURE ||
+         signature == FTPA_SCHEMA_SIGNATURE_OPTIONS ||
+         signature == FTPA_SCHEMA_SIGNATURE_HASHED;
+}
+
+static __inline bool fpta_schema_signature_options(uint32_t signature) {
+  return signature == FTPA_SCHEMA_SIGNATURE_OPTIONS ||
+         signature == FTPA_SCHEMA_SIGNATURE_HASHED;
+}
 
 //----------------------------------------------------------------------------
 
@@ -333,6 +432,7 @@ struct fpta_txn {
   MDBX_txn *mdbx_txn;
   fpta_level level;
   int unused_gap;
+  uint32_t changelog_seq /* см. fpta_db_changelog() */;
   uint64_t db_version;
   uint64_t schema_tsn_;
 
@@ -366,20 +466,55 @@ struct fpta_key {
   } place;
 };
 
+/* Кодировщик одного элемента составного ключа, подготавливается при
+ * загрузке схемы (см. fpta_composite_encoders_init). Функция получает
+ * найденное в строке поле, либо nullptr при его отсутствии.
+ *
+ * Для заголовка составной колонки вместо функции задается маска хэшей
+ * тегов всех элементов, по которой при единственном проходе по полям
+ * строки отсеиваются не входящие в составной индекс. */
+struct fpta_composite_encoder {
+  typedef int (*encode_t)(fpta_key &key, const fpta_composite_encoder &self,
+                          const fptu_field *field);
+  union {
+    encode_t encode;
+    uint64_t tags_mask;
+  };
+  uint16_t tag;
+  bool nullable;
+  bool present_marker /* маркер наличия перед значением */;
+  uint8_t absent_length /* длина заглушки для отсутствующего значения */;
+  uint8_t absent[256 / 8];
+
+  static uint64_t tag_bit(uint_fast16_t tag) {
+    return UINT64_C(1) << ((uint32_t(tag) * UINT32_C(2654435769)) >> 26);
+  }
+};
+
+inline const fpta_composite_encoder *
+fpta_table_schema::composite_encoders(size_t number) const {
+  assert(fpta_is_composite(column_shove(number)) && _composite_encoders);
+  return _composite_encoders + _composite_offsets[number];
+}
+
+/* Счетчики операций, см. fpta_cursor_stat и fpta_db_metrics() */
+struct fpta_op_counters {
+  size_t results;
+  size_t searches;
+  size_t scans;
+  size_t pk_lookups;
+  size_t uniq_checks;
+  size_t upserts;
+  size_t deletions;
+};
+
 struct fpta_cursor {
   fpta_cursor(const fpta_cursor &) = delete;
   MDBX_cursor *mdbx_cursor;
   MDBX_val current;
 
-  struct {
-    size_t results;
-    size_t searches;
-    size_t scans;
-    size_t pk_lookups;
-    size_t uniq_checks;
-    size_t upserts;
-    size_t deletions;
-  } metrics;
+  fpta_op_counters metrics;
+  fpta_shove_t metrics_table_shove, metrics_index_shove;
   int bring(MDBX_val *key, MDBX_val *data, const MDBX_cursor_op op);
 
   static constexpr void *poor = nullptr;
@@ -434,11 +569,21 @@ struct fpta_cursor {
     need_cmp_range_to = 2,
     need_cmp_range_both = need_cmp_range_from | need_cmp_range_to,
     need_key4epsilon = 4,
+    /* пустая выборка по отсутствующему в хэш-индексе значению */
+    need_nothing = 8,
   };
 
   fpta_key range_from_key;
   fpta_key range_to_key;
   fpta_db *db;
+
+  /* Место для копий длинных ключей границ диапазона, которые не помещаются
+   * в fpta_key::place. Выделяется сразу за курсором только для индексов
+   * с увеличенным ограничением длины ключей, см. fpta_describe_key_length(). */
+  uint8_t *long_key_place(bool range_to) {
+    return reinterpret_cast<uint8_t *>(this + 1) +
+           (range_to ? table_schema()->key_limit(column_number) : 0);
+  }
 };
 
 //----------------------------------------------------------------------------
@@ -454,27 +599,122 @@ int fpta_index_value2key(fpta_shove_t shove, const fpta_value &value,
 int fpta_index_key2value(fpta_shove_t shove, MDBX_val mdbx_key,
                          fpta_value &key_value);
 
+/* Варианты с учетом словаря префиксов и ограничения длины ключей, которые
+ * могут быть заданы для индекса колонки в схеме таблицы,
+ * см. fpta_describe_key_prefixes() и fpta_describe_key_length().
+ *
+ * Длинные ключи индексов с увеличенным ограничением длины всегда ссылаются
+ * на исходные данные и не копируются, даже при copy = true. */
+int fpta_index_value2key(const fpta_table_schema *const schema, size_t column,
+                         const fpta_value &value, fpta_key &key,
+                         bool copy = false);
+int fpta_index_key2value(const fpta_table_schema *const schema, size_t column,
+                         MDBX_val mdbx_key, fpta_value &key_value);
+void fpta_index_elide_prefix(const fpta_table_schema *const schema,
+                             size_t column, fpta_key &key);
+
+/* Кэш извлечения полей строки для формирования ключей индексов в рамках
+ * одной операции. При первом обращении единственным проходом по кортежу
+ * собираются поля первых fpta_row_fields_cached колонок, после чего ключи
+ * первичного, вторичных и составных индексов, а также проверка non-nullable
+ * колонок обходятся без повторного поиска каждой колонки в строке. */
+struct fpta_row_fields {
+  fpta_row_fields(const fpta_table_schema *schema, const fptu_ro &row)
+      : schema(schema), row(row), cached(0) {}
+  fpta_row_fields(const fpta_row_fields &) = delete;
+
+  const fpta_table_schema *const schema;
+  const fptu_ro row;
+  unsigned cached /* кол-во собранных колонок, 0 до первого обращения */;
+  const fptu_field *fields[fpta_row_fields_cached];
+
+  bool present() const { return row.sys.iov_base != nullptr; }
+  void collect();
+  const fptu_field *lookup(size_t column, fptu_type type) {
+    assert(type == fpta_shove2type(schema->column_shove(column)));
+    if (unlikely(cached == 0))
+      collect();
+    return likely(column < cached) ? fields[column]
+                                   : fptu::lookup(row, (unsigned)column, type);
+  }
+};
+
 int fpta_index_row2key(const fpta_table_schema *const schema, size_t column,
                        const fptu_ro &row, fpta_key &key, bool copy = false);
+int fpta_index_row2key(fpta_row_fields &row, size_t column, fpta_key &key,
+                       bool copy = false);
 
 int fpta_composite_row2key(const fpta_table_schema *const schema, size_t column,
                            const fptu_ro &row, fpta_key &key);
+int fpta_composite_row2key(fpta_row_fields &row, size_t column,
+                           fpta_key &key);
+int fpta_composite_encoders_init(const fpta_table_schema *const schema,
+                                 fpta_composite_encoder *encoders);
 
 int fpta_secondary_upsert(fpta_txn *txn, fpta_table_schema *table_def,
-                          MDBX_val old_pk_key, const fptu_ro &old_row,
-                          MDBX_val new_pk_key, const fptu_ro &new_row,
+                          MDBX_val old_pk_key, fpta_row_fields &old_row,
+                          MDBX_val new_pk_key, fpta_row_fields &new_row,
                           const unsigned stepover);
 
+/* Строка пакета для fpta_secondary_upsert_batch(), первичный ключ
+ * у старой и новой версий строки совпадает. */
+struct fpta_batch_row {
+  MDBX_val pk_key;
+  fpta_row_fields *old_row, *new_row;
+};
+
+/* Порядковый префикс ключа для сортировки пакета: если ключ a меньше b
+ * при заданных dbi_flags, то префикс a не больше префикса b. Поэтому
+ * полное сравнение ключей требуется только при равенстве префиксов,
+ * а для MDBX_INTEGERKEY префикс и есть сам ключ. */
+static inline bool fpta_batch_prefix_exact(unsigned dbi_flags) {
+  return (dbi_flags & MDBX_INTEGERKEY) != 0;
+}
+
+static inline uint64_t fpta_batch_prefix(unsigned dbi_flags,
+                                         const MDBX_val &key) {
+  const uint8_t *const bytes = static_cast<const uint8_t *>(key.iov_base);
+  if (fpta_batch_prefix_exact(dbi_flags)) {
+    if (key.iov_len == sizeof(uint32_t)) {
+      uint32_t u32;
+      memcpy(&u32, bytes, sizeof(u32));
+      return u32;
+    }
+    assert(key.iov_len == sizeof(uint64_t));
+    uint64_t u64;
+    memcpy(&u64, bytes, sizeof(u64));
+    return u64;
+  }
+
+  /* первые байты в порядке сравнения, с дополнением нулями */
+  uint64_t prefix = 0;
+  const size_t n = std::min(key.iov_len, sizeof(prefix));
+  if (dbi_flags & MDBX_REVERSEKEY) {
+    for (size_t i = 0; i < n; ++i)
+      prefix |= uint64_t(bytes[key.iov_len - 1 - i]) << (56 - 8 * i);
+  } else {
+    for (size_t i = 0; i < n; ++i)
+      prefix |= uint64_t(bytes[i]) << (56 - 8 * i);
+  }
+  return prefix;
+}
+
+unsigned fpta_batch_workers(const fpta_table_schema *table_def, size_t count,
+                            unsigned threads);
+int fpta_secondary_upsert_batch(fpta_txn *txn, fpta_table_schema *table_def,
+                                const fpta_batch_row *rows, size_t count,
+                                unsigned workers);
+
 int fpta_check_secondary_uniq(fpta_txn *txn, fpta_table_schema *table_def,
-                              const fptu_ro &row_old, const fptu_ro &row_new,
+                              fpta_row_fields &row_old,
+                              fpta_row_fields &row_new,
                               const unsigned stepover);
 
 int fpta_secondary_remove(fpta_txn *txn, fpta_table_schema *table_def,
-                          MDBX_val &pk_key, const fptu_ro &row,
+                          MDBX_val &pk_key, fpta_row_fields &row,
                           const unsigned stepover);
 
-int fpta_check_nonnullable(const fpta_table_schema *table_def,
-                           const fptu_ro &row);
+int fpta_check_nonnullable(fpta_row_fields &row);
 
 int fpta_column_set_add(fpta_column_set *column_set, const char *column_name,
                         fptu_type data_type, fpta_index_type index_type);
@@ -500,8 +740,9 @@ int fpta_open_column(fpta_txn *txn, fpta_name *column_id, MDBX_dbi &tbl_handle,
 int fpta_open_secondaries(fpta_txn *txn, fpta_table_schema *table_def,
                           MDBX_dbi *dbi_array);
 
-fpta_cursor *fpta_cursor_alloc(fpta_db *db);
+fpta_cursor *fpta_cursor_alloc(fpta_db *db, size_t long_keys_space = 0);
 void fpta_cursor_free(fpta_db *db, fpta_cursor *cursor);
+int fpta_cursor_locate_row(fpta_cursor *cursor, const fptu_ro &row);
 
 //----------------------------------------------------------------------------
 
@@ -0,0 +1,192 @@
+/*
+ *  Fast Positive Tables (libfpta), aka Позитивные Таблицы.
+ *  Copyright 2016-2020 Leonid Yuriev <leo@yuriev.ru>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "details.h"
+
+#include <thread>
+
+/* Фоновая "догоняющая" фиксация для режима fpta_async.
+ *
+ * БД открывается с MDBX_SAFE_NOSYNC и без установки порогов авто-синхронизации
+ * в libmdbx, так как они проверяются внутри mdbx_txn_commit() и заставили бы
+ * писателя ждать завершения записи на диск. Вместо этого отдельный поток
+ * периодически опрашивает объём и возраст несинхронизированных изменений
+ * и при превышении заданных пределов вызывает mdbx_env_sync_ex().
+ *
+ * При вызове вне пишущей транзакции libmdbx выполняет основную часть
+ * синхронизации данных без захвата блокировки писателей, удерживая её только
+ * для финальной записи мета-страницы. Поэтому писатели не ждут fsync. */
+
+struct fpta_async_flusher {
+  fpta_db *db;
+  fpta_mutex_t mutex;
+  fpta_cond_t cond;
+  bool stopping;
+  std::atomic<size_t> lag_bytes;
+  std::atomic<unsigned> lag_milliseconds;
+  std::atomic<uint64_t> flushes;
+  std::atomic<int> last_error;
+  std::thread thread;
+
+  unsigned tick() const {
+    const unsigned period = lag_milliseconds.load(std::memory_order_relaxed);
+    return (period == 0 || period > 400) ? 100 : (period < 4) ? 1 : period / 4;
+  }
+
+  void flush_if_lagging();
+  void run();
+};
+
+void fpta_async_flusher::flush_if_lagging() {
+  MDBX_envinfo info;
+  int rc = mdbx_env_info_ex(db->mdbx_env, nullptr, &info, sizeof(info));
+  if (unlikely(rc != MDBX_SUCCESS)) {
+    last_error.store(rc, std::memory_order_relaxed);
+    return;
+  }
+  if (info.mi_unsync_volume == 0)
+    return;
+
+  const size_t bytes = lag_bytes.load(std::memory_order_relaxed);
+  const uint64_t period16dot16 =
+      (uint64_t(lag_milliseconds.load(std::memory_order_relaxed)) << 16) /
+      1000;
+  if ((bytes && info.mi_unsync_volume >= bytes) ||
+      (period16dot16 && info.mi_since_sync_seconds16dot16 >= period16dot16)) {
+    rc = mdbx_env_sync_ex(db->mdbx_env, true, false);
+    flushes.fetch_add(1, std::memory_order_relaxed);
+    last_error.store((rc == MDBX_RESULT_TRUE) ? MDBX_SUCCESS : rc,
+                     std::memory_order_relaxed);
+  }
+}
+
+void fpta_async_flusher::run() {
+  fpta_lock_guard guard;
+  int err = guard.lock(&mutex);
+  assert(err == 0);
+  while (!stopping) {
+    fpta_cond_timedwait(&cond, &mutex, tick());
+    if (stopping)
+      break;
+    guard.unlock();
+    flush_if_lagging();
+    err = guard.lock(&mutex);
+    assert(err == 0);
+  }
+  (void)err;
+}
+
+static void fpta_async_destroy(fpta_async_flusher *flusher) {
+  int err = fpta_cond_destroy(&flusher->cond);
+  assert(err == 0);
+  err = fpta_mutex_destroy(&flusher->mutex);
+  assert(err == 0);
+  (void)err;
+  delete flusher;
+}
+
+__cold int fpta_async_start(fpta_db *db) {
+  assert(db->async == nullptr);
+  fpta_async_flusher *flusher =
+      new fpta_async_flusher /* FIXME: std::bad_alloc */;
+  flusher->db = db;
+  flusher->stopping = false;
+  flusher->lag_bytes = fpta_async_lag_bytes_default;
+  flusher->lag_milliseconds = fpta_async_lag_milliseconds_default;
+  flusher->flushes = 0;
+  flusher->last_error = FPTA_SUCCESS;
+
+  int rc = fpta_mutex_init(&flusher->mutex);
+  if (unlikely(rc != 0)) {
+    delete flusher;
+    return rc;
+  }
+  rc = fpta_cond_init(&flusher->cond);
+  if (unlikely(rc != 0)) {
+    fpta_mutex_destroy(&flusher->mutex);
+    delete flusher;
+    return rc;
+  }
+
+  try {
+    flusher->thread = std::thread(&fpta_async_flusher::run, flusher);
+  } catch (const std::system_error &) {
+    fpta_async_destroy(flusher);
+    return FPTA_ENOMEM;
+  }
+
+  db->async = flusher;
+  return FPTA_SUCCESS;
+}
+
+__cold void fpta_async_stop(fpta_db *db) {
+  fpta_async_flusher *flusher = db->async;
+  if (!flusher)
+    return;
+
+  fpta_lock_guard guard;
+  int err = guard.lock(&flusher->mutex);
+  assert(err == 0);
+  flusher->stopping = true;
+  err = fpta_cond_broadcast(&flusher->cond);
+  assert(err == 0);
+  guard.unlock();
+  (void)err;
+
+  flusher->thread.join();
+  db->async = nullptr;
+  fpta_async_destroy(flusher);
+}
+
+void fpta_async_stat(const fpta_db *db, fpta_db_stat_t *stat) {
+  memset(&stat->async, 0, sizeof(stat->async));
+  const fpta_async_flusher *flusher = db->async;
+  if (!flusher)
+    return;
+
+  if (stat->durability == fpta_lazy)
+    stat->durability = fpta_async;
+  stat->async.lag_bytes = flusher->lag_bytes.load(std::memory_order_relaxed);
+  stat->async.lag_period_seconds16dot16 = uint32_t(
+      (uint64_t(flusher->lag_milliseconds.load(std::memory_order_relaxed))
+       << 16) /
+      1000);
+  stat->async.flushes = flusher->flushes.load(std::memory_order_relaxed);
+  stat->async.last_error = flusher->last_error.load(std::memory_order_relaxed);
+}
+
+__cold int fpta_db_async_lag(fpta_db *db, size_t lag_bytes,
+                             unsigned lag_milliseconds) {
+  if (unlikely(!fpta_db_validate(db)))
+    return FPTA_EINVAL;
+  if (unlikely(lag_bytes == 0 && lag_milliseconds == 0))
+    return FPTA_EINVAL;
+
+  fpta_async_flusher *flusher = db->async;
+  if (unlikely(!flusher))
+    return FPTA_EFLAG;
+
+  flusher->lag_bytes.store(lag_bytes, std::memory_order_relaxed);
+  flusher->lag_milliseconds.store(lag_milliseconds, std::memory_order_relaxed);
+
+  /* будим поток, чтобы новые пределы применились без задержки */
+  fpta_lock_guard guard;
+  int rc = guard.lock(&flusher->mutex);
+  if (unlikely(rc != 0))
+    return (fpta_error)rc;
+  return (fpta_error)fpta_cond_broadcast(&flusher->cond);
+}
@@ -0,0 +1,354 @@
+/*
+ *  Fast Positive Tables (libfpta), aka Позитивные Таблицы.
+ *  Copyright 2016-2020 Leonid Yuriev <leo@yuriev.ru>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "details.h"
+
+/* Журнал изменений (change data capture).
+ *
+ * Журнал хранится в отдельной именованной таблице libmdbx, имя которой
+ * не может совпасть с именами таблиц и индексов, так как содержит символ
+ * вне алфавита fpta_shove2str().
+ *
+ * Ключом записи является пара (db_version, seq) в big-endian представлении,
+ * что обеспечивает упорядоченность при лексикографическом сравнении, а также
+ * позволяет добавлять записи посредством MDBX_APPEND. Значение состоит из
+ * заголовка, ключа в форме первичного индекса (выровненного на 4 байта)
+ * и опционального кортежа строки. */
+
+static const char fpta_changelog_name[] = "fpta.changelog";
+
+struct fpta_changelog_header {
+  fpta_shove_t table_shove;
+  fpta_shove_t pk_shove;
+  uint32_t kind;
+  uint32_t key_length;
+};
+
+struct fpta_changelog_cursor {
+  fpta_txn *txn;
+  MDBX_cursor *mdbx_cursor;
+  uint64_t after_version;
+  bool started;
+};
+
+enum {
+  fpta_changelog_keylen = sizeof(uint64_t) + sizeof(uint32_t),
+  /* признак сжатого словарем префиксов ключа, который возвращается как
+   * fpta_shoved, см. fpta_describe_key_prefixes() */
+  fpta_changelog_shoved_pk = 1 << 16,
+  /* признак ключа, сохраненного точно как есть без нормализации,
+   * см. fpta_describe_key_length() */
+  fpta_changelog_exact_pk = 1 << 17,
+  fpta_changelog_pk_flags = fpta_changelog_shoved_pk | fpta_changelog_exact_pk
+};
+
+static __inline size_t fpta_changelog_align(size_t bytes) {
+  return (bytes + 3) & ~size_t(3);
+}
+
+static void fpta_changelog_key(uint64_t version, uint32_t seq,
+                               uint8_t key[fpta_changelog_keylen]) {
+  for (size_t i = 8; i > 0; --i, version >>= 8)
+    key[i - 1] = uint8_t(version);
+  for (size_t i = 12; i > 8; --i, seq >>= 8)
+    key[i - 1] = uint8_t(seq);
+}
+
+static uint64_t fpta_changelog_version(const MDBX_val &key) {
+  const uint8_t *const bytes = static_cast<const uint8_t *>(key.iov_base);
+  uint64_t version = 0;
+  for (size_t i = 0; i < 8; ++i)
+    version = version << 8 | bytes[i];
+  return version;
+}
+
+static uint32_t fpta_changelog_seq(const MDBX_val &key) {
+  const uint8_t *const bytes = static_cast<const uint8_t *>(key.iov_base);
+  uint32_t seq = 0;
+  for (size_t i = 8; i < 12; ++i)
+    seq = seq << 8 | bytes[i];
+  return seq;
+}
+
+static int fpta_changelog_dbi(fpta_txn *txn, MDBX_dbi &handle) {
+  fpta_db *db = txn->db;
+  handle = db->changelog_dbi;
+  if (likely(handle > 0))
+    return FPTA_SUCCESS;
+
+  fpta_lock_guard guard;
+  if (txn->level < fpta_schema) {
+    int err = guard.lock(&db->dbi_mutex);
+    if (unlikely(err != 0))
+      return err;
+  }
+
+  if (db->changelog_dbi < 1) {
+    int rc = mdbx_dbi_open(txn->mdbx_txn, fpta_changelog_name,
+                           (txn->level > fpta_read) ? MDBX_CREATE : 0,
+                           &db->changelog_dbi);
+    if (unlikely(rc != MDBX_SUCCESS)) {
+      assert(db->changelog_dbi == 0);
+      return rc;
+    }
+  }
+
+  handle = db->changelog_dbi;
+  return FPTA_SUCCESS;
+}
+
+/* Удаляет самые старые записи сверх заданного предела. Выполняется однократно
+ * перед фиксацией транзакции, добавившей записи, а чтобы не выполнять
+ * удаление при каждой транзакции, журнал сокращается с запасом в 1/16
+ * предела. */
+static int fpta_changelog_trim(fpta_txn *txn, MDBX_dbi dbi, size_t limit) {
+  MDBX_stat stat;
+  int rc = mdbx_dbi_stat(txn->mdbx_txn, dbi, &stat, sizeof(stat));
+  if (unlikely(rc != MDBX_SUCCESS) || likely(stat.ms_entries <= limit))
+    return rc;
+
+  MDBX_cursor *mdbx_cursor;
+  rc = mdbx_cursor_open(txn->mdbx_txn, dbi, &mdbx_cursor);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  size_t excess = size_t(stat.ms_entries - limit) + (limit >> 4);
+  while (excess > 0 && rc == MDBX_SUCCESS) {
+    MDBX_val key, data;
+    rc = mdbx_cursor_get(mdbx_cursor, &key, &data, MDBX_FIRST);
+    if (likely(rc == MDBX_SUCCESS))
+      rc = mdbx_cursor_del(mdbx_cursor, 0);
+    --excess;
+  }
+  mdbx_cursor_close(mdbx_cursor);
+  return (rc == MDBX_NOTFOUND) ? MDBX_SUCCESS : rc;
+}
+
+int fpta_changelog_record(fpta_txn *txn, const fpta_table_schema *table_def,
+                          fpta_change_kind kind, const MDBX_val &pk_key,
+                          const fptu_ro *row) {
+  assert(txn->level >= fpta_write);
+  fpta_db *db = txn->db;
+  MDBX_dbi dbi;
+  int rc = fpta_changelog_dbi(txn, dbi);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  if (!db->changelog_rows)
+    row = nullptr;
+  const size_t key_bytes = fpta_changelog_align(pk_key.iov_len);
+  const size_t row_bytes = row ? row->sys.iov_len : 0;
+
+  uint8_t key_place[fpta_changelog_keylen];
+  fpta_changelog_key(txn->db_version, txn->changelog_seq, key_place);
+  MDBX_val key, data;
+  key.iov_base = key_place;
+  key.iov_len = sizeof(key_place);
+  data.iov_base = nullptr;
+  data.iov_len = sizeof(fpta_changelog_header) + key_bytes + row_bytes;
+  rc = mdbx_put(txn->mdbx_txn, dbi, &key, &data, MDBX_RESERVE | MDBX_APPEND);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  fpta_changelog_header header;
+  header.table_shove = table_def->table_shove();
+  header.pk_shove = table_def->column_shove(0);
+  header.kind = kind;
+  if (kind != fpta_change_clear && table_def->key_prefixes(0))
+    header.kind |= fpta_changelog_shoved_pk;
+  if (kind != fpta_change_clear && table_def->key_limit(0) > fpta_max_keylen)
+    header.kind |= fpta_changelog_exact_pk;
+  header.key_length = uint32_t(pk_key.iov_len);
+
+  uint8_t *ptr = static_cast<uint8_t *>(data.iov_base);
+  memcpy(ptr, &header, sizeof(header));
+  ptr += sizeof(header);
+  if (pk_key.iov_len)
+    memcpy(ptr, pk_key.iov_base, pk_key.iov_len);
+  memset(ptr + pk_key.iov_len, 0, key_bytes - pk_key.iov_len);
+  ptr += key_bytes;
+  if (row_bytes)
+    memcpy(ptr, row->sys.iov_base, row_bytes);
+
+  txn->changelog_seq += 1;
+  return FPTA_SUCCESS;
+}
+
+int fpta_changelog_commit(fpta_txn *txn) {
+  assert(txn->level >= fpta_write && txn->changelog_seq > 0);
+  fpta_db *db = txn->db;
+  if (unlikely(!fpta_changelog_enabled(db)))
+    return FPTA_SUCCESS;
+
+  MDBX_dbi dbi;
+  int rc = fpta_changelog_dbi(txn, dbi);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+  return fpta_changelog_trim(txn, dbi, db->changelog_limit);
+}
+
+//----------------------------------------------------------------------------
+
+__cold int fpta_db_changelog(fpta_db *db, size_t max_records,
+                             bool with_rows) {
+  if (unlikely(!fpta_db_validate(db)))
+    return FPTA_EINVAL;
+
+  db->changelog_limit = max_records;
+  db->changelog_rows = with_rows;
+  return FPTA_SUCCESS;
+}
+
+int fpta_changelog_open(fpta_txn *txn, uint64_t after_version,
+                        fpta_changelog_cursor **pcursor) {
+  if (unlikely(pcursor == nullptr))
+    return FPTA_EINVAL;
+  *pcursor = nullptr;
+
+  int rc = fpta_txn_validate(txn, fpta_read);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  fpta_changelog_cursor *cursor =
+      new fpta_changelog_cursor /* FIXME: std::bad_alloc */;
+  cursor->txn = txn;
+  cursor->mdbx_cursor = nullptr;
+  cursor->after_version = after_version;
+  cursor->started = false;
+
+  MDBX_dbi dbi;
+  rc = fpta_changelog_dbi(txn, dbi);
+  if (likely(rc == FPTA_SUCCESS))
+    rc = mdbx_cursor_open(txn->mdbx_txn, dbi, &cursor->mdbx_cursor);
+  if (unlikely(rc != FPTA_SUCCESS && rc != MDBX_NOTFOUND)) {
+    delete cursor;
+    return rc;
+  }
+
+  /* отсутствие журнала равнозначно пустому журналу */
+  *pcursor = cursor;
+  return FPTA_SUCCESS;
+}
+
+int fpta_changelog_next(fpta_changelog_cursor *cursor, fpta_change *change) {
+  if (unlikely(cursor == nullptr || change == nullptr))
+    return FPTA_EINVAL;
+
+  int rc = fpta_txn_validate(cursor->txn, fpta_read);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+  if (unlikely(cursor->mdbx_cursor == nullptr))
+    return FPTA_NODATA;
+
+  MDBX_val key, data;
+  if (likely(cursor->started)) {
+    rc = mdbx_cursor_get(cursor->mdbx_cursor, &key, &data, MDBX_NEXT);
+  } else if (unlikely(cursor->after_version == UINT64_MAX)) {
+    return FPTA_NODATA;
+  } else {
+    uint8_t key_place[fpta_changelog_keylen];
+    fpta_changelog_key(cursor->after_version + 1, 0, key_place);
+    key.iov_base = key_place;
+    key.iov_len = sizeof(key_place);
+    rc = mdbx_cursor_get(cursor->mdbx_cursor, &key, &data, MDBX_SET_RANGE);
+    cursor->started = true;
+  }
+  if (unlikely(rc != MDBX_SUCCESS))
+    return (rc == MDBX_NOTFOUND) ? (int)FPTA_NODATA : rc;
+
+  fpta_changelog_header header;
+  if (unlikely(key.iov_len != fpta_changelog_keylen ||
+               data.iov_len < sizeof(header)))
+    return FPTA_INDEX_CORRUPTED;
+  memcpy(&header, data.iov_base, sizeof(header));
+  const size_t key_bytes = fpta_changelog_align(header.key_length);
+  if (unlikely(data.iov_len < sizeof(header) + key_bytes))
+    return FPTA_INDEX_CORRUPTED;
+
+  const uint8_t *ptr = static_cast<const uint8_t *>(data.iov_base);
+  ptr += sizeof(header);
+  change->db_version = fpta_changelog_version(key);
+  change->seq = fpta_changelog_seq(key);
+  change->kind = fpta_change_kind(header.kind & ~fpta_changelog_pk_flags);
+  change->table_shove = header.table_shove;
+  change->pk = fpta_value_null();
+  if (header.kind & fpta_changelog_shoved_pk) {
+    if (unlikely(header.key_length > sizeof(fpta_key::place)))
+      return FPTA_INDEX_CORRUPTED;
+    change->pk.type = fpta_shoved;
+    change->pk.binary_data = const_cast<uint8_t *>(ptr);
+    change->pk.binary_length = header.key_length;
+  } else if (header.kind & fpta_changelog_exact_pk) {
+    change->pk.type = (fpta_shove2type(header.pk_shove) == fptu_cstr)
+                          ? fpta_string
+                          : fpta_binary;
+    change->pk.binary_data = const_cast<uint8_t *>(ptr);
+    change->pk.binary_length = header.key_length;
+  } else if (header.kind != fpta_change_clear) {
+    MDBX_val pk_key;
+    pk_key.iov_base = const_cast<uint8_t *>(ptr);
+    pk_key.iov_len = header.key_length;
+    rc = fpta_index_key2value(header.pk_shove, pk_key, change->pk);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+  }
+  ptr += key_bytes;
+  change->row.sys.iov_base = const_cast<uint8_t *>(ptr);
+  change->row.sys.iov_len = data.iov_len - sizeof(header) - key_bytes;
+  if (change->row.sys.iov_len == 0)
+    change->row.sys.iov_base = nullptr;
+  return FPTA_SUCCESS;
+}
+
+int fpta_changelog_close(fpta_changelog_cursor *cursor) {
+  if (unlikely(cursor == nullptr))
+    return FPTA_EINVAL;
+
+  if (cursor->mdbx_cursor)
+    mdbx_cursor_close(cursor->mdbx_cursor);
+  delete cursor;
+  return FPTA_SUCCESS;
+}
+
+int fpta_changelog_truncate(fpta_txn *txn, uint64_t upto_version) {
+  int rc = fpta_txn_validate(txn, fpta_write);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  MDBX_dbi dbi;
+  rc = fpta_changelog_dbi(txn, dbi);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  MDBX_cursor *mdbx_cursor;
+  rc = mdbx_cursor_open(txn->mdbx_txn, dbi, &mdbx_cursor);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  for (;;) {
+    MDBX_val key, data;
+    rc = mdbx_cursor_get(mdbx_cursor, &key, &data, MDBX_FIRST);
+    if (rc != MDBX_SUCCESS || key.iov_len != fpta_changelog_keylen ||
+        fpta_changelog_version(key) > upto_version)
+      break;
+    rc = mdbx_cursor_del(mdbx_cursor, 0);
+    if (unlikely(rc != MDBX_SUCCESS))
+      break;
+  }
+  mdbx_cursor_close(mdbx_cursor);
+  return (rc == MDBX_NOTFOUND) ? (int)FPTA_SUCCESS : rc;
+}
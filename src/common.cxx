@@ -69,9 +69,10 @@ static void fpta_txn_free(fpta_db *db, fpta_txn *txn) {
   }
 }
 
-fpta_cursor *fpta_cursor_alloc(fpta_db *db) {
+fpta_cursor *fpta_cursor_alloc(fpta_db *db, size_t long_keys_space) {
   // TODO: use pool
-  fpta_cursor *cursor = (fpta_cursor *)calloc(1, sizeof(fpta_cursor));
+  fpta_cursor *cursor =
+      (fpta_cursor *)calloc(1, sizeof(fpta_cursor) + long_keys_space);
   if (likely(cursor))
     cursor->db = db;
   return cursor;
@@ -122,7 +123,10 @@ int fpta_db_create_or_open(const char *path, fpta_durability durability,
     mdbx_flags |= MDBX_UTTERLY_NOSYNC;
   /* fall through */
   case fpta_lazy:
-    mdbx_flags |= MDBX_SAFE_NOSYNC | MDBX_NOMETASYNC;
+    mdbx_flags |= MDBX_NOMETASYNC;
+  /* fall through */
+  case fpta_async:
+    mdbx_flags |= MDBX_SAFE_NOSYNC;
     if (0 == (regime_flags & fpta_saferam))
       mdbx_flags |= MDBX_WRITEMAP;
   /* fall through */
@@ -213,10 +217,21 @@ int fpta_db_create_or_open(const char *path, fpta_durability durability,
     }
   }
 
+  rc = fpta_durable_init(db);
+  if (unlikely(rc != FPTA_SUCCESS))
+    goto bailout;
+
+  if (durability == fpta_async) {
+    rc = fpta_async_start(db);
+    if (unlikely(rc != FPTA_SUCCESS))
+      goto bailout;
+  }
+
   *pdb = db;
   return FPTA_SUCCESS;
 
 bailout:
+  fpta_durable_destroy(db);
   if (db->mdbx_env) {
     int err = mdbx_env_close_ex(db->mdbx_env, true /* don't touch/save/sync */);
     assert(err == MDBX_SUCCESS);
@@ -239,6 +254,7 @@ int fpta_db_close(fpta_db *db) {
   if (unlikely(!fpta_db_validate(db)))
     return FPTA_EINVAL;
 
+  fpta_async_stop(db);
   int rc = fpta_db_lock(db, db->alterable_schema ? fpta_schema : fpta_write);
   if (unlikely(rc != 0))
     return (fpta_error)rc;
@@ -268,6 +284,9 @@ int fpta_db_close(fpta_db *db) {
   }
   (void)err;
 
+  fpta_row_cache_release(db);
+  fpta_latency_release(db);
+  fpta_durable_destroy(db);
   free(db);
   return (fpta_error)rc;
 }
@@ -339,6 +358,7 @@ int fpta_transaction_begin(fpta_db *db, fpta_level level, fpta_txn **ptxn) {
   if (unlikely(!fpta_db_validate(db)))
     return FPTA_EINVAL;
 
+  fpta_latency_scope latency(db, fpta_latency_begin);
   int err = fpta_db_lock(db, level);
   if (unlikely(err != 0))
     return err;
@@ -362,6 +382,7 @@ int fpta_transaction_begin(fpta_db *db, fpta_level level, fpta_txn **ptxn) {
 
     rc = fpta_dbicache_cleanup(txn, nullptr);
     if (likely(rc == FPTA_SUCCESS)) {
+      FPTA_PROBE3(txn_begin, level, txn->db_version, rc);
       *ptxn = txn;
       return FPTA_SUCCESS;
     }
@@ -380,6 +401,7 @@ int fpta_transaction_begin(fpta_db *db, fpta_level level, fpta_txn **ptxn) {
   rc = fpta_internal_abort(txn, rc, false);
 
 bailout:
+  FPTA_PROBE3(txn_begin, level, 0, rc);
   err = fpta_db_unlock(db, level);
   assert(err == 0);
   (void)err;
@@ -389,6 +411,13 @@ bailout:
 }
 
 int fpta_transaction_end(fpta_txn *txn, bool abort) {
+  return fpta_transaction_end_ex(txn, abort, nullptr);
+}
+
+int fpta_transaction_end_ex(fpta_txn *txn, bool abort, uint64_t *version) {
+  if (version)
+    *version = 0;
+
   int rc = fpta_txn_validate(txn, fpta_read);
   if (unlikely(rc != FPTA_SUCCESS)) {
     if (rc == FPTA_TXN_CANCELLED)
@@ -404,13 +433,40 @@ int fpta_transaction_end(fpta_txn *txn, bool abort) {
     /* Текущая версия libmdbx либо фиксирует транзакцию,
      * либо самостоятельно её прерывает, т.е. в любом случае mdbx_txn_commit()
      * завершает транзакцию */
-    rc = mdbx_txn_commit(txn->mdbx_txn);
+    if (txn->changelog_seq > 0) {
+      rc = fpta_changelog_commit(txn);
+      if (unlikely(rc != FPTA_SUCCESS)) {
+        rc = fpta_internal_abort(txn, rc);
+        goto cancelled;
+      }
+    }
+    fpta_metrics_garbage garbage;
+    if (txn->level == fpta_schema)
+      fpta_metrics_collect(txn, garbage);
+    const uint64_t start = fpta_latency_start(txn->db);
+    if (likely(!start))
+      rc = mdbx_txn_commit(txn->mdbx_txn);
+    else {
+      /* время синхронизации с диском измеряется самой libmdbx */
+      MDBX_commit_latency latency;
+      rc = mdbx_txn_commit_ex(txn->mdbx_txn, &latency);
+      fpta_latency_commit_record(txn->db, rc, start, latency);
+    }
     if (unlikely(rc == MDBX_RESULT_TRUE))
       rc = FPTA_TXN_CANCELLED;
+    else if (txn->level == fpta_schema && rc == MDBX_SUCCESS)
+      /* счетчики удаленных таблиц, см. fpta_db_metrics() */
+      fpta_metrics_release(txn->db, garbage);
   }
 
-  if (unlikely(abort))
+  if (unlikely(abort)) {
     rc = fpta_internal_abort(txn, FPTA_OK);
+    FPTA_PROBE3(txn_abort, txn->level, txn->db_version, rc);
+  } else {
+    FPTA_PROBE3(txn_commit, txn->level, txn->db_version, rc);
+    if (version && rc == FPTA_SUCCESS)
+      *version = txn->db_version;
+  }
 
 cancelled:
   txn->mdbx_txn = nullptr;
@@ -467,6 +523,7 @@ int fpta_internal_abort(fpta_txn *txn, int errnum, bool txn_maybe_dead) {
    * Однако, могут быть ошибки отката транзакции, что потенциально является
    * более серьезной проблемой. */
 
+  FPTA_PROBE2(internal_abort, txn->level, errnum);
   if (txn->level > fpta_read) {
     /* Чистим кеш dbi-хендлов покалеченных таблиц */
     bool dbi_locked = false;
@@ -508,6 +565,21 @@ int fpta_internal_abort(fpta_txn *txn, int errnum, bool txn_maybe_dead) {
       }
     }
 
+    if (db->changelog_dbi > 0) {
+      unsigned tbl_flags = 0, tbl_state = 0;
+      int err = mdbx_dbi_flags_ex(txn->mdbx_txn, db->changelog_dbi, &tbl_flags,
+                                  &tbl_state);
+      if (err != MDBX_SUCCESS || (tbl_state & MDBX_DBI_CREAT)) {
+        if (!dbi_locked && txn->level < fpta_schema) {
+          err = fpta_mutex_lock(&db->dbi_mutex);
+          if (unlikely(err != 0))
+            return err;
+          dbi_locked = true;
+        }
+        db->changelog_dbi = 0;
+      }
+    }
+
     if (dbi_locked) {
       int err = fpta_mutex_unlock(&db->dbi_mutex);
       assert(err == 0);
@@ -729,6 +801,10 @@ int fpta_db_info(const fpta_db *db, const fpta_txn *txn, fpta_db_stat_t *stat) {
   if (mdbx_info.mi_mode & MDBX_COALESCE)
     stat->regime_flags |= fpta_frendly4compaction;
 
+  if (!db)
+    db = txn->db;
   stat->alterable_schema = db->alterable_schema;
+  fpta_row_cache_stat(db, stat);
+  fpta_async_stat(db, stat);
   return FPTA_SUCCESS;
 }
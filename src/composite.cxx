@@ -31,13 +31,482 @@ static __inline uint64_t add_rotate_xor(uint64_t base, uint64_t addend,
   return (base + addend) ^ rotated;
 }
 
-typedef int (*concat_column_t)(fpta_key &key, const bool tersely,
+enum {
+  /* предел количества элементов составного индекса, для которых поля
+   * собираются единственным проходом по строке */
+  fpta_composite_fastpath_items = 16
+};
+
+static const uint8_t prefix_absent = 0;
+static const uint8_t prefix_present_empty = 42;
+static const uint8_t prefix_present_nonempty = 142;
+
+static int __hot encode_unordered(fpta_key &key,
+                                  const fpta_composite_encoder &self,
+                                  const fptu_field *field) {
+  const uint64_t MARKER_ABSENT = UINT64_C(0x974BC764BAC4C7F);
+  uint64_t *const hash = (uint64_t *)key.mdbx.iov_base;
+  if (unlikely(field == nullptr)) {
+    if (unlikely(!self.nullable))
+      return FPTA_COLUMN_MISSING;
+    /* add absent-marker to resulting hash */
+    *hash = add_rotate_xor(*hash, MARKER_ABSENT);
+  } else {
+    const struct iovec iov = fptu_field_as_iovec(field);
+    /* add value to resulting hash */
+    *hash = t1ha2_atonce(iov.iov_base, iov.iov_len, *hash + field->tag);
+  }
+
+  return FPTA_SUCCESS;
+}
+
+template <bool OBVERSE>
+static int __hot concat_bytes(fpta_key &key, const void *data, size_t length) {
+  uint64_t *const hash = (uint64_t *)key.mdbx.iov_base;
+  assert(hash == (OBVERSE ? &key.place.longkey_obverse.tailhash
+                          : &key.place.longkey_reverse.headhash));
+
+  if (unlikely(length == 0))
+    return FPTA_SUCCESS;
+
+  if (key.mdbx.iov_len <= fpta_max_keylen) {
+    const size_t left = fpta_max_keylen - key.mdbx.iov_len;
+    const size_t chunk = (left >= length) ? length : left;
+
+    if (likely(chunk > 0)) {
+      if (OBVERSE) {
+        /* append bytes to the key */
+        uint8_t *obverse_append =
+            ((uint8_t *)&key.place.longkey_obverse.head) + key.mdbx.iov_len;
+        memcpy(obverse_append, data, chunk);
+        /* update pointer to the end of a chunk */
+        data = (const uint8_t *)data + chunk;
+      } else {
+        /* put bytes ahead of the key */
+        uint8_t *reverse_ahead = ((uint8_t *)&key.place.longkey_reverse.tail) +
+                                 sizeof(key.place.longkey_reverse.tail) -
+                                 key.mdbx.iov_len;
+        memcpy(reverse_ahead - chunk, (const uint8_t *)data + length - chunk,
+               chunk);
+      }
+
+      length -= chunk;
+      if (length == 0) {
+        key.mdbx.iov_len += chunk;
+        return FPTA_SUCCESS;
+      }
+    }
+
+    /* Limit for key-size reached,
+     * continue hashing all of the rest.
+     * Initialize hash value */
+    *hash = 0;
+
+    /* Now key includes hash-value. */
+    key.mdbx.iov_len = sizeof(key.place);
+  }
+
+  assert(key.mdbx.iov_len == fpta_max_keylen + 8);
+  /* add bytes to hash */
+  *hash = t1ha2_atonce(data, length, *hash);
+  return FPTA_SUCCESS;
+}
+
+/* convert to binary-comparable value in the range 0..UINT32_MAX */
+static __inline uint32_t fp32_ordered(uint32_t u32) {
+  return (int32_t(u32) < 0) ? UINT32_C(0xffffFFFF) - u32
+                            : u32 + UINT32_C(0x80000000);
+}
+
+/* convert to binary-comparable value in the range 0..UINT64_MAX */
+static __inline uint64_t fp64_ordered(uint64_t u64) {
+  return (int64_t(u64) < 0) ? UINT64_C(0xffffFFFFffffFFFF) - u64
+                            : u64 + UINT64_C(0x8000000000000000);
+}
+
+template <bool OBVERSE>
+static __inline int encode_absent(fpta_key &key,
+                                  const fpta_composite_encoder &self) {
+  if (unlikely(!self.nullable))
+    return FPTA_COLUMN_MISSING;
+  /* absent-marker or denil-value, prepared by fpta_composite_encoders_init */
+  return concat_bytes<OBVERSE>(key, self.absent, self.absent_length);
+}
+
+template <bool OBVERSE, typename T>
+static __inline int concat_ordered(fpta_key &key,
+                                   const fpta_composite_encoder &self,
+                                   T value) {
+  if (unlikely(self.present_marker))
+    /* add present-marker for fixed-length nullable columns if TERSELY is ON */
+    concat_bytes<OBVERSE>(key, &prefix_present_nonempty, 1);
+
+  /* convert byte order for proper comparison result in a index kind. */
+  value = OBVERSE ? erthink::h2be(value) : erthink::h2le(value);
+  /* concatenate to the resulting key */
+  return concat_bytes<OBVERSE>(key, &value, sizeof(value));
+}
+
+template <fptu_type TYPE, bool OBVERSE>
+static int __hot encode_ordered(fpta_key &key,
+                                const fpta_composite_encoder &self,
+                                const fptu_field *field) {
+  if (unlikely(field == nullptr))
+    return encode_absent<OBVERSE>(key, self);
+
+  const fptu_payload *const payload = field->payload();
+  switch (TYPE) {
+  default:
+    assert(false);
+    return FPTA_EOOPS;
+  case fptu_datetime:
+    return concat_ordered<OBVERSE>(key, self, payload->dt.fixedpoint);
+  case fptu_uint16:
+    return concat_ordered<OBVERSE>(key, self,
+                                   (uint16_t)field->get_payload_uint16());
+  case fptu_uint32:
+    return concat_ordered<OBVERSE>(key, self, payload->u32);
+  case fptu_uint64:
+    return concat_ordered<OBVERSE>(key, self, payload->u64);
+  case fptu_int32:
+    /* rebase signed min-value to binary all-zeros */
+    return concat_ordered<OBVERSE>(key, self,
+                                   uint32_t(payload->i32) ^ UINT32_C(1) << 31);
+  case fptu_int64:
+    /* rebase signed min-value to binary all-zeros */
+    return concat_ordered<OBVERSE>(key, self,
+                                   uint64_t(payload->i64) ^ UINT64_C(1) << 63);
+  case fptu_fp32:
+    return concat_ordered<OBVERSE>(key, self, fp32_ordered(payload->u32));
+  case fptu_fp64:
+    return concat_ordered<OBVERSE>(key, self, fp64_ordered(payload->u64));
+  }
+}
+
+template <bool OBVERSE>
+static int __hot encode_bytes(fpta_key &key, const fpta_composite_encoder &self,
+                              const fptu_field *field) {
+  if (unlikely(field == nullptr))
+    return encode_absent<OBVERSE>(key, self);
+
+  const struct iovec iov = fptu_field_as_iovec(field);
+  if (self.present_marker)
+    /* for variable-length columns add one of present-markers if TERSELY
+     * is OFF, for fixed-length nullable columns if TERSELY is ON */
+    concat_bytes<OBVERSE>(
+        key, iov.iov_len ? &prefix_present_nonempty : &prefix_present_empty,
+        1);
+
+  /* don't need byteorder conversion for string/binary data */
+  return concat_bytes<OBVERSE>(key, iov.iov_base, iov.iov_len);
+}
+
+template <typename T>
+static void encoder_denil(fpta_composite_encoder &encoder, const bool obverse,
+                          T stub) {
+  static_assert(sizeof(stub) <= sizeof(encoder.absent), "Oops");
+  /* convert byte order for proper comparison result in a index kind. */
+  stub = obverse ? erthink::h2be(stub) : erthink::h2le(stub);
+  memcpy(encoder.absent, &stub, sizeof(stub));
+  encoder.absent_length = sizeof(stub);
+}
+
+/* Выбирает специализированную для типа колонки и вида индекса функцию
+ * и заранее формирует маркер либо denil-значение для отсутствующей колонки,
+ * что избавляет от их разбора при каждом формировании ключа. */
+static int __cold encoder_init(fpta_composite_encoder &encoder,
+                               const fpta_index_type index,
+                               const fpta_shove_t shove, unsigned column) {
+  const fptu_type type = fpta_shove2type(shove);
+  const bool obverse = fpta_index_is_obverse(index);
+  const bool tersely = (index & fpta_tersely_composite) ? true : false;
+  encoder.tag = (uint16_t)fptu_make_tag(column, type);
+  encoder.nullable = fpta_column_is_nullable(shove);
+  encoder.present_marker = (type < fptu_cstr) ? encoder.nullable && tersely
+                                              : !tersely;
+  encoder.absent_length = 0;
+  if (fpta_index_is_unordered(index)) {
+    encoder.present_marker = false;
+    encoder.encode = encode_unordered;
+    return FPTA_SUCCESS;
+  }
+
+  if (type >= fptu_cstr ? !tersely : tersely) {
+    /* for variable-length columns add absent-marker to the resulting key,
+     * but only if TERSELY is OFF, for fixed-length columns put absent-marker
+     * instead of denil-value only if TERSELY is ON */
+    encoder.absent[0] = prefix_absent;
+    encoder.absent_length = 1;
+  }
+  const bool denil = type < fptu_cstr && !tersely;
+
+#define ENCODER(TYPE)                                                          \
+  (obverse ? encode_ordered<TYPE, true> : encode_ordered<TYPE, false>)
+
+  switch (type) {
+  default:
+    /* LY: fptu_farray and fptu_nested cases - curently fpta don't
+     * provide indexing such columns. */
+    return FPTA_EOOPS;
+
+  case fptu_96:
+  case fptu_128:
+  case fptu_160:
+  case fptu_256:
+    if (denil) {
+      /* заполнитель выбирается по виду индекса самой колонки, а не
+       * составного индекса, ради совместимости с ранее созданными ключами */
+      encoder.absent_length = fptu_internal_map_t2b[type];
+      assert(encoder.absent_length <= sizeof(encoder.absent));
+      memset(encoder.absent,
+             fpta_index_is_obverse(shove) ? FPTA_DENIL_FIXBIN_OBVERSE
+                                          : FPTA_DENIL_FIXBIN_REVERSE,
+             encoder.absent_length);
+    }
+    /* fall through */
+  case fptu_cstr:
+  case fptu_opaque:
+    encoder.encode = obverse ? encode_bytes<true> : encode_bytes<false>;
+    break;
+
+  case fptu_datetime:
+    if (denil)
+      encoder_denil(encoder, obverse, uint64_t(FPTA_DENIL_DATETIME_BIN));
+    encoder.encode = ENCODER(fptu_datetime);
+    break;
+
+  case fptu_uint16:
+    if (denil)
+      encoder_denil(encoder, obverse,
+                    (uint16_t)numeric_traits<fptu_uint16>::denil(shove));
+    encoder.encode = ENCODER(fptu_uint16);
+    break;
+
+  case fptu_uint32:
+    if (denil)
+      encoder_denil(encoder, obverse,
+                    (uint32_t)numeric_traits<fptu_uint32>::denil(shove));
+    encoder.encode = ENCODER(fptu_uint32);
+    break;
+
+  case fptu_uint64:
+    if (denil)
+      encoder_denil(encoder, obverse,
+                    (uint64_t)numeric_traits<fptu_uint64>::denil(shove));
+    encoder.encode = ENCODER(fptu_uint64);
+    break;
+
+  case fptu_int32:
+    if (denil) {
+      const int32_t stub = (int32_t)numeric_traits<fptu_int32>::denil(shove);
+      /* rebase signed min-value to binary all-zeros */
+      encoder_denil(encoder, obverse, uint32_t(stub) ^ UINT32_C(1) << 31);
+    }
+    encoder.encode = ENCODER(fptu_int32);
+    break;
+
+  case fptu_int64:
+    if (denil) {
+      const int64_t stub = (int64_t)numeric_traits<fptu_int64>::denil(shove);
+      /* rebase signed min-value to binary all-zeros */
+      encoder_denil(encoder, obverse, uint64_t(stub) ^ UINT64_C(1) << 63);
+    }
+    encoder.encode = ENCODER(fptu_int64);
+    break;
+
+  case fptu_fp32:
+    if (denil) {
+      union {
+        float fp32;
+        uint32_t u32;
+      } stub;
+      stub.fp32 = (float)numeric_traits<fptu_fp32>::denil(shove);
+      encoder_denil(encoder, obverse, fp32_ordered(stub.u32));
+    }
+    encoder.encode = ENCODER(fptu_fp32);
+    break;
+
+  case fptu_fp64:
+    if (denil) {
+      union {
+        double fp64;
+        uint64_t u64;
+      } stub;
+      stub.fp64 = (double)numeric_traits<fptu_fp64>::denil(shove);
+      encoder_denil(encoder, obverse, fp64_ordered(stub.u64));
+    }
+    encoder.encode = ENCODER(fptu_fp64);
+    break;
+  }
+#undef ENCODER
+
+  return FPTA_SUCCESS;
+}
+
+int __cold fpta_composite_encoders_init(const fpta_table_schema *const schema,
+                                        fpta_composite_encoder *encoders) {
+  for (size_t column = 0; column < schema->column_count(); ++column) {
+    const fpta_shove_t shove = schema->column_shove(column);
+    if (!fpta_is_indexed(shove))
+      break;
+    if (!fpta_is_composite(shove))
+      continue;
+
+    fpta_table_schema::composite_iter_t begin, end;
+    int rc = schema->composite_list(column, begin, end);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+
+    /* заголовок размещается параллельно счетчику элементов */
+    fpta_composite_encoder *const head =
+        encoders + (begin - 1 - schema->composites_begin());
+    memset(head, 0, sizeof(fpta_composite_encoder));
+    for (auto i = begin; i != end; ++i) {
+      fpta_composite_encoder &encoder = head[1 + (i - begin)];
+      rc = encoder_init(encoder, fpta_shove2index(shove),
+                        schema->column_shove(*i), *i);
+      if (unlikely(rc != FPTA_SUCCESS))
+        return rc;
+      head->tags_mask |= fpta_composite_encoder::tag_bit(encoder.tag);
+    }
+  }
+  return FPTA_SUCCESS;
+}
+
+template <typename LOOKUP>
+static __inline int
+composite_encode(const fpta_table_schema *const schema, size_t column,
+                 const fpta_composite_encoder *const encoders, size_t count,
+                 fpta_key &key, LOOKUP lookup) {
+  const fpta_index_type index = fpta_shove2index(schema->column_shove(column));
+  if (likely(fpta_index_is_unordered(index))) {
+    key.mdbx.iov_base = &key.place.u64;
+    key.mdbx.iov_len = 8;
+    key.place.u64 = 0;
+  } else {
+    key.mdbx.iov_len = 0;
+    key.mdbx.iov_base = fpta_index_is_obverse(index)
+                            ? &key.place.longkey_obverse.tailhash
+                            : &key.place.longkey_reverse.headhash;
+  }
+
+  const bool obverse = fpta_index_is_obverse(index);
+  for (size_t n = 0; n < count; ++n) {
+    const size_t i = obverse ? n : count - 1 - n;
+    int rc = encoders[i].encode(key, encoders[i], lookup(i));
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+  }
+
+  if (unlikely(fpta_index_is_ordered(index))) {
+    assert(key.mdbx.iov_len <= sizeof(key.place));
+    /* setup pointer for an ordered (variable size) key */
+    uint8_t *ptr = (uint8_t *)&key.place;
+    if (fpta_index_is_reverse(index))
+      ptr += sizeof(key.place) - key.mdbx.iov_len;
+    key.mdbx.iov_base = ptr;
+    fpta_index_elide_prefix(schema, column, key);
+  }
+
+  return FPTA_SUCCESS;
+}
+
+int __hot fpta_composite_row2key(const fpta_table_schema *const schema,
+                                 size_t column, const fptu_ro &row,
+                                 fpta_key &key) {
+#ifndef NDEBUG
+  fpta_pollute(&key, sizeof(key), 0);
+#endif
+  assert(column < schema->column_count());
+  const fpta_shove_t shove = schema->column_shove(column);
+  if (unlikely(!fpta_is_composite(shove) || !fpta_is_indexed(shove)))
+    return FPTA_EOOPS;
+
+  /* get list of the composed columns */
+  fpta_table_schema::composite_iter_t begin, end;
+  int rc = schema->composite_list(column, begin, end);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  assert(begin < end);
+  const fpta_composite_encoder *const head = schema->composite_encoders(column);
+  const fpta_composite_encoder *const encoders = head + 1;
+  const size_t count = end - begin;
+
+  if (unlikely(count > fpta_composite_fastpath_items))
+    return composite_encode(
+        schema, column, encoders, count, key, [&](size_t i) {
+          return fptu::lookup(row, begin[i], fptu_get_type(encoders[i].tag));
+        });
+
+  /* collect fields of the composed columns by a single pass over the row,
+   * the first matching field wins as in the fptu::lookup() */
+  const fptu_field *fields[fpta_composite_fastpath_items];
+  std::fill_n(fields, count, nullptr);
+  size_t missing = count;
+  const fptu_field *const fields_end = fptu::end(row);
+  for (const fptu_field *pf = fptu::begin(row); pf < fields_end; ++pf) {
+    if ((head->tags_mask & fpta_composite_encoder::tag_bit(pf->tag)) == 0)
+      continue;
+    for (size_t i = 0; i < count; ++i) {
+      if (encoders[i].tag == pf->tag) {
+        if (fields[i] == nullptr) {
+          fields[i] = pf;
+          --missing;
+        }
+        break;
+      }
+    }
+    if (missing == 0)
+      break;
+  }
+
+  return composite_encode(schema, column, encoders, count, key,
+                          [&fields](size_t i) { return fields[i]; });
+}
+
+int __hot fpta_composite_row2key(fpta_row_fields &row, size_t column,
+                                 fpta_key &key) {
+#ifndef NDEBUG
+  fpta_pollute(&key, sizeof(key), 0);
+#endif
+  const fpta_table_schema *const schema = row.schema;
+  assert(column < schema->column_count());
+  const fpta_shove_t shove = schema->column_shove(column);
+  if (unlikely(!fpta_is_composite(shove) || !fpta_is_indexed(shove)))
+    return FPTA_EOOPS;
+
+  fpta_table_schema::composite_iter_t begin, end;
+  int rc = schema->composite_list(column, begin, end);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  /* fields of the composed columns are taken from the per-row cache,
+   * which is shared with other indexes of the same row */
+  assert(begin < end);
+  const fpta_composite_encoder *const encoders =
+      schema->composite_encoders(column) + 1;
+  return composite_encode(schema, column, encoders, end - begin, key,
+                          [&](size_t i) {
+                            return row.lookup(begin[i],
+                                              fptu_get_type(encoders[i].tag));
+                          });
+}
+
+#if FPTA_ENABLE_TESTS
+
+/* Прежняя реализация формирования составных ключей, с поиском каждого
+ * элемента в строке посредством fptu::lookup() и разбором типа колонки
+ * и вида индекса при каждом вызове. Сохранена только для тестов и fpta_bench,
+ * как эталон для сравнения ключей и производительности. */
+
+typedef int (*legacy_concat_t)(fpta_key &key, const bool tersely,
                                const fpta_table_schema *const schema,
                                const fptu_ro &row, unsigned column);
 
-static int __hot concat_unordered(fpta_key &key, const bool unused_tersely,
-                                  const fpta_table_schema *const schema,
-                                  const fptu_ro &row, unsigned column) {
+static int legacy_concat_unordered(fpta_key &key, const bool unused_tersely,
+                                   const fpta_table_schema *const schema,
+                                   const fptu_ro &row, unsigned column) {
   (void)unused_tersely;
   const uint64_t MARKER_ABSENT = UINT64_C(0x974BC764BAC4C7F);
   uint64_t *const hash = (uint64_t *)key.mdbx.iov_base;
@@ -58,7 +527,7 @@ static int __hot concat_unordered(fpta_key &key, const bool unused_tersely,
   return FPTA_SUCCESS;
 }
 
-static int __hot concat_bytes(fpta_key &key, const void *data, size_t length) {
+static int legacy_concat_bytes(fpta_key &key, const void *data, size_t length) {
   uint64_t *const hash = (uint64_t *)key.mdbx.iov_base;
   assert(hash == &key.place.longkey_obverse.tailhash ||
          hash == &key.place.longkey_reverse.headhash);
@@ -110,16 +579,13 @@ static int __hot concat_bytes(fpta_key &key, const void *data, size_t length) {
   return FPTA_SUCCESS;
 }
 
-static int __hot concat_ordered(fpta_key &key, const bool tersely,
-                                const fpta_table_schema *const schema,
-                                const fptu_ro &row, unsigned column) {
+static int legacy_concat_ordered(fpta_key &key, const bool tersely,
+                                 const fpta_table_schema *const schema,
+                                 const fptu_ro &row, unsigned column) {
   const fpta_shove_t shove = schema->column_shove(column);
   const fptu_type type = fpta_shove2type(shove);
   const fptu_field *field = fptu::lookup(row, column, type);
 
-  const uint8_t prefix_absent = 0;
-  const uint8_t prefix_present_empty = 42;
-  const uint8_t prefix_present_nonempty = 142;
   const bool obverse = key.mdbx.iov_base == &key.place.longkey_obverse.tailhash;
 
   if (unlikely(field == nullptr)) {
@@ -130,11 +596,11 @@ static int __hot concat_ordered(fpta_key &key, const bool tersely,
       /* for variable-length columns add absent-marker to the resulting key,
        * but only if TERSELY is OFF */
       return unlikely(tersely) ? (int)FPTA_SUCCESS
-                               : concat_bytes(key, &prefix_absent, 1);
+                               : legacy_concat_bytes(key, &prefix_absent, 1);
     } else if (unlikely(tersely)) {
       /* for fixed-length columns put absent-marker instead of denil-value
        * only if TERSELY is ON */
-      return concat_bytes(key, &prefix_absent, 1);
+      return legacy_concat_bytes(key, &prefix_absent, 1);
     }
 
     switch (type) {
@@ -152,7 +618,7 @@ static int __hot concat_ordered(fpta_key &key, const bool tersely,
                                : FPTA_DENIL_FIXBIN_REVERSE;
       memset(&stub, fillbyte, length);
       /* concatenate to the resulting key */
-      return concat_bytes(key, stub, length);
+      return legacy_concat_bytes(key, stub, length);
     }
 
     case fptu_datetime: {
@@ -161,7 +627,7 @@ static int __hot concat_ordered(fpta_key &key, const bool tersely,
       stub.fixedpoint = obverse ? erthink::h2be(FPTA_DENIL_DATETIME_BIN)
                                 : erthink::h2le(FPTA_DENIL_DATETIME_BIN);
       /* concatenate to the resulting key */
-      return concat_bytes(key, &stub, sizeof(stub));
+      return legacy_concat_bytes(key, &stub, sizeof(stub));
     }
 
     case fptu_uint16: {
@@ -169,7 +635,7 @@ static int __hot concat_ordered(fpta_key &key, const bool tersely,
       /* convert byte order for proper comparison result in a index kind. */
       stub = obverse ? erthink::h2be(stub) : erthink::h2le(stub);
       /* concatenate to the resulting key */
-      return concat_bytes(key, &stub, sizeof(stub));
+      return legacy_concat_bytes(key, &stub, sizeof(stub));
     }
 
     case fptu_uint32: {
@@ -177,7 +643,7 @@ static int __hot concat_ordered(fpta_key &key, const bool tersely,
       /* convert byte order for proper comparison result in a index kind. */
       stub = obverse ? erthink::h2be(stub) : erthink::h2le(stub);
       /* concatenate to the resulting key */
-      return concat_bytes(key, &stub, sizeof(stub));
+      return legacy_concat_bytes(key, &stub, sizeof(stub));
     }
 
     case fptu_uint64: {
@@ -185,7 +651,7 @@ static int __hot concat_ordered(fpta_key &key, const bool tersely,
       /* convert byte order for proper comparison result in a index kind. */
       stub = obverse ? erthink::h2be(stub) : erthink::h2le(stub);
       /* concatenate to the resulting key */
-      return concat_bytes(key, &stub, sizeof(stub));
+      return legacy_concat_bytes(key, &stub, sizeof(stub));
     }
 
     case fptu_int32: {
@@ -194,7 +660,7 @@ static int __hot concat_ordered(fpta_key &key, const bool tersely,
       /* convert byte order for proper comparison result in a index kind. */
       stub = obverse ? erthink::h2be(stub) : erthink::h2le(stub);
       /* concatenate to the resulting key */
-      return concat_bytes(key, &stub, sizeof(stub));
+      return legacy_concat_bytes(key, &stub, sizeof(stub));
     }
 
     case fptu_int64: {
@@ -203,7 +669,7 @@ static int __hot concat_ordered(fpta_key &key, const bool tersely,
       /* convert byte order for proper comparison result in a index kind. */
       stub = obverse ? erthink::h2be(stub) : erthink::h2le(stub);
       /* concatenate to the resulting key */
-      return concat_bytes(key, &stub, sizeof(stub));
+      return legacy_concat_bytes(key, &stub, sizeof(stub));
     }
 
     case fptu_fp32: {
@@ -219,7 +685,7 @@ static int __hot concat_ordered(fpta_key &key, const bool tersely,
       /* convert byte order for proper comparison result in a index kind. */
       stub.u32 = obverse ? erthink::h2be(stub.u32) : erthink::h2le(stub.u32);
       /* concatenate to the resulting key */
-      return concat_bytes(key, &stub, sizeof(stub));
+      return legacy_concat_bytes(key, &stub, sizeof(stub));
     }
 
     case fptu_fp64: {
@@ -235,14 +701,14 @@ static int __hot concat_ordered(fpta_key &key, const bool tersely,
       /* convert byte order for proper comparison result in a index kind. */
       stub.u64 = obverse ? erthink::h2be(stub.u64) : erthink::h2le(stub.u64);
       /* concatenate to the resulting key */
-      return concat_bytes(key, &stub, sizeof(stub));
+      return legacy_concat_bytes(key, &stub, sizeof(stub));
     }
     }
   }
 
   if (type < fptu_cstr && fpta_column_is_nullable(shove) && unlikely(tersely)) {
     /* add present-marker for fixed-length nullable columns if TERSELY is ON */
-    concat_bytes(key, &prefix_present_nonempty, 1);
+    legacy_concat_bytes(key, &prefix_present_nonempty, 1);
   }
 
   switch (type) {
@@ -257,13 +723,13 @@ static int __hot concat_ordered(fpta_key &key, const bool tersely,
     if (likely(!tersely) && type >= fptu_cstr) {
       /* for variable-length columns, add one of present-markers,
        * but only if TERSELY is OFF */
-      concat_bytes(
+      legacy_concat_bytes(
           key, iov.iov_len ? &prefix_present_nonempty : &prefix_present_empty,
           1);
     }
 
     /* don't need byteorder conversion for string/binary data */
-    return concat_bytes(key, iov.iov_base, iov.iov_len);
+    return legacy_concat_bytes(key, iov.iov_base, iov.iov_len);
   }
 
   case fptu_datetime: {
@@ -272,7 +738,7 @@ static int __hot concat_ordered(fpta_key &key, const bool tersely,
     value.fixedpoint = obverse ? erthink::h2be(value.fixedpoint)
                                : erthink::h2le(value.fixedpoint);
     /* concatenate to the resulting key */
-    return concat_bytes(key, &value, sizeof(value));
+    return legacy_concat_bytes(key, &value, sizeof(value));
   }
 
   case fptu_uint16: {
@@ -280,7 +746,7 @@ static int __hot concat_ordered(fpta_key &key, const bool tersely,
     /* convert byte order for proper comparison result in a index kind. */
     value = obverse ? erthink::h2be(value) : erthink::h2le(value);
     /* concatenate to the resulting key */
-    return concat_bytes(key, &value, sizeof(value));
+    return legacy_concat_bytes(key, &value, sizeof(value));
   }
 
   case fptu_uint32: {
@@ -288,7 +754,7 @@ static int __hot concat_ordered(fpta_key &key, const bool tersely,
     /* convert byte order for proper comparison result in a index kind. */
     value = obverse ? erthink::h2be(value) : erthink::h2le(value);
     /* concatenate to the resulting key */
-    return concat_bytes(key, &value, sizeof(value));
+    return legacy_concat_bytes(key, &value, sizeof(value));
   }
 
   case fptu_uint64: {
@@ -296,7 +762,7 @@ static int __hot concat_ordered(fpta_key &key, const bool tersely,
     /* convert byte order for proper comparison result in a index kind. */
     value = obverse ? erthink::h2be(value) : erthink::h2le(value);
     /* concatenate to the resulting key */
-    return concat_bytes(key, &value, sizeof(value));
+    return legacy_concat_bytes(key, &value, sizeof(value));
   }
 
   case fptu_int32: {
@@ -305,7 +771,7 @@ static int __hot concat_ordered(fpta_key &key, const bool tersely,
     /* convert byte order for proper comparison result in a index kind. */
     value = obverse ? erthink::h2be(value) : erthink::h2le(value);
     /* concatenate to the resulting key */
-    return concat_bytes(key, &value, sizeof(value));
+    return legacy_concat_bytes(key, &value, sizeof(value));
   }
 
   case fptu_int64: {
@@ -314,7 +780,7 @@ static int __hot concat_ordered(fpta_key &key, const bool tersely,
     /* convert byte order for proper comparison result in a index kind. */
     value = obverse ? erthink::h2be(value) : erthink::h2le(value);
     /* concatenate to the resulting key */
-    return concat_bytes(key, &value, sizeof(value));
+    return legacy_concat_bytes(key, &value, sizeof(value));
   }
 
   case fptu_fp32: {
@@ -330,7 +796,7 @@ static int __hot concat_ordered(fpta_key &key, const bool tersely,
     /* convert byte order for proper comparison result in a index kind. */
     value.u32 = obverse ? erthink::h2be(value.u32) : erthink::h2le(value.u32);
     /* concatenate to the resulting key */
-    return concat_bytes(key, &value, sizeof(value));
+    return legacy_concat_bytes(key, &value, sizeof(value));
   }
 
   case fptu_fp64: {
@@ -346,14 +812,13 @@ static int __hot concat_ordered(fpta_key &key, const bool tersely,
     /* convert byte order for proper comparison result in a index kind. */
     value.u64 = obverse ? erthink::h2be(value.u64) : erthink::h2le(value.u64);
     /* concatenate to the resulting key */
-    return concat_bytes(key, &value, sizeof(value));
+    return legacy_concat_bytes(key, &value, sizeof(value));
   }
   }
 }
 
-int __hot fpta_composite_row2key(const fpta_table_schema *const schema,
-                                 size_t column, const fptu_ro &row,
-                                 fpta_key &key) {
+static int legacy_row2key(const fpta_table_schema *const schema,
+                          size_t column, const fptu_ro &row, fpta_key &key) {
 #ifndef NDEBUG
   fpta_pollute(&key, sizeof(key), 0);
 #endif
@@ -370,18 +835,18 @@ int __hot fpta_composite_row2key(const fpta_table_schema *const schema,
     return rc;
 
   assert(begin < end);
-  concat_column_t concat;
+  legacy_concat_t concat;
   if (likely(fpta_index_is_unordered(index))) {
     key.mdbx.iov_base = &key.place.u64;
     key.mdbx.iov_len = 8;
     key.place.u64 = 0;
-    concat = concat_unordered;
+    concat = legacy_concat_unordered;
   } else {
     key.mdbx.iov_len = 0;
     key.mdbx.iov_base = fpta_index_is_obverse(index)
                             ? &key.place.longkey_obverse.tailhash
                             : &key.place.longkey_reverse.headhash;
-    concat = concat_ordered;
+    concat = legacy_concat_ordered;
   }
 
   const bool tersely = (index & fpta_tersely_composite) ? true : false;
@@ -406,11 +871,38 @@ int __hot fpta_composite_row2key(const fpta_table_schema *const schema,
     if (fpta_index_is_reverse(index))
       ptr += sizeof(key.place) - key.mdbx.iov_len;
     key.mdbx.iov_base = ptr;
+    fpta_index_elide_prefix(schema, column, key);
   }
 
   return FPTA_SUCCESS;
 }
 
+int __fpta_composite_row2key_legacy(fptu_ro row, const fpta_name *column_id,
+                                    fpta_value4key *value4key) {
+  if (unlikely(value4key == nullptr))
+    return FPTA_EINVAL;
+  int rc = fpta_id_validate(column_id, fpta_column_with_schema);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+  if (unlikely(!fpta_column_is_composite(column_id)))
+    return FPTA_EINVAL;
+
+  static_assert(sizeof(fpta_key) == sizeof(value4key->key_buffer),
+                "expect equal");
+  fpta_key *key = (fpta_key *)value4key->key_buffer;
+  rc = legacy_row2key(column_id->column.table->table_schema,
+                      column_id->column.num, row, *key);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  value4key->value.type = fpta_shoved;
+  value4key->value.binary_length = (unsigned)key->mdbx.iov_len;
+  value4key->value.binary_data = key->mdbx.iov_base;
+  return FPTA_SUCCESS;
+}
+
+#endif /* FPTA_ENABLE_TESTS */
+
 //----------------------------------------------------------------------------
 
 int fpta_composite_column_count_ex(const fpta_name *composite_id,
@@ -23,9 +23,28 @@ static int fpta_cursor_seek(fpta_cursor *cursor,
                             const MDBX_val *mdbx_seek_key,
                             const MDBX_val *mdbx_seek_data);
 
+/* Копирует длинный ключ границы диапазона в место за курсором, так как
+ * для таких ключей fpta_index_value2key() не делает копию. */
+static void fpta_cursor_hold_key(fpta_cursor *cursor, fpta_key &key,
+                                 bool range_to) {
+  if (likely(key.mdbx.iov_len <= fpta_max_keylen))
+    return;
+  assert(key.mdbx.iov_len <=
+         cursor->table_schema()->key_limit(cursor->column_number));
+  key.mdbx.iov_base = memcpy(cursor->long_key_place(range_to),
+                             key.mdbx.iov_base, key.mdbx.iov_len);
+}
+
+static void fpta_cursor_account(fpta_cursor *cursor) {
+  fpta_metrics_account(cursor->db, cursor->metrics_table_shove,
+                       cursor->metrics_index_shove, cursor->metrics);
+}
+
 int fpta_cursor_close(fpta_cursor *cursor) {
   int rc = fpta_cursor_validate(cursor, fpta_read);
 
+  if (likely(rc == FPTA_SUCCESS))
+    fpta_cursor_account(cursor);
   if (likely(rc == FPTA_SUCCESS) || rc == FPTA_TXN_CANCELLED) {
     mdbx_cursor_close(cursor->mdbx_cursor);
     fpta_cursor_free(cursor->db, cursor);
@@ -35,6 +54,55 @@ int fpta_cursor_close(fpta_cursor *cursor) {
   return rc;
 }
 
+/* Курсор по хэш-индексу перебирает строки таблицы в порядке первичного
+ * индекса, поэтому заданные значениями границы диапазона заменяются
+ * значениями первичного ключа соответствующих строк. Отсутствие значения
+ * в хэш-индексе делает выборку пустой. */
+static int fpta_cursor_hash_bounds(fpta_txn *txn, fpta_name *column_id,
+                                   MDBX_dbi idx_handle, fpta_value &range_from,
+                                   fpta_value &range_to, bool &nothing) {
+  const fpta_table_schema *const schema = column_id->column.table->table_schema;
+  const unsigned column = column_id->column.num;
+  fpta_key from_key, to_key;
+  if (range_from.type <= fpta_shoved) {
+    int rc = fpta_index_value2key(schema, column, range_from, from_key);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+  }
+  if (range_to.type <= fpta_shoved) {
+    int rc = fpta_index_value2key(schema, column, range_to, to_key);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+    /* как и для других неупорядоченных индексов допустима только точка */
+    if (range_from.type <= fpta_shoved &&
+        !fpta_is_same(from_key.mdbx, to_key.mdbx))
+      return FPTA_NO_INDEX;
+  }
+
+  nothing = false;
+  fpta_value *const bounds[2] = {&range_from, &range_to};
+  fpta_key *const keys[2] = {&from_key, &to_key};
+  for (size_t i = 0; i < 2; ++i) {
+    if (bounds[i]->type > fpta_shoved)
+      continue;
+    MDBX_val pk_key;
+    int rc =
+        fpta_hash_get(txn->mdbx_txn, idx_handle, keys[i]->mdbx, &pk_key);
+    if (rc == MDBX_NOTFOUND) {
+      nothing = true;
+      range_from = fpta_value_begin();
+      range_to = fpta_value_end();
+      return FPTA_SUCCESS;
+    }
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    rc = fpta_index_key2value(schema, 0, pk_key, *bounds[i]);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+  }
+  return FPTA_SUCCESS;
+}
+
 int fpta_cursor_open(fpta_txn *txn, fpta_name *column_id, fpta_value range_from,
                      fpta_value range_to, fpta_filter *filter,
                      fpta_cursor_options options, fpta_cursor **pcursor) {
@@ -61,6 +129,8 @@ int fpta_cursor_open(fpta_txn *txn, fpta_name *column_id, fpta_value range_from,
   if (unlikely(rc != FPTA_SUCCESS))
     return rc;
 
+  fpta_latency_scope latency(txn->db, fpta_latency_cursor_open);
+
   if (unlikely(!fpta_is_indexed(column_id->shove)))
     return FPTA_NO_INDEX;
 
@@ -78,11 +148,23 @@ int fpta_cursor_open(fpta_txn *txn, fpta_name *column_id, fpta_value range_from,
   if (unlikely(rc != FPTA_SUCCESS))
     return rc;
 
-  const fpta_index_type index = fpta_shove2index(column_id->shove);
+  fpta_index_type index = fpta_shove2index(column_id->shove);
   if (fpta_index_is_unordered(index) &&
       unlikely(fpta_cursor_is_ordered(options)))
     return FPTA_NO_INDEX;
 
+  unsigned column = column_id->column.num;
+  bool nothing = false;
+  if (table_id->table_schema->is_hash_index(column)) {
+    rc = fpta_cursor_hash_bounds(txn, column_id, idx_handle, range_from,
+                                 range_to, nothing);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+    column = 0;
+    idx_handle = tbl_handle;
+    index = fpta_shove2index(table_id->table_schema->column_shove(0));
+  }
+
   rc = fpta_name_refresh_filter(txn, column_id->column.table, filter);
   if (unlikely(rc != FPTA_SUCCESS))
     return rc;
@@ -91,7 +173,9 @@ int fpta_cursor_open(fpta_txn *txn, fpta_name *column_id, fpta_value range_from,
     return FPTA_EINVAL;
 
   fpta_db *db = txn->db;
-  fpta_cursor *cursor = fpta_cursor_alloc(db);
+  const size_t key_limit = table_id->table_schema->key_limit(column);
+  const bool long_keys = key_limit > fpta_max_keylen;
+  fpta_cursor *cursor = fpta_cursor_alloc(db, long_keys ? key_limit * 2 : 0);
   if (unlikely(cursor == nullptr))
     return FPTA_ENOMEM;
 
@@ -101,25 +185,33 @@ int fpta_cursor_open(fpta_txn *txn, fpta_name *column_id, fpta_value range_from,
                     ~fpta_zeroed_range_is_point;
   cursor->txn = txn;
   cursor->table_id = table_id;
-  cursor->column_number = column_id->column.num;
+  cursor->column_number = column;
+  cursor->metrics_table_shove = table_id->shove;
+  cursor->metrics_index_shove = column_id->shove;
   cursor->tbl_handle = tbl_handle;
   cursor->idx_handle = idx_handle;
 
   assert(cursor->seek_range_flags == 0);
+  if (unlikely(nothing))
+    cursor->seek_range_flags = fpta_cursor::need_nothing;
   if (range_from.type <= fpta_shoved) {
-    rc = fpta_index_value2key(cursor->index_shove(), range_from,
-                              cursor->range_from_key, true);
+    rc = fpta_index_value2key(cursor->table_schema(), cursor->column_number,
+                              range_from, cursor->range_from_key, true);
     if (unlikely(rc != FPTA_SUCCESS))
       goto bailout;
+    if (unlikely(long_keys))
+      fpta_cursor_hold_key(cursor, cursor->range_from_key, false);
     assert(cursor->range_from_key.mdbx.iov_base != nullptr);
     cursor->seek_range_flags |= fpta_cursor::need_cmp_range_from;
   }
 
   if (range_to.type <= fpta_shoved) {
-    rc = fpta_index_value2key(cursor->index_shove(), range_to,
-                              cursor->range_to_key, true);
+    rc = fpta_index_value2key(cursor->table_schema(), cursor->column_number,
+                              range_to, cursor->range_to_key, true);
     if (unlikely(rc != FPTA_SUCCESS))
       goto bailout;
+    if (unlikely(long_keys))
+      fpta_cursor_hold_key(cursor, cursor->range_to_key, true);
     assert(cursor->range_to_key.mdbx.iov_base != nullptr);
     cursor->seek_range_flags |= fpta_cursor::need_cmp_range_to;
   }
@@ -187,10 +279,12 @@ int fpta_cursor_open(fpta_txn *txn, fpta_name *column_id, fpta_value range_from,
       goto bailout;
   }
 
+  FPTA_PROBE3(cursor_open, table_id->shove, column_id->shove, rc);
   *pcursor = cursor;
   return FPTA_SUCCESS;
 
 bailout:
+  FPTA_PROBE3(cursor_open, table_id->shove, column_id->shove, rc);
   if (cursor->mdbx_cursor)
     mdbx_cursor_close(cursor->mdbx_cursor);
   fpta_cursor_free(db, cursor);
@@ -314,6 +408,10 @@ static int fpta_cursor_seek(fpta_cursor *cursor,
     }
   }
 
+  if (unlikely(cursor->seek_range_flags & fpta_cursor::need_nothing))
+    /* значение границы диапазона отсутствует в хэш-индексе */
+    rc = MDBX_NOTFOUND;
+
   if (unlikely(cursor->seek_range_flags == fpta_cursor::need_key4epsilon)) {
     /* Если при установленном флажке fpta_zeroed_range_is_point не задана
        граница диапазона, то значит был передан псевдо-тип fpta_epsilon в
@@ -324,13 +422,19 @@ static int fpta_cursor_seek(fpta_cursor *cursor,
     assert(cursor->range_from_key.mdbx.iov_base == nullptr &&
            cursor->range_to_key.mdbx.iov_base == nullptr);
     assert(mdbx_seek_op == MDBX_FIRST || mdbx_seek_op == MDBX_LAST);
-    assert(cursor->current.iov_len <= sizeof(cursor->range_from_key.place));
+    const size_t key_limit =
+        std::max(sizeof(cursor->range_from_key.place),
+                 cursor->table_schema()->key_limit(cursor->column_number));
+    assert(cursor->current.iov_len <= key_limit);
     cursor->range_from_key.mdbx.iov_len =
-        std::min(cursor->current.iov_len,
-                 /* paranoia */ sizeof(cursor->range_from_key.place));
+        std::min(cursor->current.iov_len, /* paranoia */ key_limit);
     cursor->range_from_key.mdbx.iov_base =
-        ::memcpy(&cursor->range_from_key.place, cursor->current.iov_base,
-                 cursor->range_from_key.mdbx.iov_len);
+        (cursor->range_from_key.mdbx.iov_len <=
+         sizeof(cursor->range_from_key.place))
+            ? static_cast<void *>(&cursor->range_from_key.place)
+            : cursor->long_key_place(false);
+    ::memcpy(cursor->range_from_key.mdbx.iov_base, cursor->current.iov_base,
+             cursor->range_from_key.mdbx.iov_len);
     cursor->range_to_key.mdbx = cursor->range_from_key.mdbx;
     cursor->seek_range_state = cursor->seek_range_flags =
         fpta_cursor::need_cmp_range_both;
@@ -481,6 +585,8 @@ int fpta_cursor_move(fpta_cursor *cursor, fpta_seek_operations op) {
   if (unlikely(rc != FPTA_SUCCESS))
     return rc;
 
+  fpta_latency_scope latency(cursor->db, fpta_latency_cursor_move);
+
   if (unlikely(op < fpta_first || op > fpta_key_prev)) {
     cursor->set_poor();
     return FPTA_EFLAG;
@@ -603,6 +709,42 @@ int fpta_cursor_move(fpta_cursor *cursor, fpta_seek_operations op) {
                           nullptr);
 }
 
+/* Устанавливает курсор точно на заданную строку, в том числе среди
+ * дубликатов индекса. В отличие от fpta_cursor_locate() для первичного
+ * индекса с дубликатами сравнивается вся строка, что необходимо для
+ * повторного позиционирования на ранее прочитанную строку. */
+int fpta_cursor_locate_row(fpta_cursor *cursor, const fptu_ro &row) {
+  fpta_key seek_key, pk_key;
+  int rc = fpta_index_row2key(cursor->table_schema(), cursor->column_number,
+                              row, seek_key, false);
+  if (unlikely(rc != FPTA_SUCCESS)) {
+    cursor->set_poor();
+    return rc;
+  }
+
+  MDBX_cursor_op mdbx_seek_op = MDBX_SET_KEY;
+  const MDBX_val *mdbx_seek_data = nullptr;
+  if (!fpta_index_is_unique(cursor->index_shove())) {
+    if (fpta_index_is_primary(cursor->index_shove()))
+      mdbx_seek_data = &row.sys;
+    else {
+      rc = fpta_index_row2key(cursor->table_schema(), 0, row, pk_key, false);
+      if (unlikely(rc != FPTA_SUCCESS)) {
+        cursor->set_poor();
+        return rc;
+      }
+      mdbx_seek_data = &pk_key.mdbx;
+    }
+    mdbx_seek_op = MDBX_GET_BOTH;
+  }
+
+  rc = fpta_cursor_seek(cursor, mdbx_seek_op, MDBX_NEXT, &seek_key.mdbx,
+                        mdbx_seek_data);
+  if (unlikely(rc != FPTA_SUCCESS))
+    cursor->set_poor();
+  return rc;
+}
+
 int fpta_cursor_locate(fpta_cursor *cursor, bool exactly, const fpta_value *key,
                        const fptu_ro *row) {
   int rc = fpta_cursor_validate(cursor, fpta_read);
@@ -633,7 +775,8 @@ int fpta_cursor_locate(fpta_cursor *cursor, bool exactly, const fpta_value *key,
   if (key) {
     /* Поиск по значению проиндексированной колонки, конвертируем его в ключ
      * для поиска по индексу. Дополнительных данных для поиска нет. */
-    rc = fpta_index_value2key(cursor->index_shove(), *key, seek_key, false);
+    rc = fpta_index_value2key(cursor->table_schema(), cursor->column_number,
+                              *key, seek_key, false);
     if (unlikely(rc != FPTA_SUCCESS)) {
       cursor->set_poor();
       return rc;
@@ -697,6 +840,8 @@ int fpta_cursor_locate(fpta_cursor *cursor, bool exactly, const fpta_value *key,
                         fpta_cursor_is_descending(cursor->options) ? MDBX_PREV
                                                                    : MDBX_NEXT,
                         &seek_key.mdbx, mdbx_seek_data);
+  FPTA_PROBE3(cursor_seek, cursor->metrics_table_shove, seek_key.mdbx.iov_len,
+              rc);
   if (unlikely(rc != FPTA_SUCCESS)) {
     cursor->set_poor();
     return rc;
@@ -878,7 +1023,8 @@ int fpta_cursor_key(fpta_cursor *cursor, fpta_value *key) {
   if (unlikely(!cursor->is_filled()))
     return cursor->unladed_state();
 
-  rc = fpta_index_key2value(cursor->index_shove(), cursor->current, *key);
+  rc = fpta_index_key2value(cursor->table_schema(), cursor->column_number,
+                            cursor->current, *key);
   return rc;
 }
 
@@ -890,15 +1036,22 @@ int fpta_cursor_delete(fpta_cursor *cursor) {
   if (unlikely(!cursor->is_filled()))
     return cursor->unladed_state();
 
+  const bool changelog = fpta_changelog_enabled(cursor->txn->db);
+  MDBX_val pk_key;
   cursor->metrics.deletions += 1;
   if (!cursor->table_schema()->has_secondary()) {
+    pk_key = cursor->current;
+    if (changelog && pk_key.iov_len > 0) {
+      /* ключ будет утрачен при удалении, а нужен для журнала изменений */
+      void *buffer = alloca(pk_key.iov_len);
+      pk_key.iov_base = memcpy(buffer, pk_key.iov_base, pk_key.iov_len);
+    }
     rc = mdbx_cursor_del(cursor->mdbx_cursor, 0);
     if (unlikely(rc != FPTA_SUCCESS)) {
       cursor->set_poor();
       return rc;
     }
   } else {
-    MDBX_val pk_key;
     if (fpta_index_is_primary(cursor->index_shove())) {
       pk_key = cursor->current;
       if (pk_key.iov_len > 0 &&
@@ -915,6 +1068,11 @@ int fpta_cursor_delete(fpta_cursor *cursor) {
         cursor->set_poor();
         return (rc != MDBX_NOTFOUND) ? rc : (int)FPTA_INDEX_CORRUPTED;
       }
+      if (changelog && pk_key.iov_len > 0) {
+        /* значение PK во вторичном индексе будет удалено */
+        void *buffer = alloca(pk_key.iov_len);
+        pk_key.iov_base = memcpy(buffer, pk_key.iov_base, pk_key.iov_len);
+      }
     }
 
     fptu_ro row;
@@ -942,8 +1100,9 @@ int fpta_cursor_delete(fpta_cursor *cursor) {
       return rc;
     }
 
-    rc = fpta_secondary_remove(cursor->txn, cursor->table_schema(), pk_key, row,
-                               cursor->column_number);
+    fpta_row_fields fields(cursor->table_schema(), row);
+    rc = fpta_secondary_remove(cursor->txn, cursor->table_schema(), pk_key,
+                               fields, cursor->column_number);
     if (unlikely(rc != MDBX_SUCCESS)) {
       cursor->set_poor();
       return fpta_internal_abort(cursor->txn, rc);
@@ -958,6 +1117,15 @@ int fpta_cursor_delete(fpta_cursor *cursor) {
     }
   }
 
+  if (changelog) {
+    rc = fpta_changelog_record(cursor->txn, cursor->table_schema(),
+                               fpta_change_delete, pk_key, nullptr);
+    if (unlikely(rc != FPTA_SUCCESS)) {
+      cursor->set_poor();
+      return fpta_internal_abort(cursor->txn, rc);
+    }
+  }
+
   if (fpta_cursor_is_descending(cursor->options)) {
     /* Для курсора с обратным порядком строк требуется перейти к предыдущей
      * строке, в том числе подходящей под условие фильтрации. */
@@ -989,9 +1157,10 @@ int fpta_cursor_validate_update_ex(fpta_cursor *cursor, fptu_ro new_row_value,
   if (unlikely(!cursor->is_filled()))
     return cursor->unladed_state();
 
+  fpta_row_fields new_fields(cursor->table_schema(), new_row_value);
   fpta_key column_key;
-  rc = fpta_index_row2key(cursor->table_schema(), cursor->column_number,
-                          new_row_value, column_key, false);
+  rc = fpta_index_row2key(new_fields, cursor->column_number, column_key,
+                          false);
   if (unlikely(rc != FPTA_SUCCESS))
     return rc;
 
@@ -999,7 +1168,7 @@ int fpta_cursor_validate_update_ex(fpta_cursor *cursor, fptu_ro new_row_value,
     return FPTA_KEY_MISMATCH;
 
   if ((op & fpta_skip_nonnullable_check) == 0) {
-    rc = fpta_check_nonnullable(cursor->table_schema(), new_row_value);
+    rc = fpta_check_nonnullable(new_fields);
     if (unlikely(rc != FPTA_SUCCESS))
       return rc;
   }
@@ -1014,8 +1183,9 @@ int fpta_cursor_validate_update_ex(fpta_cursor *cursor, fptu_ro new_row_value,
       return rc;
 
     cursor->metrics.uniq_checks += 1;
+    fpta_row_fields present_fields(cursor->table_schema(), present_row);
     return fpta_check_secondary_uniq(cursor->txn, cursor->table_schema(),
-                                     present_row, new_row_value, 0);
+                                     present_fields, new_fields, 0);
   }
 
   MDBX_val present_pk_key;
@@ -1024,8 +1194,7 @@ int fpta_cursor_validate_update_ex(fpta_cursor *cursor, fptu_ro new_row_value,
     return rc;
 
   fpta_key new_pk_key;
-  rc = fpta_index_row2key(cursor->table_schema(), 0, new_row_value, new_pk_key,
-                          false);
+  rc = fpta_index_row2key(new_fields, 0, new_pk_key, false);
   if (unlikely(rc != FPTA_SUCCESS))
     return rc;
 
@@ -1036,8 +1205,9 @@ int fpta_cursor_validate_update_ex(fpta_cursor *cursor, fptu_ro new_row_value,
     return (rc != MDBX_NOTFOUND) ? rc : (int)FPTA_INDEX_CORRUPTED;
 
   cursor->metrics.uniq_checks += 1;
+  fpta_row_fields present_fields(cursor->table_schema(), present_row);
   return fpta_check_secondary_uniq(cursor->txn, cursor->table_schema(),
-                                   present_row, new_row_value,
+                                   present_fields, new_fields,
                                    cursor->column_number);
 }
 
@@ -1050,13 +1220,14 @@ int fpta_cursor_update(fpta_cursor *cursor, fptu_ro new_row_value) {
     return cursor->unladed_state();
 
   const fpta_table_schema *table_def = cursor->table_schema();
-  rc = fpta_check_nonnullable(table_def, new_row_value);
+  fpta_row_fields new_fields(table_def, new_row_value);
+  rc = fpta_check_nonnullable(new_fields);
   if (unlikely(rc != FPTA_SUCCESS))
     return rc;
 
   fpta_key column_key;
-  rc = fpta_index_row2key(table_def, cursor->column_number, new_row_value,
-                          column_key, false);
+  rc = fpta_index_row2key(new_fields, cursor->column_number, column_key,
+                          false);
   if (unlikely(rc != FPTA_SUCCESS))
     return rc;
 
@@ -1073,9 +1244,19 @@ int fpta_cursor_update(fpta_cursor *cursor, fptu_ro new_row_value) {
         mdbx_is_dirty(cursor->txn->mdbx_txn, cursor->current.iov_base)) {
       rc = cursor->bring(&cursor->current, nullptr, MDBX_GET_CURRENT);
     }
-    if (unlikely(rc != MDBX_SUCCESS))
+    if (unlikely(rc != MDBX_SUCCESS)) {
       cursor->set_poor();
-    return rc;
+      return rc;
+    }
+    if (fpta_changelog_enabled(cursor->txn->db)) {
+      rc = fpta_changelog_record(cursor->txn, table_def, fpta_change_upsert,
+                                 column_key.mdbx, &new_row_value);
+      if (unlikely(rc != FPTA_SUCCESS)) {
+        cursor->set_poor();
+        return fpta_internal_abort(cursor->txn, rc);
+      }
+    }
+    return FPTA_SUCCESS;
   }
 
   MDBX_val old_pk_key;
@@ -1118,11 +1299,19 @@ int fpta_cursor_update(fpta_cursor *cursor, fptu_ro new_row_value) {
   }
 
   fpta_key new_pk_key;
-  rc = fpta_index_row2key(cursor->table_schema(), 0, new_row_value, new_pk_key,
-                          false);
+  rc = fpta_index_row2key(new_fields, 0, new_pk_key, false);
   if (unlikely(rc != FPTA_SUCCESS))
     return rc;
 
+  const bool changelog = fpta_changelog_enabled(cursor->txn->db);
+  if (changelog && old_pk_key.iov_len > 0) {
+    /* при изменении PK старое значение потребуется для журнала изменений
+     * уже после его удаления */
+    void *buffer = alloca(old_pk_key.iov_len);
+    old_pk_key.iov_base =
+        memcpy(buffer, old_pk_key.iov_base, old_pk_key.iov_len);
+  }
+
 #if 0 /* LY: в данный момент нет необходимости */
   if (old_pk_key.iov_len > 0 &&
       mdbx_is_dirty(cursor->txn->mdbx_txn, old_pk_key.iov_base) !=
@@ -1133,8 +1322,9 @@ int fpta_cursor_update(fpta_cursor *cursor, fptu_ro new_row_value) {
   }
 #endif
 
+  fpta_row_fields old_fields(table_def, old_row);
   rc = fpta_secondary_upsert(cursor->txn, cursor->table_schema(), old_pk_key,
-                             old_row, new_pk_key.mdbx, new_row_value,
+                             old_fields, new_pk_key.mdbx, new_fields,
                              cursor->column_number);
   if (unlikely(rc != MDBX_SUCCESS)) {
     cursor->set_poor();
@@ -1177,6 +1367,19 @@ int fpta_cursor_update(fpta_cursor *cursor, fptu_ro new_row_value) {
     return fpta_internal_abort(cursor->txn, rc);
   }
 
+  if (changelog) {
+    if (pk_changed)
+      rc = fpta_changelog_record(cursor->txn, table_def, fpta_change_delete,
+                                 old_pk_key, nullptr);
+    if (likely(rc == FPTA_SUCCESS))
+      rc = fpta_changelog_record(cursor->txn, table_def, fpta_change_upsert,
+                                 new_pk_key.mdbx, &new_row_value);
+    if (unlikely(rc != FPTA_SUCCESS)) {
+      cursor->set_poor();
+      return fpta_internal_abort(cursor->txn, rc);
+    }
+  }
+
   return FPTA_SUCCESS;
 }
 
@@ -1202,7 +1405,8 @@ int fpta_apply_visitor(
 
   if (page_top) {
     if (rc == FPTA_SUCCESS) {
-      int err = fpta_index_key2value(cursor->index_shove(), cursor->current,
+      int err = fpta_index_key2value(cursor->table_schema(),
+                                     cursor->column_number, cursor->current,
                                      *page_top);
       assert(err == FPTA_SUCCESS);
       if (unlikely(err != FPTA_SUCCESS))
@@ -1229,7 +1433,8 @@ int fpta_apply_visitor(
 
   if (page_bottom) {
     if (cursor && cursor->is_filled()) {
-      int err = fpta_index_key2value(cursor->index_shove(), cursor->current,
+      int err = fpta_index_key2value(cursor->table_schema(),
+                                     cursor->column_number, cursor->current,
                                      *page_bottom);
       assert(err == FPTA_SUCCESS);
       if (unlikely(err != FPTA_SUCCESS))
@@ -1250,6 +1455,78 @@ int fpta_apply_visitor(
 
 //----------------------------------------------------------------------------
 
+int fpta_table_export_json(fpta_txn *txn, fpta_name *column_id,
+                           fpta_value range_from, fpta_value range_to,
+                           fpta_filter *filter, fpta_cursor_options op,
+                           const fpta_json_names *names, fptu_emit_func output,
+                           void *output_ctx, size_t *count) {
+  if (count)
+    *count = 0;
+  if (unlikely(names == nullptr ||
+               names->signature != fpta_json_names::signature_value ||
+               !output))
+    return FPTA_EINVAL;
+
+  fpta_cursor *cursor = nullptr /* TODO: заменить на объект на стеке */;
+  int rc =
+      fpta_cursor_open(txn, column_id, range_from, range_to, filter,
+                       (fpta_cursor_options)(op | fpta_dont_fetch), &cursor);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  const fpta_table_schema *table_schema = cursor->table_schema();
+  if (unlikely(table_schema->table_shove() != names->table_shove)) {
+    fpta_cursor_close(cursor);
+    return FPTA_EINVAL;
+  }
+  if (unlikely(table_schema->version_tsn() > names->schema_tsn)) {
+    fpta_cursor_close(cursor);
+    return FPTA_SCHEMA_CHANGED;
+  }
+
+  enum { chunk_threshold = 1 << 16 };
+  std::string buffer;
+  buffer.reserve(chunk_threshold + chunk_threshold / 4);
+
+  size_t n = 0;
+  rc = fpta_cursor_move(cursor, fpta_first);
+  while (likely(rc == FPTA_SUCCESS)) {
+    fptu_ro row;
+    rc = fpta_cursor_get(cursor, &row);
+    if (unlikely(rc != FPTA_SUCCESS))
+      break;
+    rc = fptu::tuple2json(row, buffer, nullptr, 0, names->names, names->count);
+    if (unlikely(rc != FPTU_SUCCESS))
+      break;
+    buffer.push_back('\n');
+    ++n;
+    if (buffer.size() >= chunk_threshold) {
+      rc = output(output_ctx, buffer.data(), buffer.size());
+      if (unlikely(rc != FPTA_SUCCESS))
+        break;
+      buffer.clear();
+    }
+    rc = fpta_cursor_move(cursor, fpta_next);
+  }
+
+  if (rc == FPTA_NODATA) {
+    rc = FPTA_SUCCESS;
+    if (!buffer.empty())
+      rc = output(output_ctx, buffer.data(), buffer.size());
+  }
+
+  if (count)
+    *count = n;
+
+  int err = fpta_cursor_close(cursor);
+  assert(err == FPTA_SUCCESS);
+  if (unlikely(err != FPTA_SUCCESS) && rc == FPTA_SUCCESS)
+    rc = err;
+  return rc;
+}
+
+//----------------------------------------------------------------------------
+
 int fpta_cursor_info(fpta_cursor *cursor, fpta_cursor_stat *stat) {
   int rc = fpta_cursor_validate(cursor, fpta_read);
   if (unlikely(rc != FPTA_SUCCESS))
@@ -1278,6 +1555,7 @@ int fpta_cursor_reset_accounting(fpta_cursor *cursor) {
   if (unlikely(rc != FPTA_SUCCESS))
     return rc;
 
+  fpta_cursor_account(cursor);
   memset(&cursor->metrics, 0, sizeof(cursor->metrics));
   return FPTA_SUCCESS;
 }
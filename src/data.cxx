@@ -17,6 +17,9 @@
 
 #include "details.h"
 
+#include <deque>
+#include <memory>
+
 /*FPTA_API*/ const fpta_fp32_t fpta_fp32_denil = {FPTA_DENIL_FP32_BIN};
 /*FPTA_API*/ const fpta_fp32_t fpta_fp32_qsnan = {FPTA_QSNAN_FP32_BIN};
 /*FPTA_API*/ const fpta_fp64_t fpta_fp64_denil = {FPTA_DENIL_FP64_BIN};
@@ -540,15 +543,16 @@ int fpta_validate_put(fpta_txn *txn, fpta_name *table_id, fptu_ro row_value,
     return rc;
 
   fpta_table_schema *table_def = table_id->table_schema;
+  fpta_row_fields new_fields(table_def, row_value);
   fpta_key pk_key;
-  rc = fpta_index_row2key(table_def, 0, row_value, pk_key, false);
+  rc = fpta_index_row2key(new_fields, 0, pk_key, false);
   if (unlikely(rc != FPTA_SUCCESS))
     return rc;
 
   if (op & fpta_skip_nonnullable_check)
     op = (fpta_put_options)(op - fpta_skip_nonnullable_check);
   else {
-    rc = fpta_check_nonnullable(table_def, row_value);
+    rc = fpta_check_nonnullable(new_fields);
     if (unlikely(rc != FPTA_SUCCESS))
       return rc;
   }
@@ -604,7 +608,9 @@ int fpta_validate_put(fpta_txn *txn, fpta_name *table_id, fptu_ro row_value,
   if (!table_def->has_secondary())
     return FPTA_SUCCESS;
 
-  return fpta_check_secondary_uniq(txn, table_def, present_row, row_value, 0);
+  fpta_row_fields present_fields(table_def, present_row);
+  return fpta_check_secondary_uniq(txn, table_def, present_fields, new_fields,
+                                   0);
 }
 
 int fpta_put(fpta_txn *txn, fpta_name *table_id, fptu_ro row,
@@ -613,6 +619,8 @@ int fpta_put(fpta_txn *txn, fpta_name *table_id, fptu_ro row,
   if (unlikely(rc != FPTA_SUCCESS))
     return rc;
 
+  fpta_latency_scope latency(txn->db, fpta_latency_put);
+
   fpta_table_schema *table_def = table_id->table_schema;
   unsigned flags = MDBX_NODUPDATA;
   switch (op) {
@@ -631,12 +639,14 @@ int fpta_put(fpta_txn *txn, fpta_name *table_id, fptu_ro row,
     break;
   }
 
-  rc = fpta_check_nonnullable(table_def, row);
+  /* поля строки собираются однократно для всех индексов */
+  fpta_row_fields new_fields(table_def, row);
+  rc = fpta_check_nonnullable(new_fields);
   if (unlikely(rc != FPTA_SUCCESS))
     return rc;
 
   fpta_key pk_key;
-  rc = fpta_index_row2key(table_def, 0, row, pk_key, false);
+  rc = fpta_index_row2key(new_fields, 0, pk_key, false);
   if (unlikely(rc != FPTA_SUCCESS))
     return rc;
 
@@ -645,8 +655,22 @@ int fpta_put(fpta_txn *txn, fpta_name *table_id, fptu_ro row,
   if (unlikely(rc != FPTA_SUCCESS))
     return rc;
 
-  if (!table_def->has_secondary())
-    return mdbx_put(txn->mdbx_txn, handle, &pk_key.mdbx, &row.sys, flags);
+  fpta_op_counters delta = {};
+  delta.upserts = 1;
+  if (!table_def->has_secondary()) {
+    rc = mdbx_put(txn->mdbx_txn, handle, &pk_key.mdbx, &row.sys, flags);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    if (fpta_changelog_enabled(txn->db)) {
+      rc = fpta_changelog_record(txn, table_def, fpta_change_upsert,
+                                 pk_key.mdbx, &row);
+      if (unlikely(rc != FPTA_SUCCESS))
+        return fpta_internal_abort(txn, rc);
+    }
+    fpta_metrics_account(txn->db, table_id->shove, table_def->column_shove(0),
+                         delta);
+    return FPTA_SUCCESS;
+  }
 
   fptu_ro old_row;
 #if defined(NDEBUG)
@@ -670,11 +694,189 @@ int fpta_put(fpta_txn *txn, fpta_name *table_id, fptu_ro row,
   if (unlikely(rc != MDBX_SUCCESS))
     return rc;
 
-  rc = fpta_secondary_upsert(txn, table_def, pk_key.mdbx, old_row, pk_key.mdbx,
-                             row, 0);
+  fpta_row_fields old_fields(table_def, old_row);
+  rc = fpta_secondary_upsert(txn, table_def, pk_key.mdbx, old_fields,
+                             pk_key.mdbx, new_fields, 0);
   if (unlikely(rc != MDBX_SUCCESS))
     return fpta_internal_abort(txn, rc);
 
+  if (fpta_changelog_enabled(txn->db)) {
+    rc = fpta_changelog_record(txn, table_def, fpta_change_upsert, pk_key.mdbx,
+                               &row);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return fpta_internal_abort(txn, rc);
+  }
+
+  fpta_metrics_account(txn->db, table_id->shove, table_def->column_shove(0),
+                       delta);
+  return FPTA_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+
+static int fpta_put_serial(fpta_txn *txn, fpta_name *table_id,
+                           const fptu_ro *rows, size_t count,
+                           fpta_put_options op) {
+  for (size_t n = 0; n < count; ++n) {
+    int rc = fpta_put(txn, table_id, rows[n], op);
+    if (unlikely(rc != FPTA_SUCCESS)) {
+      /* часть строк пакета уже внесена, поэтому транзакция прерывается,
+       * если этого еще не сделала fpta_put() */
+      if (n > 0 && txn->mdbx_txn)
+        rc = fpta_internal_abort(txn, rc);
+      return rc;
+    }
+  }
+  return FPTA_SUCCESS;
+}
+
+int fpta_put_batch(fpta_txn *txn, fpta_name *table_id, const fptu_ro *rows,
+                   size_t count, fpta_put_options op, unsigned threads) {
+  if (unlikely(op < fpta_insert || op > fpta_upsert))
+    return FPTA_EFLAG;
+  if (unlikely(rows == nullptr && count > 0))
+    return FPTA_EINVAL;
+
+  int rc = fpta_name_refresh_couple(txn, table_id, nullptr);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+  if (unlikely(txn->level < fpta_write))
+    return FPTA_EPERM;
+
+  fpta_table_schema *table_def = table_id->table_schema;
+  if (count < 2 || !fpta_index_is_unique(table_def->table_pk()))
+    /* для не-уникального PK результат зависит от порядка операций */
+    return fpta_put_serial(txn, table_id, rows, count, op);
+
+  /* Без рабочих потоков упорядочивание небольшого пакета не окупается,
+   * так как его ключи редко оказываются на одних страницах b-tree. */
+  cxx11_constexpr_var size_t serial_threshold = 4096;
+  const unsigned workers = fpta_batch_workers(table_def, count, threads);
+  if (workers < 2 && count < serial_threshold)
+    return fpta_put_serial(txn, table_id, rows, count, op);
+
+  MDBX_dbi handle;
+  rc = fpta_open_table(txn, table_def, handle);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  /* адреса элементов std::deque не меняются при добавлении */
+  std::deque<fpta_row_fields> new_fields, old_fields;
+  std::unique_ptr<fpta_key[]> pk_keys(
+      new fpta_key[count] /* FIXME: std::bad_alloc */);
+  for (size_t n = 0; n < count; ++n) {
+    new_fields.emplace_back(table_def, rows[n]);
+    rc = fpta_check_nonnullable(new_fields.back());
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+    rc = fpta_index_row2key(new_fields.back(), 0, pk_keys[n], false);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+  }
+
+  /* строки обрабатываются в порядке PK, сортируются пары из порядкового
+   * префикса ключа и номера строки */
+  const unsigned pk_flags =
+      fpta_index_shove2primary_dbiflags(table_def->table_pk());
+  const bool exact = fpta_batch_prefix_exact(pk_flags);
+  MDBX_cmp_func *const keycmp = mdbx_get_keycmp(pk_flags);
+  const auto keydiff = [&](const std::pair<uint64_t, size_t> &left,
+                           const std::pair<uint64_t, size_t> &right) {
+    if (left.first != right.first)
+      return (left.first < right.first) ? -1 : 1;
+    return exact ? 0
+                 : keycmp(&pk_keys[left.second].mdbx,
+                          &pk_keys[right.second].mdbx);
+  };
+  std::vector<std::pair<uint64_t, size_t>> order(count);
+  for (size_t n = 0; n < count; ++n)
+    order[n] =
+        std::make_pair(fpta_batch_prefix(pk_flags, pk_keys[n].mdbx), n);
+  std::sort(order.begin(), order.end(),
+            [&](const std::pair<uint64_t, size_t> &left,
+                const std::pair<uint64_t, size_t> &right) {
+              return keydiff(left, right) < 0;
+            });
+  for (size_t i = 1; i < count; ++i)
+    if (keydiff(order[i - 1], order[i]) == 0)
+      /* повторы PK внутри пакета применяются последовательно */
+      return fpta_put_serial(txn, table_id, rows, count, op);
+
+  /* Поиск и последующее обновление строк выполняются через курсор
+   * в порядке PK, что позволяет libmdbx не спускаться от корня b-tree,
+   * если очередной ключ находится на текущей странице. */
+  MDBX_cursor *mdbx_cursor;
+  rc = mdbx_cursor_open(txn->mdbx_txn, handle, &mdbx_cursor);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  std::unique_ptr<MDBX_cursor, void (*)(MDBX_cursor *)> cursor_guard(
+      mdbx_cursor, mdbx_cursor_close);
+
+  std::vector<fpta_batch_row> batch(count);
+  std::vector<std::unique_ptr<uint8_t[]>> copies;
+  for (size_t i = 0; i < count; ++i) {
+    const size_t n = order[i].second;
+    MDBX_val pk_key = pk_keys[n].mdbx;
+    fptu_ro present_row;
+    rc = mdbx_cursor_get(mdbx_cursor, &pk_key, &present_row.sys, MDBX_SET);
+    if (rc == MDBX_SUCCESS) {
+      if (op == fpta_insert)
+        /* запись с таким PK уже есть, вставка НЕ возможна */
+        return FPTA_KEYEXIST;
+      if (mdbx_is_dirty(txn->mdbx_txn, present_row.sys.iov_base) !=
+          MDBX_RESULT_FALSE) {
+        /* строка в грязной странице может быть перемещена при изменениях,
+         * а её поля потребуются для удаления старых ключей из индексов */
+        copies.emplace_back(
+            new uint8_t[present_row.sys.iov_len] /* FIXME: std::bad_alloc */);
+        present_row.sys.iov_base = memcpy(
+            copies.back().get(), present_row.sys.iov_base,
+            present_row.sys.iov_len);
+      }
+    } else {
+      if (unlikely(rc != MDBX_NOTFOUND))
+        return rc;
+      if (op == fpta_update)
+        /* нет записи с таким PK, обновлять нечего */
+        return FPTA_NOTFOUND;
+      present_row.sys.iov_base = nullptr;
+      present_row.sys.iov_len = 0;
+    }
+    old_fields.emplace_back(table_def, present_row);
+    batch[i].pk_key = pk_keys[n].mdbx;
+    batch[i].old_row = &old_fields.back();
+    batch[i].new_row = &new_fields[n];
+  }
+
+  if (table_def->has_secondary()) {
+    /* при ошибке внесения изменений транзакция уже прервана */
+    rc = fpta_secondary_upsert_batch(txn, table_def, batch.data(), count,
+                                     workers);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    MDBX_val row_value = rows[order[i].second].sys;
+    rc = mdbx_cursor_put(mdbx_cursor, &batch[i].pk_key, &row_value,
+                         MDBX_NODUPDATA);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return fpta_internal_abort(txn, rc);
+  }
+
+  if (fpta_changelog_enabled(txn->db)) {
+    for (size_t i = 0; i < count; ++i) {
+      rc = fpta_changelog_record(txn, table_def, fpta_change_upsert,
+                                 batch[i].pk_key, &rows[order[i].second]);
+      if (unlikely(rc != FPTA_SUCCESS))
+        return fpta_internal_abort(txn, rc);
+    }
+  }
+
+  fpta_op_counters delta = {};
+  delta.upserts = count;
+  fpta_metrics_account(txn->db, table_id->shove, table_def->column_shove(0),
+                       delta);
   return FPTA_SUCCESS;
 }
 
@@ -686,7 +888,8 @@ int fpta_delete(fpta_txn *txn, fpta_name *table_id, fptu_ro row) {
     return rc;
 
   fpta_table_schema *table_def = table_id->table_schema;
-  if (row.sys.iov_len && table_def->has_secondary() &&
+  if (row.sys.iov_len &&
+      (table_def->has_secondary() || fpta_changelog_enabled(txn->db)) &&
       mdbx_is_dirty(txn->mdbx_txn, row.sys.iov_base)) {
     /* LY: Делаем копию строки, так как удаление в основной таблице
      * уничтожит текущее значение при перезаписи "грязной" страницы.
@@ -708,8 +911,9 @@ int fpta_delete(fpta_txn *txn, fpta_name *table_id, fptu_ro row) {
     row.sys.iov_base = memcpy(buffer, row.sys.iov_base, row.sys.iov_len);
   }
 
+  fpta_row_fields fields(table_def, row);
   fpta_key key;
-  rc = fpta_index_row2key(table_def, 0, row, key, false);
+  rc = fpta_index_row2key(fields, 0, key, false);
   if (unlikely(rc != FPTA_SUCCESS))
     return rc;
 
@@ -723,24 +927,29 @@ int fpta_delete(fpta_txn *txn, fpta_name *table_id, fptu_ro row) {
     return rc;
 
   if (table_def->has_secondary()) {
-    rc = fpta_secondary_remove(txn, table_def, key.mdbx, row, 0);
+    rc = fpta_secondary_remove(txn, table_def, key.mdbx, fields, 0);
     if (unlikely(rc != MDBX_SUCCESS))
       return fpta_internal_abort(txn, rc);
   }
 
+  if (fpta_changelog_enabled(txn->db)) {
+    rc = fpta_changelog_record(txn, table_def, fpta_change_delete, key.mdbx,
+                               nullptr);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return fpta_internal_abort(txn, rc);
+  }
+
+  fpta_op_counters delta = {};
+  delta.deletions = 1;
+  fpta_metrics_account(txn->db, table_id->shove, table_def->column_shove(0),
+                       delta);
   return FPTA_SUCCESS;
 }
 
-int fpta_get(fpta_txn *txn, fpta_name *column_id,
-             const fpta_value *column_value, fptu_ro *row) {
-  if (unlikely(row == nullptr))
-    return FPTA_EINVAL;
-
-  row->units = nullptr;
-  row->total_bytes = 0;
-
-  if (unlikely(column_value == nullptr))
-    return FPTA_EINVAL;
+/* Привязка колонки для точечного чтения: актуализация схемы, проверка
+ * наличия уникального индекса и получение dbi-хендлов. */
+static int fpta_get_bind(fpta_txn *txn, fpta_name *column_id,
+                         MDBX_dbi &tbl_handle, MDBX_dbi &idx_handle) {
   int rc = fpta_id_validate(column_id, fpta_column);
   if (unlikely(rc != FPTA_SUCCESS))
     return rc;
@@ -757,27 +966,268 @@ int fpta_get(fpta_txn *txn, fpta_name *column_id,
   if (unlikely(!fpta_index_is_unique(index)))
     return FPTA_NO_INDEX;
 
+  return fpta_open_column(txn, column_id, tbl_handle, idx_handle);
+}
+
+static __hot int fpta_get_lookup(fpta_txn *txn, fpta_shove_t table_shove,
+                                 const fpta_name *column_id,
+                                 MDBX_dbi tbl_handle, MDBX_dbi idx_handle,
+                                 const fpta_value &column_value,
+                                 fptu_ro *row) {
+  fpta_latency_scope latency(txn->db, fpta_latency_get);
+  const fpta_shove_t column_shove = column_id->shove;
+  const fpta_table_schema *const table_def =
+      column_id->column.table->table_schema;
   fpta_key column_key;
-  rc = fpta_index_value2key(column_id->shove, *column_value, column_key, false);
+  int rc = fpta_index_value2key(table_def, column_id->column.num, column_value,
+                                column_key, false);
   if (unlikely(rc != FPTA_SUCCESS))
     return rc;
 
+  fpta_op_counters delta = {};
+  delta.searches = 1;
+  if (fpta_index_is_primary(fpta_shove2index(column_shove)))
+    rc = fpta_get_by_pk(txn, table_shove, tbl_handle, column_key.mdbx,
+                        &row->sys);
+  else {
+    MDBX_val pk_key;
+    rc = table_def->is_hash_index(column_id->column.num)
+             ? fpta_hash_get(txn->mdbx_txn, idx_handle, column_key.mdbx,
+                             &pk_key)
+             : mdbx_get(txn->mdbx_txn, idx_handle, &column_key.mdbx, &pk_key);
+    if (likely(rc == MDBX_SUCCESS)) {
+      delta.pk_lookups = 1;
+      rc = fpta_get_by_pk(txn, table_shove, tbl_handle, pk_key, &row->sys);
+      if (unlikely(rc == MDBX_NOTFOUND))
+        rc = FPTA_INDEX_CORRUPTED;
+    }
+  }
+
+  delta.results = (rc == MDBX_SUCCESS) ? 1 : 0;
+  fpta_metrics_account(txn->db, table_shove, column_shove, delta);
+  return rc;
+}
+
+int fpta_get(fpta_txn *txn, fpta_name *column_id,
+             const fpta_value *column_value, fptu_ro *row) {
+  if (unlikely(row == nullptr))
+    return FPTA_EINVAL;
+
+  row->units = nullptr;
+  row->total_bytes = 0;
+
+  if (unlikely(column_value == nullptr))
+    return FPTA_EINVAL;
+
   MDBX_dbi tbl_handle, idx_handle;
-  rc = fpta_open_column(txn, column_id, tbl_handle, idx_handle);
+  int rc = fpta_get_bind(txn, column_id, tbl_handle, idx_handle);
   if (unlikely(rc != FPTA_SUCCESS))
     return rc;
 
-  if (fpta_index_is_primary(index))
-    return mdbx_get(txn->mdbx_txn, idx_handle, &column_key.mdbx, &row->sys);
+  return fpta_get_lookup(txn, column_id->column.table->shove, column_id,
+                         tbl_handle, idx_handle, *column_value, row);
+}
 
-  MDBX_val pk_key;
-  rc = mdbx_get(txn->mdbx_txn, idx_handle, &column_key.mdbx, &pk_key);
+/* Проход одним курсором по упорядоченным ключам. Для позиционированного
+ * курсора libmdbx сначала проверяет границы текущей листовой страницы,
+ * поэтому для близких ключей спуск от корня B-дерева не требуется. */
+static int fpta_get_many_walk(fpta_txn *txn, MDBX_dbi dbi,
+                              std::vector<size_t> &order, MDBX_val in[],
+                              MDBX_val out[], int errors[]) {
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return mdbx_cmp(txn->mdbx_txn, dbi, &in[a], &in[b]) < 0;
+  });
+
+  MDBX_cursor *mdbx_cursor;
+  int rc = mdbx_cursor_open(txn->mdbx_txn, dbi, &mdbx_cursor);
   if (unlikely(rc != MDBX_SUCCESS))
     return rc;
 
-  rc = mdbx_get(txn->mdbx_txn, tbl_handle, &pk_key, &row->sys);
-  if (unlikely(rc == MDBX_NOTFOUND))
-    return FPTA_INDEX_CORRUPTED;
+  for (const size_t i : order) {
+    MDBX_val key = in[i];
+    rc = mdbx_cursor_get(mdbx_cursor, &key, &out[i], MDBX_SET_KEY);
+    if (unlikely(rc != MDBX_SUCCESS)) {
+      if (unlikely(rc != MDBX_NOTFOUND))
+        break;
+      out[i].iov_base = nullptr;
+      out[i].iov_len = 0;
+    }
+    errors[i] = rc;
+    rc = MDBX_SUCCESS;
+  }
 
+  mdbx_cursor_close(mdbx_cursor);
   return rc;
 }
+
+int fpta_get_many(fpta_txn *txn, fpta_name *column_id,
+                  const fpta_value column_values[], size_t count,
+                  fptu_ro rows[], int errors[]) {
+  if (unlikely(count && (column_values == nullptr || rows == nullptr ||
+                         errors == nullptr)))
+    return FPTA_EINVAL;
+
+  for (size_t i = 0; i < count; ++i) {
+    rows[i].units = nullptr;
+    rows[i].total_bytes = 0;
+    errors[i] = FPTA_NODATA;
+  }
+
+  MDBX_dbi tbl_handle, idx_handle;
+  int rc = fpta_get_bind(txn, column_id, tbl_handle, idx_handle);
+  if (unlikely(rc != FPTA_SUCCESS) || count == 0)
+    return rc;
+
+  std::vector<fpta_key> keys(count);
+  std::vector<MDBX_val> in(count), out(count);
+  std::vector<size_t> order;
+  order.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    errors[i] = fpta_index_value2key(column_id->column.table->table_schema,
+                                     column_id->column.num, column_values[i],
+                                     keys[i], false);
+    if (likely(errors[i] == FPTA_SUCCESS)) {
+      in[i] = keys[i].mdbx;
+      order.push_back(i);
+    }
+  }
+
+  const bool is_primary =
+      fpta_index_is_primary(fpta_shove2index(column_id->shove));
+  if (column_id->column.table->table_schema->is_hash_index(
+          column_id->column.num)) {
+    /* порядок ключей не дает локальности в хэш-индексе */
+    for (const size_t i : order) {
+      rc = fpta_hash_get(txn->mdbx_txn, idx_handle, in[i], &out[i]);
+      if (unlikely(rc != MDBX_SUCCESS && rc != MDBX_NOTFOUND))
+        return rc;
+      errors[i] = rc;
+    }
+  } else {
+    rc = fpta_get_many_walk(txn, is_primary ? tbl_handle : idx_handle, order,
+                            in.data(), out.data(), errors);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+  }
+
+  if (!is_primary) {
+    /* второй проход по первичному ключу, в порядке уже его сортировки */
+    order.clear();
+    for (size_t i = 0; i < count; ++i)
+      if (errors[i] == FPTA_SUCCESS) {
+        in[i] = out[i];
+        order.push_back(i);
+      }
+    rc = fpta_get_many_walk(txn, tbl_handle, order, in.data(), out.data(),
+                            errors);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+    for (const size_t i : order)
+      if (unlikely(errors[i] == MDBX_NOTFOUND))
+        errors[i] = FPTA_INDEX_CORRUPTED;
+  }
+
+  fpta_op_counters delta = {};
+  delta.searches = count;
+  delta.pk_lookups = is_primary ? 0 : order.size();
+  rc = FPTA_SUCCESS;
+  for (size_t i = 0; i < count; ++i) {
+    if (likely(errors[i] == FPTA_SUCCESS)) {
+      rows[i].sys = out[i];
+      delta.results += 1;
+    } else if (rc == FPTA_SUCCESS)
+      rc = errors[i];
+  }
+  fpta_metrics_account(txn->db, column_id->column.table->shove,
+                       column_id->shove, delta);
+  return rc;
+}
+
+//----------------------------------------------------------------------------
+
+struct fpta_prepared_get {
+  enum { signature_value = 1329145279 };
+  unsigned signature;
+  MDBX_dbi tbl_handle, idx_handle;
+  fpta_db *db;
+  fpta_name *column_id;
+  uint64_t schema_tsn;
+  fpta_shove_t table_shove;
+};
+
+static int fpta_prepared_rebind(fpta_txn *txn, fpta_prepared_get *prepared) {
+  int rc = fpta_get_bind(txn, prepared->column_id, prepared->tbl_handle,
+                         prepared->idx_handle);
+  if (unlikely(rc != FPTA_SUCCESS)) {
+    prepared->schema_tsn = 0;
+    return rc;
+  }
+
+  prepared->db = txn->db;
+  prepared->schema_tsn = txn->schema_tsn();
+  prepared->table_shove = prepared->column_id->column.table->shove;
+  return FPTA_SUCCESS;
+}
+
+int fpta_prepare_get(fpta_txn *txn, fpta_name *column_id,
+                     fpta_prepared_get **pprepared) {
+  if (unlikely(pprepared == nullptr))
+    return FPTA_EINVAL;
+  *pprepared = nullptr;
+
+  fpta_prepared_get *prepared =
+      (fpta_prepared_get *)calloc(1, sizeof(fpta_prepared_get));
+  if (unlikely(prepared == nullptr))
+    return FPTA_ENOMEM;
+
+  prepared->column_id = column_id;
+  int rc = fpta_prepared_rebind(txn, prepared);
+  if (unlikely(rc != FPTA_SUCCESS)) {
+    free(prepared);
+    return rc;
+  }
+
+  prepared->signature = fpta_prepared_get::signature_value;
+  *pprepared = prepared;
+  return FPTA_SUCCESS;
+}
+
+int fpta_prepared_get_destroy(fpta_prepared_get *prepared) {
+  if (unlikely(prepared == nullptr ||
+               prepared->signature != fpta_prepared_get::signature_value))
+    return FPTA_EINVAL;
+
+  prepared->signature = ~fpta_prepared_get::signature_value;
+  free(prepared);
+  return FPTA_SUCCESS;
+}
+
+__hot int fpta_get_prepared(fpta_txn *txn, fpta_prepared_get *prepared,
+                            const fpta_value *column_value, fptu_ro *row) {
+  if (unlikely(row == nullptr))
+    return FPTA_EINVAL;
+
+  row->units = nullptr;
+  row->total_bytes = 0;
+
+  if (unlikely(column_value == nullptr || prepared == nullptr ||
+               prepared->signature != fpta_prepared_get::signature_value))
+    return FPTA_EINVAL;
+
+  int rc = fpta_txn_validate(txn, fpta_read);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  /* Полная перепривязка требуется только при изменении схемы, а в остальных
+   * случаях достаточно сохраненных dbi-хендлов и шовов. */
+  if (unlikely(prepared->schema_tsn != txn->schema_tsn() ||
+               prepared->db != txn->db)) {
+    rc = fpta_prepared_rebind(txn, prepared);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+  }
+
+  return fpta_get_lookup(txn, prepared->table_shove, prepared->column_id,
+                         prepared->tbl_handle, prepared->idx_handle,
+                         *column_value, row);
+}
@@ -223,6 +223,7 @@ __cold int fpta_dbicache_open(fpta_txn *txn, const fpta_shove_t dbi_shove,
   }
 
   int rc = fpta_dbi_open(txn, dbi_shove, handle, dbi_flags);
+  FPTA_PROBE2(dbi_miss, dbi_shove, rc);
   if (likely(rc == FPTA_SUCCESS))
     *cache_hint =
         fpta_dbicache_update(db, dbi_shove, handle, txn->schema_tsn());
@@ -29,6 +29,31 @@
                                    for aligment */
 #endif                          /* _MSC_VER (warnings) */
 
+struct fpta_row_cache;
+struct fpta_latency;
+struct fpta_async_flusher;
+struct fpta_durable;
+
+/* Реестр счетчиков операций в разрезе таблиц и индексов, см. metrics.cxx */
+struct fpta_metrics {
+  enum { shards_count = 8, slots_count = 256, max_probes = 32 };
+
+  struct slot {
+    std::atomic<uint64_t> tag;
+    fpta_shove_t table_shove, index_shove;
+  };
+
+  struct cell {
+    std::atomic<size_t> results, searches, scans, pk_lookups, uniq_checks,
+        upserts, deletions;
+  };
+
+  slot slots[slots_count];
+  /* последний столбец учитывает операции с парами, не поместившимися
+   * в каталог */
+  cell cells[shards_count][slots_count + 1];
+};
+
 struct fpta_db {
   fpta_db(const fpta_db &) = delete;
   MDBX_env *mdbx_env;
@@ -42,6 +67,17 @@ struct fpta_db {
   fpta_shove_t dbi_shoves[fpta_dbi_cache_size];
   uint64_t dbi_tsns[fpta_dbi_cache_size];
   MDBX_dbi dbi_handles[fpta_dbi_cache_size];
+
+  fpta_row_cache *row_cache /* см. fpta_db_row_cache() */;
+  fpta_metrics metrics /* см. fpta_db_metrics() */;
+  std::atomic<bool> latency_enabled;
+  fpta_latency *latency /* см. fpta_db_latency() */;
+  fpta_async_flusher *async /* см. fpta_db_async_lag() */;
+  fpta_durable *durable /* см. fpta_db_wait_durable() */;
+
+  MDBX_dbi changelog_dbi;
+  size_t changelog_limit /* см. fpta_db_changelog() */;
+  bool changelog_rows;
 };
 
 #ifdef _MSC_VER
@@ -90,6 +126,111 @@ public:
 
 //----------------------------------------------------------------------------
 
+/* Предварительно подготовленная таблица имен колонок для сериализации
+ * строк в JSON, см fpta_json_names_build(). */
+struct fpta_json_names {
+  enum { signature_value = 1920358817 };
+  unsigned signature;
+  unsigned count;
+  fpta_shove_t table_shove;
+  uint64_t schema_tsn;
+  std::string holder;
+  const char *names[fpta_max_cols];
+};
+
+//----------------------------------------------------------------------------
+
+int fpta_row_cache_get(fpta_txn *txn, fpta_shove_t table_shove,
+                       MDBX_dbi tbl_handle, const MDBX_val &pk_key,
+                       MDBX_val *row);
+void fpta_row_cache_release(fpta_db *db);
+void fpta_row_cache_stat(const fpta_db *db, fpta_db_stat_t *stat);
+
+static __inline int fpta_get_by_pk(fpta_txn *txn, fpta_shove_t table_shove,
+                                   MDBX_dbi tbl_handle, const MDBX_val &pk_key,
+                                   MDBX_val *row) {
+  if (txn->db->row_cache && txn->level == fpta_read)
+    return fpta_row_cache_get(txn, table_shove, tbl_handle, pk_key, row);
+  return mdbx_get(txn->mdbx_txn, tbl_handle, &pk_key, row);
+}
+
+/* Хэш-индексы, см. fpta_describe_hash_index(). Функции соответствуют
+ * mdbx_get(), mdbx_put(), mdbx_del() и mdbx_replace() для уникального
+ * индекса и возвращают MDBX_NOTFOUND и MDBX_KEYEXIST в тех же случаях. */
+int fpta_hash_get(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val &se_key,
+                  MDBX_val *pk_key);
+int fpta_hash_put(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val &se_key,
+                  const MDBX_val &pk_key);
+int fpta_hash_del(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val &se_key,
+                  const MDBX_val &pk_key);
+int fpta_hash_replace(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val &se_key,
+                      const MDBX_val &new_pk_key, const MDBX_val &old_pk_key);
+
+/* Слоты каталога счетчиков, принадлежащие удаленным таблицам */
+struct fpta_metrics_garbage {
+  uint64_t bits[fpta_metrics::slots_count / 64];
+};
+void fpta_metrics_collect(fpta_txn *txn, fpta_metrics_garbage &garbage);
+void fpta_metrics_release(fpta_db *db, const fpta_metrics_garbage &garbage);
+void fpta_metrics_account(fpta_db *db, fpta_shove_t table_shove,
+                          fpta_shove_t index_shove,
+                          const fpta_op_counters &delta);
+
+/* Порядковый номер текущего потока, используется для выбора сегмента
+ * счетчиков и гистограмм. */
+inline unsigned fpta_thread_ordinal() {
+  static std::atomic<unsigned> next;
+  static thread_local unsigned ordinal =
+      next.fetch_add(1, std::memory_order_relaxed);
+  return ordinal;
+}
+
+int fpta_async_start(fpta_db *db);
+void fpta_async_stop(fpta_db *db);
+void fpta_async_stat(const fpta_db *db, fpta_db_stat_t *stat);
+
+int fpta_durable_init(fpta_db *db);
+void fpta_durable_destroy(fpta_db *db);
+
+int fpta_changelog_record(fpta_txn *txn, const fpta_table_schema *table_def,
+                          fpta_change_kind kind, const MDBX_val &pk_key,
+                          const fptu_ro *row);
+int fpta_changelog_commit(fpta_txn *txn);
+
+static __inline bool fpta_changelog_enabled(const fpta_db *db) {
+  return unlikely(db->changelog_limit != 0);
+}
+
+void fpta_latency_release(fpta_db *db);
+void fpta_latency_record(fpta_db *db, fpta_latency_point point,
+                         uint64_t start);
+void fpta_latency_commit_record(fpta_db *db, int rc, uint64_t start,
+                                const MDBX_commit_latency &latency);
+uint64_t fpta_latency_now();
+
+static __inline uint64_t fpta_latency_start(const fpta_db *db) {
+  return unlikely(db->latency_enabled.load(std::memory_order_acquire))
+             ? fpta_latency_now()
+             : 0;
+}
+
+class fpta_latency_scope {
+  fpta_latency_scope(const fpta_latency_scope &) = delete;
+  fpta_db *const db;
+  const fpta_latency_point point;
+  const uint64_t start;
+
+public:
+  fpta_latency_scope(fpta_db *db, fpta_latency_point point)
+      : db(db), point(point), start(fpta_latency_start(db)) {}
+  ~fpta_latency_scope() {
+    if (unlikely(start))
+      fpta_latency_record(db, point, start);
+  }
+};
+
+//----------------------------------------------------------------------------
+
 bool fpta_filter_validate(const fpta_filter *filter);
 
 static __inline bool fpta_db_validate(const fpta_db *db) {
@@ -132,7 +273,7 @@ static cxx14_constexpr int fpta_id_validate(const fpta_name *id,
       const fpta_table_schema *table_schema = id->table_schema;
       if (unlikely(table_schema == nullptr))
         return FPTA_EINVAL;
-      if (unlikely(table_schema->signature() != FTPA_SCHEMA_SIGNATURE))
+      if (unlikely(!fpta_schema_signature_valid(table_schema->signature())))
         return FPTA_SCHEMA_CORRUPTED;
       if (unlikely(table_schema->table_shove() != id->shove))
         return FPTA_SCHEMA_CORRUPTED;
@@ -0,0 +1,488 @@
+/*
+ *  Fast Positive Tables (libfpta), aka Позитивные Таблицы.
+ *  Copyright 2016-2020 Leonid Yuriev <leo@yuriev.ru>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "details.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+/* Двоичная выгрузка и загрузка таблиц.
+ *
+ * Формат состоит из заголовка со схемой таблицы и последовательности кадров.
+ * Заголовок включает сигнатуру, версию формата, shove таблицы и размер
+ * описания схемы, за которым следует само описание: shove всех колонок,
+ * элементы составных индексов и опции индексов каждой колонки (признак
+ * хэш-индекса, ограничение длины ключей и словарь префиксов), с выравниванием
+ * до 8 байт. Каждый кадр начинается с пары uint32_t (размер в байтах,
+ * количество строк), за которой следуют строки в виде uint32_t длины и
+ * кортежа fptu. Так как кортежи fptu состоят из 4-байтовых юнитов, то
+ * выравнивание сохраняется. Кадр с нулевым размером завершает выгрузку.
+ *
+ * Все числа в заголовке и кадрах записываются в порядке little-endian
+ * независимо от платформы, а кортежи fptu сохраняются как есть.
+ *
+ * Строки выгружаются в порядке первичного индекса, в том числе для
+ * неупорядоченных индексов, так как используется порядок ключей в libmdbx.
+ * Поэтому при загрузке строки добавляются посредством MDBX_APPEND, а пары
+ * вторичных индексов накапливаются, сортируются и затем также добавляются
+ * в конец соответствующих деревьев. Схема проверяется до записи первой
+ * строки, поэтому выгрузка таблицы с другими колонками или опциями индексов
+ * отвергается без изменения БД. */
+
+static cxx11_constexpr_var uint32_t fpta_dump_magic =
+    UINT32_C(0x70446146) /* "FaDp" */;
+static cxx11_constexpr_var uint32_t fpta_dump_format = 2;
+
+struct fpta_dump_header {
+  uint32_t magic;
+  uint32_t format;
+  fpta_shove_t table_shove;
+  uint32_t column_count;
+  uint32_t composite_items;
+  uint32_t schema_bytes;
+  uint32_t reserved;
+};
+
+/* размер заголовка в выгрузке, без учета выравнивания структуры */
+enum { fpta_dump_header_bytes = 4 + 4 + 8 + 4 + 4 + 4 + 4 };
+
+struct fpta_dump_frame {
+  uint32_t bytes;
+  uint32_t rows;
+};
+
+enum { fpta_dump_chunk_threshold = 1 << 16 };
+
+static __inline size_t fpta_dump_align8(size_t bytes) {
+  return (bytes + 7) & ~size_t(7);
+}
+
+static void fpta_dump_put(std::string &out, uint64_t value, size_t bytes) {
+  for (size_t i = 0; i < bytes; ++i)
+    out.push_back(char(uint8_t(value >> (i * 8))));
+}
+
+static uint64_t fpta_dump_get(const void *ptr, size_t bytes) {
+  const uint8_t *const src = static_cast<const uint8_t *>(ptr);
+  uint64_t value = 0;
+  for (size_t i = 0; i < bytes; ++i)
+    value |= uint64_t(src[i]) << (i * 8);
+  return value;
+}
+
+static void fpta_dump_put_header(std::string &out,
+                                 const fpta_dump_header &header) {
+  fpta_dump_put(out, header.magic, 4);
+  fpta_dump_put(out, header.format, 4);
+  fpta_dump_put(out, header.table_shove, 8);
+  fpta_dump_put(out, header.column_count, 4);
+  fpta_dump_put(out, header.composite_items, 4);
+  fpta_dump_put(out, header.schema_bytes, 4);
+  fpta_dump_put(out, header.reserved, 4);
+}
+
+static void fpta_dump_get_header(const void *ptr, fpta_dump_header &header) {
+  const char *const src = static_cast<const char *>(ptr);
+  header.magic = uint32_t(fpta_dump_get(src, 4));
+  header.format = uint32_t(fpta_dump_get(src + 4, 4));
+  header.table_shove = fpta_dump_get(src + 8, 8);
+  header.column_count = uint32_t(fpta_dump_get(src + 16, 4));
+  header.composite_items = uint32_t(fpta_dump_get(src + 20, 4));
+  header.schema_bytes = uint32_t(fpta_dump_get(src + 24, 4));
+  header.reserved = uint32_t(fpta_dump_get(src + 28, 4));
+}
+
+static void fpta_dump_put_frame(char *dst, const fpta_dump_frame &frame) {
+  for (size_t i = 0; i < 4; ++i) {
+    dst[i] = char(uint8_t(frame.bytes >> (i * 8)));
+    dst[i + 4] = char(uint8_t(frame.rows >> (i * 8)));
+  }
+}
+
+static void fpta_dump_schema(const fpta_table_schema *table_def,
+                             std::string &out) {
+  fpta_dump_header header;
+  header.magic = fpta_dump_magic;
+  header.format = fpta_dump_format;
+  header.table_shove = table_def->table_shove();
+  header.column_count = uint32_t(table_def->column_count());
+  header.composite_items =
+      uint32_t(table_def->composites_end() - table_def->composites_begin());
+  header.reserved = 0;
+
+  std::string schema;
+  for (size_t i = 0; i < header.column_count; ++i)
+    fpta_dump_put(schema, table_def->column_shove(i), 8);
+  for (auto item = table_def->composites_begin();
+       item != table_def->composites_end(); ++item)
+    fpta_dump_put(schema, *item, 2);
+
+  /* опции индексов, влияющие на формирование ключей и их размещение */
+  for (size_t i = 0; i < header.column_count; ++i) {
+    fpta_dump_put(schema, table_def->is_hash_index(i), 2);
+    fpta_dump_put(schema, table_def->key_limit(i), 2);
+    const fpta_key_prefixes *const prefixes = table_def->key_prefixes(i);
+    fpta_dump_put(schema, prefixes ? prefixes->count : 0, 2);
+    if (prefixes) {
+      for (size_t k = 0; k <= prefixes->count; ++k)
+        fpta_dump_put(schema, prefixes->offsets[k], 2);
+      schema.append(reinterpret_cast<const char *>(prefixes->bytes()),
+                    prefixes->offsets[prefixes->count]);
+    }
+  }
+  schema.resize(fpta_dump_align8(fpta_dump_header_bytes + schema.size()) -
+                    fpta_dump_header_bytes,
+                '\0');
+
+  header.schema_bytes = uint32_t(schema.size());
+  fpta_dump_put_header(out, header);
+  out.append(schema);
+}
+
+int fpta_table_dump(fpta_txn *txn, fpta_name *table_id, fptu_emit_func output,
+                    void *output_ctx, size_t *count) {
+  if (count)
+    *count = 0;
+  if (unlikely(!output))
+    return FPTA_EINVAL;
+
+  int rc = fpta_name_refresh_couple(txn, table_id, nullptr);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  fpta_table_schema *table_def = table_id->table_schema;
+  MDBX_dbi handle;
+  rc = fpta_open_table(txn, table_def, handle);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  std::string buffer;
+  buffer.reserve(fpta_dump_chunk_threshold + fpta_dump_chunk_threshold / 4);
+  fpta_dump_schema(table_def, buffer);
+  rc = output(output_ctx, buffer.data(), buffer.size());
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  MDBX_cursor *mdbx_cursor;
+  rc = mdbx_cursor_open(txn->mdbx_txn, handle, &mdbx_cursor);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  size_t n = 0;
+  fpta_dump_frame frame = {0, 0};
+  buffer.assign(sizeof(frame), '\0');
+  MDBX_val key, data;
+  rc = mdbx_cursor_get(mdbx_cursor, &key, &data, MDBX_FIRST);
+  while (true) {
+    const bool done = (rc != MDBX_SUCCESS);
+    if (done || buffer.size() + sizeof(uint32_t) + data.iov_len >
+                    fpta_dump_chunk_threshold) {
+      if (frame.rows) {
+        frame.bytes = uint32_t(buffer.size() - sizeof(frame));
+        fpta_dump_put_frame(&buffer[0], frame);
+        int err = output(output_ctx, buffer.data(), buffer.size());
+        if (unlikely(err != FPTA_SUCCESS)) {
+          rc = err;
+          break;
+        }
+        frame.rows = 0;
+        buffer.resize(sizeof(frame));
+      }
+      if (done)
+        break;
+    }
+
+    fpta_dump_put(buffer, data.iov_len, sizeof(uint32_t));
+    buffer.append(static_cast<const char *>(data.iov_base), data.iov_len);
+    frame.rows += 1;
+    ++n;
+    rc = mdbx_cursor_get(mdbx_cursor, &key, &data, MDBX_NEXT);
+  }
+  mdbx_cursor_close(mdbx_cursor);
+
+  if (rc == MDBX_NOTFOUND) {
+    /* завершающий кадр */
+    frame.bytes = frame.rows = 0;
+    char tail[sizeof(frame)];
+    fpta_dump_put_frame(tail, frame);
+    rc = output(output_ctx, tail, sizeof(tail));
+  }
+
+  if (count)
+    *count = n;
+  return rc;
+}
+
+//----------------------------------------------------------------------------
+
+namespace {
+
+/* Накопитель пар <ключ вторичного индекса, ключ PK> для одного индекса */
+struct fpta_restore_secondary {
+  std::string keys;
+  std::vector<size_t> offsets;
+
+  /* ключи выравниваются на 8 байт, как того требуют компараторы libmdbx */
+  void add(const MDBX_val &se_key, const MDBX_val &pk_key) {
+    offsets.push_back(keys.size());
+    const uint32_t lengths[2] = {uint32_t(se_key.iov_len),
+                                 uint32_t(pk_key.iov_len)};
+    keys.append(reinterpret_cast<const char *>(lengths), sizeof(lengths));
+    keys.append(static_cast<const char *>(se_key.iov_base), se_key.iov_len);
+    keys.resize(fpta_dump_align8(keys.size()), '\0');
+    keys.append(static_cast<const char *>(pk_key.iov_base), pk_key.iov_len);
+    keys.resize(fpta_dump_align8(keys.size()), '\0');
+  }
+
+  void get(size_t offset, MDBX_val &se_key, MDBX_val &pk_key) const {
+    uint32_t lengths[2];
+    memcpy(lengths, &keys[offset], sizeof(lengths));
+    offset += sizeof(lengths);
+    se_key.iov_len = lengths[0];
+    se_key.iov_base = const_cast<char *>(&keys[offset]);
+    offset = fpta_dump_align8(offset + lengths[0]);
+    pk_key.iov_len = lengths[1];
+    pk_key.iov_base = const_cast<char *>(&keys[offset]);
+  }
+
+  int build(MDBX_txn *mdbx_txn, MDBX_dbi dbi, bool unique, bool hashed) {
+    if (hashed) {
+      /* порядок вставки в хэш-индекс не влияет на его построение */
+      for (const size_t offset : offsets) {
+        MDBX_val se_key, pk_key;
+        get(offset, se_key, pk_key);
+        int rc = fpta_hash_put(mdbx_txn, dbi, se_key, pk_key);
+        if (unlikely(rc != MDBX_SUCCESS))
+          return rc;
+      }
+      return FPTA_SUCCESS;
+    }
+
+    std::sort(offsets.begin(), offsets.end(), [&](size_t a, size_t b) {
+      MDBX_val a_key, a_pk, b_key, b_pk;
+      get(a, a_key, a_pk);
+      get(b, b_key, b_pk);
+      const int cmp = mdbx_cmp(mdbx_txn, dbi, &a_key, &b_key);
+      return cmp ? cmp < 0 : mdbx_dcmp(mdbx_txn, dbi, &a_pk, &b_pk) < 0;
+    });
+
+    const unsigned flags =
+        unique ? MDBX_APPEND : MDBX_APPEND | MDBX_APPENDDUP | MDBX_NODUPDATA;
+    MDBX_val prev_key = {nullptr, 0};
+    for (const size_t offset : offsets) {
+      MDBX_val se_key, pk_key;
+      get(offset, se_key, pk_key);
+      if (unique && prev_key.iov_base &&
+          mdbx_cmp(mdbx_txn, dbi, &prev_key, &se_key) == 0)
+        return FPTA_KEYEXIST;
+      int rc = mdbx_put(mdbx_txn, dbi, &se_key, &pk_key, flags);
+      if (unlikely(rc != MDBX_SUCCESS))
+        return rc;
+      prev_key = se_key;
+    }
+    return FPTA_SUCCESS;
+  }
+};
+
+} // namespace
+
+static int fpta_restore_schema(const fpta_table_schema *table_def,
+                               fpta_input_func input, void *input_ctx) {
+  char raw[fpta_dump_header_bytes];
+  int rc = input(input_ctx, raw, sizeof(raw));
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+  fpta_dump_header header;
+  fpta_dump_get_header(raw, header);
+  if (unlikely(header.magic != fpta_dump_magic ||
+               header.format != fpta_dump_format || header.reserved != 0))
+    return FPTA_EVALUE;
+
+  std::string expected;
+  fpta_dump_schema(table_def, expected);
+  fpta_dump_header own;
+  fpta_dump_get_header(expected.data(), own);
+  if (unlikely(header.column_count != own.column_count ||
+               header.composite_items != own.composite_items ||
+               header.schema_bytes != own.schema_bytes))
+    return FPTA_SCHEMA_CHANGED;
+
+  std::string stored(header.schema_bytes, '\0');
+  rc = input(input_ctx, &stored[0], stored.size());
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  /* Имя таблицы может отличаться, но колонки и опции индексов должны
+   * совпадать */
+  if (unlikely(memcmp(&expected[fpta_dump_header_bytes], stored.data(),
+                      stored.size()) != 0))
+    return FPTA_SCHEMA_CHANGED;
+  return FPTA_SUCCESS;
+}
+
+int fpta_table_restore(fpta_txn *txn, fpta_name *table_id,
+                       fpta_input_func input, void *input_ctx, size_t *count) {
+  if (count)
+    *count = 0;
+  if (unlikely(!input))
+    return FPTA_EINVAL;
+
+  int rc = fpta_txn_validate(txn, fpta_write);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+  rc = fpta_name_refresh_couple(txn, table_id, nullptr);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  fpta_table_schema *table_def = table_id->table_schema;
+  MDBX_dbi handle;
+  rc = fpta_open_table(txn, table_def, handle);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  MDBX_dbi dbi[fpta_max_indexes];
+  if (table_def->has_secondary()) {
+    rc = fpta_open_secondaries(txn, table_def, dbi);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+  }
+
+  MDBX_stat mdbx_stat;
+  rc = mdbx_dbi_stat(txn->mdbx_txn, handle, &mdbx_stat, sizeof(mdbx_stat));
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  if (unlikely(mdbx_stat.ms_entries != 0))
+    return FPTA_EEXIST;
+
+  rc = fpta_restore_schema(table_def, input, input_ctx);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  size_t secondary_count = 0;
+  while (secondary_count + 1 < table_def->column_count() &&
+         fpta_index_is_secondary(
+             fpta_shove2index(table_def->column_shove(secondary_count + 1))))
+    ++secondary_count;
+  std::vector<fpta_restore_secondary> secondary(secondary_count);
+
+  const unsigned pk_flags =
+      fpta_index_is_unique(table_def->table_pk())
+          ? MDBX_APPEND
+          : MDBX_APPEND | MDBX_APPENDDUP | MDBX_NODUPDATA;
+  std::string buffer;
+  bool modified = false;
+  size_t n = 0;
+  while (true) {
+    char raw[sizeof(fpta_dump_frame)];
+    rc = input(input_ctx, raw, sizeof(raw));
+    if (unlikely(rc != FPTA_SUCCESS))
+      break;
+    fpta_dump_frame frame;
+    frame.bytes = uint32_t(fpta_dump_get(raw, 4));
+    frame.rows = uint32_t(fpta_dump_get(raw + 4, 4));
+    if (frame.bytes == 0) {
+      rc = (frame.rows == 0) ? FPTA_SUCCESS : FPTA_EVALUE;
+      break;
+    }
+
+    buffer.resize(frame.bytes);
+    rc = input(input_ctx, &buffer[0], frame.bytes);
+    if (unlikely(rc != FPTA_SUCCESS))
+      break;
+
+    size_t offset = 0;
+    for (uint32_t i = 0; i < frame.rows; ++i) {
+      if (unlikely(offset + sizeof(uint32_t) > buffer.size())) {
+        rc = FPTA_EVALUE;
+        break;
+      }
+      const size_t length = size_t(fpta_dump_get(&buffer[offset], 4));
+      offset += sizeof(uint32_t);
+      if (unlikely(length > buffer.size() - offset)) {
+        rc = FPTA_EVALUE;
+        break;
+      }
+
+      fptu_ro row;
+      row.sys.iov_base = &buffer[offset];
+      row.sys.iov_len = length;
+      offset += length;
+      if (unlikely(fptu_check_ro(row) != nullptr)) {
+        rc = FPTA_EVALUE;
+        break;
+      }
+      fpta_row_fields fields(table_def, row);
+      rc = fpta_check_nonnullable(fields);
+      if (unlikely(rc != FPTA_SUCCESS))
+        break;
+
+      fpta_key pk_key;
+      rc = fpta_index_row2key(fields, 0, pk_key, false);
+      if (unlikely(rc != FPTA_SUCCESS))
+        break;
+      modified = true;
+      rc = mdbx_put(txn->mdbx_txn, handle, &pk_key.mdbx, &row.sys, pk_flags);
+      if (unlikely(rc != MDBX_SUCCESS))
+        break;
+
+      for (size_t k = 0; k < secondary_count; ++k) {
+        fpta_key se_key;
+        rc = fpta_index_row2key(fields, k + 1, se_key, false);
+        if (unlikely(rc != FPTA_SUCCESS))
+          break;
+        secondary[k].add(se_key.mdbx, pk_key.mdbx);
+      }
+      if (unlikely(rc != FPTA_SUCCESS))
+        break;
+
+      if (fpta_changelog_enabled(txn->db)) {
+        rc = fpta_changelog_record(txn, table_def, fpta_change_upsert,
+                                   pk_key.mdbx, &row);
+        if (unlikely(rc != FPTA_SUCCESS))
+          break;
+      }
+      ++n;
+    }
+    if (unlikely(rc != FPTA_SUCCESS))
+      break;
+    if (unlikely(offset != buffer.size())) {
+      rc = FPTA_EVALUE;
+      break;
+    }
+  }
+
+  /* пакетное построение вторичных индексов */
+  for (size_t k = 0; k < secondary_count && rc == FPTA_SUCCESS; ++k) {
+    rc = secondary[k].build(
+        txn->mdbx_txn, dbi[k + 1],
+        fpta_index_is_unique(fpta_shove2index(table_def->column_shove(k + 1))),
+        table_def->is_hash_index(k + 1));
+    secondary[k] = fpta_restore_secondary();
+  }
+
+  if (unlikely(rc != FPTA_SUCCESS))
+    return modified ? fpta_internal_abort(txn, rc) : rc;
+
+  fpta_op_counters delta = {};
+  delta.upserts = n;
+  fpta_metrics_account(txn->db, table_id->shove, table_def->column_shove(0),
+                       delta);
+  if (count)
+    *count = n;
+  return FPTA_SUCCESS;
+}
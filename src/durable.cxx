@@ -0,0 +1,157 @@
+/*
+ *  Fast Positive Tables (libfpta), aka Позитивные Таблицы.
+ *  Copyright 2016-2020 Leonid Yuriev <leo@yuriev.ru>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "details.h"
+
+/* Ожидание сохранности на диске заданной версии данных.
+ *
+ * Версия считается сохраненной, если её покрывает сильная (steady) точка
+ * фиксации, т.е. одна из мета-страниц libmdbx с "сильной" сигнатурой
+ * и номером транзакции не меньше заданного.
+ *
+ * Ожидающие потоки объединяются: синхронизацию выполняет только один из них
+ * ("лидер"), а остальные ждут её завершения на условной переменной. Так как
+ * mdbx_env_sync_ex() синхронизирует все зафиксированные к этому моменту
+ * изменения, то одного вызова достаточно для всех, кто ждал до его начала. */
+
+struct fpta_durable {
+  fpta_mutex_t mutex;
+  fpta_cond_t cond;
+  bool syncing;
+  uint64_t steady_version;
+};
+
+static int fpta_steady_version(fpta_db *db, uint64_t *steady,
+                               uint64_t *recent) {
+  MDBX_envinfo info;
+  int rc = mdbx_env_info_ex(db->mdbx_env, nullptr, &info, sizeof(info));
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  const uint64_t steady_sign_threshold = 1 /* MDBX_DATASIGN_WEAK */;
+  uint64_t version = 0;
+  if (info.mi_meta0_sign > steady_sign_threshold)
+    version = std::max(version, info.mi_meta0_txnid);
+  if (info.mi_meta1_sign > steady_sign_threshold)
+    version = std::max(version, info.mi_meta1_txnid);
+  if (info.mi_meta2_sign > steady_sign_threshold)
+    version = std::max(version, info.mi_meta2_txnid);
+
+  *steady = version;
+  *recent = info.mi_recent_txnid;
+  return FPTA_SUCCESS;
+}
+
+/* Выполняется лидером вне захвата мьютекса.
+ *
+ * Версия могла так и не появиться из-за фиксации пустой транзакции, поэтому
+ * ожидаемая версия ограничивается последней зафиксированной. */
+static int fpta_durable_sync(fpta_db *db, uint64_t version, uint64_t *steady,
+                             bool *reached) {
+  uint64_t recent;
+  int rc = fpta_steady_version(db, steady, &recent);
+  if (likely(rc == FPTA_SUCCESS) && *steady < std::min(version, recent)) {
+    rc = mdbx_env_sync_ex(db->mdbx_env, true, false);
+    if (likely(rc == MDBX_SUCCESS || rc == MDBX_RESULT_TRUE))
+      rc = fpta_steady_version(db, steady, &recent);
+  }
+  *reached = *steady >= std::min(version, recent);
+  return rc;
+}
+
+__cold int fpta_durable_init(fpta_db *db) {
+  assert(db->durable == nullptr);
+  fpta_durable *durable = new fpta_durable /* FIXME: std::bad_alloc */;
+  durable->syncing = false;
+  durable->steady_version = 0;
+
+  int rc = fpta_mutex_init(&durable->mutex);
+  if (unlikely(rc != 0)) {
+    delete durable;
+    return rc;
+  }
+  rc = fpta_cond_init(&durable->cond);
+  if (unlikely(rc != 0)) {
+    fpta_mutex_destroy(&durable->mutex);
+    delete durable;
+    return rc;
+  }
+
+  db->durable = durable;
+  return FPTA_SUCCESS;
+}
+
+__cold void fpta_durable_destroy(fpta_db *db) {
+  fpta_durable *durable = db->durable;
+  if (!durable)
+    return;
+
+  assert(!durable->syncing);
+  int err = fpta_cond_destroy(&durable->cond);
+  assert(err == 0);
+  err = fpta_mutex_destroy(&durable->mutex);
+  assert(err == 0);
+  (void)err;
+  db->durable = nullptr;
+  delete durable;
+}
+
+int fpta_db_wait_durable(fpta_db *db, uint64_t version,
+                         unsigned timeout_milliseconds) {
+  if (unlikely(!fpta_db_validate(db)))
+    return FPTA_EINVAL;
+
+  fpta_durable *const durable = db->durable;
+  const uint64_t start = fpta_latency_now();
+  fpta_lock_guard guard;
+  int rc = guard.lock(&durable->mutex);
+  if (unlikely(rc != 0))
+    return (fpta_error)rc;
+
+  while (durable->steady_version < version) {
+    if (!durable->syncing) {
+      durable->syncing = true;
+      guard.unlock();
+
+      uint64_t steady = 0;
+      bool reached = false;
+      rc = fpta_durable_sync(db, version, &steady, &reached);
+
+      int err = guard.lock(&durable->mutex);
+      assert(err == 0);
+      (void)err;
+      durable->syncing = false;
+      if (likely(rc == FPTA_SUCCESS) && durable->steady_version < steady)
+        durable->steady_version = steady;
+      err = fpta_cond_broadcast(&durable->cond);
+      assert(err == 0);
+      if (unlikely(rc != FPTA_SUCCESS) || reached)
+        return (fpta_error)rc;
+      continue;
+    }
+
+    const uint64_t elapsed_ms = (fpta_latency_now() - start) / 1000000u;
+    if (elapsed_ms >= timeout_milliseconds)
+      return FPTA_ETIMEDOUT;
+    rc = fpta_cond_timedwait(&durable->cond, &durable->mutex,
+                             unsigned(timeout_milliseconds - elapsed_ms));
+    if (unlikely(rc != 0 && rc != FPTA_ETIMEDOUT))
+      return (fpta_error)rc;
+  }
+
+  return FPTA_SUCCESS;
+}
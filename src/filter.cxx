@@ -455,7 +455,9 @@ FPTA_API int fpta_estimate(fpta_txn *txn, unsigned items_count,
       break;
 
     default:
-      err = fpta_index_value2key(i->column_id->shove, i->range_from, begin_key);
+      err = fpta_index_value2key(i->column_id->column.table->table_schema,
+                                 i->column_id->column.num, i->range_from,
+                                 begin_key);
       if (unlikely(err != FPTA_SUCCESS)) {
         i->error = err;
         continue;
@@ -477,7 +479,9 @@ FPTA_API int fpta_estimate(fpta_txn *txn, unsigned items_count,
       break;
 
     default:
-      err = fpta_index_value2key(i->column_id->shove, i->range_to, end_key);
+      err = fpta_index_value2key(i->column_id->column.table->table_schema,
+                                 i->column_id->column.num, i->range_to,
+                                 end_key);
       if (unlikely(err != FPTA_SUCCESS)) {
         i->error = err;
         continue;
@@ -500,6 +504,31 @@ FPTA_API int fpta_estimate(fpta_txn *txn, unsigned items_count,
       }
     }
 
+    MDBX_val pk_keys[2];
+    if (i->column_id->column.table->table_schema->is_hash_index(
+            i->column_id->column.num)) {
+      /* Курсор по хэш-индексу перебирает строки по первичному индексу,
+       * поэтому и оценка выполняется по нему, с заменой значений колонки
+       * значениями первичного ключа. */
+      MDBX_val **const keys[2] = {&mdbx_begin_key, &mdbx_end_key};
+      for (size_t k = 0; k < 2 && err == MDBX_SUCCESS; ++k)
+        if (*keys[k] && *keys[k] != MDBX_EPSILON) {
+          err = fpta_hash_get(txn->mdbx_txn, idx_handle, **keys[k],
+                              &pk_keys[k]);
+          *keys[k] = &pk_keys[k];
+        }
+      if (err == MDBX_NOTFOUND) {
+        i->estimated_rows = 0;
+        i->error = rc = FPTA_SUCCESS;
+        continue;
+      }
+      if (unlikely(err != MDBX_SUCCESS)) {
+        i->error = err;
+        continue;
+      }
+      idx_handle = tbl_handle;
+    }
+
     err =
         mdbx_estimate_range(txn->mdbx_txn, idx_handle, mdbx_begin_key, nullptr,
                             mdbx_end_key, nullptr, &i->estimated_rows);
@@ -0,0 +1,328 @@
+/*
+ *  Fast Positive Tables (libfpta), aka Позитивные Таблицы.
+ *  Copyright 2016-2020 Leonid Yuriev <leo@yuriev.ru>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "details.h"
+
+#include <deque>
+#include <thread>
+
+/* Групповая фиксация.
+ *
+ * Отправители помещают квитанции с функциями в общую очередь, а единственный
+ * поток-писатель забирает из очереди всё накопившееся (но не более max_batch),
+ * выполняет функции в одной пишущей транзакции и фиксирует её однократно.
+ * Пока писатель занят фиксацией (и синхронизацией с диском), в очереди
+ * накапливается следующая группа, что и дает выигрыш при fpta_sync.
+ *
+ * Неудачно завершившаяся функция могла успеть частично изменить данные,
+ * а вложенные транзакции в libfpta не поддерживаются. Поэтому в этом случае
+ * транзакция отменяется и все ранее успешные функции группы выполняются
+ * повторно в новой транзакции. От функций требуется детерминированность
+ * и отсутствие побочных эффектов вне транзакции, а функция не повторившая
+ * прежний успешный результат исключается из группы с кодом FPTA_EOOPS.
+ *
+ * Чтобы повторы не приводили к квадратичным затратам при множестве неудач,
+ * их количество в рамках одной транзакции ограничено replay_limit. При
+ * достижении предела уже выполненная часть группы фиксируется, а остальные
+ * функции продолжают выполняться в новой транзакции. */
+
+struct fpta_commit_ticket {
+  enum { signature_value = 1563587537 };
+  unsigned signature;
+  bool done;
+  int result;
+  fpta_group_commit *gc;
+  fpta_group_commit_func func;
+  void *arg;
+};
+
+struct fpta_group_commit {
+  enum {
+    signature_value = 1096040459,
+    max_batch_default = 1024,
+    replay_limit = 4
+  };
+  unsigned signature;
+  bool stopping;
+  size_t max_batch;
+  fpta_db *db;
+  fpta_mutex_t mutex;
+  fpta_cond_t queue_cond, done_cond;
+  std::deque<fpta_commit_ticket *> queue;
+  std::thread writer;
+
+  void run();
+  void process(std::vector<fpta_commit_ticket *> &batch);
+};
+
+static int fpta_group_commit_replay(fpta_db *db, fpta_txn *&txn,
+                                    std::vector<fpta_commit_ticket *> &ok) {
+  for (;;) {
+    if (txn) {
+      fpta_transaction_end(txn, true);
+      txn = nullptr;
+    }
+
+    int rc = fpta_transaction_begin(db, fpta_write, &txn);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+
+    auto it = ok.begin();
+    while (it != ok.end() && (*it)->func(txn, (*it)->arg) == FPTA_SUCCESS)
+      ++it;
+    if (likely(it == ok.end()))
+      return FPTA_SUCCESS;
+
+    /* функция не повторила прежний результат, исключаем её из группы */
+    (*it)->result = FPTA_EOOPS;
+    ok.erase(it);
+  }
+}
+
+void fpta_group_commit::process(std::vector<fpta_commit_ticket *> &batch) {
+  std::vector<fpta_commit_ticket *> ok;
+  ok.reserve(batch.size());
+
+  fpta_txn *txn = nullptr;
+  unsigned replays = 0;
+  int rc = fpta_transaction_begin(db, fpta_write, &txn);
+  for (fpta_commit_ticket *ticket : batch) {
+    if (unlikely(rc != FPTA_SUCCESS)) {
+      ticket->result = rc;
+      continue;
+    }
+
+    const int err = ticket->func(txn, ticket->arg);
+    if (likely(err == FPTA_SUCCESS)) {
+      ok.push_back(ticket);
+      continue;
+    }
+
+    ticket->result = err;
+    rc = fpta_group_commit_replay(db, txn, ok);
+    if (unlikely(rc != FPTA_SUCCESS)) {
+      for (fpta_commit_ticket *failed : ok)
+        failed->result = rc;
+      continue;
+    }
+
+    if (++replays >= replay_limit) {
+      /* фиксируем выполненную часть группы, чтобы ограничить повторы */
+      rc = fpta_transaction_end(txn, false);
+      txn = nullptr;
+      for (fpta_commit_ticket *committed : ok)
+        committed->result = rc;
+      ok.clear();
+      replays = 0;
+      if (likely(rc == FPTA_SUCCESS))
+        rc = fpta_transaction_begin(db, fpta_write, &txn);
+    }
+  }
+
+  if (likely(rc == FPTA_SUCCESS)) {
+    rc = fpta_transaction_end(txn, false);
+    for (fpta_commit_ticket *ticket : ok)
+      ticket->result = rc;
+  } else if (txn) {
+    fpta_transaction_end(txn, true);
+  }
+}
+
+void fpta_group_commit::run() {
+  std::vector<fpta_commit_ticket *> batch;
+  batch.reserve(max_batch);
+
+  fpta_lock_guard guard;
+  int err = guard.lock(&mutex);
+  assert(err == 0);
+  for (;;) {
+    while (queue.empty() && !stopping) {
+      err = fpta_cond_wait(&queue_cond, &mutex);
+      assert(err == 0);
+    }
+    if (queue.empty())
+      break;
+
+    while (!queue.empty() && batch.size() < max_batch) {
+      batch.push_back(queue.front());
+      queue.pop_front();
+    }
+
+    guard.unlock();
+    process(batch);
+    err = guard.lock(&mutex);
+    assert(err == 0);
+
+    for (fpta_commit_ticket *ticket : batch)
+      ticket->done = true;
+    batch.clear();
+    err = fpta_cond_broadcast(&done_cond);
+    assert(err == 0);
+  }
+  (void)err;
+}
+
+static void fpta_group_commit_destroy(fpta_group_commit *gc) {
+  int err = fpta_cond_destroy(&gc->done_cond);
+  assert(err == 0);
+  err = fpta_cond_destroy(&gc->queue_cond);
+  assert(err == 0);
+  err = fpta_mutex_destroy(&gc->mutex);
+  assert(err == 0);
+  (void)err;
+  gc->signature = ~fpta_group_commit::signature_value;
+  delete gc;
+}
+
+//----------------------------------------------------------------------------
+
+__cold int fpta_group_commit_open(fpta_db *db, size_t max_batch,
+                                  fpta_group_commit **pgc) {
+  if (unlikely(pgc == nullptr))
+    return FPTA_EINVAL;
+  *pgc = nullptr;
+
+  if (unlikely(!fpta_db_validate(db)))
+    return FPTA_EINVAL;
+
+  fpta_group_commit *gc = new fpta_group_commit /* FIXME: std::bad_alloc */;
+  gc->signature = fpta_group_commit::signature_value;
+  gc->stopping = false;
+  gc->max_batch =
+      max_batch ? max_batch : size_t(fpta_group_commit::max_batch_default);
+  gc->db = db;
+
+  int rc = fpta_mutex_init(&gc->mutex);
+  if (unlikely(rc != 0)) {
+    delete gc;
+    return (fpta_error)rc;
+  }
+  rc = fpta_cond_init(&gc->queue_cond);
+  if (unlikely(rc != 0)) {
+    fpta_mutex_destroy(&gc->mutex);
+    delete gc;
+    return (fpta_error)rc;
+  }
+  rc = fpta_cond_init(&gc->done_cond);
+  if (unlikely(rc != 0)) {
+    fpta_cond_destroy(&gc->queue_cond);
+    fpta_mutex_destroy(&gc->mutex);
+    delete gc;
+    return (fpta_error)rc;
+  }
+
+  try {
+    gc->writer = std::thread(&fpta_group_commit::run, gc);
+  } catch (const std::system_error &) {
+    fpta_group_commit_destroy(gc);
+    return FPTA_ENOMEM;
+  }
+
+  *pgc = gc;
+  return FPTA_SUCCESS;
+}
+
+__cold int fpta_group_commit_close(fpta_group_commit *gc) {
+  if (unlikely(gc == nullptr ||
+               gc->signature != fpta_group_commit::signature_value))
+    return FPTA_EINVAL;
+
+  fpta_lock_guard guard;
+  int rc = guard.lock(&gc->mutex);
+  if (unlikely(rc != 0))
+    return (fpta_error)rc;
+  gc->stopping = true;
+  rc = fpta_cond_broadcast(&gc->queue_cond);
+  guard.unlock();
+  if (unlikely(rc != 0))
+    return (fpta_error)rc;
+
+  gc->writer.join();
+  fpta_group_commit_destroy(gc);
+  return FPTA_SUCCESS;
+}
+
+int fpta_group_commit_submit(fpta_group_commit *gc,
+                             fpta_group_commit_func func, void *arg,
+                             fpta_commit_ticket **pticket) {
+  if (unlikely(pticket == nullptr))
+    return FPTA_EINVAL;
+  *pticket = nullptr;
+
+  if (unlikely(gc == nullptr || func == nullptr ||
+               gc->signature != fpta_group_commit::signature_value))
+    return FPTA_EINVAL;
+
+  fpta_commit_ticket *ticket =
+      new fpta_commit_ticket /* FIXME: std::bad_alloc */;
+  ticket->signature = fpta_commit_ticket::signature_value;
+  ticket->done = false;
+  ticket->result = FPTA_EOOPS;
+  ticket->gc = gc;
+  ticket->func = func;
+  ticket->arg = arg;
+
+  fpta_lock_guard guard;
+  int rc = guard.lock(&gc->mutex);
+  if (unlikely(rc != 0)) {
+    delete ticket;
+    return (fpta_error)rc;
+  }
+  if (unlikely(gc->stopping)) {
+    delete ticket;
+    return FPTA_EPERM;
+  }
+  gc->queue.push_back(ticket);
+  rc = fpta_cond_broadcast(&gc->queue_cond);
+  assert(rc == 0);
+  guard.unlock();
+
+  *pticket = ticket;
+  return FPTA_SUCCESS;
+}
+
+int fpta_group_commit_wait(fpta_commit_ticket *ticket) {
+  if (unlikely(ticket == nullptr ||
+               ticket->signature != fpta_commit_ticket::signature_value))
+    return FPTA_EINVAL;
+
+  fpta_group_commit *const gc = ticket->gc;
+  fpta_lock_guard guard;
+  int rc = guard.lock(&gc->mutex);
+  if (unlikely(rc != 0))
+    return (fpta_error)rc;
+  while (!ticket->done) {
+    rc = fpta_cond_wait(&gc->done_cond, &gc->mutex);
+    if (unlikely(rc != 0))
+      return (fpta_error)rc;
+  }
+  guard.unlock();
+
+  rc = ticket->result;
+  ticket->signature = ~fpta_commit_ticket::signature_value;
+  delete ticket;
+  return rc;
+}
+
+int fpta_group_commit_execute(fpta_group_commit *gc,
+                              fpta_group_commit_func func, void *arg) {
+  fpta_commit_ticket *ticket;
+  int rc = fpta_group_commit_submit(gc, func, arg, &ticket);
+  if (likely(rc == FPTA_SUCCESS))
+    rc = fpta_group_commit_wait(ticket);
+  return rc;
+}
@@ -0,0 +1,732 @@
+/*
+ *  Fast Positive Tables (libfpta), aka Позитивные Таблицы.
+ *  Copyright 2016-2020 Leonid Yuriev <leo@yuriev.ru>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "details.h"
+
+#include <string>
+#include <vector>
+
+/* Хэш-индексы, см. fpta_describe_hash_index().
+ *
+ * Записи уникального неупорядоченного индекса хранятся расширяемой
+ * хэш-таблицей (R. Fagin et al., 1979) в обычном dbi индекса. Каждая
+ * корзина и каждый сегмент каталога являются отдельным значением размером
+ * в целое число страниц, т.е. всегда размещаются libmdbx вне листовых
+ * страниц B-дерева. Каталог ссылается на корзины номерами их страниц,
+ * поэтому поиск по ключу читает корень каталога, сегмент и корзину
+ * посредством mdbx_get_bypgno() без спуска по B-дереву (см. патч
+ * externals/libmdbx-patches/0005-mdbx_get_bypgno.patch).
+ *
+ * Ключами в dbi служат:
+ *  - UINT64_MAX для корня каталога, номер страницы которого хранится
+ *    в mdbx_dbi_sequence() этого же dbi, поэтому очистка таблицы
+ *    посредством mdbx_drop() сбрасывает и хэш-таблицу;
+ *  - 2^63 + s для s-го сегмента каталога;
+ *  - (d << 48) + p для корзины локальной глубины d, в которую попадают
+ *    ключи со старшими d битами хэша равными p.
+ *
+ * Каталог глубины G содержит 2^G номеров страниц корзин, индексируемых
+ * старшими G битами хэша, поэтому корзине глубины d соответствует
+ * непрерывный диапазон из 2^(G-d) элементов каталога. При переполнении
+ * страницы корзина расщепляется (с удвоением каталога при d = G) именно
+ * та, в которую выполняется вставка. Глубина каталога ограничена
+ * fpta_hash_depth_limit, а корзина этой глубины при переполнении растет
+ * на следующие страницы, что возможно только при массовых коллизиях
+ * 64-битного хэша. Опустевшие корзины удаляются, а ссылки на них
+ * обнуляются; корзины не объединяются, а каталог не сокращается.
+ *
+ * Изменение значения в пишущей транзакции может переместить его
+ * на другие страницы, поэтому после каждой записи номер страницы
+ * перечитывается посредством mdbx_get_large() и при изменении
+ * обновляются ссылки в каталоге. Каждая запись начинается с её ключа,
+ * смешанного с fpta_hash_seed, что позволяет обнаружить устаревшие
+ * ссылки (например, после копирования БД с дефрагментацией). В таком
+ * случае читающие транзакции ищут корзину по ключам, а пишущие
+ * перестраивают каталог. */
+
+static cxx11_constexpr_var uint64_t fpta_hash_seed =
+    UINT64_C(0x48617368496E6478) /* "HashIndx" */;
+
+enum {
+  /* Предельная глубина каталога, т.е. не более 2^24 ссылок на корзины */
+  fpta_hash_depth_limit = 24
+};
+
+namespace {
+
+struct fpta_hash_entry {
+  MDBX_val se_key, pk_key;
+};
+
+class fpta_hash_table {
+  MDBX_txn *const txn;
+  const MDBX_dbi dbi;
+  /* Номер страницы и содержимое корня каталога */
+  uint32_t root_pgno;
+  MDBX_val root;
+  /* Глубина каталога, количество ссылок в сегменте и количество сегментов */
+  unsigned depth, capacity, segments;
+
+  enum {
+    /* Заголовок корня: ключ, глубина, емкость и количество сегментов */
+    root_header = 24,
+    /* Заголовок сегмента: ключ */
+    segment_header = 8,
+    /* Заголовок корзины: ключ, количество записей и начало кучи записей */
+    bucket_header = 16,
+    /* Слот корзины: младшие 32 бита хэша и смещение записи */
+    bucket_slot = 8
+  };
+
+  static cxx11_constexpr uint64_t key_root() { return UINT64_MAX; }
+  static cxx11_constexpr uint64_t key_segment(uint64_t number) {
+    return UINT64_C(1) << 63 | number;
+  }
+  static cxx11_constexpr uint64_t key_bucket(unsigned depth,
+                                             uint64_t prefix) {
+    return uint64_t(depth) << 48 | prefix;
+  }
+  static cxx11_constexpr uint64_t index(uint64_t hash, unsigned depth) {
+    return depth ? hash >> (64 - depth) : 0;
+  }
+
+  static uint32_t peek32(const void *ptr) {
+    uint32_t value;
+    memcpy(&value, ptr, sizeof(value));
+    return value;
+  }
+  static uint64_t peek64(const void *ptr) {
+    uint64_t value;
+    memcpy(&value, ptr, sizeof(value));
+    return value;
+  }
+  static void poke32(void *ptr, uint32_t value) {
+    memcpy(ptr, &value, sizeof(value));
+  }
+  static void poke64(void *ptr, uint64_t value) {
+    memcpy(ptr, &value, sizeof(value));
+  }
+  static const uint8_t *bytes(const MDBX_val &val) {
+    return static_cast<const uint8_t *>(val.iov_base);
+  }
+
+  /* Ключи и значения в записи корзины выравниваются на 4 байта,
+   * как того требуют компараторы целочисленных ключей libmdbx. */
+  static size_t align(size_t bytes) { return (bytes + 3) & ~size_t(3); }
+  static size_t entry_size(const fpta_hash_entry &entry) {
+    return 4 + align(entry.se_key.iov_len) + align(entry.pk_key.iov_len);
+  }
+
+  static bool valid(const MDBX_val &record, uint64_t key) {
+    return record.iov_len >= 8 &&
+           peek64(record.iov_base) == (key ^ fpta_hash_seed);
+  }
+
+  int read(uint32_t pgno, uint64_t key, MDBX_val &record) const {
+    if (unlikely(pgno < 3))
+      return MDBX_CORRUPTED;
+    int rc = mdbx_get_bypgno(txn, pgno, &record);
+    if (likely(rc == MDBX_SUCCESS) && unlikely(!valid(record, key)))
+      rc = MDBX_CORRUPTED;
+    return rc;
+  }
+
+  int room(size_t pages, size_t &bytes) const {
+    return mdbx_large_room(mdbx_txn_env(txn), pages, &bytes);
+  }
+
+  /* Записывает значение и возвращает номер его первой страницы */
+  int store(uint64_t key, const std::string &image, uint32_t &pgno) {
+    MDBX_val k = {&key, sizeof(key)};
+    MDBX_val data = {const_cast<char *>(image.data()), image.size()};
+    int rc = mdbx_put(txn, dbi, &k, &data, 0);
+    if (likely(rc == MDBX_SUCCESS))
+      rc = mdbx_get_large(txn, dbi, &k, &data, &pgno);
+    if (likely(rc == MDBX_SUCCESS) && unlikely(pgno == 0))
+      rc = MDBX_CORRUPTED;
+    return rc;
+  }
+
+  int store_root(const std::string &image) {
+    uint32_t pgno;
+    int rc = store(key_root(), image, pgno);
+    if (likely(rc == MDBX_SUCCESS) && pgno != root_pgno)
+      rc = mdbx_dbi_sequence_set(txn, dbi, pgno);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    root_pgno = pgno;
+    return reload();
+  }
+
+  /* Перечитывает корень после изменений, которые могли сделать
+   * недействительным указатель на его данные. */
+  int reload() {
+    int rc = read(root_pgno, key_root(), root);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    depth = peek32(bytes(root) + 8);
+    capacity = peek32(bytes(root) + 12);
+    segments = peek32(bytes(root) + 16);
+    if (unlikely(depth > fpta_hash_depth_limit || capacity < 1 ||
+                 segments != ((UINT64_C(1) << depth) - 1) / capacity + 1 ||
+                 root_header + segments * size_t(4) > root.iov_len))
+      return MDBX_CORRUPTED;
+    return MDBX_SUCCESS;
+  }
+
+  uint32_t segment_pgno(uint64_t number) const {
+    return peek32(bytes(root) + root_header + number * 4);
+  }
+
+  /* Формирует корень с заданной глубиной и номерами страниц сегментов */
+  int make_root(unsigned new_depth, const std::vector<uint32_t> &pgnos,
+                std::string &image) const {
+    const size_t length = root_header + pgnos.size() * 4;
+    size_t bytes = 0;
+    for (size_t pages = 1; bytes < length; ++pages) {
+      int rc = room(pages, bytes);
+      if (unlikely(rc != MDBX_SUCCESS))
+        return rc;
+    }
+    image.assign(bytes, '\0');
+    char *const ptr = &image[0];
+    poke64(ptr, key_root() ^ fpta_hash_seed);
+    poke32(ptr + 8, new_depth);
+    poke32(ptr + 12, capacity);
+    poke32(ptr + 16, uint32_t(pgnos.size()));
+    memcpy(ptr + root_header, pgnos.data(), pgnos.size() * 4);
+    return MDBX_SUCCESS;
+  }
+
+  /* Записывает каталог заданной глубины целиком */
+  int store_directory(unsigned new_depth, const std::vector<uint32_t> &dir) {
+    const uint64_t count = ((UINT64_C(1) << new_depth) - 1) / capacity + 1;
+    std::vector<uint32_t> pgnos(size_t(count), 0);
+    std::string image;
+    for (uint64_t s = 0; s < count; ++s) {
+      size_t bytes;
+      int rc = room(1, bytes);
+      if (unlikely(rc != MDBX_SUCCESS))
+        return rc;
+      image.assign(bytes, '\0');
+      poke64(&image[0], key_segment(s) ^ fpta_hash_seed);
+      const uint64_t first = s * capacity;
+      const uint64_t last = std::min(first + capacity, uint64_t(dir.size()));
+      memcpy(&image[segment_header], dir.data() + first,
+             size_t(last - first) * 4);
+      rc = store(key_segment(s), image, pgnos[size_t(s)]);
+      if (unlikely(rc != MDBX_SUCCESS))
+        return rc;
+    }
+    int rc = make_root(new_depth, pgnos, image);
+    if (likely(rc == MDBX_SUCCESS))
+      rc = store_root(image);
+    return rc;
+  }
+
+  /* Удваивает каталог, увеличивая его глубину на единицу */
+  int grow() {
+    int rc = reload();
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    std::vector<uint32_t> dir(size_t(2) << depth);
+    for (uint64_t i = 0; i < (UINT64_C(1) << depth);) {
+      const uint64_t s = i / capacity;
+      MDBX_val segment;
+      rc = read(segment_pgno(s), key_segment(s), segment);
+      if (unlikely(rc != MDBX_SUCCESS))
+        return rc;
+      for (uint64_t j = 0; j < capacity && i < (UINT64_C(1) << depth);
+           ++j, ++i)
+        dir[size_t(i * 2)] = dir[size_t(i * 2 + 1)] =
+            peek32(bytes(segment) + segment_header + j * 4);
+    }
+    return store_directory(depth + 1, dir);
+  }
+
+  /* Записывает номер страницы корзины во все ссылающиеся на неё элементы
+   * каталога. */
+  int assign(unsigned bucket_depth, uint64_t prefix, uint32_t pgno) {
+    const uint64_t first = prefix << (depth - bucket_depth);
+    const uint64_t last = (prefix + 1) << (depth - bucket_depth);
+    int rc = reload();
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    std::string image;
+    for (uint64_t i = first; i < last;) {
+      const uint64_t s = i / capacity;
+      const uint32_t old_pgno = segment_pgno(s);
+      MDBX_val segment;
+      rc = read(old_pgno, key_segment(s), segment);
+      if (unlikely(rc != MDBX_SUCCESS))
+        return rc;
+      image.assign(static_cast<const char *>(segment.iov_base),
+                   segment.iov_len);
+      for (; i < last && i / capacity == s; ++i)
+        poke32(&image[size_t(segment_header + (i - s * capacity) * 4)], pgno);
+      uint32_t new_pgno;
+      rc = store(key_segment(s), image, new_pgno);
+      if (likely(rc == MDBX_SUCCESS))
+        rc = reload();
+      if (unlikely(rc != MDBX_SUCCESS))
+        return rc;
+      if (new_pgno != old_pgno) {
+        image.assign(static_cast<const char *>(root.iov_base), root.iov_len);
+        poke32(&image[size_t(root_header + s * 4)], new_pgno);
+        rc = store_root(image);
+        if (unlikely(rc != MDBX_SUCCESS))
+          return rc;
+      }
+    }
+    return MDBX_SUCCESS;
+  }
+
+  /* Перестраивает каталог по имеющимся записям корзин */
+  int repair() {
+    MDBX_val key, data;
+    uint64_t number = key_root();
+    key.iov_base = &number;
+    key.iov_len = sizeof(number);
+    int rc = mdbx_get(txn, dbi, &key, &data);
+    if (rc == MDBX_NOTFOUND)
+      return mdbx_dbi_sequence_set(txn, dbi, 0);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    if (unlikely(!valid(data, key_root()) || data.iov_len < root_header))
+      return MDBX_CORRUPTED;
+    unsigned new_depth = peek32(bytes(data) + 8);
+
+    std::vector<uint64_t> buckets;
+    MDBX_cursor *cursor;
+    rc = mdbx_cursor_open(txn, dbi, &cursor);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    for (rc = mdbx_cursor_get(cursor, &key, &data, MDBX_FIRST);
+         rc == MDBX_SUCCESS;
+         rc = mdbx_cursor_get(cursor, &key, &data, MDBX_NEXT)) {
+      number = peek64(key.iov_base);
+      if (number >= key_segment(0))
+        break;
+      const unsigned bucket_depth = unsigned(number >> 48);
+      if (unlikely(bucket_depth > fpta_hash_depth_limit ||
+                   (number & UINT64_C(0xFFFFffffFFFF)) >> bucket_depth)) {
+        rc = MDBX_CORRUPTED;
+        break;
+      }
+      new_depth = std::max(new_depth, bucket_depth);
+      buckets.push_back(number);
+    }
+    mdbx_cursor_close(cursor);
+    if (unlikely(rc != MDBX_SUCCESS && rc != MDBX_NOTFOUND))
+      return rc;
+    if (unlikely(new_depth > fpta_hash_depth_limit))
+      return MDBX_CORRUPTED;
+
+    size_t bytes;
+    rc = room(1, bytes);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    capacity = unsigned((bytes - segment_header) / 4);
+    std::vector<uint32_t> dir(size_t(1) << new_depth, 0);
+    for (const uint64_t item : buckets) {
+      key.iov_base = &number;
+      number = item;
+      uint32_t pgno;
+      rc = mdbx_get_large(txn, dbi, &key, &data, &pgno);
+      if (unlikely(rc != MDBX_SUCCESS))
+        return rc;
+      if (unlikely(pgno == 0 || !valid(data, item)))
+        return MDBX_CORRUPTED;
+      const unsigned bucket_depth = unsigned(item >> 48);
+      const uint64_t prefix = item & UINT64_C(0xFFFFffffFFFF);
+      std::fill(dir.begin() + size_t(prefix << (new_depth - bucket_depth)),
+                dir.begin() +
+                    size_t((prefix + 1) << (new_depth - bucket_depth)),
+                pgno);
+    }
+    root_pgno = 0;
+    return store_directory(new_depth, dir);
+  }
+
+public:
+  /* Найденная (либо отсутствующая) корзина для значения хэша */
+  struct bucket {
+    unsigned depth;
+    uint64_t prefix;
+    uint32_t pgno;
+    MDBX_val data;
+  };
+
+  fpta_hash_table(MDBX_txn *txn, MDBX_dbi dbi)
+      : txn(txn), dbi(dbi), root_pgno(0), root({nullptr, 0}), depth(0),
+        capacity(0), segments(0) {}
+
+  static uint64_t hash(const MDBX_val &se_key) {
+    return t1ha2_atonce(se_key.iov_base, se_key.iov_len, fpta_hash_seed);
+  }
+
+  /* Признак ссылки, не соответствующей записи хэш-таблицы */
+  static bool stale(int rc) {
+    return rc == MDBX_CORRUPTED || rc == MDBX_PAGE_NOTFOUND;
+  }
+
+  /* Читает корень каталога, а в пишущей транзакции при необходимости
+   * создает пустой каталог. */
+  int open(bool create) {
+    uint64_t sequence;
+    int rc = mdbx_dbi_sequence(txn, dbi, &sequence, 0);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    if (unlikely(sequence > UINT32_MAX))
+      return MDBX_CORRUPTED;
+    root_pgno = uint32_t(sequence);
+    if (root_pgno)
+      return reload();
+    if (!create)
+      return MDBX_SUCCESS;
+
+    size_t bytes;
+    rc = room(1, bytes);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    capacity = unsigned((bytes - segment_header) / 4);
+    return store_directory(0, std::vector<uint32_t>(1, 0));
+  }
+
+  /* Находит корзину по ссылкам каталога */
+  int find(uint64_t hash, bucket &b) const {
+    b.depth = depth;
+    b.prefix = index(hash, depth);
+    b.pgno = 0;
+    b.data.iov_base = nullptr;
+    b.data.iov_len = 0;
+    if (!root_pgno)
+      return MDBX_SUCCESS;
+
+    const uint64_t s = b.prefix / capacity;
+    MDBX_val segment;
+    int rc = read(segment_pgno(s), key_segment(s), segment);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    if (unlikely(segment.iov_len < segment_header + capacity * size_t(4)))
+      return MDBX_CORRUPTED;
+    b.pgno = peek32(bytes(segment) + segment_header +
+                    (b.prefix - s * capacity) * 4);
+    if (!b.pgno)
+      return MDBX_SUCCESS;
+
+    rc = mdbx_get_bypgno(txn, b.pgno, &b.data);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    if (unlikely(b.data.iov_len < bucket_header))
+      return MDBX_CORRUPTED;
+    const uint64_t key = peek64(b.data.iov_base) ^ fpta_hash_seed;
+    const unsigned bucket_depth = unsigned(key >> 48);
+    if (unlikely(bucket_depth > depth ||
+                 key_bucket(bucket_depth, b.prefix >> (depth - bucket_depth)) !=
+                     key))
+      return MDBX_CORRUPTED;
+    b.depth = bucket_depth;
+    b.prefix >>= depth - bucket_depth;
+    return MDBX_SUCCESS;
+  }
+
+  /* Находит корзину поиском по ключам, без использования ссылок каталога */
+  int probe(uint64_t hash, bucket &b) const {
+    b.pgno = 0;
+    b.data.iov_base = nullptr;
+    b.data.iov_len = 0;
+    uint64_t number = key_root();
+    MDBX_val key = {&number, sizeof(number)}, data;
+    int rc = mdbx_get(txn, dbi, &key, &data);
+    if (rc == MDBX_NOTFOUND)
+      return MDBX_SUCCESS;
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    if (unlikely(!valid(data, key_root()) || data.iov_len < root_header))
+      return MDBX_CORRUPTED;
+    for (int d = std::min(int(peek32(bytes(data) + 8)),
+                          int(fpta_hash_depth_limit));
+         d >= 0; --d) {
+      number = key_bucket(unsigned(d), index(hash, unsigned(d)));
+      rc = mdbx_get(txn, dbi, &key, &b.data);
+      if (rc != MDBX_NOTFOUND) {
+        if (unlikely(rc != MDBX_SUCCESS))
+          return rc;
+        if (unlikely(!valid(b.data, number) ||
+                     b.data.iov_len < bucket_header))
+          return MDBX_CORRUPTED;
+        b.depth = unsigned(d);
+        b.prefix = index(hash, unsigned(d));
+        return MDBX_SUCCESS;
+      }
+    }
+    return MDBX_SUCCESS;
+  }
+
+  /* Находит корзину для изменения, перестраивая при необходимости
+   * устаревший каталог. */
+  int prepare(uint64_t hash, bool create, bucket &b) {
+    int rc = open(create);
+    if (likely(rc == MDBX_SUCCESS))
+      rc = find(hash, b);
+    if (unlikely(stale(rc))) {
+      rc = repair();
+      if (likely(rc == MDBX_SUCCESS))
+        rc = open(create);
+      if (likely(rc == MDBX_SUCCESS))
+        rc = find(hash, b);
+    }
+    return rc;
+  }
+
+  /* Ищет в корзине запись с ключом se_key */
+  static int search(const MDBX_val &data, const MDBX_val &se_key,
+                    uint64_t hash, MDBX_val *pk_key) {
+    if (!data.iov_base)
+      return MDBX_NOTFOUND;
+    const uint8_t *const base = bytes(data);
+    const size_t count = peek32(base + 8);
+    const size_t heap = peek32(base + 12);
+    if (unlikely(heap > data.iov_len ||
+                 bucket_header + count * bucket_slot > heap))
+      return MDBX_CORRUPTED;
+    const uint32_t tag = uint32_t(hash);
+    for (size_t i = 0; i < count; ++i) {
+      const uint8_t *const slot = base + bucket_header + i * bucket_slot;
+      if (peek32(slot) != tag)
+        continue;
+      const size_t offset = peek32(slot + 4);
+      if (unlikely(offset < heap || offset + 4 > data.iov_len))
+        return MDBX_CORRUPTED;
+      const size_t se_length = uint16_t(peek32(base + offset));
+      const size_t pk_length = peek32(base + offset) >> 16;
+      const size_t pk_offset = offset + 4 + align(se_length);
+      if (unlikely(pk_offset + pk_length > data.iov_len))
+        return MDBX_CORRUPTED;
+      if (se_length == se_key.iov_len &&
+          memcmp(base + offset + 4, se_key.iov_base, se_length) == 0) {
+        if (pk_key) {
+          pk_key->iov_base = const_cast<uint8_t *>(base + pk_offset);
+          pk_key->iov_len = pk_length;
+        }
+        return MDBX_SUCCESS;
+      }
+    }
+    return MDBX_NOTFOUND;
+  }
+
+  /* Разбирает записи корзины, копия которой хранится в image */
+  static int parse(const std::string &image,
+                   std::vector<fpta_hash_entry> &entries) {
+    entries.clear();
+    if (image.empty())
+      return MDBX_SUCCESS;
+    const uint8_t *const base = reinterpret_cast<const uint8_t *>(image.data());
+    const size_t count = peek32(base + 8);
+    const size_t heap = peek32(base + 12);
+    if (unlikely(heap > image.size() ||
+                 bucket_header + count * bucket_slot > heap))
+      return MDBX_CORRUPTED;
+    entries.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+      const size_t offset = peek32(base + bucket_header + i * bucket_slot + 4);
+      if (unlikely(offset < heap || offset + 4 > image.size()))
+        return MDBX_CORRUPTED;
+      fpta_hash_entry &entry = entries[i];
+      entry.se_key.iov_len = uint16_t(peek32(base + offset));
+      entry.pk_key.iov_len = peek32(base + offset) >> 16;
+      entry.se_key.iov_base = const_cast<uint8_t *>(base + offset + 4);
+      entry.pk_key.iov_base = const_cast<uint8_t *>(
+          base + offset + 4 + align(entry.se_key.iov_len));
+      if (unlikely(offset + entry_size(entry) > image.size()))
+        return MDBX_CORRUPTED;
+    }
+    return MDBX_SUCCESS;
+  }
+
+  /* Записывает корзину с заданным набором записей вместо существующей
+   * (с номером страницы pgno, либо отсутствующей при нулевом pgno),
+   * при переполнении страницы расщепляя её. */
+  int write(unsigned bucket_depth, uint64_t prefix, uint32_t pgno,
+            fpta_hash_entry *begin, fpta_hash_entry *end) {
+    uint64_t number = key_bucket(bucket_depth, prefix);
+    MDBX_val key = {&number, sizeof(number)};
+    int rc;
+    if (begin == end) {
+      if (pgno) {
+        rc = mdbx_del(txn, dbi, &key, nullptr);
+        if (unlikely(rc != MDBX_SUCCESS))
+          return rc;
+      }
+      return assign(bucket_depth, prefix, 0);
+    }
+
+    size_t length = bucket_header;
+    for (const fpta_hash_entry *entry = begin; entry != end; ++entry)
+      length += bucket_slot + entry_size(*entry);
+    size_t bytes;
+    rc = room(1, bytes);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+
+    if (length > bytes && bucket_depth < fpta_hash_depth_limit) {
+      if (bucket_depth == depth) {
+        rc = grow();
+        if (unlikely(rc != MDBX_SUCCESS))
+          return rc;
+      }
+      if (pgno) {
+        rc = mdbx_del(txn, dbi, &key, nullptr);
+        if (unlikely(rc != MDBX_SUCCESS))
+          return rc;
+      }
+      const unsigned shift = 63 - bucket_depth;
+      fpta_hash_entry *const middle =
+          std::partition(begin, end, [shift](const fpta_hash_entry &entry) {
+            return ((hash(entry.se_key) >> shift) & 1) == 0;
+          });
+      rc = write(bucket_depth + 1, prefix * 2, 0, begin, middle);
+      if (likely(rc == MDBX_SUCCESS))
+        rc = write(bucket_depth + 1, prefix * 2 + 1, 0, middle, end);
+      return rc;
+    }
+
+    for (size_t pages = 2; bytes < length; ++pages) {
+      rc = room(pages, bytes);
+      if (unlikely(rc != MDBX_SUCCESS))
+        return rc;
+    }
+    std::string image(bytes, '\0');
+    char *const base = &image[0];
+    poke64(base, number ^ fpta_hash_seed);
+    poke32(base + 8, uint32_t(end - begin));
+    size_t heap = bytes;
+    char *slot = base + bucket_header;
+    for (const fpta_hash_entry *entry = begin; entry != end; ++entry) {
+      heap -= entry_size(*entry);
+      poke32(slot, uint32_t(hash(entry->se_key)));
+      poke32(slot + 4, uint32_t(heap));
+      slot += bucket_slot;
+      poke32(base + heap, uint32_t(entry->se_key.iov_len) |
+                              uint32_t(entry->pk_key.iov_len) << 16);
+      memcpy(base + heap + 4, entry->se_key.iov_base, entry->se_key.iov_len);
+      memcpy(base + heap + 4 + align(entry->se_key.iov_len),
+             entry->pk_key.iov_base, entry->pk_key.iov_len);
+    }
+    poke32(base + 12, uint32_t(heap));
+
+    uint32_t new_pgno;
+    rc = store(number, image, new_pgno);
+    if (likely(rc == MDBX_SUCCESS) && new_pgno != pgno)
+      rc = assign(bucket_depth, prefix, new_pgno);
+    return rc;
+  }
+};
+
+} // namespace
+
+__hot int fpta_hash_get(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val &se_key,
+                        MDBX_val *pk_key) {
+  fpta_hash_table table(txn, dbi);
+  const uint64_t hash = fpta_hash_table::hash(se_key);
+  fpta_hash_table::bucket bucket;
+  int rc = table.open(false);
+  if (likely(rc == MDBX_SUCCESS))
+    rc = table.find(hash, bucket);
+  if (unlikely(fpta_hash_table::stale(rc)))
+    rc = table.probe(hash, bucket);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  return fpta_hash_table::search(bucket.data, se_key, hash, pk_key);
+}
+
+int fpta_hash_put(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val &se_key,
+                  const MDBX_val &pk_key) {
+  if (unlikely(se_key.iov_len > UINT16_MAX || pk_key.iov_len > UINT16_MAX))
+    return MDBX_BAD_VALSIZE;
+
+  fpta_hash_table table(txn, dbi);
+  const uint64_t hash = fpta_hash_table::hash(se_key);
+  fpta_hash_table::bucket bucket;
+  int rc = table.prepare(hash, true, bucket);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  rc = fpta_hash_table::search(bucket.data, se_key, hash, nullptr);
+  if (unlikely(rc != MDBX_NOTFOUND))
+    return (rc == MDBX_SUCCESS) ? MDBX_KEYEXIST : rc;
+
+  /* Корзина копируется, так как любое изменение в транзакции может
+   * сделать недействительными указатели на её страницы. */
+  const std::string image(static_cast<const char *>(bucket.data.iov_base),
+                          bucket.data.iov_len);
+  std::vector<fpta_hash_entry> entries;
+  rc = fpta_hash_table::parse(image, entries);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  entries.push_back({se_key, pk_key});
+  return table.write(bucket.depth, bucket.prefix, bucket.pgno,
+                     entries.data(), entries.data() + entries.size());
+}
+
+/* Удаляет запись с ключом se_key и значением old_pk_key, заменяя её
+ * при наличии new_pk_key записью с новым значением. */
+static int fpta_hash_change(MDBX_txn *txn, MDBX_dbi dbi,
+                            const MDBX_val &se_key, const MDBX_val &old_pk_key,
+                            const MDBX_val *new_pk_key) {
+  fpta_hash_table table(txn, dbi);
+  const uint64_t hash = fpta_hash_table::hash(se_key);
+  fpta_hash_table::bucket bucket;
+  int rc = table.prepare(hash, false, bucket);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  MDBX_val pk_exist;
+  rc = fpta_hash_table::search(bucket.data, se_key, hash, &pk_exist);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  if (unlikely(!fpta_is_same(pk_exist, old_pk_key)))
+    return MDBX_NOTFOUND;
+
+  const std::string image(static_cast<const char *>(bucket.data.iov_base),
+                          bucket.data.iov_len);
+  std::vector<fpta_hash_entry> entries;
+  rc = fpta_hash_table::parse(image, entries);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  for (auto entry = entries.begin(); entry != entries.end(); ++entry)
+    if (fpta_is_same(entry->se_key, se_key)) {
+      if (new_pk_key)
+        entry->pk_key = *new_pk_key;
+      else
+        entries.erase(entry);
+      break;
+    }
+  return table.write(bucket.depth, bucket.prefix, bucket.pgno,
+                     entries.data(), entries.data() + entries.size());
+}
+
+int fpta_hash_del(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val &se_key,
+                  const MDBX_val &pk_key) {
+  return fpta_hash_change(txn, dbi, se_key, pk_key, nullptr);
+}
+
+int fpta_hash_replace(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val &se_key,
+                      const MDBX_val &new_pk_key, const MDBX_val &old_pk_key) {
+  if (unlikely(new_pk_key.iov_len > UINT16_MAX))
+    return MDBX_BAD_VALSIZE;
+  return fpta_hash_change(txn, dbi, se_key, old_pk_key, &new_pk_key);
+}
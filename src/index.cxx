@@ -864,23 +864,34 @@ return_corrupted:
 
 //----------------------------------------------------------------------------
 
-__hot int fpta_index_row2key(const fpta_table_schema *const schema,
-                             size_t column, const fptu_ro &row, fpta_key &key,
-                             bool copy) {
+/* Для индексов с увеличенным ограничением длины (см. fpta_describe_key_length)
+ * ключи строк и бинарных данных не требуют нормализации, так как колонка
+ * не может быть nullable. Поэтому ключ ссылается непосредственно на данные
+ * значения или строки-кортежа, а не копируется в fpta_key::place, в том числе
+ * при запросе копии (это обеспечивает вызывающая сторона). */
+static __inline int fpta_index_exact_key(const fpta_table_schema *const schema,
+                                         size_t column, const void *data,
+                                         size_t length, fpta_key &key) {
+  assert(length > fpta_max_keylen);
+  if (unlikely(length > schema->key_limit(column)))
+    return FPTA_DATALEN_MISMATCH;
+  if (unlikely(data == nullptr))
+    return FPTA_EINVAL;
+  key.mdbx.iov_base = const_cast<void *>(data);
+  key.mdbx.iov_len = length;
+  return FPTA_SUCCESS;
+}
+
+static __hot int fpta_index_field2key(const fpta_table_schema *const schema,
+                                     size_t column, const fptu_field *field,
+                                     fpta_key &key, bool copy) {
 #ifndef NDEBUG
   fpta_pollute(&key, sizeof(key), 0);
 #endif
 
-  assert(column < schema->column_count());
   const fpta_shove_t shove = schema->column_shove(column);
   const fptu_type type = fpta_shove2type(shove);
   const fpta_index_type index = fpta_shove2index(shove);
-  if (unlikely(type == /* composite */ fptu_null)) {
-    /* composite pseudo-column */
-    return fpta_composite_row2key(schema, column, row, key);
-  }
-
-  const fptu_field *field = fptu::lookup(row, (unsigned)column, type);
   if (unlikely(field == nullptr)) {
     if (!fpta_is_indexed_and_nullable(index))
       return FPTA_COLUMN_MISSING;
@@ -980,7 +991,198 @@ __hot int fpta_index_row2key(const fpta_table_schema *const schema,
     break;
   }
 
-  return fpta_normalize_key(index, key, copy);
+  if (unlikely(key.mdbx.iov_len > fpta_max_keylen) &&
+      schema->key_limit(column) > fpta_max_keylen)
+    return fpta_index_exact_key(schema, column, key.mdbx.iov_base,
+                                key.mdbx.iov_len, key);
+
+  int rc = fpta_normalize_key(index, key, copy);
+  if (likely(rc == FPTA_SUCCESS))
+    fpta_index_elide_prefix(schema, column, key);
+  return rc;
+}
+
+__hot int fpta_index_row2key(const fpta_table_schema *const schema,
+                             size_t column, const fptu_ro &row, fpta_key &key,
+                             bool copy) {
+  assert(column < schema->column_count());
+  const fptu_type type = fpta_shove2type(schema->column_shove(column));
+  if (unlikely(type == /* composite */ fptu_null)) {
+    /* composite pseudo-column */
+    return fpta_composite_row2key(schema, column, row, key);
+  }
+
+  return fpta_index_field2key(schema, column,
+                              fptu::lookup(row, (unsigned)column, type), key,
+                              copy);
+}
+
+__hot int fpta_index_row2key(fpta_row_fields &row, size_t column,
+                             fpta_key &key, bool copy) {
+  assert(column < row.schema->column_count());
+  const fptu_type type = fpta_shove2type(row.schema->column_shove(column));
+  if (unlikely(type == /* composite */ fptu_null)) {
+    /* composite pseudo-column */
+    return fpta_composite_row2key(row, column, key);
+  }
+
+  return fpta_index_field2key(row.schema, column, row.lookup(column, type),
+                              key, copy);
+}
+
+__hot void fpta_row_fields::collect() {
+  cached = (unsigned)std::min(schema->column_count(),
+                              size_t(fpta_row_fields_cached));
+  std::fill_n(fields, cached, nullptr);
+  const fptu_field *const end = fptu::end(row);
+  for (const fptu_field *pf = fptu::begin(row); pf < end; ++pf) {
+    const unsigned column = fptu_get_colnum(pf->tag);
+    /* как и в fptu::lookup() берется первое поле с ожидаемым типом,
+     * удаленные поля отсеиваются по номеру колонки */
+    if (column < cached && fields[column] == nullptr &&
+        pf->tag == fptu_make_tag(column, fpta_shove2type(
+                                             schema->column_shove(column))))
+      fields[column] = pf;
+  }
+}
+
+//----------------------------------------------------------------------------
+
+/* Сжатие ключа посредством словаря префиксов с сохранением порядка.
+ *
+ * Ключ заменяется на: первые skip байт без изменений, байт-тег и остаток.
+ * Если ключ начинается с i-го префикса, то тег равен 2*i+1, а сам префикс
+ * из ключа удаляется. Иначе тег равен 2*r, где r - кол-во префиксов меньших
+ * ключа. Префиксы упорядочены и не вложены друг в друга, поэтому порядок
+ * тегов совпадает с порядком соответствующих им ключей.
+ *
+ * Первые skip байт - это not-null префикс для nullable-колонок, либо
+ * маркер наличия первой колонки в составном ключе. Так префиксы словаря
+ * сопоставляются именно со значением колонки.
+ *
+ * Чтобы ключ вместе с тегом не превысил sizeof(fpta_key::place), точно
+ * сохраняются только первые fpta_max_keylen - 1 байт, а остаток заменяется
+ * хэшем. Для уже подрезанных длинных ключей хэш дополнительно охватывает
+ * вытесненный байт, что сохраняет однозначность. */
+void __hot fpta_index_elide_prefix(const fpta_table_schema *const schema,
+                                   size_t column, fpta_key &key) {
+  const fpta_key_prefixes *const prefixes = schema->key_prefixes(column);
+  if (likely(prefixes == nullptr))
+    return;
+
+  const fpta_shove_t shove = schema->column_shove(column);
+  const size_t skip = fpta_is_composite(shove)
+                          ? ((shove & fpta_tersely_composite) ? 0 : 1)
+                          : (fpta_column_is_nullable(shove)
+                                 ? size_t(fpta_notnil_prefix_length)
+                                 : 0);
+
+  const uint8_t *const src = (const uint8_t *)key.mdbx.iov_base;
+  const size_t length = key.mdbx.iov_len;
+  if (unlikely(length < skip))
+    /* NIL в nullable-колонке */
+    return;
+
+  const size_t head_limit = fpta_max_keylen - 1;
+  const size_t head = (length > head_limit) ? head_limit : length;
+  const uint8_t *const body = src + skip;
+  const size_t body_length = head - skip;
+
+  /* бинарным поиском считаем кол-во префиксов не больших ключа */
+  size_t lo = 0, hi = prefixes->count;
+  while (lo < hi) {
+    const size_t middle = (lo + hi) >> 1;
+    if (prefixes->compare(middle, body, body_length) <= 0)
+      lo = middle + 1;
+    else
+      hi = middle;
+  }
+
+  unsigned tag = unsigned(lo * 2);
+  size_t elided = 0;
+  if (lo > 0 && prefixes->length(lo - 1) <= body_length &&
+      memcmp(prefixes->prefix(lo - 1), body, prefixes->length(lo - 1)) == 0) {
+    tag -= 1;
+    elided = prefixes->length(lo - 1);
+  }
+
+  uint8_t buffer[sizeof(key.place)];
+  memcpy(buffer, src, skip);
+  buffer[skip] = uint8_t(tag);
+  size_t total = skip + 1;
+  memcpy(buffer + total, body + elided, body_length - elided);
+  total += body_length - elided;
+  if (length > head_limit) {
+    const uint64_t tailhash =
+        t1ha2_atonce(src + head_limit, length - head_limit, 0);
+    memcpy(buffer + total, &tailhash, sizeof(tailhash));
+    total += sizeof(tailhash);
+  }
+
+  assert(total <= sizeof(key.place));
+  key.mdbx.iov_base = memcpy(&key.place, buffer, total);
+  key.mdbx.iov_len = total;
+}
+
+int fpta_index_value2key(const fpta_table_schema *const schema, size_t column,
+                         const fpta_value &value, fpta_key &key, bool copy) {
+  const fpta_shove_t shove = schema->column_shove(column);
+  if (unlikely(schema->key_limit(column) > fpta_max_keylen) &&
+      (value.type == fpta_string || value.type == fpta_binary) &&
+      value.binary_length > fpta_max_keylen) {
+    if (unlikely(value.type != (fpta_shove2type(shove) == fptu_cstr
+                                    ? fpta_string
+                                    : fpta_binary)))
+      return FPTA_ETYPE;
+    return fpta_index_exact_key(schema, column, value.binary_data,
+                                value.binary_length, key);
+  }
+
+  if (likely(schema->key_prefixes(column) == nullptr) ||
+      /* значение уже преобразовано в формат ключа */
+      value.type == fpta_shoved)
+    return fpta_index_value2key(shove, value, key, copy);
+
+  int rc = fpta_index_value2key(shove, value, key, false);
+  if (likely(rc == FPTA_SUCCESS) && value.type != fpta_null)
+    fpta_index_elide_prefix(schema, column, key);
+  return rc;
+}
+
+int fpta_index_key2value(const fpta_table_schema *const schema, size_t column,
+                         MDBX_val mdbx, fpta_value &value) {
+  const fpta_shove_t shove = schema->column_shove(column);
+  if (unlikely(schema->key_limit(column) > fpta_max_keylen)) {
+    /* ключи хранятся точно как есть, в том числе длинные */
+    if (unlikely(mdbx.iov_len > schema->key_limit(column))) {
+      value.type = fpta_invalid;
+      value.binary_data = nullptr;
+      value.binary_length = ~0u;
+      return FPTA_INDEX_CORRUPTED;
+    }
+    value.type =
+        (fpta_shove2type(shove) == fptu_cstr) ? fpta_string : fpta_binary;
+    value.binary_data = mdbx.iov_base;
+    value.binary_length = unsigned(mdbx.iov_len);
+    return FPTA_SUCCESS;
+  }
+
+  if (likely(schema->key_prefixes(column) == nullptr) ||
+      (mdbx.iov_len == 0 && fpta_column_is_nullable(shove) &&
+       !fpta_is_composite(shove)))
+    return fpta_index_key2value(shove, mdbx, value);
+
+  /* сжатый ключ возвращается как есть */
+  if (unlikely(mdbx.iov_len > sizeof(fpta_key::place))) {
+    value.type = fpta_invalid;
+    value.binary_data = nullptr;
+    value.binary_length = ~0u;
+    return FPTA_INDEX_CORRUPTED;
+  }
+  value.type = fpta_shoved;
+  value.binary_data = mdbx.iov_base;
+  value.binary_length = unsigned(mdbx.iov_len);
+  return FPTA_SUCCESS;
 }
 
 //----------------------------------------------------------------------------
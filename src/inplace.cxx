@@ -17,6 +17,9 @@
 
 #include "details.h"
 
+#include <cstdarg>
+#include <vector>
+
 #ifdef __LCC__
 #pragma diag_suppress unsigned_compare_with_zero
 #endif /* __LCC__ */
@@ -136,6 +139,107 @@ double_t confine_value<double_t>(const fpta_value &value, const double_t begin,
 
 //----------------------------------------------------------------------------
 
+static double_t fpta_value2fp(const fpta_value &value) {
+  switch (value.type) {
+  case fpta_unsigned_int:
+    return (double_t)value.uint;
+  case fpta_signed_int:
+    return (double_t)value.sint;
+  default:
+    assert(value.type == fpta_float_point);
+    return value.fp;
+  }
+}
+
+static uint64_t fpta_value_magnitude(const fpta_value &value) {
+  assert(value.type == fpta_unsigned_int || value.type == fpta_signed_int);
+  return (value.type == fpta_signed_int && value.sint < 0)
+             ? UINT64_C(0) - uint64_t(value.sint)
+             : value.uint;
+}
+
+/* Собирает знаковый результат, насыщая его до диапазона int64/uint64.
+ * Окончательное ограничение выполняется посредством confine_value(). */
+static fpta_value fpta_value_signed(bool negative, uint64_t magnitude,
+                                    bool overflow) {
+  if (!negative)
+    return fpta_value_uint(overflow ? UINT64_MAX : magnitude);
+  if (overflow || magnitude > uint64_t(INT64_MAX))
+    return fpta_value_sint(INT64_MIN);
+  return fpta_value_sint(-int64_t(magnitude));
+}
+
+static fpta_value fpta_mul_integers(const fpta_value &left,
+                                    const fpta_value &right) {
+  const uint64_t a = fpta_value_magnitude(left);
+  const uint64_t b = fpta_value_magnitude(right);
+  return fpta_value_signed(left.is_negative() != right.is_negative(), a * b,
+                           a && b > UINT64_MAX / a);
+}
+
+static fpta_value fpta_div_integers(const fpta_value &left,
+                                    const fpta_value &right) {
+  const uint64_t a = fpta_value_magnitude(left);
+  const uint64_t b = fpta_value_magnitude(right);
+  assert(b != 0);
+  return fpta_value_signed(left.is_negative() != right.is_negative(), a / b,
+                           false);
+}
+
+/* Коэффициент сглаживания для fpta_bes, либо в виде значения из интервала
+ * (0..1), либо как степень двойки из интервала (-24..0). */
+struct fpta_bes_factor {
+  double_t alpha;
+  unsigned shift /* ноль если задано значение alpha */;
+
+  int setup(const fpta_value &factor) {
+    switch (factor.type) {
+    case fpta_float_point:
+      if (unlikely(!(factor.fp > 0 && factor.fp < 1)))
+        return FPTA_EVALUE;
+      alpha = factor.fp;
+      shift = 0;
+      return FPTA_SUCCESS;
+    case fpta_signed_int:
+      if (unlikely(factor.sint <= -24 || factor.sint >= 0))
+        return FPTA_EVALUE;
+      alpha = std::ldexp(1.0, int(factor.sint));
+      shift = unsigned(-factor.sint);
+      return FPTA_SUCCESS;
+    default:
+      return FPTA_EVALUE;
+    }
+  }
+};
+
+/* Шаг сглаживания для целых при коэффициенте 2^-shift, с округлением.
+ * Значения передаются в дополнительном коде, результат всегда оказывается
+ * между present и target, поэтому переполнение невозможно. */
+static uint64_t fpta_bes_shift(uint64_t present, uint64_t target,
+                               bool ascending, unsigned shift) {
+  assert(shift > 0 && shift < 64);
+  const uint64_t distance = ascending ? target - present : present - target;
+  const uint64_t step =
+      (distance >> shift) + ((distance >> (shift - 1)) & 1);
+  return ascending ? present + step : present - step;
+}
+
+/* Шаг сглаживания для целых при дробном коэффициенте alpha. В плавающей
+ * точке вычисляется только округленная величина шага, а сам шаг прибавляется
+ * в целых. Поэтому значения больше 2^53 не искажаются округлением, а при
+ * target == present результат в точности равен present. */
+static uint64_t fpta_bes_alpha(uint64_t present, uint64_t target,
+                               bool ascending, double_t alpha) {
+  assert(alpha > 0 && alpha < 1);
+  const uint64_t distance = ascending ? target - present : present - target;
+  const double_t step = std::round(alpha * double_t(distance));
+  const uint64_t limited =
+      (step < double_t(distance)) ? uint64_t(step) : distance;
+  return ascending ? present + limited : present - limited;
+}
+
+//----------------------------------------------------------------------------
+
 template <fptu_type type> struct saturated {
   typedef numeric_traits<type> traits;
   typedef typename traits::native native;
@@ -261,8 +365,64 @@ template <fptu_type type> struct saturated {
     }
   }
 
+  static bool mul(const fpta_index_type index, const fptu_field *field,
+                  const fpta_value &value, fast &result) {
+    assert(value.is_number());
+    if (unlikely(!field))
+      return false /* пустота остается пустотой */;
+
+    const fast present = fptu::get_number<type, fast>(field);
+    const fpta_value wide = traits::make_value(present);
+    const fpta_value product =
+        (!native_limits::is_integer || value.type == fpta_float_point)
+            ? fpta_value_float(fpta_value2fp(wide) * fpta_value2fp(value))
+            : fpta_mul_integers(wide, value);
+    result = confine_value(product, bottom(index), top(index));
+    return result != present;
+  }
+
+  static bool div(const fpta_index_type index, const fptu_field *field,
+                  const fpta_value &value, fast &result) {
+    assert(value.is_number() && fpta_value2fp(value) != 0);
+    if (unlikely(!field))
+      return false /* пустота остается пустотой */;
+
+    const fast present = fptu::get_number<type, fast>(field);
+    const fpta_value wide = traits::make_value(present);
+    const fpta_value quotient =
+        (!native_limits::is_integer || value.type == fpta_float_point)
+            ? fpta_value_float(fpta_value2fp(wide) / fpta_value2fp(value))
+            : fpta_div_integers(wide, value);
+    result = confine_value(quotient, bottom(index), top(index));
+    return result != present;
+  }
+
+  static bool bes(const fpta_index_type index, const fptu_field *field,
+                  const fpta_value &value, const fpta_bes_factor &factor,
+                  fast &result) {
+    assert(value.is_number());
+    const fast target = confine_value(value, bottom(index), top(index));
+    if (unlikely(!field)) {
+      /* сглаживание начинается с первого значения */
+      result = target;
+      return true;
+    }
+
+    const fast present = fptu::get_number<type, fast>(field);
+    if (!native_limits::is_integer)
+      result = fast(present + factor.alpha * (target - present));
+    else if (factor.shift)
+      result = fast(fpta_bes_shift(uint64_t(present), uint64_t(target),
+                                   target > present, factor.shift));
+    else
+      result = fast(fpta_bes_alpha(uint64_t(present), uint64_t(target),
+                                   target > present, factor.alpha));
+    return result != present;
+  }
+
   static int inplace(const fpta_inplace op, const fpta_index_type index,
-                     const fptu_field *field, fpta_value value, fast &result) {
+                     const fptu_field *field, fpta_value value,
+                     const fpta_value &factor, fast &result) {
     assert(value.is_number());
 
     switch (op) {
@@ -295,18 +455,33 @@ template <fptu_type type> struct saturated {
         return FPTA_NODATA;
       break;
     case fpta_saturated_mul:
+      if (!mul(index, field, value, result))
+        return FPTA_NODATA;
+      break;
     case fpta_saturated_div:
-    case fpta_bes:
-      return FPTA_ENOIMP /* TODO */;
+      if (unlikely(fpta_value2fp(value) == 0))
+        return FPTA_EVALUE;
+      if (!div(index, field, value, result))
+        return FPTA_NODATA;
+      break;
+    case fpta_bes: {
+      fpta_bes_factor bes_factor;
+      int rc = bes_factor.setup(factor);
+      if (unlikely(rc != FPTA_SUCCESS))
+        return rc;
+      if (!bes(index, field, value, bes_factor, result))
+        return FPTA_NODATA;
+    } break;
     }
     return FPTA_SUCCESS;
   }
 
   static int inplace(const fpta_inplace op, const fpta_index_type index,
-                     fptu_field *field, fpta_value value, fptu_rw *row,
+                     fptu_field *field, fpta_value value,
+                     const fpta_value &factor, fptu_rw *row,
                      const unsigned colnum) {
     fast result;
-    int rc = inplace(op, index, field, value, result);
+    int rc = inplace(op, index, field, value, factor, result);
     if (unlikely(rc != FPTA_SUCCESS))
       return rc;
 
@@ -410,6 +585,14 @@ FPTA_API int fpta_column_inplace(fptu_rw *row, const fpta_name *column_id,
     break;
   }
 
+  fpta_value factor = fpta_value_null();
+  if (op == fpta_bes) {
+    va_list ap;
+    va_start(ap, value);
+    factor = va_arg(ap, fpta_value);
+    va_end(ap);
+  }
+
   const fpta_index_type index = fpta_name_colindex(column_id);
   fptu_field *field = fptu::lookup(row, colnum, coltype);
   switch (coltype) {
@@ -417,44 +600,45 @@ FPTA_API int fpta_column_inplace(fptu_rw *row, const fpta_name *column_id,
     assert(false);
     return FPTA_EOOPS;
   case fptu_uint16:
-    return saturated<fptu_uint16>::inplace(op, index, field, value, row,
-                                           colnum);
+    return saturated<fptu_uint16>::inplace(op, index, field, value, factor,
+                                           row, colnum);
   case fptu_uint32:
-    return saturated<fptu_uint32>::inplace(op, index, field, value, row,
-                                           colnum);
+    return saturated<fptu_uint32>::inplace(op, index, field, value, factor,
+                                           row, colnum);
   case fptu_uint64:
-    return saturated<fptu_uint64>::inplace(op, index, field, value, row,
-                                           colnum);
+    return saturated<fptu_uint64>::inplace(op, index, field, value, factor,
+                                           row, colnum);
   case fptu_int32:
-    return saturated<fptu_int32>::inplace(op, index, field, value, row, colnum);
+    return saturated<fptu_int32>::inplace(op, index, field, value, factor, row,
+                                          colnum);
   case fptu_int64:
-    return saturated<fptu_int64>::inplace(op, index, field, value, row, colnum);
+    return saturated<fptu_int64>::inplace(op, index, field, value, factor, row,
+                                          colnum);
   case fptu_fp32:
-    return saturated<fptu_fp32>::inplace(op, index, field, value, row, colnum);
+    return saturated<fptu_fp32>::inplace(op, index, field, value, factor, row,
+                                         colnum);
   case fptu_fp64:
-    return saturated<fptu_fp64>::inplace(op, index, field, value, row, colnum);
+    return saturated<fptu_fp64>::inplace(op, index, field, value, factor, row,
+                                         colnum);
   }
 }
 
 //----------------------------------------------------------------------------
 
-FPTA_API int fpta_cursor_inplace(fpta_cursor *cursor, fpta_name *column_id,
-                                 const fpta_inplace op, const fpta_value value,
-                                 ...) {
-  if (unlikely(op < fpta_saturated_add || op > fpta_bes))
-    return FPTA_EFLAG;
-
-  int rc = fpta_cursor_validate(cursor, fpta_write);
-  if (unlikely(rc != FPTA_SUCCESS))
-    return rc;
-
-  rc = fpta_name_refresh_couple(cursor->txn, cursor->table_id, column_id);
-  if (unlikely(rc != FPTA_SUCCESS))
-    return rc;
-
-  if (unlikely(cursor->column_number == column_id->column.num))
-    return FPTA_EINVAL;
+namespace {
+union fpta_inplace_result {
+  numeric_traits<fptu_uint16>::fast uint16;
+  numeric_traits<fptu_uint32>::fast uint32;
+  numeric_traits<fptu_uint64>::fast uint64;
+  numeric_traits<fptu_int32>::fast int32;
+  numeric_traits<fptu_int64>::fast int64;
+  numeric_traits<fptu_fp32>::fast fp32;
+  numeric_traits<fptu_fp64>::fast fp64;
+};
+} // namespace
 
+static int fpta_inplace_precheck(const fpta_name *column_id,
+                                 const fpta_value &value) {
   const fptu_type coltype = fpta_shove2type(column_id->shove);
   if (unlikely((fptu_any_number & (INT32_C(1) << coltype)) == 0))
     return FPTA_ETYPE;
@@ -474,95 +658,151 @@ FPTA_API int fpta_cursor_inplace(fpta_cursor *cursor, fpta_name *column_id,
   case fpta_unsigned_int:
     break;
   }
+  return FPTA_SUCCESS;
+}
 
-  fptu_ro source_row;
-  rc = fpta_cursor_get(cursor, &source_row);
-  if (unlikely(rc != FPTA_SUCCESS))
-    return rc;
-
-  union {
-    numeric_traits<fptu_uint16>::fast uint16;
-    numeric_traits<fptu_uint32>::fast uint32;
-    numeric_traits<fptu_uint64>::fast uint64;
-    numeric_traits<fptu_int32>::fast int32;
-    numeric_traits<fptu_int64>::fast int64;
-    numeric_traits<fptu_fp32>::fast fp32;
-    numeric_traits<fptu_fp64>::fast fp64;
-  } result;
-
-  const unsigned colnum = column_id->column.num;
-  const fpta_index_type index = fpta_name_colindex(column_id);
-  const fptu_field *field = fptu::lookup(source_row, colnum, coltype);
-
+static int fpta_inplace_calc(const fpta_inplace op, const fptu_type coltype,
+                             const fpta_index_type index,
+                             const fptu_field *field, const fpta_value &value,
+                             const fpta_value &factor,
+                             fpta_inplace_result &result) {
   switch (coltype) {
   default:
     assert(false);
     return FPTA_EOOPS;
   case fptu_uint16:
-    rc =
-        saturated<fptu_uint16>::inplace(op, index, field, value, result.uint16);
+    return saturated<fptu_uint16>::inplace(op, index, field, value, factor,
+                                           result.uint16);
+  case fptu_uint32:
+    return saturated<fptu_uint32>::inplace(op, index, field, value, factor,
+                                           result.uint32);
+  case fptu_uint64:
+    return saturated<fptu_uint64>::inplace(op, index, field, value, factor,
+                                           result.uint64);
+  case fptu_int32:
+    return saturated<fptu_int32>::inplace(op, index, field, value, factor,
+                                          result.int32);
+  case fptu_int64:
+    return saturated<fptu_int64>::inplace(op, index, field, value, factor,
+                                          result.int64);
+  case fptu_fp32:
+    return saturated<fptu_fp32>::inplace(op, index, field, value, factor,
+                                         result.fp32);
+  case fptu_fp64:
+    return saturated<fptu_fp64>::inplace(op, index, field, value, factor,
+                                         result.fp64);
+  }
+}
+
+/* Записывает результат в уже существующее поле, размер кортежа при этом
+ * не меняется. */
+static void fpta_inplace_patch(const fptu_type coltype, fptu_field *field,
+                               const fpta_inplace_result &result) {
+  switch (coltype) {
+  default:
+    assert(false);
+    break;
+  case fptu_uint16:
+    fptu::set_number<fptu_uint16>(field, result.uint16);
     break;
   case fptu_uint32:
-    rc =
-        saturated<fptu_uint32>::inplace(op, index, field, value, result.uint32);
+    fptu::set_number<fptu_uint32>(field, result.uint32);
     break;
   case fptu_uint64:
-    rc =
-        saturated<fptu_uint64>::inplace(op, index, field, value, result.uint64);
+    fptu::set_number<fptu_uint64>(field, result.uint64);
     break;
   case fptu_int32:
-    rc = saturated<fptu_int32>::inplace(op, index, field, value, result.int32);
+    fptu::set_number<fptu_int32>(field, result.int32);
     break;
   case fptu_int64:
-    rc = saturated<fptu_int64>::inplace(op, index, field, value, result.int64);
+    fptu::set_number<fptu_int64>(field, result.int64);
     break;
   case fptu_fp32:
-    rc = saturated<fptu_fp32>::inplace(op, index, field, value, result.fp32);
+    fptu::set_number<fptu_fp32>(field, result.fp32);
     break;
   case fptu_fp64:
-    rc = saturated<fptu_fp64>::inplace(op, index, field, value, result.fp64);
+    fptu::set_number<fptu_fp64>(field, result.fp64);
     break;
   }
-  if (unlikely(rc != FPTA_SUCCESS))
-    return rc;
-
-  const size_t buffer_size =
-      fptu_get_buffer_size(source_row, field ? 0u : 1u, field ? 0u : 8u);
-  void *const buffer = alloca(buffer_size);
-  fptu_rw *changeable_row =
-      fptu_fetch(source_row, buffer, buffer_size, field ? 0u : 1u);
-  if (unlikely(changeable_row == nullptr))
-    return FPTA_EOOPS;
+}
 
+static int fpta_inplace_upsert(const fptu_type coltype, fptu_rw *row,
+                               const unsigned colnum,
+                               const fpta_inplace_result &result) {
   switch (coltype) {
   default:
     assert(false);
     return FPTA_EOOPS;
   case fptu_uint16:
-    rc =
-        fptu::upsert_number<fptu_uint16>(changeable_row, colnum, result.uint16);
-    break;
+    return fptu::upsert_number<fptu_uint16>(row, colnum, result.uint16);
   case fptu_uint32:
-    rc =
-        fptu::upsert_number<fptu_uint16>(changeable_row, colnum, result.uint32);
-    break;
+    return fptu::upsert_number<fptu_uint32>(row, colnum, result.uint32);
   case fptu_uint64:
-    rc =
-        fptu::upsert_number<fptu_uint16>(changeable_row, colnum, result.uint64);
-    break;
+    return fptu::upsert_number<fptu_uint64>(row, colnum, result.uint64);
   case fptu_int32:
-    rc = fptu::upsert_number<fptu_uint16>(changeable_row, colnum, result.int32);
-    break;
+    return fptu::upsert_number<fptu_int32>(row, colnum, result.int32);
   case fptu_int64:
-    rc = fptu::upsert_number<fptu_uint16>(changeable_row, colnum, result.int64);
-    break;
+    return fptu::upsert_number<fptu_int64>(row, colnum, result.int64);
   case fptu_fp32:
-    rc = fptu::upsert_number<fptu_uint16>(changeable_row, colnum, result.fp32);
-    break;
+    return fptu::upsert_number<fptu_fp32>(row, colnum, result.fp32);
   case fptu_fp64:
-    rc = fptu::upsert_number<fptu_uint16>(changeable_row, colnum, result.fp64);
-    break;
+    return fptu::upsert_number<fptu_fp64>(row, colnum, result.fp64);
   }
+}
+
+FPTA_API int fpta_cursor_inplace(fpta_cursor *cursor, fpta_name *column_id,
+                                 const fpta_inplace op, const fpta_value value,
+                                 ...) {
+  if (unlikely(op < fpta_saturated_add || op > fpta_bes))
+    return FPTA_EFLAG;
+
+  int rc = fpta_cursor_validate(cursor, fpta_write);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  rc = fpta_name_refresh_couple(cursor->txn, cursor->table_id, column_id);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  if (unlikely(cursor->column_number == column_id->column.num))
+    return FPTA_EINVAL;
+
+  rc = fpta_inplace_precheck(column_id, value);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  fpta_value factor = fpta_value_null();
+  if (op == fpta_bes) {
+    va_list ap;
+    va_start(ap, value);
+    factor = va_arg(ap, fpta_value);
+    va_end(ap);
+  }
+
+  fptu_ro source_row;
+  rc = fpta_cursor_get(cursor, &source_row);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  const fptu_type coltype = fpta_shove2type(column_id->shove);
+  const unsigned colnum = column_id->column.num;
+  const fpta_index_type index = fpta_name_colindex(column_id);
+  const fptu_field *field = fptu::lookup(source_row, colnum, coltype);
+
+  fpta_inplace_result result;
+  rc = fpta_inplace_calc(op, coltype, index, field, value, factor, result);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  const size_t buffer_size =
+      fptu_get_buffer_size(source_row, field ? 0u : 1u, field ? 0u : 8u);
+  void *const buffer = alloca(buffer_size);
+  fptu_rw *changeable_row =
+      fptu_fetch(source_row, buffer, buffer_size, field ? 0u : 1u);
+  if (unlikely(changeable_row == nullptr))
+    return FPTA_EOOPS;
+
+  rc = fpta_inplace_upsert(coltype, changeable_row, colnum, result);
   if (unlikely(rc != FPTA_SUCCESS))
     return rc;
 
@@ -575,3 +815,418 @@ FPTA_API int fpta_cursor_inplace(fpta_cursor *cursor, fpta_name *column_id,
 
   return fpta_cursor_update(cursor, modified_row);
 }
+
+//----------------------------------------------------------------------------
+
+/* Проверяет входит ли колонка в какой-либо индекс, в том числе составной */
+static bool fpta_column_is_indexed_anyhow(const fpta_table_schema *table_def,
+                                          const unsigned colnum) {
+  if (fpta_is_indexed(fpta_shove2index(table_def->column_shove(colnum))))
+    return true;
+
+  for (size_t i = 0; i < table_def->column_count(); ++i) {
+    const fpta_shove_t shove = table_def->column_shove(i);
+    if (!fpta_is_indexed(fpta_shove2index(shove)))
+      break;
+    if (!fpta_is_composite(shove))
+      continue;
+    fpta_table_schema::composite_iter_t begin, end;
+    if (unlikely(table_def->composite_list(i, begin, end) != FPTA_SUCCESS))
+      return true;
+    for (auto item = begin; item != end; ++item)
+      if (*item == colnum)
+        return true;
+  }
+  return false;
+}
+
+/* Обновляет строку в текущей позиции курсора, минуя сопровождение вторичных
+ * индексов, так как изменяемая колонка не индексирована. При неизменном
+ * размере строки libmdbx перезаписывает данные непосредственно в грязной
+ * странице, без удаления и вставки узла. */
+static int fpta_inplace_write(fpta_cursor *cursor, const fptu_ro &row) {
+  int rc;
+  MDBX_val pk_key;
+  if (fpta_index_is_primary(cursor->index_shove())) {
+    pk_key = cursor->current;
+    rc = mdbx_cursor_put(cursor->mdbx_cursor, &pk_key,
+                         const_cast<MDBX_val *>(&row.sys), MDBX_CURRENT);
+    if (likely(rc == MDBX_SUCCESS) &&
+        mdbx_is_dirty(cursor->txn->mdbx_txn, cursor->current.iov_base)) {
+      rc = cursor->bring(&cursor->current, nullptr, MDBX_GET_CURRENT);
+      pk_key = cursor->current;
+    }
+  } else {
+    rc = cursor->bring(&cursor->current, &pk_key, MDBX_GET_CURRENT);
+    if (likely(rc == MDBX_SUCCESS))
+      rc = mdbx_put(cursor->txn->mdbx_txn, cursor->tbl_handle, &pk_key,
+                    const_cast<MDBX_val *>(&row.sys), MDBX_CURRENT);
+  }
+  if (unlikely(rc != MDBX_SUCCESS)) {
+    cursor->set_poor();
+    return rc;
+  }
+
+  cursor->metrics.upserts += 1;
+  if (fpta_changelog_enabled(cursor->txn->db)) {
+    rc = fpta_changelog_record(cursor->txn, cursor->table_schema(),
+                               fpta_change_upsert, pk_key, &row);
+    if (unlikely(rc != FPTA_SUCCESS)) {
+      cursor->set_poor();
+      return fpta_internal_abort(cursor->txn, rc);
+    }
+  }
+  return FPTA_SUCCESS;
+}
+
+FPTA_API int fpta_inplace_range(fpta_txn *txn, fpta_name *column_id,
+                                fpta_value range_from, fpta_value range_to,
+                                fpta_filter *filter, fpta_name *target_column,
+                                const fpta_inplace op, const fpta_value value,
+                                size_t *count, ...) {
+  if (count)
+    *count = 0;
+  if (unlikely(op < fpta_saturated_add || op > fpta_bes))
+    return FPTA_EFLAG;
+  if (unlikely(!target_column))
+    return FPTA_EINVAL;
+
+  fpta_value factor = fpta_value_null();
+  if (op == fpta_bes) {
+    va_list ap;
+    va_start(ap, count);
+    factor = va_arg(ap, fpta_value);
+    va_end(ap);
+  }
+
+  fpta_cursor *cursor = nullptr /* TODO: заменить на объект на стеке */;
+  int rc = fpta_cursor_open(txn, column_id, range_from, range_to, filter,
+                            fpta_unsorted_dont_fetch, &cursor);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  rc = fpta_name_refresh_couple(txn, cursor->table_id, target_column);
+  if (unlikely(rc != FPTA_SUCCESS))
+    goto bailout;
+  if (unlikely(cursor->column_number == target_column->column.num)) {
+    rc = FPTA_EINVAL;
+    goto bailout;
+  }
+  rc = fpta_inplace_precheck(target_column, value);
+  if (unlikely(rc != FPTA_SUCCESS))
+    goto bailout;
+
+  {
+    const fpta_table_schema *table_def = cursor->table_schema();
+    const fptu_type coltype = fpta_shove2type(target_column->shove);
+    const unsigned colnum = target_column->column.num;
+    const fpta_index_type index = fpta_name_colindex(target_column);
+    /* Сопровождение индексов не требуется, если колонка не входит ни в один
+     * из них. Для первичного индекса с дубликатами изменение строки меняет
+     * порядок внутри multi-value, поэтому используется общий путь. */
+    const bool bypass_indexes =
+        !fpta_column_is_indexed_anyhow(table_def, colnum) &&
+        fpta_index_is_unique(table_def->table_pk());
+    /* При обновлении по общему пути в индексе с дубликатами строка может
+     * переместиться внутри multi-value, после чего проход курсором пропустит
+     * часть строк либо обработает перемещенную строку повторно. Поэтому
+     * в этом случае сначала собираются копии изменяемых строк, а затем
+     * курсор устанавливается на каждую из них для обновления. */
+    const bool two_pass =
+        !bypass_indexes && !fpta_index_is_unique(cursor->index_shove());
+
+    /* буфер для изменяемой копии строки, переиспользуется для всех строк */
+    std::vector<uint64_t> scratch;
+    const auto apply = [&](const fptu_ro &source_row) {
+      const fptu_field *field = fptu::lookup(source_row, colnum, coltype);
+      fpta_inplace_result result;
+      int err =
+          fpta_inplace_calc(op, coltype, index, field, value, factor, result);
+      if (err != FPTA_SUCCESS)
+        return err;
+
+      if (bypass_indexes && field) {
+        /* размер строки не меняется, изменяем значение в копии строки */
+        const size_t field_offset =
+            (const char *)field - (const char *)source_row.units;
+        scratch.resize(source_row.total_bytes / sizeof(uint64_t) + 1);
+        char *const buffer = (char *)scratch.data();
+        memcpy(buffer, source_row.units, source_row.total_bytes);
+        fpta_inplace_patch(coltype, (fptu_field *)(buffer + field_offset),
+                           result);
+        fptu_ro patched_row;
+        patched_row.sys.iov_base = buffer;
+        patched_row.sys.iov_len = source_row.total_bytes;
+        return fpta_inplace_write(cursor, patched_row);
+      }
+
+      const size_t buffer_size =
+          fptu_get_buffer_size(source_row, field ? 0u : 1u, field ? 0u : 8u);
+      scratch.resize(buffer_size / sizeof(uint64_t) + 1);
+      fptu_rw *changeable_row = fptu_fetch(source_row, scratch.data(),
+                                           buffer_size, field ? 0u : 1u);
+      if (unlikely(changeable_row == nullptr))
+        return int(FPTA_EOOPS);
+      err = fpta_inplace_upsert(coltype, changeable_row, colnum, result);
+      if (unlikely(err != FPTA_SUCCESS))
+        return err;
+      const fptu_ro modified_row = fptu_take(changeable_row);
+      if (bypass_indexes)
+        return fpta_inplace_write(cursor, modified_row);
+      if (fpta_is_indexed(index) && fpta_index_is_unique(index)) {
+        err = fpta_cursor_validate_update(cursor, modified_row);
+        if (unlikely(err != FPTA_SUCCESS))
+          return err;
+      }
+      return fpta_cursor_update(cursor, modified_row);
+    };
+
+    /* копии строк для второго прохода, выровненные на 8 байт */
+    std::vector<uint64_t> copies;
+    std::vector<size_t> copies_bytes;
+    size_t n = 0;
+    rc = fpta_cursor_move(cursor, fpta_first);
+    while (rc == FPTA_SUCCESS) {
+      fptu_ro source_row;
+      rc = fpta_cursor_get(cursor, &source_row);
+      if (unlikely(rc != FPTA_SUCCESS))
+        break;
+
+      if (two_pass) {
+        /* строки с неизменным значением не копируются */
+        const fptu_field *field = fptu::lookup(source_row, colnum, coltype);
+        fpta_inplace_result result;
+        rc = fpta_inplace_calc(op, coltype, index, field, value, factor,
+                               result);
+        if (rc == FPTA_NODATA) {
+          rc = fpta_cursor_move(cursor, fpta_next);
+          continue;
+        }
+        if (unlikely(rc != FPTA_SUCCESS))
+          break;
+        const size_t bytes = source_row.total_bytes;
+        const size_t offset = copies.size();
+        copies.resize(offset + (bytes + 7) / 8);
+        memcpy(copies.data() + offset, source_row.units, bytes);
+        copies_bytes.push_back(bytes);
+      } else {
+        rc = apply(source_row);
+        if (rc == FPTA_SUCCESS)
+          ++n;
+        else if (unlikely(rc != FPTA_NODATA))
+          break;
+      }
+      rc = fpta_cursor_move(cursor, fpta_next);
+    }
+
+    if (two_pass && rc == FPTA_NODATA) {
+      const uint64_t *copy = copies.data();
+      for (const size_t bytes : copies_bytes) {
+        fptu_ro source_row;
+        source_row.sys.iov_base = (void *)copy;
+        source_row.sys.iov_len = bytes;
+        copy += (bytes + 7) / 8;
+        rc = fpta_cursor_locate_row(cursor, source_row);
+        if (unlikely(rc != FPTA_SUCCESS))
+          break;
+        rc = apply(source_row);
+        if (rc == FPTA_SUCCESS)
+          ++n;
+        else if (unlikely(rc != FPTA_NODATA))
+          break;
+      }
+    }
+
+    if (count)
+      *count = n;
+    if (rc == FPTA_NODATA)
+      rc = FPTA_SUCCESS;
+  }
+
+bailout:
+  int err = fpta_cursor_close(cursor);
+  assert(err == FPTA_SUCCESS);
+  if (unlikely(err != FPTA_SUCCESS) && rc == FPTA_SUCCESS)
+    rc = err;
+  return rc;
+}
+
+//----------------------------------------------------------------------------
+
+namespace {
+/* Контекст для изменения значения колонки посредством mdbx_patch().
+ * При первом вызове вычисляется результат и запоминается смещение поля
+ * внутри строки, при втором - значение записывается в грязную страницу.
+ *
+ * Если поле отсутствует или значение не меняется, то первый вызов
+ * возвращает MDBX_RESULT_TRUE, а причина сохраняется в absent/unchanged. */
+struct fpta_inplace_patcher {
+  fpta_inplace op;
+  fptu_type coltype;
+  fpta_index_type index;
+  unsigned colnum;
+  fpta_value value, factor;
+
+  fpta_inplace_result result;
+  ptrdiff_t field_offset;
+  bool absent, unchanged;
+  std::vector<uint64_t> *row_copy /* для журнала изменений */;
+  fptu_ro modified_row;
+
+  static int callback(void *ctx, const MDBX_val *present, MDBX_val *writable) {
+    return static_cast<fpta_inplace_patcher *>(ctx)->patch(*present, writable);
+  }
+
+  int patch(const MDBX_val &present, MDBX_val *writable) {
+    if (writable == nullptr) {
+      fptu_ro row;
+      row.sys = present;
+      const fptu_field *field = fptu::lookup(row, colnum, coltype);
+      int rc;
+      if (unlikely(!field)) {
+        /* добавление поля меняет размер строки */
+        rc = fpta_inplace_calc(op, coltype, index, nullptr, value, factor,
+                               result);
+        absent = (rc == FPTA_SUCCESS);
+      } else {
+        field_offset = (const char *)field - (const char *)present.iov_base;
+        rc = fpta_inplace_calc(op, coltype, index, field, value, factor,
+                               result);
+      }
+      unchanged = (rc == FPTA_NODATA);
+      return (absent || unchanged) ? int(MDBX_RESULT_TRUE) : rc;
+    }
+
+    fptu_field *field =
+        (fptu_field *)((char *)writable->iov_base + field_offset);
+    fpta_inplace_patch(coltype, field, result);
+    if (row_copy) {
+      /* данные в грязной странице могут быть перемещены при последующих
+       * изменениях, поэтому в журнал передается копия строки */
+      row_copy->resize((writable->iov_len + 7) / 8);
+      memcpy(row_copy->data(), writable->iov_base, writable->iov_len);
+      modified_row.sys.iov_base = row_copy->data();
+      modified_row.sys.iov_len = writable->iov_len;
+    }
+    return MDBX_SUCCESS;
+  }
+};
+} // namespace
+
+FPTA_API int fpta_inplace_by_key(fpta_txn *txn, fpta_name *pk_column,
+                                 const fpta_value *key_value,
+                                 fpta_name *target_column,
+                                 const fpta_inplace op, const fpta_value value,
+                                 ...) {
+  if (unlikely(op < fpta_saturated_add || op > fpta_bes))
+    return FPTA_EFLAG;
+  if (unlikely(!key_value || !target_column))
+    return FPTA_EINVAL;
+
+  int rc = fpta_txn_validate(txn, fpta_write);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+  rc = fpta_id_validate(pk_column, fpta_column);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  fpta_name *table_id = pk_column->column.table;
+  rc = fpta_name_refresh_couple(txn, table_id, pk_column);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+  rc = fpta_name_refresh_couple(txn, table_id, target_column);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  const fpta_index_type pk_index = fpta_shove2index(pk_column->shove);
+  if (unlikely(!fpta_index_is_primary(pk_index) ||
+               !fpta_index_is_unique(pk_index)))
+    return FPTA_NO_INDEX;
+  if (unlikely(pk_column->column.num == target_column->column.num))
+    return FPTA_EINVAL;
+
+  rc = fpta_inplace_precheck(target_column, value);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  fpta_value factor = fpta_value_null();
+  if (op == fpta_bes) {
+    va_list ap;
+    va_start(ap, value);
+    factor = va_arg(ap, fpta_value);
+    va_end(ap);
+  }
+
+  const fpta_table_schema *table_def = table_id->table_schema;
+  const unsigned colnum = target_column->column.num;
+  if (!fpta_column_is_indexed_anyhow(table_def, colnum)) {
+    MDBX_dbi tbl_handle, idx_handle;
+    rc = fpta_open_column(txn, pk_column, tbl_handle, idx_handle);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+
+    fpta_key pk_key;
+    rc = fpta_index_value2key(table_def, pk_column->column.num, *key_value,
+                              pk_key, false);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+
+    fpta_latency_scope latency(txn->db, fpta_latency_put);
+    std::vector<uint64_t> row_copy;
+    fpta_inplace_patcher patcher;
+    patcher.op = op;
+    patcher.coltype = fpta_shove2type(target_column->shove);
+    patcher.index = fpta_name_colindex(target_column);
+    patcher.colnum = colnum;
+    patcher.value = value;
+    patcher.factor = factor;
+    patcher.absent = false;
+    patcher.unchanged = false;
+    patcher.row_copy = fpta_changelog_enabled(txn->db) ? &row_copy : nullptr;
+
+    /* Единственный спуск по B-дереву, при этом значение фиксированного
+     * размера изменяется непосредственно в грязной странице. */
+    rc = mdbx_patch(txn->mdbx_txn, tbl_handle, &pk_key.mdbx,
+                    fpta_inplace_patcher::callback, &patcher);
+    if (rc != MDBX_RESULT_TRUE || !patcher.absent) {
+      /* операция завершена здесь, иначе её учтет fpta_cursor_inplace() */
+      fpta_op_counters delta = {};
+      delta.searches = 1;
+      delta.results = (rc == MDBX_SUCCESS || rc == MDBX_RESULT_TRUE) ? 1 : 0;
+      delta.upserts = (rc == MDBX_SUCCESS) ? 1 : 0;
+      fpta_metrics_account(txn->db, table_id->shove, pk_column->shove, delta);
+      if (rc == MDBX_RESULT_TRUE) {
+        assert(patcher.unchanged);
+        return FPTA_NODATA /* значение не изменилось */;
+      }
+      if (rc == MDBX_SUCCESS && patcher.row_copy) {
+        rc = fpta_changelog_record(txn, table_def, fpta_change_upsert,
+                                   pk_key.mdbx, &patcher.modified_row);
+        if (unlikely(rc != FPTA_SUCCESS))
+          return fpta_internal_abort(txn, rc);
+      }
+      return rc;
+    }
+  }
+
+  /* Колонка индексирована или отсутствует в строке, поэтому требуется
+   * обновление всей строки с сопровождением индексов. */
+  fpta_cursor *cursor = nullptr /* TODO: заменить на объект на стеке */;
+  rc = fpta_cursor_open(txn, pk_column, *key_value, *key_value, nullptr,
+                        fpta_unsorted_dont_fetch | fpta_zeroed_range_is_point,
+                        &cursor);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  rc = fpta_cursor_move(cursor, fpta_first);
+  if (likely(rc == FPTA_SUCCESS))
+    rc = fpta_cursor_inplace(cursor, target_column, op, value, factor);
+  else if (rc == FPTA_NODATA)
+    rc = FPTA_NOTFOUND;
+
+  int err = fpta_cursor_close(cursor);
+  assert(err == FPTA_SUCCESS);
+  if (unlikely(err != FPTA_SUCCESS) && rc == FPTA_SUCCESS)
+    rc = err;
+  return rc;
+}
@@ -0,0 +1,222 @@
+/*
+ *  Fast Positive Tables (libfpta), aka Позитивные Таблицы.
+ *  Copyright 2016-2020 Leonid Yuriev <leo@yuriev.ru>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "details.h"
+
+#include "externals/libfptu/src/erthink/erthink_clz.h"
+
+#include <chrono>
+
+/* Гистограммы задержек.
+ *
+ * Для каждой точки измерения ведется несколько сегментов гистограмм, каждый
+ * поток пишет в свой сегмент (выбираемый по fpta_thread_ordinal()) атомарными
+ * операциями без блокировок. Объединение сегментов выполняется при чтении.
+ *
+ * Шкала логарифмическая: значения меньше 8 нс попадают в интервалы "как есть",
+ * а далее каждая степень двойки делится на 8 равных интервалов. */
+
+struct fpta_latency {
+  enum { shards_count = 8, sub_bits = 3, sub_count = 1 << sub_bits };
+
+  struct histogram {
+    std::atomic<uint64_t> count, total_ns, max_ns;
+    std::atomic<uint64_t> buckets[fpta_latency_buckets];
+  };
+
+  histogram shards[fpta_latency_points_count][shards_count];
+};
+
+static __inline unsigned fpta_latency_bucket(uint64_t ns) {
+  if (ns < fpta_latency::sub_count)
+    return unsigned(ns);
+  const unsigned exp = 63 - erthink::clz64(ns);
+  const unsigned bucket =
+      (exp - fpta_latency::sub_bits + 1) * fpta_latency::sub_count +
+      unsigned(ns >> (exp - fpta_latency::sub_bits)) % fpta_latency::sub_count;
+  return (bucket < fpta_latency_buckets) ? bucket : fpta_latency_buckets - 1;
+}
+
+uint64_t fpta_latency_bucket_lower(unsigned bucket) {
+  if (bucket < fpta_latency::sub_count)
+    return bucket;
+  if (bucket >= fpta_latency_buckets)
+    bucket = fpta_latency_buckets - 1;
+  const unsigned exp =
+      bucket / fpta_latency::sub_count + fpta_latency::sub_bits - 1;
+  return uint64_t(fpta_latency::sub_count + bucket % fpta_latency::sub_count)
+         << (exp - fpta_latency::sub_bits);
+}
+
+uint64_t fpta_latency_now() {
+  return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now().time_since_epoch())
+                      .count()) |
+         1 /* ноль означает отсутствие измерения */;
+}
+
+static void fpta_latency_account(fpta_db *db, fpta_latency_point point,
+                                 uint64_t ns) {
+  fpta_latency::histogram &h =
+      db->latency->shards[point]
+                         [fpta_thread_ordinal() % fpta_latency::shards_count];
+  h.count.fetch_add(1, std::memory_order_relaxed);
+  h.total_ns.fetch_add(ns, std::memory_order_relaxed);
+  h.buckets[fpta_latency_bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+  uint64_t max = h.max_ns.load(std::memory_order_relaxed);
+  while (ns > max &&
+         !h.max_ns.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+    ;
+}
+
+void fpta_latency_record(fpta_db *db, fpta_latency_point point,
+                         uint64_t start) {
+  fpta_latency_account(db, point, fpta_latency_now() - start);
+}
+
+/* Время синхронизации берется из результатов mdbx_txn_commit_ex() в единицах
+ * 1/65536 секунды и вычитается из общего времени фиксации. Таким образом
+ * измерение не меняет протокол фиксации, в отличие от фиксации без
+ * синхронизации с последующим явным вызовом mdbx_env_sync(). */
+void fpta_latency_commit_record(fpta_db *db, int rc, uint64_t start,
+                                const MDBX_commit_latency &latency) {
+  const uint64_t whole = fpta_latency_now() - start;
+  const uint64_t sync =
+      std::min(whole, (uint64_t(latency.sync) * UINT64_C(1000000000)) >> 16);
+  fpta_latency_account(db, fpta_latency_commit, whole - sync);
+  if (rc == MDBX_SUCCESS)
+    fpta_latency_account(db, fpta_latency_sync, sync);
+}
+
+void fpta_latency_release(fpta_db *db) {
+  db->latency_enabled.store(false, std::memory_order_relaxed);
+  free(db->latency);
+  db->latency = nullptr;
+}
+
+//----------------------------------------------------------------------------
+
+__cold int fpta_db_latency(fpta_db *db, bool enable) {
+  if (unlikely(!fpta_db_validate(db)))
+    return FPTA_EINVAL;
+
+  if (enable && !db->latency) {
+    /* атомарные счетчики допускают инициализацию нулями */
+    db->latency = (fpta_latency *)calloc(1, sizeof(fpta_latency));
+    if (unlikely(db->latency == nullptr))
+      return FPTA_ENOMEM;
+  }
+  db->latency_enabled.store(enable, std::memory_order_release);
+  return FPTA_SUCCESS;
+}
+
+__cold int fpta_db_latency_reset(fpta_db *db) {
+  if (unlikely(!fpta_db_validate(db)))
+    return FPTA_EINVAL;
+
+  fpta_latency *latency = db->latency;
+  if (latency)
+    for (auto &point : latency->shards)
+      for (auto &h : point) {
+        h.count.store(0, std::memory_order_relaxed);
+        h.total_ns.store(0, std::memory_order_relaxed);
+        h.max_ns.store(0, std::memory_order_relaxed);
+        for (auto &bucket : h.buckets)
+          bucket.store(0, std::memory_order_relaxed);
+      }
+  return FPTA_SUCCESS;
+}
+
+int fpta_db_latency_histogram(fpta_db *db, fpta_latency_point point,
+                              fpta_latency_histogram *histogram) {
+  if (unlikely(!fpta_db_validate(db) || histogram == nullptr ||
+               point < fpta_latency_begin ||
+               point >= fpta_latency_points_count))
+    return FPTA_EINVAL;
+
+  memset(histogram, 0, sizeof(fpta_latency_histogram));
+  const fpta_latency *latency = db->latency;
+  if (latency)
+    for (const auto &h : latency->shards[point]) {
+      histogram->count += h.count.load(std::memory_order_relaxed);
+      histogram->total_ns += h.total_ns.load(std::memory_order_relaxed);
+      histogram->max_ns = std::max(histogram->max_ns,
+                                   h.max_ns.load(std::memory_order_relaxed));
+      for (size_t i = 0; i < fpta_latency_buckets; ++i)
+        histogram->buckets[i] += h.buckets[i].load(std::memory_order_relaxed);
+    }
+  return FPTA_SUCCESS;
+}
+
+uint64_t fpta_latency_quantile(const fpta_latency_histogram *histogram,
+                               double quantile) {
+  if (unlikely(histogram == nullptr))
+    return 0;
+
+  uint64_t total = 0;
+  for (const uint64_t n : histogram->buckets)
+    total += n;
+  if (total == 0)
+    return 0;
+
+  const uint64_t rank =
+      (quantile >= 1) ? total
+                      : std::max(uint64_t(1), uint64_t(quantile * total + .5));
+  uint64_t passed = 0;
+  for (unsigned i = 0; i < fpta_latency_buckets; ++i) {
+    passed += histogram->buckets[i];
+    if (passed >= rank)
+      return (i + 1 < fpta_latency_buckets)
+                 ? std::min(fpta_latency_bucket_lower(i + 1) - 1,
+                            histogram->max_ns)
+                 : histogram->max_ns;
+  }
+  return histogram->max_ns;
+}
+
+//----------------------------------------------------------------------------
+
+namespace fpta {
+
+int latency2text(fpta_db *db, std::string &text) {
+  static const char *const names[fpta_latency_points_count] = {
+      "begin", "commit", "sync", "put", "get", "cursor_open", "cursor_move"};
+
+  text.clear();
+  for (unsigned i = 0; i < fpta_latency_points_count; ++i) {
+    const fpta_latency_point point = fpta_latency_point(i);
+    fpta_latency_histogram histogram;
+    int rc = fpta_db_latency_histogram(db, point, &histogram);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return rc;
+
+    const uint64_t avg =
+        histogram.count ? histogram.total_ns / histogram.count : 0;
+    text += fptu::format(
+        "%-11s count %" PRIu64 ", avg %.3f, p50 %.3f, p90 %.3f, p99 %.3f, "
+        "p999 %.3f, max %.3f us\n",
+        names[i], histogram.count, avg / 1e3,
+        fpta_latency_quantile(&histogram, 0.5) / 1e3,
+        fpta_latency_quantile(&histogram, 0.9) / 1e3,
+        fpta_latency_quantile(&histogram, 0.99) / 1e3,
+        fpta_latency_quantile(&histogram, 0.999) / 1e3,
+        histogram.max_ns / 1e3);
+  }
+  return FPTA_SUCCESS;
+}
+
+} // namespace fpta
@@ -0,0 +1,233 @@
+/*
+ *  Fast Positive Tables (libfpta), aka Позитивные Таблицы.
+ *  Copyright 2016-2020 Leonid Yuriev <leo@yuriev.ru>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "details.h"
+
+#include <thread>
+
+/* Реестр счетчиков операций.
+ *
+ * Пары (таблица, индекс) регистрируются в общем каталоге слотов с открытой
+ * адресацией, а сами счетчики разнесены по нескольким сегментам (shards).
+ * Каждый поток при первом обращении получает свой сегмент по кругу, поэтому
+ * атомарные инкременты из разных потоков как правило затрагивают разные
+ * кэш-линии. Суммирование по сегментам выполняется только при чтении.
+ *
+ * Поиск пары ограничен max_probes слотами, а если среди них нет ни пары,
+ * ни свободного слота, то операции учитываются в общем элементе "прочие".
+ * Слоты удаленных таблиц освобождаются при фиксации схемной транзакции,
+ * которая исключает выполнение других транзакций с тем же fpta_db. Поэтому
+ * освобожденный слот помечается как удаленный, а не пустой, только ради
+ * продолжения цепочек поиска, а его повторное занятие не гоняется
+ * с освобождением. */
+
+enum : uint64_t {
+  fpta_metrics_tag_empty = 0,
+  fpta_metrics_tag_busy = 1,
+  fpta_metrics_tag_deleted = 2
+};
+
+static __inline uint64_t fpta_metrics_tag(fpta_shove_t table_shove,
+                                          fpta_shove_t index_shove) {
+  const uint64_t tag =
+      (table_shove ^ (index_shove << 29 | index_shove >> 35)) *
+      UINT64_C(0x9E3779B97F4A7C15);
+  return (tag > fpta_metrics_tag_deleted) ? tag : tag + 3;
+}
+
+/* Возвращает номер слота пары, либо slots_count для элемента "прочие" */
+static size_t fpta_metrics_lookup(fpta_metrics &metrics,
+                                  fpta_shove_t table_shove,
+                                  fpta_shove_t index_shove) {
+  const uint64_t tag = fpta_metrics_tag(table_shove, index_shove);
+  for (;;) {
+    size_t vacant = fpta_metrics::slots_count;
+    uint64_t vacant_tag = fpta_metrics_tag_empty;
+    for (size_t n = 0, i = size_t(tag >> 32); n < fpta_metrics::max_probes;
+         ++n, ++i) {
+      const size_t index = i % fpta_metrics::slots_count;
+      fpta_metrics::slot &slot = metrics.slots[index];
+      uint64_t present = slot.tag.load(std::memory_order_acquire);
+      while (unlikely(present == fpta_metrics_tag_busy)) {
+        std::this_thread::yield();
+        present = slot.tag.load(std::memory_order_acquire);
+      }
+      if (present == tag && likely(slot.table_shove == table_shove &&
+                                   slot.index_shove == index_shove))
+        return index;
+      if (present <= fpta_metrics_tag_deleted &&
+          vacant == fpta_metrics::slots_count) {
+        vacant = index;
+        vacant_tag = present;
+      }
+      if (present == fpta_metrics_tag_empty)
+        break;
+    }
+
+    if (unlikely(vacant == fpta_metrics::slots_count))
+      return vacant;
+
+    /* Пары нет в цепочке, занимаем первый свободный слот. Все потоки,
+     * регистрирующие ту же пару, выбирают один и тот же слот. */
+    fpta_metrics::slot &slot = metrics.slots[vacant];
+    if (slot.tag.compare_exchange_strong(vacant_tag, fpta_metrics_tag_busy,
+                                         std::memory_order_acquire)) {
+      slot.table_shove = table_shove;
+      slot.index_shove = index_shove;
+      slot.tag.store(tag, std::memory_order_release);
+      return vacant;
+    }
+  }
+}
+
+__hot void fpta_metrics_account(fpta_db *db, fpta_shove_t table_shove,
+                                fpta_shove_t index_shove,
+                                const fpta_op_counters &delta) {
+  fpta_metrics &metrics = db->metrics;
+  fpta_metrics::cell &cell =
+      metrics.cells[fpta_thread_ordinal() % fpta_metrics::shards_count]
+                   [fpta_metrics_lookup(metrics, table_shove, index_shove)];
+  if (delta.results)
+    cell.results.fetch_add(delta.results, std::memory_order_relaxed);
+  if (delta.searches)
+    cell.searches.fetch_add(delta.searches, std::memory_order_relaxed);
+  if (delta.scans)
+    cell.scans.fetch_add(delta.scans, std::memory_order_relaxed);
+  if (delta.pk_lookups)
+    cell.pk_lookups.fetch_add(delta.pk_lookups, std::memory_order_relaxed);
+  if (delta.uniq_checks)
+    cell.uniq_checks.fetch_add(delta.uniq_checks, std::memory_order_relaxed);
+  if (delta.upserts)
+    cell.upserts.fetch_add(delta.upserts, std::memory_order_relaxed);
+  if (delta.deletions)
+    cell.deletions.fetch_add(delta.deletions, std::memory_order_relaxed);
+}
+
+static bool fpta_metrics_sum(const fpta_metrics &metrics, size_t index,
+                             fpta_cursor_stat &stat) {
+  memset(&stat, 0, sizeof(stat));
+  for (size_t shard = 0; shard < fpta_metrics::shards_count; ++shard) {
+    const fpta_metrics::cell &cell = metrics.cells[shard][index];
+    stat.results += cell.results.load(std::memory_order_relaxed);
+    stat.index_searches += cell.searches.load(std::memory_order_relaxed);
+    stat.index_scans += cell.scans.load(std::memory_order_relaxed);
+    stat.pk_lookups += cell.pk_lookups.load(std::memory_order_relaxed);
+    stat.uniq_checks += cell.uniq_checks.load(std::memory_order_relaxed);
+    stat.upserts += cell.upserts.load(std::memory_order_relaxed);
+    stat.deletions += cell.deletions.load(std::memory_order_relaxed);
+  }
+  stat.selectivity_x1024 =
+      (stat.results + stat.upserts + stat.deletions + 1) * 1024u /
+      (stat.index_scans + stat.index_searches + stat.pk_lookups + 1);
+  return stat.results + stat.index_searches + stat.index_scans +
+             stat.pk_lookups + stat.uniq_checks + stat.upserts +
+             stat.deletions !=
+         0;
+}
+
+static void fpta_metrics_clear(fpta_metrics &metrics, size_t index) {
+  for (size_t shard = 0; shard < fpta_metrics::shards_count; ++shard) {
+    fpta_metrics::cell &cell = metrics.cells[shard][index];
+    cell.results.store(0, std::memory_order_relaxed);
+    cell.searches.store(0, std::memory_order_relaxed);
+    cell.scans.store(0, std::memory_order_relaxed);
+    cell.pk_lookups.store(0, std::memory_order_relaxed);
+    cell.uniq_checks.store(0, std::memory_order_relaxed);
+    cell.upserts.store(0, std::memory_order_relaxed);
+    cell.deletions.store(0, std::memory_order_relaxed);
+  }
+}
+
+void fpta_metrics_collect(fpta_txn *txn, fpta_metrics_garbage &garbage) {
+  assert(txn->level == fpta_schema);
+  memset(&garbage, 0, sizeof(garbage));
+  fpta_db *db = txn->db;
+  if (unlikely(db->schema_dbi < 1))
+    return;
+
+  for (size_t i = 0; i < fpta_metrics::slots_count; ++i) {
+    const fpta_metrics::slot &slot = db->metrics.slots[i];
+    if (slot.tag.load(std::memory_order_relaxed) <= fpta_metrics_tag_deleted)
+      continue;
+    fpta_shove_t table_shove = slot.table_shove;
+    MDBX_val key = {&table_shove, sizeof(table_shove)}, data;
+    /* прочие ошибки не должны мешать фиксации, слот остается занятым */
+    if (mdbx_get(txn->mdbx_txn, db->schema_dbi, &key, &data) == MDBX_NOTFOUND)
+      garbage.bits[i / 64] |= UINT64_C(1) << (i % 64);
+  }
+}
+
+void fpta_metrics_release(fpta_db *db, const fpta_metrics_garbage &garbage) {
+  fpta_metrics &metrics = db->metrics;
+  for (size_t i = 0; i < fpta_metrics::slots_count; ++i)
+    if ((garbage.bits[i / 64] >> (i % 64)) & 1) {
+      fpta_metrics_clear(metrics, i);
+      metrics.slots[i].table_shove = 0;
+      metrics.slots[i].index_shove = 0;
+      metrics.slots[i].tag.store(fpta_metrics_tag_deleted,
+                                 std::memory_order_release);
+    }
+}
+
+//----------------------------------------------------------------------------
+
+int fpta_db_metrics(fpta_db *db, fpta_metrics_item *items, size_t *count) {
+  if (unlikely(!fpta_db_validate(db) || count == nullptr ||
+               (items == nullptr && *count != 0)))
+    return FPTA_EINVAL;
+
+  const fpta_metrics &metrics = db->metrics;
+  size_t used = 0;
+  fpta_cursor_stat stat;
+  for (size_t i = 0; i < fpta_metrics::slots_count; ++i) {
+    const fpta_metrics::slot &slot = metrics.slots[i];
+    if (slot.tag.load(std::memory_order_acquire) <= fpta_metrics_tag_deleted)
+      continue;
+
+    if (used < *count) {
+      fpta_metrics_item &item = items[used];
+      item.table_shove = slot.table_shove;
+      item.index_shove = slot.index_shove;
+      fpta_metrics_sum(metrics, i, item.stat);
+    }
+    ++used;
+  }
+
+  /* элемент "прочие" для пар, не поместившихся в каталог */
+  if (fpta_metrics_sum(metrics, fpta_metrics::slots_count, stat)) {
+    if (used < *count) {
+      fpta_metrics_item &item = items[used];
+      item.table_shove = 0;
+      item.index_shove = 0;
+      item.stat = stat;
+    }
+    ++used;
+  }
+
+  const bool enough = used <= *count;
+  *count = used;
+  return enough ? FPTA_SUCCESS : FPTA_DATALEN_MISMATCH;
+}
+
+int fpta_db_metrics_reset(fpta_db *db) {
+  if (unlikely(!fpta_db_validate(db)))
+    return FPTA_EINVAL;
+
+  for (size_t i = 0; i <= fpta_metrics::slots_count; ++i)
+    fpta_metrics_clear(db->metrics, i);
+  return FPTA_SUCCESS;
+}
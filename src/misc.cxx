@@ -53,6 +53,7 @@ static __cold const char *error2cp(int32_t errcode) {
   static_assert(FPTA_EBUSY == ERROR_BUSY, "error code mismatch");
   static_assert(FPTA_ENAME == ERROR_INVALID_NAME, "error code mismatch");
   static_assert(FPTA_EFLAG == ERROR_INVALID_FLAG_NUMBER, "error code mismatch");
+  static_assert(FPTA_ETIMEDOUT == ERROR_TIMEOUT, "error code mismatch");
 #endif /* static_asserts for Windows */
 
   static const char *const msgs[] = {
@@ -205,6 +206,8 @@ __cold ostream &operator<<(ostream &out, const fpta_durability value) {
     return out << "mode-lazy";
   case fpta_weak:
     return out << "mode-weak";
+  case fpta_async:
+    return out << "mode-async";
   }
 }
 FPTA_TOSTRING_IMP(const fpta_durability &);
@@ -38,7 +38,9 @@
 /* Threads */
 
 #ifdef CMAKE_HAVE_PTHREAD_H
+#include <errno.h>
 #include <pthread.h>
+#include <time.h>
 
 typedef struct fpta_rwl {
   pthread_rwlock_t prwl;
@@ -88,6 +90,40 @@ static int __inline fpta_mutex_destroy(fpta_mutex_t *mutex) {
   return pthread_mutex_destroy(&mutex->ptmx);
 }
 
+typedef struct fpta_cond {
+  pthread_cond_t ptcv;
+} fpta_cond_t;
+
+static int __inline fpta_cond_init(fpta_cond_t *cond) {
+  return pthread_cond_init(&cond->ptcv, NULL);
+}
+
+static int __inline fpta_cond_wait(fpta_cond_t *cond, fpta_mutex_t *mutex) {
+  return pthread_cond_wait(&cond->ptcv, &mutex->ptmx);
+}
+
+static int __inline fpta_cond_timedwait(fpta_cond_t *cond, fpta_mutex_t *mutex,
+                                        unsigned milliseconds) {
+  struct timespec abstime;
+  if (clock_gettime(CLOCK_REALTIME, &abstime) != 0)
+    return errno;
+  abstime.tv_sec += milliseconds / 1000;
+  abstime.tv_nsec += (milliseconds % 1000) * 1000000l;
+  if (abstime.tv_nsec >= 1000000000l) {
+    abstime.tv_sec += 1;
+    abstime.tv_nsec -= 1000000000l;
+  }
+  return pthread_cond_timedwait(&cond->ptcv, &mutex->ptmx, &abstime);
+}
+
+static int __inline fpta_cond_broadcast(fpta_cond_t *cond) {
+  return pthread_cond_broadcast(&cond->ptcv);
+}
+
+static int __inline fpta_cond_destroy(fpta_cond_t *cond) {
+  return pthread_cond_destroy(&cond->ptcv);
+}
+
 #else
 
 #ifdef _MSC_VER
@@ -230,4 +266,75 @@ static int __inline fpta_mutex_destroy(fpta_mutex_t *mutex) {
   return FPTA_SUCCESS;
 }
 
+typedef struct fpta_cond {
+  CONDITION_VARIABLE cv;
+} fpta_cond_t;
+
+static int __inline fpta_cond_init(fpta_cond_t *cond) {
+  if (!cond)
+    return FPTA_EINVAL;
+  InitializeConditionVariable(&cond->cv);
+  return FPTA_SUCCESS;
+}
+
+static int __inline fpta_cond_wait(fpta_cond_t *cond, fpta_mutex_t *mutex) {
+  if (!cond || !mutex)
+    return FPTA_EINVAL;
+  return SleepConditionVariableCS(&cond->cv, &mutex->cs, INFINITE)
+             ? FPTA_SUCCESS
+             : (int)GetLastError();
+}
+
+static int __inline fpta_cond_timedwait(fpta_cond_t *cond, fpta_mutex_t *mutex,
+                                        unsigned milliseconds) {
+  if (!cond || !mutex)
+    return FPTA_EINVAL;
+  return SleepConditionVariableCS(&cond->cv, &mutex->cs, milliseconds)
+             ? FPTA_SUCCESS
+             : (int)GetLastError();
+}
+
+static int __inline fpta_cond_broadcast(fpta_cond_t *cond) {
+  if (!cond)
+    return FPTA_EINVAL;
+  WakeAllConditionVariable(&cond->cv);
+  return FPTA_SUCCESS;
+}
+
+static int __inline fpta_cond_destroy(fpta_cond_t *cond) {
+  return cond ? FPTA_SUCCESS : FPTA_EINVAL;
+}
+
 #endif /* CMAKE_HAVE_PTHREAD_H */
+
+/*----------------------------------------------------------------------------*/
+/* Tracing */
+
+/* Статические точки трассировки (USDT) для SystemTap, bpftrace и т.п.
+ * Провайдер "fpta", аргументы точек:
+ *   txn_begin(level, db_version, rc), txn_commit(level, db_version, rc),
+ *   txn_abort(level, db_version, rc), internal_abort(level, errnum),
+ *   cursor_open(table_shove, index_shove, rc),
+ *   cursor_seek(table_shove, key_length, rc),
+ *   secondary_upsert(table_shove, pk_length, rc),
+ *   schema_refresh(table_shove, rc), dbi_miss(dbi_shove, rc).
+ *
+ * Без FPTA_ENABLE_USDT точки вырождаются в пустые операторы. */
+
+#if FPTA_ENABLE_USDT
+#include <sys/sdt.h>
+#define FPTA_PROBE2(name, a1, a2) DTRACE_PROBE2(fpta, name, a1, a2)
+#define FPTA_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(fpta, name, a1, a2, a3)
+#else
+#define FPTA_PROBE2(name, a1, a2)                                              \
+  do {                                                                         \
+    (void)(a1);                                                                \
+    (void)(a2);                                                                \
+  } while (0)
+#define FPTA_PROBE3(name, a1, a2, a3)                                          \
+  do {                                                                         \
+    (void)(a1);                                                                \
+    (void)(a2);                                                                \
+    (void)(a3);                                                                \
+  } while (0)
+#endif /* FPTA_ENABLE_USDT */
@@ -0,0 +1,236 @@
+/*
+ *  Fast Positive Tables (libfpta), aka Позитивные Таблицы.
+ *  Copyright 2016-2020 Leonid Yuriev <leo@yuriev.ru>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "details.h"
+
+/* Кэш строк для точечных чтений по первичному ключу.
+ *
+ * Кэш хранит не копии строк, а указатели на данные внутри отображенной в память
+ * БД, вместе с mod_txnid таблицы (номером транзакции, в которой таблица была
+ * изменена последний раз). Если в MVCC-снимке читающей транзакции mod_txnid
+ * таблицы совпадает с сохраненным, то B-дерево таблицы в этом снимке в точности
+ * то же самое, что и в момент заполнения элемента кэша, а все его страницы
+ * удерживаются от повторного использования самой читающей транзакцией.
+ * Поэтому указатель из кэша можно отдавать без копирования.
+ *
+ * Любая фиксация пишущей транзакции, изменяющей таблицу, меняет её mod_txnid и
+ * тем самым неявно инвалидирует все закэшированные строки таблицы. Пишущие
+ * транзакции кэш не используют, так как видят "грязные" страницы.
+ *
+ * Однако при изменении размера БД отображение может быть перемещено
+ * по другому адресу, в том числе из-за увеличения верхнего предела размера
+ * БД другим процессом. Поэтому элемент также хранит базовый адрес
+ * отображения, при котором был получен указатель на строку.
+ *
+ * Кэш организован как хэш-таблица с прямым отображением. Элементы изменяются
+ * под мьютексами сегментов, а читаются без блокировок с проверкой счетчика
+ * изменений элемента (seqlock), поэтому попадание в кэш не требует захвата
+ * мьютекса. */
+
+struct fpta_row_cache {
+  struct entry {
+    /* нечетное значение означает, что элемент изменяется */
+    std::atomic<uint32_t> seq;
+    uint32_t key_length;
+    fpta_shove_t table_shove;
+    uint64_t mod_txnid;
+    const void *map_addr;
+    MDBX_val row;
+    uint8_t key[fpta_shoved_keylen];
+  };
+
+  struct shard {
+    fpta_mutex_t mutex;
+    std::atomic<uint64_t> hits, misses, evictions;
+  };
+
+  enum { shards_count = 16 };
+
+  size_t mask;
+  shard shards[shards_count];
+  entry slots[1];
+
+  shard &shard4slot(size_t slot) { return shards[slot % shards_count]; }
+
+  static size_t bytes(size_t slots_count) {
+    return offsetof(fpta_row_cache, slots) + sizeof(entry) * slots_count;
+  }
+};
+
+static __inline size_t fpta_row_cache_slot(const fpta_row_cache *cache,
+                                           fpta_shove_t table_shove,
+                                           const MDBX_val &key) {
+  return size_t(t1ha2_atonce(key.iov_base, key.iov_len, table_shove)) &
+         cache->mask;
+}
+
+static void fpta_row_cache_destroy(fpta_row_cache *cache) {
+  for (size_t i = 0; i < fpta_row_cache::shards_count; ++i) {
+    int err = fpta_mutex_destroy(&cache->shards[i].mutex);
+    assert(err == 0);
+    (void)err;
+  }
+  free(cache);
+}
+
+__cold int fpta_db_row_cache(fpta_db *db, size_t max_rows) {
+  if (unlikely(!fpta_db_validate(db)))
+    return FPTA_EINVAL;
+  if (unlikely(max_rows > fpta_row_cache_max))
+    return FPTA_EINVAL;
+
+  fpta_row_cache *cache = nullptr;
+  if (max_rows) {
+    size_t slots = 64;
+    while (slots < max_rows)
+      slots <<= 1;
+
+    cache = (fpta_row_cache *)calloc(1, fpta_row_cache::bytes(slots));
+    if (unlikely(cache == nullptr))
+      return FPTA_ENOMEM;
+    cache->mask = slots - 1;
+
+    for (size_t i = 0; i < fpta_row_cache::shards_count; ++i) {
+      int rc = fpta_mutex_init(&cache->shards[i].mutex);
+      if (unlikely(rc != 0)) {
+        while (i > 0) {
+          int err = fpta_mutex_destroy(&cache->shards[--i].mutex);
+          assert(err == 0);
+          (void)err;
+        }
+        free(cache);
+        return (fpta_error)rc;
+      }
+    }
+  }
+
+  fpta_row_cache *prev = db->row_cache;
+  db->row_cache = cache;
+  if (prev)
+    fpta_row_cache_destroy(prev);
+  return FPTA_SUCCESS;
+}
+
+void fpta_row_cache_release(fpta_db *db) {
+  if (db->row_cache) {
+    fpta_row_cache_destroy(db->row_cache);
+    db->row_cache = nullptr;
+  }
+}
+
+void fpta_row_cache_stat(const fpta_db *db, fpta_db_stat_t *stat) {
+  memset(&stat->row_cache, 0, sizeof(stat->row_cache));
+  fpta_row_cache *cache = db->row_cache;
+  if (!cache)
+    return;
+
+  stat->row_cache.capacity = cache->mask + 1;
+  for (size_t i = 0; i < fpta_row_cache::shards_count; ++i) {
+    const fpta_row_cache::shard &shard = cache->shards[i];
+    stat->row_cache.hits += shard.hits.load(std::memory_order_relaxed);
+    stat->row_cache.misses += shard.misses.load(std::memory_order_relaxed);
+    stat->row_cache.evictions +=
+        shard.evictions.load(std::memory_order_relaxed);
+  }
+}
+
+/* Читает элемент без блокировки, возвращая false если элемент изменялся */
+static __inline bool fpta_row_cache_read(const fpta_row_cache::entry &entry,
+                                         fpta_shove_t table_shove,
+                                         const MDBX_val &pk_key,
+                                         uint64_t &mod_txnid,
+                                         const void *&map_addr, MDBX_val &row,
+                                         bool &match) {
+  const uint32_t seq = entry.seq.load(std::memory_order_acquire);
+  if (unlikely(seq & 1))
+    return false;
+  match = entry.table_shove == table_shove &&
+          entry.key_length == pk_key.iov_len &&
+          memcmp(entry.key, pk_key.iov_base, pk_key.iov_len) == 0;
+  mod_txnid = entry.mod_txnid;
+  map_addr = entry.map_addr;
+  row = entry.row;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return entry.seq.load(std::memory_order_relaxed) == seq;
+}
+
+__hot int fpta_row_cache_get(fpta_txn *txn, fpta_shove_t table_shove,
+                             MDBX_dbi tbl_handle, const MDBX_val &pk_key,
+                             MDBX_val *row) {
+  fpta_row_cache *const cache = txn->db->row_cache;
+  assert(cache != nullptr && txn->level == fpta_read);
+  if (unlikely(pk_key.iov_len > sizeof(fpta_row_cache::entry::key)))
+    return mdbx_get(txn->mdbx_txn, tbl_handle, &pk_key, row);
+
+  MDBX_stat table_stat;
+  int rc = mdbx_dbi_stat(txn->mdbx_txn, tbl_handle, &table_stat,
+                         sizeof(table_stat));
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  const uint64_t mod_txnid = table_stat.ms_mod_txnid;
+  const void *map_addr;
+  rc = mdbx_env_get_mapaddr(txn->db->mdbx_env, &map_addr);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  const size_t slot = fpta_row_cache_slot(cache, table_shove, pk_key);
+  fpta_row_cache::entry &entry = cache->slots[slot];
+  fpta_row_cache::shard &shard = cache->shard4slot(slot);
+
+  uint64_t cached_txnid;
+  const void *cached_addr;
+  MDBX_val cached_row;
+  bool match;
+  if (likely(fpta_row_cache_read(entry, table_shove, pk_key, cached_txnid,
+                                 cached_addr, cached_row, match)) &&
+      match && cached_txnid == mod_txnid && cached_addr == map_addr) {
+    shard.hits.fetch_add(1, std::memory_order_relaxed);
+    *row = cached_row;
+    return MDBX_SUCCESS;
+  }
+  shard.misses.fetch_add(1, std::memory_order_relaxed);
+
+  rc = mdbx_get(txn->mdbx_txn, tbl_handle, &pk_key, row);
+  if (unlikely(rc != MDBX_SUCCESS) || unlikely(mod_txnid == 0))
+    return rc;
+
+  fpta_lock_guard guard;
+  rc = guard.lock(&shard.mutex);
+  if (unlikely(rc != 0))
+    return rc;
+
+  /* не вытесняем более свежую версию, которую мог успеть поместить читатель
+   * с более новым снимком */
+  if (entry.table_shove == table_shove && entry.mod_txnid > mod_txnid &&
+      entry.map_addr == map_addr && entry.key_length == pk_key.iov_len &&
+      memcmp(entry.key, pk_key.iov_base, pk_key.iov_len) == 0)
+    return MDBX_SUCCESS;
+
+  if (entry.table_shove)
+    shard.evictions.fetch_add(1, std::memory_order_relaxed);
+  const uint32_t seq = entry.seq.load(std::memory_order_relaxed);
+  entry.seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  entry.table_shove = table_shove;
+  entry.mod_txnid = mod_txnid;
+  entry.map_addr = map_addr;
+  entry.row = *row;
+  entry.key_length = uint32_t(pk_key.iov_len);
+  memcpy(entry.key, pk_key.iov_base, pk_key.iov_len);
+  entry.seq.store(seq + 2, std::memory_order_release);
+  return MDBX_SUCCESS;
+}
@@ -317,6 +317,125 @@ static cxx14_constexpr bool shove_index_compare(const fpta_shove_t &left,
 
 //----------------------------------------------------------------------------
 
+/* Дополнительные опции индексов хранятся в образе схемы после описаний
+ * составных колонок, последовательностью записей из composite_item_t:
+ * вид опции, номер колонки, кол-во элементов данных и сами данные.
+ * В fpta_column_set опции хранятся в таком же виде, но с предваряющим
+ * счетчиком элементов. */
+struct fpta_column_options {
+  size_t length;
+  fpta_table_schema::composite_item_t items[1];
+};
+
+enum { fpta_option_header_items = 3 };
+
+static cxx11_constexpr bool fpta_key_prefixes_applicable(fpta_shove_t shove) {
+  return fpta_is_indexed(shove) && fpta_index_is_ordered(shove) &&
+         fpta_index_is_obverse(shove) &&
+         (fpta_shove2type(shove) == fptu_cstr ||
+          fpta_shove2type(shove) == fptu_opaque ||
+          fpta_shove2type(shove) == /* composite */ fptu_null);
+}
+
+static cxx11_constexpr bool fpta_key_length_applicable(fpta_shove_t shove) {
+  return fpta_is_indexed(shove) && fpta_index_is_ordered(shove) &&
+         !fpta_column_is_nullable(shove) &&
+         (fpta_shove2type(shove) == fptu_cstr ||
+          fpta_shove2type(shove) == fptu_opaque);
+}
+
+static cxx11_constexpr bool fpta_hash_index_applicable(fpta_shove_t shove) {
+  return fpta_is_indexed(shove) && fpta_index_is_secondary(shove) &&
+         fpta_index_is_unique(shove) && fpta_index_is_unordered(shove);
+}
+
+static bool
+fpta_key_prefixes_validate(const fpta_table_schema::composite_item_t *payload,
+                           size_t payload_items) {
+  const fpta_key_prefixes *prefixes = (const fpta_key_prefixes *)payload;
+  if (unlikely(payload_items < 3 || prefixes->count < 1 ||
+               prefixes->count > fpta_max_key_prefixes ||
+               payload_items < 2u + prefixes->count))
+    return false;
+  if (unlikely(prefixes->offsets[0] != 0 ||
+               payload_items != fpta_key_prefixes::items(
+                                    prefixes->count,
+                                    prefixes->offsets[prefixes->count])))
+    return false;
+
+  for (size_t i = 0; i < prefixes->count; ++i) {
+    if (unlikely(prefixes->offsets[i] >= prefixes->offsets[i + 1] ||
+                 prefixes->length(i) > fpta_max_key_prefix_length))
+      return false;
+    /* префиксы должны быть упорядочены и не вложены друг в друга */
+    if (i > 0 &&
+        (prefixes->compare(i - 1, prefixes->prefix(i), prefixes->length(i)) >=
+             0 ||
+         memcmp(prefixes->prefix(i - 1), prefixes->prefix(i),
+                std::min(prefixes->length(i - 1), prefixes->length(i))) == 0))
+      return false;
+  }
+  return true;
+}
+
+static int fpta_column_options_validate(
+    const fpta_shove_t *shoves, size_t shoves_count,
+    const fpta_table_schema::composite_item_t *const options_begin,
+    const fpta_table_schema::composite_item_t *const options_end) {
+  for (auto scan = options_begin; scan < options_end;) {
+    if (unlikely(options_end - scan < fpta_option_header_items))
+      return FPTA_SCHEMA_CORRUPTED;
+
+    const unsigned kind = scan[0], column = scan[1], payload_items = scan[2];
+    const auto payload = scan + fpta_option_header_items;
+    if (unlikely(payload_items > size_t(options_end - payload) ||
+                 column >= shoves_count))
+      return FPTA_SCHEMA_CORRUPTED;
+
+    switch (kind) {
+    default:
+      return FPTA_SCHEMA_CORRUPTED;
+    case fpta_schema_option_key_prefixes:
+      if (unlikely(!fpta_key_prefixes_applicable(shoves[column])))
+        return FPTA_EFLAG;
+      if (unlikely(!fpta_key_prefixes_validate(payload, payload_items)))
+        return FPTA_SCHEMA_CORRUPTED;
+      break;
+    case fpta_schema_option_key_length:
+      if (unlikely(!fpta_key_length_applicable(shoves[column])))
+        return FPTA_EFLAG;
+      if (unlikely(payload_items != 1 || payload[0] <= fpta_max_keylen))
+        return FPTA_SCHEMA_CORRUPTED;
+      break;
+    case fpta_schema_option_hash_index:
+      if (unlikely(!fpta_hash_index_applicable(shoves[column])))
+        return FPTA_EFLAG;
+      if (unlikely(payload_items != 0))
+        return FPTA_SCHEMA_CORRUPTED;
+      break;
+    }
+
+    for (auto prev = options_begin; prev < scan;
+         prev += fpta_option_header_items + prev[2])
+      if (unlikely(prev[1] == column))
+        /* словарь префиксов несовместим с длинными ключами */
+        return (prev[0] == kind) ? FPTA_EEXIST : FPTA_EFLAG;
+    scan = payload + payload_items;
+  }
+  return FPTA_SUCCESS;
+}
+
+static cxx11_constexpr size_t
+fpta_column_options_bytes(const fpta_column_set *column_set) {
+  return column_set->options_ptr
+             ? sizeof(fpta_table_schema::composite_item_t) *
+                   ((const fpta_column_options *)column_set->options_ptr)
+                       ->length
+             : 0;
+}
+
+//----------------------------------------------------------------------------
+
 static size_t fpta_schema_stored_size(fpta_column_set *column_set,
                                       const void *composites_end) {
   assert(column_set != nullptr);
@@ -326,7 +445,8 @@ static size_t fpta_schema_stored_size(fpta_column_set *column_set,
 
   return fpta_table_schema::header_size() +
          sizeof(fpta_shove_t) * column_set->count + (uintptr_t)composites_end -
-         (uintptr_t)&column_set->composites[0];
+         (uintptr_t)&column_set->composites[0] +
+         fpta_column_options_bytes(column_set);
 }
 
 static void fpta_schema_free(fpta_table_schema *def) {
@@ -346,11 +466,49 @@ static int fpta_schema_clone(const fpta_shove_t schema_key,
       schema_data.iov_len - fpta_table_schema::header_size();
 
   const auto stored = (const fpta_table_stored_schema *)schema_data.iov_base;
-  const size_t bytes =
-      sizeof(fpta_table_schema) - sizeof(fpta_table_stored_schema::columns) +
-      payload_size +
+  const size_t image_bytes = sizeof(fpta_table_schema) -
+                             sizeof(fpta_table_stored_schema::columns) +
+                             payload_size;
+  /* при наличии опций индексов за образом схемы размещается выровненный
+   * массив указателей на словари префиксов и массив ограничений длины
+   * ключей */
+  const bool with_options = fpta_schema_signature_options(stored->signature);
+  const size_t prefixes_offset =
+      (image_bytes + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+  const size_t limits_offset = prefixes_offset + stored->count * sizeof(void *);
+  const size_t items_bytes =
       stored->count * sizeof(fpta_table_schema::composite_item_t);
 
+  /* кодировщики составных ключей размещаются параллельно описаниям
+   * составных колонок, включая их заголовки */
+  const auto stored_composites =
+      (const fpta_table_schema::composite_item_t *)(stored->columns +
+                                                    stored->count);
+  const size_t stored_items =
+      (payload_size - stored->count * sizeof(fpta_shove_t)) /
+      sizeof(fpta_table_schema::composite_item_t);
+  size_t encoders_count = 0;
+  for (size_t i = 0; i < stored->count; ++i) {
+    const fpta_shove_t column_shove = stored->columns[i];
+    if (!fpta_is_indexed(column_shove))
+      break;
+    if (!fpta_is_composite(column_shove))
+      continue;
+    if (unlikely(encoders_count >= stored_items))
+      return FPTA_EOOPS;
+    encoders_count += 1 + stored_composites[encoders_count];
+  }
+  const size_t encoders_offset =
+      ((with_options ? limits_offset + items_bytes : image_bytes) +
+       sizeof(uint64_t) - 1) &
+      ~(sizeof(uint64_t) - 1);
+  const size_t bytes =
+      (encoders_count ? encoders_offset +
+                            encoders_count * sizeof(fpta_composite_encoder)
+                      : with_options ? limits_offset + items_bytes
+                                     : image_bytes) +
+      items_bytes;
+
   fpta_table_schema *schema = (fpta_table_schema *)realloc(*ptrdef, bytes);
   if (unlikely(schema == nullptr))
     return FPTA_ENOMEM;
@@ -363,6 +521,10 @@ static int fpta_schema_clone(const fpta_shove_t schema_key,
       schema->_stored.count;
   schema->_key = schema_key;
   schema->_composite_offsets = offsets;
+  schema->_key_prefixes = nullptr;
+  schema->_key_limits = nullptr;
+  schema->_hash_indexes = 0;
+  schema->_composite_encoders = nullptr;
 
   const auto composites_begin =
       (const fpta_table_schema::composite_item_t *)&schema->_stored
@@ -388,6 +550,68 @@ static int fpta_schema_clone(const fpta_shove_t schema_key,
     offsets[i] = (fpta_table_schema::composite_item_t)distance;
     composites = last;
   }
+
+  /* маски зависимостей вторичных индексов от колонок */
+  std::fill_n(schema->_dependents, fpta_row_fields_cached + 1, 0);
+  for (size_t i = 1; i < schema->_stored.count && i < 64; ++i) {
+    const fpta_shove_t column_shove = schema->_stored.columns[i];
+    if (!fpta_is_indexed(column_shove))
+      break;
+    const uint64_t bit = UINT64_C(1) << i;
+    if (!fpta_is_composite(column_shove)) {
+      schema->_dependents[std::min(i, size_t(fpta_row_fields_cached))] |= bit;
+      continue;
+    }
+    fpta_table_schema::composite_iter_t first, last;
+    if (unlikely(schema->composite_list(i, first, last) != FPTA_SUCCESS))
+      return FPTA_EOOPS;
+    for (auto item = first; item != last; ++item)
+      schema->_dependents[std::min(size_t(*item),
+                                   size_t(fpta_row_fields_cached))] |= bit;
+  }
+
+  if (with_options) {
+    const fpta_key_prefixes **const prefixes =
+        (const fpta_key_prefixes **)((uint8_t *)schema + prefixes_offset);
+    std::fill_n(prefixes, schema->_stored.count, nullptr);
+    schema->_key_prefixes = prefixes;
+    fpta_table_schema::composite_item_t *const limits =
+        (fpta_table_schema::composite_item_t *)((uint8_t *)schema +
+                                                limits_offset);
+    std::fill_n(limits, schema->_stored.count,
+                fpta_table_schema::composite_item_t(fpta_max_keylen));
+
+    const auto options_end =
+        (const fpta_table_schema::composite_item_t *)((const uint8_t *)&schema
+                                                          ->_stored +
+                                                      schema_data.iov_len);
+    for (auto scan = composites; scan < options_end;
+         scan += fpta_option_header_items + scan[2]) {
+      if (unlikely(options_end - scan < fpta_option_header_items ||
+                   scan[1] >= schema->_stored.count))
+        return FPTA_EOOPS;
+      if (scan[0] == fpta_schema_option_key_prefixes)
+        prefixes[scan[1]] =
+            (const fpta_key_prefixes *)(scan + fpta_option_header_items);
+      else if (scan[0] == fpta_schema_option_key_length) {
+        limits[scan[1]] = scan[fpta_option_header_items];
+        schema->_key_limits = limits;
+      } else if (scan[0] == fpta_schema_option_hash_index) {
+        if (unlikely(scan[1] >= 64 ||
+                     schema->_stored.signature !=
+                         FTPA_SCHEMA_SIGNATURE_HASHED))
+          return FPTA_EOOPS;
+        schema->_hash_indexes |= UINT64_C(1) << scan[1];
+      }
+    }
+  }
+
+  if (encoders_count) {
+    fpta_composite_encoder *const encoders =
+        (fpta_composite_encoder *)((uint8_t *)schema + encoders_offset);
+    schema->_composite_encoders = encoders;
+    return fpta_composite_encoders_init(schema, encoders);
+  }
   return FPTA_SUCCESS;
 }
 
@@ -577,6 +801,25 @@ static int fpta_column_set_sort(fpta_column_set *column_set) {
     }
   }
 
+  /* fixup column numbers of index options */
+  fpta_column_options *const options =
+      (fpta_column_options *)column_set->options_ptr;
+  if (options) {
+    for (size_t i = 0; i + fpta_option_header_items <= options->length;
+         i += fpta_option_header_items + options->items[i + 2]) {
+      const size_t column_number = options->items[i + 1];
+      if (unlikely(column_number >= column_set->count))
+        return FPTA_SCHEMA_CORRUPTED;
+      const auto renum = std::distance(
+          sorted.begin(), std::find(sorted.begin(), sorted.end(),
+                                    column_set->shoves[column_number]));
+      if (unlikely(renum < 0 || (unsigned)renum >= column_set->count))
+        return FPTA_EOOPS;
+      options->items[i + 1] =
+          static_cast<fpta_table_schema::composite_item_t>(renum);
+    }
+  }
+
   /* put sorted arrays */
   memset(column_set->shoves, 0, sizeof(column_set->shoves));
   memset(column_set->composites, 0, sizeof(column_set->composites));
@@ -661,7 +904,7 @@ fpta_schema_image_validate(const fpta_shove_t schema_key,
 
   const fpta_table_stored_schema *schema =
       (const fpta_table_stored_schema *)schema_data.iov_base;
-  if (unlikely(schema->signature != FTPA_SCHEMA_SIGNATURE))
+  if (unlikely(!fpta_schema_signature_valid(schema->signature)))
     return nullptr;
 
   if (unlikely(schema->count < 1 || schema->count > fpta_max_cols))
@@ -687,11 +930,22 @@ fpta_schema_image_validate(const fpta_shove_t schema_key,
   const void *const composites_begin = schema->columns + schema->count;
   const void *const composites_end =
       (uint8_t *)schema_data.iov_base + schema_data.iov_len;
+  const void *composites_eof = nullptr;
   if (FPTA_SUCCESS !=
       fpta_columns_description_validate(
           schema->columns, schema->count,
           (const fpta_table_schema::composite_item_t *)composites_begin,
-          (const fpta_table_schema::composite_item_t *)composites_end))
+          (const fpta_table_schema::composite_item_t *)composites_end,
+          &composites_eof))
+    return nullptr;
+
+  if (fpta_schema_signature_options(schema->signature) &&
+      (composites_eof == composites_end ||
+       FPTA_SUCCESS !=
+           fpta_column_options_validate(
+               schema->columns, schema->count,
+               (const fpta_table_schema::composite_item_t *)composites_eof,
+               (const fpta_table_schema::composite_item_t *)composites_end)))
     return nullptr;
 
   if (!std::is_sorted(schema->columns, schema->columns + schema->count,
@@ -777,6 +1031,7 @@ void fpta_column_set_init(fpta_column_set *column_set) {
   column_set->signature = column_set_signature;
   column_set->count = 0;
   column_set->dict_ptr = nullptr;
+  column_set->options_ptr = nullptr;
   column_set->shoves[0] = 0;
   column_set->composites[0] = 0;
 }
@@ -788,6 +1043,8 @@ int fpta_column_set_destroy(fpta_column_set *column_set) {
     column_set->count = (unsigned)FPTA_DEADBEEF;
     free(column_set->dict_ptr);
     column_set->dict_ptr = (void *)(intptr_t)FPTA_DEADBEEF;
+    free(column_set->options_ptr);
+    column_set->options_ptr = (void *)(intptr_t)FPTA_DEADBEEF;
     column_set->shoves[0] = 0;
     column_set->composites[0] = INT16_MAX;
     return FPTA_SUCCESS;
@@ -806,6 +1063,8 @@ int fpta_column_set_reset(fpta_column_set *column_set) {
 
   if (column_set->dict_ptr)
     *(char *)column_set->dict_ptr = '\0';
+  if (column_set->options_ptr)
+    ((fpta_column_options *)column_set->options_ptr)->length = 0;
   column_set->count = 0;
   column_set->shoves[0] = 0;
   column_set->composites[0] = 0;
@@ -834,6 +1093,225 @@ int fpta_column_describe(const char *column_name, fptu_type data_type,
   return fpta_column_set_add(column_set, column_name, data_type, index_type);
 }
 
+__cold int fpta_describe_key_prefixes(const char *column_name,
+                                      fpta_column_set *column_set,
+                                      const char *const prefixes_array[],
+                                      size_t prefixes_count) {
+  if (unlikely(column_set == nullptr || prefixes_array == nullptr))
+    return FPTA_EINVAL;
+
+  if (unlikely(column_set->signature != column_set_signature))
+    return FPTA_EBADSIGN;
+
+  if (unlikely(prefixes_count < 1 || prefixes_count > fpta_max_key_prefixes))
+    return FPTA_EINVAL;
+
+  const fpta_shove_t name_shove = fpta_shove_name(column_name, fpta_column);
+  if (unlikely(!name_shove))
+    return FPTA_ENAME;
+
+  size_t column = 0;
+  while (column < column_set->count &&
+         (column_set->shoves[column] == 0 ||
+          !fpta_shove_eq(column_set->shoves[column], name_shove)))
+    ++column;
+  if (unlikely(column == column_set->count))
+    return FPTA_COLUMN_MISSING;
+
+  const fpta_shove_t shove = column_set->shoves[column];
+  if (unlikely(!fpta_key_prefixes_applicable(shove)))
+    return fpta_is_indexed(shove) ? FPTA_EFLAG : FPTA_NO_INDEX;
+
+  if (fpta_is_composite(shove)) {
+    /* префиксы сопоставляются со значением первой из образующих колонок,
+     * поэтому она должна быть строкой или бинарными данными */
+    auto composite = column_set->composites;
+    for (size_t i = 0; i < column; ++i)
+      if (fpta_is_composite(column_set->shoves[i]))
+        composite += *composite + 1;
+    if (unlikely(composite >= FPT_ARRAY_END(column_set->composites) ||
+                 *composite < 2 || composite[1] >= column_set->count))
+      return FPTA_SCHEMA_CORRUPTED;
+    const fptu_type first_type =
+        fpta_shove2type(column_set->shoves[composite[1]]);
+    if (unlikely(first_type != fptu_cstr && first_type != fptu_opaque))
+      return FPTA_ETYPE;
+  }
+
+  std::vector<fpta::string_view> prefixes;
+  prefixes.reserve(prefixes_count);
+  size_t total_bytes = 0;
+  for (size_t i = 0; i < prefixes_count; ++i) {
+    if (unlikely(prefixes_array[i] == nullptr))
+      return FPTA_EINVAL;
+    const size_t length = strlen(prefixes_array[i]);
+    if (unlikely(length < 1 || length > fpta_max_key_prefix_length))
+      return FPTA_DATALEN_MISMATCH;
+    prefixes.emplace_back(prefixes_array[i], length);
+    total_bytes += length;
+  }
+  /* порядок должен совпадать с порядком сравнения ключей (как memcmp) */
+  std::sort(prefixes.begin(), prefixes.end(),
+            [](const fpta::string_view &left, const fpta::string_view &right) {
+              const int diff =
+                  memcmp(left.data(), right.data(),
+                         std::min(left.length(), right.length()));
+              return diff ? diff < 0 : left.length() < right.length();
+            });
+  for (size_t i = 1; i < prefixes.size(); ++i) {
+    const fpta::string_view &prev = prefixes[i - 1];
+    if (unlikely(prev.length() <= prefixes[i].length() &&
+                 memcmp(prev.data(), prefixes[i].data(), prev.length()) == 0))
+      /* повтор, либо вложенный префикс */
+      return (prev.length() == prefixes[i].length()) ? FPTA_EEXIST
+                                                     : FPTA_EINVAL;
+  }
+
+  fpta_column_options *options =
+      (fpta_column_options *)column_set->options_ptr;
+  const size_t length = options ? options->length : 0;
+  for (size_t i = 0; i + fpta_option_header_items <= length;
+       i += fpta_option_header_items + options->items[i + 2])
+    if (options->items[i + 1] == column)
+      return (options->items[i] == fpta_schema_option_key_prefixes)
+                 ? FPTA_EEXIST
+                 : FPTA_EFLAG;
+
+  const size_t payload_items =
+      fpta_key_prefixes::items(prefixes_count, total_bytes);
+  const size_t new_length = length + fpta_option_header_items + payload_items;
+  options = (fpta_column_options *)realloc(
+      options, sizeof(fpta_column_options) +
+                   sizeof(options->items[0]) * new_length);
+  if (unlikely(!options))
+    return FPTA_ENOMEM;
+  column_set->options_ptr = options;
+
+  fpta_table_schema::composite_item_t *const record = options->items + length;
+  memset(record, 0, sizeof(record[0]) * (new_length - length));
+  record[0] = fpta_schema_option_key_prefixes;
+  record[1] = fpta_table_schema::composite_item_t(column);
+  record[2] = fpta_table_schema::composite_item_t(payload_items);
+  fpta_key_prefixes *const dict =
+      (fpta_key_prefixes *)(record + fpta_option_header_items);
+  dict->count = uint16_t(prefixes_count);
+  dict->offsets[0] = 0;
+  for (size_t i = 0; i < prefixes_count; ++i)
+    dict->offsets[i + 1] = uint16_t(dict->offsets[i] + prefixes[i].length());
+  for (size_t i = 0; i < prefixes_count; ++i)
+    memcpy((uint8_t *)dict->prefix(i), prefixes[i].data(),
+           prefixes[i].length());
+  options->length = new_length;
+  return FPTA_SUCCESS;
+}
+
+__cold int fpta_describe_key_length(const char *column_name,
+                                    fpta_column_set *column_set,
+                                    size_t max_keylen) {
+  if (unlikely(column_set == nullptr))
+    return FPTA_EINVAL;
+
+  if (unlikely(column_set->signature != column_set_signature))
+    return FPTA_EBADSIGN;
+
+  static_assert(sizeof(fpta_table_schema::composite_item_t) == 2,
+                "expect uint16_t");
+  if (unlikely(max_keylen <= fpta_max_keylen || max_keylen > UINT16_MAX))
+    return FPTA_EINVAL;
+
+  const fpta_shove_t name_shove = fpta_shove_name(column_name, fpta_column);
+  if (unlikely(!name_shove))
+    return FPTA_ENAME;
+
+  size_t column = 0;
+  while (column < column_set->count &&
+         (column_set->shoves[column] == 0 ||
+          !fpta_shove_eq(column_set->shoves[column], name_shove)))
+    ++column;
+  if (unlikely(column == column_set->count))
+    return FPTA_COLUMN_MISSING;
+
+  const fpta_shove_t shove = column_set->shoves[column];
+  if (unlikely(!fpta_key_length_applicable(shove)))
+    return fpta_is_indexed(shove) ? FPTA_EFLAG : FPTA_NO_INDEX;
+
+  fpta_column_options *options =
+      (fpta_column_options *)column_set->options_ptr;
+  const size_t length = options ? options->length : 0;
+  for (size_t i = 0; i + fpta_option_header_items <= length;
+       i += fpta_option_header_items + options->items[i + 2])
+    if (options->items[i + 1] == column)
+      return (options->items[i] == fpta_schema_option_key_length)
+                 ? FPTA_EEXIST
+                 : FPTA_EFLAG;
+
+  const size_t new_length = length + fpta_option_header_items + 1;
+  options = (fpta_column_options *)realloc(
+      options, sizeof(fpta_column_options) +
+                   sizeof(options->items[0]) * new_length);
+  if (unlikely(!options))
+    return FPTA_ENOMEM;
+  column_set->options_ptr = options;
+
+  fpta_table_schema::composite_item_t *const record = options->items + length;
+  record[0] = fpta_schema_option_key_length;
+  record[1] = fpta_table_schema::composite_item_t(column);
+  record[2] = 1;
+  record[3] = fpta_table_schema::composite_item_t(max_keylen);
+  options->length = new_length;
+  return FPTA_SUCCESS;
+}
+
+__cold int fpta_describe_hash_index(const char *column_name,
+                                    fpta_column_set *column_set) {
+  if (unlikely(column_set == nullptr))
+    return FPTA_EINVAL;
+
+  if (unlikely(column_set->signature != column_set_signature))
+    return FPTA_EBADSIGN;
+
+  const fpta_shove_t name_shove = fpta_shove_name(column_name, fpta_column);
+  if (unlikely(!name_shove))
+    return FPTA_ENAME;
+
+  size_t column = 0;
+  while (column < column_set->count &&
+         (column_set->shoves[column] == 0 ||
+          !fpta_shove_eq(column_set->shoves[column], name_shove)))
+    ++column;
+  if (unlikely(column == column_set->count))
+    return FPTA_COLUMN_MISSING;
+
+  const fpta_shove_t shove = column_set->shoves[column];
+  if (unlikely(!fpta_hash_index_applicable(shove)))
+    return fpta_is_indexed(shove) ? FPTA_EFLAG : FPTA_NO_INDEX;
+
+  fpta_column_options *options =
+      (fpta_column_options *)column_set->options_ptr;
+  const size_t length = options ? options->length : 0;
+  for (size_t i = 0; i + fpta_option_header_items <= length;
+       i += fpta_option_header_items + options->items[i + 2])
+    if (options->items[i + 1] == column)
+      return (options->items[i] == fpta_schema_option_hash_index)
+                 ? FPTA_EEXIST
+                 : FPTA_EFLAG;
+
+  const size_t new_length = length + fpta_option_header_items;
+  options = (fpta_column_options *)realloc(
+      options, sizeof(fpta_column_options) +
+                   sizeof(options->items[0]) * new_length);
+  if (unlikely(!options))
+    return FPTA_ENOMEM;
+  column_set->options_ptr = options;
+
+  fpta_table_schema::composite_item_t *const record = options->items + length;
+  record[0] = fpta_schema_option_hash_index;
+  record[1] = fpta_table_schema::composite_item_t(column);
+  record[2] = 0;
+  options->length = new_length;
+  return FPTA_SUCCESS;
+}
+
 int fpta_column_set_validate(fpta_column_set *column_set) {
   if (unlikely(column_set == nullptr))
     return FPTA_EINVAL;
@@ -841,9 +1319,16 @@ int fpta_column_set_validate(fpta_column_set *column_set) {
   if (unlikely(column_set->signature != column_set_signature))
     return FPTA_EBADSIGN;
 
-  return fpta_columns_description_validate(
+  int rc = fpta_columns_description_validate(
       column_set->shoves, column_set->count, column_set->composites,
       FPT_ARRAY_END(column_set->composites));
+  const fpta_column_options *const options =
+      (const fpta_column_options *)column_set->options_ptr;
+  if (rc == FPTA_SUCCESS && options)
+    rc = fpta_column_options_validate(column_set->shoves, column_set->count,
+                                      options->items,
+                                      options->items + options->length);
+  return rc;
 }
 
 //----------------------------------------------------------------------------
@@ -1072,6 +1557,7 @@ int fpta_name_refresh_couple(fpta_txn *txn, fpta_name *table_id,
       return FPTA_SCHEMA_CHANGED;
 
     rc = fpta_schema_read(txn, table_id->shove, &table_id->table_schema);
+    FPTA_PROBE2(schema_refresh, table_id->shove, rc);
     if (unlikely(rc != FPTA_SUCCESS)) {
       if (rc != MDBX_NOTFOUND)
         return rc;
@@ -1092,7 +1578,7 @@ int fpta_name_refresh_couple(fpta_txn *txn, fpta_name *table_id,
     return FPTA_NOTFOUND;
 
   fpta_table_schema *schema = table_id->table_schema;
-  if (unlikely(schema->signature() != FTPA_SCHEMA_SIGNATURE))
+  if (unlikely(!fpta_schema_signature_valid(schema->signature())))
     return FPTA_SCHEMA_CORRUPTED;
 
   assert(fpta_shove2index(table_id->shove) == (fpta_index_type)fpta_flag_table);
@@ -1173,6 +1659,36 @@ int fpta_table_create(fpta_txn *txn, const char *table_name,
   if (rc != FPTA_SUCCESS)
     return rc;
 
+  const fpta_column_options *const options =
+      (const fpta_column_options *)column_set->options_ptr;
+  bool hashed = false;
+  if (options && options->length) {
+    rc = fpta_column_options_validate(column_set->shoves, column_set->count,
+                                      options->items,
+                                      options->items + options->length);
+    if (rc != FPTA_SUCCESS)
+      return rc;
+
+    /* длинные ключи должны помещаться в страницы БД, в том числе
+     * в качестве значений во вторичных индексах с дубликатами */
+    const int maxkeysize =
+        mdbx_env_get_maxkeysize_ex(txn->db->mdbx_env, MDBX_DUPSORT);
+    for (size_t i = 0; i + fpta_option_header_items <= options->length;
+         i += fpta_option_header_items + options->items[i + 2]) {
+      if (options->items[i] == fpta_schema_option_key_length &&
+          unlikely(maxkeysize < 0 ||
+                   options->items[i + fpta_option_header_items] >
+                       unsigned(maxkeysize)))
+        return FPTA_DATALEN_MISMATCH;
+      /* хэш-индексы отмечаются в схеме 64-битной маской */
+      if (options->items[i] == fpta_schema_option_hash_index) {
+        if (unlikely(options->items[i + 1] >= 64))
+          return FPTA_TOOMANY;
+        hashed = true;
+      }
+    }
+  }
+
   fpta_db *db = txn->db;
   assert(db->schema_dbi > 1);
 
@@ -1270,7 +1786,10 @@ int fpta_table_create(fpta_txn *txn, const char *table_name,
   if (rc == MDBX_SUCCESS) {
     fpta_table_stored_schema *const record =
         (fpta_table_stored_schema *)data.iov_base;
-    record->signature = FTPA_SCHEMA_SIGNATURE;
+    record->signature = hashed ? FTPA_SCHEMA_SIGNATURE_HASHED
+                        : (options && options->length)
+                            ? FTPA_SCHEMA_SIGNATURE_OPTIONS
+                            : FTPA_SCHEMA_SIGNATURE;
     record->count = column_set->count;
     record->version_tsn = txn->db_version;
     memcpy(record->columns, column_set->shoves,
@@ -1281,7 +1800,12 @@ int fpta_table_create(fpta_txn *txn, const char *table_name,
     const size_t composites_bytes =
         (uintptr_t)composites_eof - (uintptr_t)&column_set->composites[0];
     memcpy(ptr, column_set->composites, composites_bytes);
-    assert((uint8_t *)ptr + composites_bytes == (uint8_t *)record + bytes);
+    const size_t options_bytes = fpta_column_options_bytes(column_set);
+    if (options_bytes)
+      memcpy((uint8_t *)ptr + composites_bytes, options->items,
+             options_bytes);
+    assert((uint8_t *)ptr + composites_bytes + options_bytes ==
+           (uint8_t *)record + bytes);
 
     record->checksum =
         t1ha2_atonce(&record->signature, bytes - sizeof(record->checksum),
@@ -1512,6 +2036,67 @@ int fpta_schema_symbol(const fpta_schema_info *info, const fpta_name *id,
   return FPTA_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+
+int fpta_json_names_build(const fpta_schema_info *info,
+                          const fpta_name *table_id, fpta_json_names **names) {
+  if (unlikely(names == nullptr))
+    return FPTA_EINVAL;
+  *names = nullptr;
+
+  int err = fpta_schema_info_validate(info);
+  if (unlikely(err != FPTA_SUCCESS))
+    return err;
+  if (unlikely(info->dict_ptr == nullptr))
+    return FPTA_EINVAL;
+
+  err = fpta_id_validate(table_id, fpta_table_with_schema);
+  if (unlikely(err != FPTA_SUCCESS))
+    return err;
+  if (unlikely(table_id->version_tsn > info->version.tsn))
+    return FPTA_SCHEMA_CHANGED;
+
+  const fpta_table_schema *schema = table_id->table_schema;
+  fpta_json_names *table =
+      new fpta_json_names() /* FIXME: std::bad_alloc */;
+  if (unlikely(!table))
+    return FPTA_ENOMEM;
+
+  /* Сначала собираем имена в одну строку, запоминая смещения, а указатели
+   * формируем в самом конце, так как holder может перераспределяться. */
+  size_t offsets[fpta_max_cols];
+  table->count = schema->column_count();
+  for (size_t i = 0; i < table->count; ++i) {
+    const fpta::string_view symbol =
+        info->dict_ptr->dict_.lookup(schema->column_shove(i));
+    if (unlikely(symbol.empty())) {
+      delete table;
+      return FPTA_SCHEMA_CORRUPTED;
+    }
+    offsets[i] = table->holder.size();
+    table->holder.append(symbol.data(), symbol.length());
+    table->holder.push_back('\0');
+  }
+  for (size_t i = 0; i < table->count; ++i)
+    table->names[i] = table->holder.data() + offsets[i];
+
+  table->table_shove = table_id->shove;
+  table->schema_tsn = info->version.tsn;
+  table->signature = fpta_json_names::signature_value;
+  *names = table;
+  return FPTA_SUCCESS;
+}
+
+int fpta_json_names_destroy(fpta_json_names *names) {
+  if (unlikely(names == nullptr ||
+               names->signature != fpta_json_names::signature_value))
+    return FPTA_EINVAL;
+
+  names->signature = ~fpta_json_names::signature_value;
+  delete names;
+  return FPTA_SUCCESS;
+}
+
 enum {
   colnum_schema_format,
   colnum_schema_t1ha,
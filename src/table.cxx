@@ -19,12 +19,16 @@
 
 #include "../externals/libfptu/src/erthink/erthink_clz.h"
 
+#include <deque>
+#include <system_error>
+#include <thread>
+
 /* Проверяет наличие в строке значений non-nullable колонок, которые
  * не индексированы, либо индексированы без ограничений уникальности.
  * Другими словами, это те колонки, которые должны иметь значения,
  * но не проверяются в fpta_check_secondary_uniqueness(). */
-__hot int fpta_check_nonnullable(const fpta_table_schema *table_def,
-                                 const fptu_ro &row) {
+__hot int fpta_check_nonnullable(fpta_row_fields &row) {
+  const fpta_table_schema *const table_def = row.schema;
   assert(table_def->column_count() > 0);
   for (size_t i = 1; i < table_def->column_count(); ++i) {
     const auto shove = table_def->column_shove(i);
@@ -58,39 +62,82 @@ __hot int fpta_check_nonnullable(const fpta_table_schema *table_def,
     if (type == /* composite */ fptu_null)
       continue;
 
-    const fptu_field *field = fptu::lookup(row, (unsigned)i, type);
+    const fptu_field *field = row.lookup(i, type);
     if (unlikely(field == nullptr))
       return FPTA_COLUMN_MISSING;
   }
   return FPTA_SUCCESS;
 }
 
+static __inline bool fpta_field_same(const fptu_field *left,
+                                     const fptu_field *right) {
+  if (left == nullptr || right == nullptr)
+    return left == right;
+
+  assert(left->tag == right->tag);
+  const struct iovec l = fptu_field_as_iovec(left);
+  const struct iovec r = fptu_field_as_iovec(right);
+  return l.iov_len == r.iov_len &&
+         memcmp(l.iov_base, r.iov_base, l.iov_len) == 0;
+}
+
+/* Возвращает маску вторичных индексов (с номерами меньше 64), у которых
+ * различаются значения исходных колонок в старой и новой версиях строки.
+ * Сравниваются только поля колонок, от которых зависит хотя-бы один еще
+ * не затронутый индекс, а сами ключи индексов не формируются. */
+static __hot uint64_t fpta_secondary_affected(fpta_row_fields &old_row,
+                                              fpta_row_fields &new_row) {
+  const fpta_table_schema *const table_def = new_row.schema;
+  const size_t count = std::min(table_def->column_count(),
+                                size_t(fpta_row_fields_cached));
+  uint64_t affected = table_def->_dependents[fpta_row_fields_cached];
+  for (size_t i = 0; i < count; ++i) {
+    const uint64_t dependents = table_def->_dependents[i];
+    if ((dependents & ~affected) == 0)
+      continue;
+    const fptu_type type = fpta_shove2type(table_def->column_shove(i));
+    if (!fpta_field_same(old_row.lookup(i, type), new_row.lookup(i, type)))
+      affected |= dependents;
+  }
+  return affected;
+}
+
+static __inline bool fpta_secondary_skip(uint64_t affected, size_t i) {
+  return i < 64 && (affected & UINT64_C(1) << i) == 0;
+}
+
 __hot int fpta_check_secondary_uniq(fpta_txn *txn, fpta_table_schema *table_def,
-                                    const fptu_ro &old_row,
-                                    const fptu_ro &new_row,
+                                    fpta_row_fields &old_row,
+                                    fpta_row_fields &new_row,
                                     const unsigned stepover) {
+  assert(old_row.schema == table_def && new_row.schema == table_def);
   MDBX_dbi dbi[fpta_max_indexes];
   int rc = fpta_open_secondaries(txn, table_def, dbi);
   if (unlikely(rc != FPTA_SUCCESS))
     return rc;
 
+  const uint64_t affected = old_row.present()
+                                ? fpta_secondary_affected(old_row, new_row)
+                                : ~UINT64_C(0);
   for (size_t i = 1; i < table_def->column_count(); ++i) {
     const auto shove = table_def->column_shove(i);
     const auto index = fpta_shove2index(shove);
     assert(i < fpta_max_indexes);
     if (!fpta_index_is_secondary(index))
       break;
-    if (i == stepover || !fpta_index_is_unique(index))
+    if (i == stepover || !fpta_index_is_unique(index) ||
+        /* исходные колонки не изменились, ключ индекса прежний */
+        fpta_secondary_skip(affected, i))
       continue;
 
     fpta_key new_se_key;
-    rc = fpta_index_row2key(table_def, i, new_row, new_se_key, false);
+    rc = fpta_index_row2key(new_row, i, new_se_key, false);
     if (unlikely(rc != MDBX_SUCCESS))
       return rc;
 
-    if (old_row.sys.iov_base) {
+    if (old_row.present()) {
       fpta_key old_se_key;
-      rc = fpta_index_row2key(table_def, i, old_row, old_se_key, false);
+      rc = fpta_index_row2key(old_row, i, old_se_key, false);
       if (unlikely(rc != MDBX_SUCCESS))
         return rc;
       if (fpta_is_same(old_se_key.mdbx, new_se_key.mdbx))
@@ -98,7 +145,9 @@ __hot int fpta_check_secondary_uniq(fpta_txn *txn, fpta_table_schema *table_def,
     }
 
     MDBX_val pk_exist;
-    rc = mdbx_get(txn->mdbx_txn, dbi[i], &new_se_key.mdbx, &pk_exist);
+    rc = table_def->is_hash_index(i)
+             ? fpta_hash_get(txn->mdbx_txn, dbi[i], new_se_key.mdbx, &pk_exist)
+             : mdbx_get(txn->mdbx_txn, dbi[i], &new_se_key.mdbx, &pk_exist);
     if (unlikely(rc != MDBX_NOTFOUND))
       return (rc == MDBX_SUCCESS) ? MDBX_KEYEXIST : rc;
   }
@@ -106,37 +155,52 @@ __hot int fpta_check_secondary_uniq(fpta_txn *txn, fpta_table_schema *table_def,
   return FPTA_SUCCESS;
 }
 
-int fpta_secondary_upsert(fpta_txn *txn, fpta_table_schema *table_def,
-                          MDBX_val old_pk_key, const fptu_ro &old_row,
-                          MDBX_val new_pk_key, const fptu_ro &new_row,
-                          const unsigned stepover) {
+static int fpta_secondary_upsert_apply(fpta_txn *txn,
+                                       fpta_table_schema *table_def,
+                                       MDBX_val old_pk_key,
+                                       fpta_row_fields &old_row,
+                                       MDBX_val new_pk_key,
+                                       fpta_row_fields &new_row,
+                                       const unsigned stepover) {
+  assert(old_row.schema == table_def && new_row.schema == table_def);
   MDBX_dbi dbi[fpta_max_indexes];
   int rc = fpta_open_secondaries(txn, table_def, dbi);
   if (unlikely(rc != FPTA_SUCCESS))
     return rc;
 
+  /* При неизменном PK индексы, исходные колонки которых не изменились,
+   * пропускаются без формирования ключей. */
+  const bool pk_same = old_pk_key.iov_base == new_pk_key.iov_base ||
+                       fpta_is_same(old_pk_key, new_pk_key);
+  const uint64_t affected = (old_row.present() && pk_same)
+                                ? fpta_secondary_affected(old_row, new_row)
+                                : ~UINT64_C(0);
   for (size_t i = 1; i < table_def->column_count(); ++i) {
     const auto shove = table_def->column_shove(i);
     const auto index = fpta_shove2index(shove);
     assert(i < fpta_max_indexes);
     if (!fpta_index_is_secondary(index))
       break;
-    if (i == stepover)
+    if (i == stepover || fpta_secondary_skip(affected, i))
       continue;
 
     fpta_key new_se_key;
-    rc = fpta_index_row2key(table_def, i, new_row, new_se_key, false);
+    rc = fpta_index_row2key(new_row, i, new_se_key, false);
     if (unlikely(rc != MDBX_SUCCESS))
       return rc;
 
-    if (old_row.sys.iov_base == nullptr) {
+    const bool hashed = table_def->is_hash_index(i);
+    if (!old_row.present()) {
       /* Старой версии нет, выполняется добавление новой строки */
       assert(old_pk_key.iov_base == new_pk_key.iov_base);
       /* Вставляем новую пару в secondary индекс */
-      rc = mdbx_put(txn->mdbx_txn, dbi[i], &new_se_key.mdbx, &new_pk_key,
-                    fpta_index_is_unique(index)
-                        ? MDBX_NODUPDATA | MDBX_NOOVERWRITE
-                        : MDBX_NODUPDATA);
+      rc = hashed ? fpta_hash_put(txn->mdbx_txn, dbi[i], new_se_key.mdbx,
+                                  new_pk_key)
+                  : mdbx_put(txn->mdbx_txn, dbi[i], &new_se_key.mdbx,
+                             &new_pk_key,
+                             fpta_index_is_unique(index)
+                                 ? MDBX_NODUPDATA | MDBX_NOOVERWRITE
+                                 : MDBX_NODUPDATA);
       if (unlikely(rc != MDBX_SUCCESS))
         return rc;
 
@@ -145,27 +209,32 @@ int fpta_secondary_upsert(fpta_txn *txn, fpta_table_schema *table_def,
     /* else: Выполняется обновление существующей строки */
 
     fpta_key old_se_key;
-    rc = fpta_index_row2key(table_def, i, old_row, old_se_key, false);
+    rc = fpta_index_row2key(old_row, i, old_se_key, false);
     if (unlikely(rc != MDBX_SUCCESS))
       return rc;
 
     if (!fpta_is_same(old_se_key.mdbx, new_se_key.mdbx)) {
       /* Изменилось значение индексированного поля, выполняем удаление
        * из индекса пары со старым значением и добавляем пару с новым. */
-      rc = mdbx_del(txn->mdbx_txn, dbi[i], &old_se_key.mdbx, &old_pk_key);
+      rc = hashed ? fpta_hash_del(txn->mdbx_txn, dbi[i], old_se_key.mdbx,
+                                  old_pk_key)
+                  : mdbx_del(txn->mdbx_txn, dbi[i], &old_se_key.mdbx,
+                             &old_pk_key);
       if (unlikely(rc != MDBX_SUCCESS))
         return (rc != MDBX_NOTFOUND) ? rc : (int)FPTA_INDEX_CORRUPTED;
-      rc = mdbx_put(txn->mdbx_txn, dbi[i], &new_se_key.mdbx, &new_pk_key,
-                    fpta_index_is_unique(index)
-                        ? MDBX_NODUPDATA | MDBX_NOOVERWRITE
-                        : MDBX_NODUPDATA);
+      rc = hashed ? fpta_hash_put(txn->mdbx_txn, dbi[i], new_se_key.mdbx,
+                                  new_pk_key)
+                  : mdbx_put(txn->mdbx_txn, dbi[i], &new_se_key.mdbx,
+                             &new_pk_key,
+                             fpta_index_is_unique(index)
+                                 ? MDBX_NODUPDATA | MDBX_NOOVERWRITE
+                                 : MDBX_NODUPDATA);
       if (unlikely(rc != MDBX_SUCCESS))
         return rc;
       continue;
     }
 
-    if (old_pk_key.iov_base == new_pk_key.iov_base ||
-        fpta_is_same(old_pk_key, new_pk_key))
+    if (pk_same)
       continue;
 
     /* Изменился PK, необходимо обновить пару<SE_value, PK_value> во вторичном
@@ -175,21 +244,359 @@ int fpta_secondary_upsert(fpta_txn *txn, fpta_table_schema *table_def,
      * старого значения PK на новое, даже если для индексируемого поля
      * разрешены не уникальные значения. */
     MDBX_val old_pk_key_clone = old_pk_key;
-    rc = mdbx_replace(txn->mdbx_txn, dbi[i], &new_se_key.mdbx, &new_pk_key,
-                      &old_pk_key_clone,
-                      fpta_index_is_unique(index)
-                          ? MDBX_CURRENT | MDBX_NODUPDATA
-                          : MDBX_CURRENT | MDBX_NODUPDATA | MDBX_NOOVERWRITE);
+    rc = hashed
+             ? fpta_hash_replace(txn->mdbx_txn, dbi[i], new_se_key.mdbx,
+                                 new_pk_key, old_pk_key)
+             : mdbx_replace(txn->mdbx_txn, dbi[i], &new_se_key.mdbx,
+                            &new_pk_key, &old_pk_key_clone,
+                            fpta_index_is_unique(index)
+                                ? MDBX_CURRENT | MDBX_NODUPDATA
+                                : MDBX_CURRENT | MDBX_NODUPDATA |
+                                      MDBX_NOOVERWRITE);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return (rc != MDBX_NOTFOUND) ? rc : (int)FPTA_INDEX_CORRUPTED;
+  }
+
+  return FPTA_SUCCESS;
+}
+
+int fpta_secondary_upsert(fpta_txn *txn, fpta_table_schema *table_def,
+                          MDBX_val old_pk_key, fpta_row_fields &old_row,
+                          MDBX_val new_pk_key, fpta_row_fields &new_row,
+                          const unsigned stepover) {
+  const int rc = fpta_secondary_upsert_apply(txn, table_def, old_pk_key,
+                                             old_row, new_pk_key, new_row,
+                                             stepover);
+  FPTA_PROBE3(secondary_upsert, table_def->table_shove(), new_pk_key.iov_len,
+              rc);
+  return rc;
+}
+
+//----------------------------------------------------------------------------
+
+/* Пакетная поддержка вторичных индексов для fpta_put_batch().
+ *
+ * Ключи каждого из затронутых индексов формируются и упорядочиваются
+ * отдельным заданием, которые разбираются рабочими потоками, а без них
+ * формируются за один проход по строкам пакета. Задания не обращаются
+ * к транзакции, а только читают схему и строки, поля которых собраны
+ * заранее. Затем в потоке транзакции проверяется уникальность
+ * относительно уже имеющихся в БД ключей и только после этого изменения
+ * вносятся в каждый индекс в порядке возрастания ключей. */
+
+struct fpta_batch_index {
+  /* Ключи копируются подряд в arena, а сортируются компактные элементы
+   * с порядковым префиксом, поэтому большинство сравнений не требует
+   * обращения к самим ключам. */
+  struct item {
+    uint64_t prefix, pk_prefix;
+    MDBX_val se_key;
+    const MDBX_val *pk_key;
+  };
+
+  fpta_batch_index(size_t column, fpta_shove_t pk_shove, fpta_shove_t shove,
+                   bool hashed)
+      : column(column), unique(fpta_index_is_unique(fpta_shove2index(shove))),
+        hashed(hashed), rc(FPTA_SUCCESS) {
+    dbi_flags = fpta_index_shove2secondary_dbiflags(pk_shove, shove);
+    /* PK хранится как значение в dupsort-индексе */
+    dup_flags = ((dbi_flags & MDBX_INTEGERDUP) ? MDBX_INTEGERKEY : 0) |
+                ((dbi_flags & MDBX_REVERSEDUP) ? MDBX_REVERSEKEY : 0);
+    exact = fpta_batch_prefix_exact(dbi_flags);
+    dup_exact = fpta_batch_prefix_exact(dup_flags);
+    keycmp = mdbx_get_keycmp(dbi_flags);
+    datacmp = mdbx_get_datacmp(dbi_flags);
+  }
+
+  const size_t column;
+  const bool unique, hashed;
+  bool exact, dup_exact;
+  int rc;
+  unsigned dbi_flags, dup_flags;
+  MDBX_cmp_func *keycmp, *datacmp;
+  std::vector<uint8_t> arena;
+  std::vector<item> dels, puts;
+
+  int keydiff(const item &left, const item &right) const {
+    if (left.prefix != right.prefix)
+      return (left.prefix < right.prefix) ? -1 : 1;
+    return exact ? 0 : keycmp(&left.se_key, &right.se_key);
+  }
+  bool less(const item &left, const item &right) const {
+    const int diff = keydiff(left, right);
+    if (diff)
+      return diff < 0;
+    if (left.pk_prefix != right.pk_prefix)
+      return left.pk_prefix < right.pk_prefix;
+    return !dup_exact && datacmp(left.pk_key, right.pk_key) < 0;
+  }
+  void sort(std::vector<item> &items) const {
+    std::sort(items.begin(), items.end(),
+              [this](const item &left, const item &right) {
+                return less(left, right);
+              });
+  }
+  bool deleted(const MDBX_val &se_key, const MDBX_val *pk_key) const {
+    const item probe = {fpta_batch_prefix(dbi_flags, se_key),
+                        fpta_batch_prefix(dup_flags, *pk_key), se_key, pk_key};
+    const auto it =
+        std::lower_bound(dels.begin(), dels.end(), probe,
+                         [this](const item &left, const item &right) {
+                           return less(left, right);
+                         });
+    return it != dels.end() && !less(probe, *it);
+  }
+
+  void append(std::vector<item> &items, const MDBX_val &se_key,
+              const MDBX_val *pk_key) {
+    /* пока arena растет, вместо адреса ключа сохраняется смещение */
+    const item entry = {fpta_batch_prefix(dbi_flags, se_key),
+                        fpta_batch_prefix(dup_flags, *pk_key),
+                        {(void *)arena.size(), se_key.iov_len},
+                        pk_key};
+    const uint8_t *const bytes = static_cast<const uint8_t *>(se_key.iov_base);
+    arena.insert(arena.end(), bytes, bytes + se_key.iov_len);
+    items.push_back(entry);
+  }
+  void rebase(std::vector<item> &items) const {
+    for (auto &entry : items)
+      entry.se_key.iov_base =
+          const_cast<uint8_t *>(arena.data()) + (size_t)entry.se_key.iov_base;
+  }
+
+  void reserve(size_t count) {
+    puts.reserve(count);
+    arena.reserve(count * sizeof(uint64_t));
+  }
+  void add(const fpta_batch_row &row, uint64_t affected);
+  void finish();
+  void prepare(const fpta_batch_row *rows, const uint64_t *affected,
+               size_t count) {
+    reserve(count);
+    for (size_t n = 0; n < count && rc == FPTA_SUCCESS; ++n)
+      add(rows[n], affected[n]);
+    finish();
+  }
+  int apply(MDBX_cursor *mdbx_cursor) const;
+  int apply(MDBX_txn *mdbx_txn, MDBX_dbi dbi) const;
+};
+
+void fpta_batch_index::add(const fpta_batch_row &row, uint64_t affected) {
+  if (fpta_secondary_skip(affected, column))
+    return;
+
+  fpta_key new_se_key;
+  rc = fpta_index_row2key(*row.new_row, column, new_se_key, false);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return;
+
+  if (row.old_row->present()) {
+    fpta_key old_se_key;
+    rc = fpta_index_row2key(*row.old_row, column, old_se_key, false);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return;
+    if (fpta_is_same(old_se_key.mdbx, new_se_key.mdbx))
+      return;
+    append(dels, old_se_key.mdbx, &row.pk_key);
+  }
+  append(puts, new_se_key.mdbx, &row.pk_key);
+}
+
+void fpta_batch_index::finish() {
+  if (unlikely(rc != FPTA_SUCCESS))
+    return;
+
+  rebase(dels);
+  rebase(puts);
+  sort(dels);
+  sort(puts);
+  if (unique)
+    /* дубликаты ключей уникального индекса внутри пакета */
+    for (size_t i = 1; i < puts.size(); ++i)
+      if (unlikely(keydiff(puts[i - 1], puts[i]) == 0)) {
+        rc = FPTA_KEYEXIST;
+        return;
+      }
+}
+
+/* Изменения вносятся через курсор в порядке возрастания ключей, поэтому
+ * libmdbx не спускается от корня b-tree, если очередной ключ находится
+ * на текущей странице. */
+int fpta_batch_index::apply(MDBX_cursor *mdbx_cursor) const {
+  for (const auto &entry : dels) {
+    MDBX_val se_key = entry.se_key, pk_key = *entry.pk_key;
+    int rc = mdbx_cursor_get(mdbx_cursor, &se_key, &pk_key, MDBX_GET_BOTH);
     if (unlikely(rc != MDBX_SUCCESS))
       return (rc != MDBX_NOTFOUND) ? rc : (int)FPTA_INDEX_CORRUPTED;
+    rc = mdbx_cursor_del(mdbx_cursor, 0);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+  }
+
+  const unsigned flags =
+      unique ? MDBX_NODUPDATA | MDBX_NOOVERWRITE : MDBX_NODUPDATA;
+  for (const auto &entry : puts) {
+    MDBX_val se_key = entry.se_key, pk_key = *entry.pk_key;
+    int rc = mdbx_cursor_put(mdbx_cursor, &se_key, &pk_key, flags);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+  }
+  return FPTA_SUCCESS;
+}
+
+/* Хэш-индекс изменяется по записям, так как соседние ключи попадают
+ * в разные корзины. */
+int fpta_batch_index::apply(MDBX_txn *mdbx_txn, MDBX_dbi dbi) const {
+  assert(hashed && unique);
+  for (const auto &entry : dels) {
+    int rc = fpta_hash_del(mdbx_txn, dbi, entry.se_key, *entry.pk_key);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return (rc != MDBX_NOTFOUND) ? rc : (int)FPTA_INDEX_CORRUPTED;
+  }
+  for (const auto &entry : puts) {
+    int rc = fpta_hash_put(mdbx_txn, dbi, entry.se_key, *entry.pk_key);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+  }
+  return FPTA_SUCCESS;
+}
+
+/* Кол-во потоков, включая вызывающий, для формирования ключей пакета.
+ * Дополнительные потоки запускаются только если работы достаточно,
+ * чтобы окупить их создание. */
+unsigned fpta_batch_workers(const fpta_table_schema *table_def, size_t count,
+                            unsigned threads) {
+  size_t indexes = 0;
+  for (size_t i = 1; i < table_def->column_count(); ++i) {
+    if (!fpta_index_is_secondary(fpta_shove2index(table_def->column_shove(i))))
+      break;
+    ++indexes;
+  }
+
+  cxx11_constexpr_var size_t parallel_threshold = 4096;
+  if (count * indexes < parallel_threshold)
+    return 1;
+  const size_t workers =
+      threads ? threads : std::thread::hardware_concurrency();
+  return (unsigned)std::max(size_t(1), std::min(workers, indexes));
+}
+
+int fpta_secondary_upsert_batch(fpta_txn *txn, fpta_table_schema *table_def,
+                                const fpta_batch_row *rows, size_t count,
+                                unsigned workers) {
+  MDBX_dbi dbi[fpta_max_indexes];
+  int rc = fpta_open_secondaries(txn, table_def, dbi);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  /* Поля строк собираются заранее, так как fpta_row_fields::collect()
+   * изменяет кэш и не может выполняться конкурентно из рабочих потоков. */
+  std::vector<uint64_t> affected(count);
+  uint64_t affected_any = 0;
+  for (size_t n = 0; n < count; ++n) {
+    fpta_row_fields &old_row = *rows[n].old_row, &new_row = *rows[n].new_row;
+    assert(old_row.schema == table_def && new_row.schema == table_def);
+    if (new_row.cached == 0)
+      new_row.collect();
+    if (old_row.present()) {
+      if (old_row.cached == 0)
+        old_row.collect();
+      affected[n] = fpta_secondary_affected(old_row, new_row);
+    } else
+      affected[n] = ~UINT64_C(0);
+    affected_any |= affected[n];
+  }
+
+  std::deque<fpta_batch_index> jobs;
+  for (size_t i = 1; i < table_def->column_count(); ++i) {
+    const auto shove = table_def->column_shove(i);
+    const auto index = fpta_shove2index(shove);
+    assert(i < fpta_max_indexes);
+    if (!fpta_index_is_secondary(index))
+      break;
+    if (!fpta_secondary_skip(affected_any, i))
+      jobs.emplace_back(i, table_def->table_pk(), shove,
+                        table_def->is_hash_index(i));
+  }
+
+  if (workers > jobs.size())
+    workers = (unsigned)jobs.size();
+  if (workers < 2) {
+    /* В одном потоке строки перебираются однократно с формированием
+     * ключей сразу для всех индексов, пока поля строки в кэше. */
+    for (auto &job : jobs)
+      job.reserve(count);
+    for (size_t n = 0; n < count; ++n)
+      for (auto &job : jobs)
+        if (likely(job.rc == FPTA_SUCCESS))
+          job.add(rows[n], affected[n]);
+    for (auto &job : jobs)
+      job.finish();
+  } else {
+    std::atomic<size_t> next(0);
+    const auto worker = [&]() {
+      for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) <
+                     jobs.size();)
+        jobs[i].prepare(rows, affected.data(), count);
+    };
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < workers; ++i) {
+      try {
+        pool.emplace_back(worker);
+      } catch (const std::system_error &) {
+        /* оставшиеся задания выполнит вызывающий поток */
+        break;
+      }
+    }
+    worker();
+    for (auto &thread : pool)
+      thread.join();
+  }
+
+  /* Проверки до внесения изменений, после чего ошибки уже не возможны
+   * без нарушения целостности и требуют прерывания транзакции. */
+  for (const auto &job : jobs) {
+    if (unlikely(job.rc != FPTA_SUCCESS))
+      return job.rc;
+    if (!job.unique)
+      continue;
+    for (const auto &entry : job.puts) {
+      MDBX_val se_key = entry.se_key, pk_exist;
+      rc = job.hashed
+               ? fpta_hash_get(txn->mdbx_txn, dbi[job.column], se_key,
+                               &pk_exist)
+               : mdbx_get(txn->mdbx_txn, dbi[job.column], &se_key, &pk_exist);
+      if (rc == MDBX_SUCCESS && !job.deleted(se_key, &pk_exist))
+        return FPTA_KEYEXIST;
+      if (unlikely(rc != MDBX_SUCCESS && rc != MDBX_NOTFOUND))
+        return rc;
+    }
+  }
+
+  for (const auto &job : jobs) {
+    if (job.hashed) {
+      rc = job.apply(txn->mdbx_txn, dbi[job.column]);
+      if (unlikely(rc != FPTA_SUCCESS))
+        return fpta_internal_abort(txn, rc);
+      continue;
+    }
+    MDBX_cursor *mdbx_cursor;
+    rc = mdbx_cursor_open(txn->mdbx_txn, dbi[job.column], &mdbx_cursor);
+    if (likely(rc == MDBX_SUCCESS)) {
+      rc = job.apply(mdbx_cursor);
+      mdbx_cursor_close(mdbx_cursor);
+    }
+    if (unlikely(rc != FPTA_SUCCESS))
+      return fpta_internal_abort(txn, rc);
   }
 
   return FPTA_SUCCESS;
 }
 
 int fpta_secondary_remove(fpta_txn *txn, fpta_table_schema *table_def,
-                          MDBX_val &pk_key, const fptu_ro &row,
+                          MDBX_val &pk_key, fpta_row_fields &row,
                           const unsigned stepover) {
+  assert(row.schema == table_def);
   MDBX_dbi dbi[fpta_max_indexes];
   int rc = fpta_open_secondaries(txn, table_def, dbi);
   if (unlikely(rc != FPTA_SUCCESS))
@@ -205,11 +612,13 @@ int fpta_secondary_remove(fpta_txn *txn, fpta_table_schema *table_def,
       continue;
 
     fpta_key se_key;
-    rc = fpta_index_row2key(table_def, i, row, se_key, false);
+    rc = fpta_index_row2key(row, i, se_key, false);
     if (unlikely(rc != MDBX_SUCCESS))
       return rc;
 
-    rc = mdbx_del(txn->mdbx_txn, dbi[i], &se_key.mdbx, &pk_key);
+    rc = table_def->is_hash_index(i)
+             ? fpta_hash_del(txn->mdbx_txn, dbi[i], se_key.mdbx, pk_key)
+             : mdbx_del(txn->mdbx_txn, dbi[i], &se_key.mdbx, &pk_key);
     if (unlikely(rc != MDBX_SUCCESS))
       return (rc != MDBX_NOTFOUND) ? rc : (int)FPTA_INDEX_CORRUPTED;
   }
@@ -346,6 +755,9 @@ int fpta_table_info_ex(fpta_txn *txn, fpta_name *table_id, size_t *row_count,
             mdbx_dbi_stat(txn->mdbx_txn, dbi[i], &mdbx_stat, sizeof(mdbx_stat));
         if (unlikely(rc != MDBX_SUCCESS))
           return rc;
+        if (table_id->table_schema->is_hash_index(i))
+          /* элементами дерева хэш-индекса являются корзины */
+          mdbx_stat.ms_entries = stat->row_count;
 
         if (fpta_index_is_unique(shove)) {
           uniq_total_items += size_t(mdbx_stat.ms_entries);
@@ -438,6 +850,85 @@ int fpta_table_sequence(fpta_txn *txn, fpta_name *table_id, uint64_t *result,
   return rc;
 }
 
+namespace {
+struct fpta_changes_walker {
+  fpta_txn *txn;
+  MDBX_dbi handle;
+  MDBX_cursor *mdbx_cursor;
+  size_t count;
+  int (*visitor)(const fptu_ro *row, void *context, void *arg);
+  void *visitor_context;
+  void *visitor_arg;
+  int rc;
+
+  int leaf(const MDBX_val *first_key, const MDBX_val *last_key);
+};
+
+int fpta_changes_walker::leaf(const MDBX_val *first_key,
+                              const MDBX_val *last_key) {
+  MDBX_val key = *first_key;
+  fptu_ro row;
+  rc = mdbx_cursor_get(mdbx_cursor, &key, &row.sys, MDBX_SET_RANGE);
+  while (likely(rc == MDBX_SUCCESS) &&
+         mdbx_cmp(txn->mdbx_txn, handle, &key, last_key) <= 0) {
+    rc = visitor(&row, visitor_context, visitor_arg);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return MDBX_RESULT_TRUE;
+    ++count;
+    rc = mdbx_cursor_get(mdbx_cursor, &key, &row.sys, MDBX_NEXT);
+  }
+
+  if (likely(rc == MDBX_SUCCESS || rc == MDBX_NOTFOUND)) {
+    rc = FPTA_SUCCESS;
+    return MDBX_SUCCESS;
+  }
+  return MDBX_RESULT_TRUE;
+}
+
+int fpta_changes_leaf(void *ctx, const MDBX_val *first_key,
+                      const MDBX_val *last_key, uint64_t page_txnid) {
+  (void)page_txnid;
+  return static_cast<fpta_changes_walker *>(ctx)->leaf(first_key, last_key);
+}
+} // namespace
+
+int fpta_table_changes_since(
+    fpta_txn *txn, fpta_name *table_id, uint64_t since_version, size_t *count,
+    int (*visitor)(const fptu_ro *row, void *context, void *arg),
+    void *visitor_context, void *visitor_arg) {
+  if (count)
+    *count = 0;
+  if (unlikely(!visitor))
+    return FPTA_EINVAL;
+
+  int rc = fpta_name_refresh_couple(txn, table_id, nullptr);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  fpta_changes_walker walker;
+  walker.txn = txn;
+  rc = fpta_open_table(txn, table_id->table_schema, walker.handle);
+  if (unlikely(rc != FPTA_SUCCESS))
+    return rc;
+
+  rc = mdbx_cursor_open(txn->mdbx_txn, walker.handle, &walker.mdbx_cursor);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  walker.count = 0;
+  walker.visitor = visitor;
+  walker.visitor_context = visitor_context;
+  walker.visitor_arg = visitor_arg;
+  walker.rc = FPTA_SUCCESS;
+  rc = mdbx_dbi_changed_leaves(txn->mdbx_txn, walker.handle, since_version,
+                               fpta_changes_leaf, &walker);
+  mdbx_cursor_close(walker.mdbx_cursor);
+
+  if (count)
+    *count = walker.count;
+  return (rc == MDBX_SUCCESS) ? walker.rc : rc;
+}
+
 int fpta_table_clear(fpta_txn *txn, fpta_name *table_id, bool reset_sequence) {
   int rc = fpta_name_refresh_couple(txn, table_id, nullptr);
   if (unlikely(rc != FPTA_SUCCESS))
@@ -484,5 +975,14 @@ int fpta_table_clear(fpta_txn *txn, fpta_name *table_id, bool reset_sequence) {
       return fpta_internal_abort(txn, rc);
   }
 
+  if (fpta_changelog_enabled(txn->db)) {
+    MDBX_val nil;
+    nil.iov_base = const_cast<char *>(&fpta_NIL);
+    nil.iov_len = 0;
+    rc = fpta_changelog_record(txn, table_def, fpta_change_clear, nil, nullptr);
+    if (unlikely(rc != FPTA_SUCCESS))
+      return fpta_internal_abort(txn, rc);
+  }
+
   return FPTA_SUCCESS;
 }
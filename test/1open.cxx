@@ -17,6 +17,11 @@
 
 #include "fpta_test.h"
 
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <thread>
+
 static const char testdb_name[] = TEST_DB_DIR "ut_open.fpta";
 static const char testdb_name_lck[] =
     TEST_DB_DIR "ut_open.fpta" MDBX_LOCK_SUFFIX;
@@ -258,6 +263,168 @@ TEST(Open, MultipleProcesses_ChangeGeometry) {
   }
 }
 
+TEST(Open, AsyncDurability) {
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime_default,
+                                  1, true, &db));
+  ASSERT_NE(nullptr, db);
+  // фоновая синхронизация доступна только в режиме fpta_async
+  EXPECT_EQ(FPTA_EFLAG, fpta_db_async_lag(db, 1024, 10));
+  fpta_db_stat_t stat;
+  ASSERT_EQ(FPTA_OK, fpta_db_info(db, nullptr, &stat));
+  EXPECT_EQ(fpta_weak, stat.durability);
+  EXPECT_EQ(0u, stat.async.lag_bytes);
+  EXPECT_EQ(FPTA_SUCCESS, fpta_db_close(db));
+
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_async,
+                                  fpta_regime_default, 1, true, &db));
+  ASSERT_NE(nullptr, db);
+  ASSERT_EQ(FPTA_OK, fpta_db_info(db, nullptr, &stat));
+  EXPECT_EQ(fpta_async, stat.durability);
+  std::ostringstream text;
+  text << stat.durability;
+  EXPECT_EQ("mode-async", text.str());
+  EXPECT_EQ(unsigned(fpta_async_lag_bytes_default), stat.async.lag_bytes);
+  EXPECT_EQ(FPTA_OK, stat.async.last_error);
+
+  EXPECT_EQ(FPTA_EINVAL, fpta_db_async_lag(nullptr, 1024, 10));
+  EXPECT_EQ(FPTA_EINVAL, fpta_db_async_lag(db, 0, 0));
+  EXPECT_EQ(FPTA_OK, fpta_db_async_lag(db, 0, 20));
+  ASSERT_EQ(FPTA_OK, fpta_db_info(db, nullptr, &stat));
+  EXPECT_EQ(0u, stat.async.lag_bytes);
+  EXPECT_EQ((20u << 16) / 1000, stat.async.lag_period_seconds16dot16);
+
+  // изменения фиксируются без синхронизации с диском
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("pk", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  fpta_txn *txn = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  EXPECT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+
+  // фоновый поток должен догнать последнюю транзакцию
+  for (int i = 0; i < 500; ++i) {
+    ASSERT_EQ(FPTA_OK, fpta_db_info(db, nullptr, &stat));
+    if (stat.unsync_volume == 0 && stat.async.flushes > 0)
+      break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(0u, stat.unsync_volume);
+  EXPECT_LT(0u, stat.async.flushes);
+  EXPECT_EQ(FPTA_OK, stat.async.last_error);
+
+  EXPECT_EQ(FPTA_SUCCESS, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+TEST(Open, WaitDurable) {
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_lazy, fpta_regime_default,
+                                  1, true, &db));
+  ASSERT_NE(nullptr, db);
+  EXPECT_EQ(FPTA_EINVAL, fpta_db_wait_durable(nullptr, 1, 0));
+  EXPECT_EQ(FPTA_OK, fpta_db_wait_durable(db, 0, 0));
+
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("pk", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  fpta_txn *txn = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  EXPECT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+  uint64_t created = 0;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end_ex(txn, false, &created));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+  EXPECT_LT(0u, created);
+
+  // для отмененной транзакции ожидать нечего
+  uint64_t version = ~0ull;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+  ASSERT_NE(nullptr, txn);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end_ex(txn, true, &version));
+  EXPECT_EQ(0u, version);
+
+  // читающая транзакция возвращает версию прочитанного снимка
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  ASSERT_NE(nullptr, txn);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end_ex(txn, false, &version));
+  EXPECT_EQ(created, version);
+
+  fpta_db_stat_t stat;
+  ASSERT_EQ(FPTA_OK, fpta_db_info(db, nullptr, &stat));
+  EXPECT_LT(0u, stat.unsync_volume);
+  EXPECT_EQ(FPTA_OK, fpta_db_wait_durable(db, created, 1000));
+  ASSERT_EQ(FPTA_OK, fpta_db_info(db, nullptr, &stat));
+  EXPECT_EQ(0u, stat.unsync_volume);
+  // повторное ожидание и версии из "будущего" не требуют синхронизации
+  EXPECT_EQ(FPTA_OK, fpta_db_wait_durable(db, created, 0));
+  EXPECT_EQ(FPTA_OK, fpta_db_wait_durable(db, created + 42, 0));
+
+  // одновременные ожидания из нескольких потоков
+  fpta_name table, col_pk;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_pk, "pk"));
+  std::vector<std::thread> threads;
+  std::atomic<int> failures(0);
+  for (unsigned n = 0; n < 4; ++n)
+    threads.emplace_back([&, n]() {
+      for (unsigned i = 0; i < 16; ++i) {
+        fpta_txn *txn = nullptr;
+        int rc = fpta_transaction_begin(db, fpta_write, &txn);
+        if (rc == FPTA_OK)
+          rc = fpta_name_refresh_couple(txn, &table, &col_pk);
+        fptu_rw *row = fptu_alloc(1, 8);
+        if (rc == FPTA_OK)
+          rc = fpta_upsert_column(row, &col_pk,
+                                  fpta_value_uint(n * 1000 + i));
+        if (rc == FPTA_OK)
+          rc = fpta_insert_row(txn, &table, fptu_take_noshrink(row));
+        free(row);
+        uint64_t committed = 0;
+        if (txn) {
+          const int err = fpta_transaction_end_ex(txn, rc != FPTA_OK,
+                                                  &committed);
+          rc = (rc == FPTA_OK) ? err : rc;
+        }
+        if (rc == FPTA_OK)
+          rc = fpta_db_wait_durable(db, committed, 10000);
+        if (rc != FPTA_OK)
+          failures += 1;
+      }
+    });
+  for (auto &thread : threads)
+    thread.join();
+  EXPECT_EQ(0, failures.load());
+
+  fpta_name_destroy(&col_pk);
+  fpta_name_destroy(&table);
+  EXPECT_EQ(FPTA_SUCCESS, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   mdbx_setup_debug(MDBX_LOG_WARN,
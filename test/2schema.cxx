@@ -16,6 +16,7 @@
  */
 
 #include "fpta_test.h"
+#include <sstream>
 
 static const char testdb_name[] = TEST_DB_DIR "ut_schema.fpta";
 static const char testdb_name_lck[] =
@@ -1239,6 +1240,191 @@ TEST(Schema, SameNames) {
 
 //----------------------------------------------------------------------------
 
+static int export_json_collector(void *emiter_ctx, const char *text,
+                                 size_t length) {
+  std::vector<std::string> *chunks =
+      static_cast<std::vector<std::string> *>(emiter_ctx);
+  chunks->emplace_back(text, length);
+  return FPTA_SUCCESS;
+}
+
+TEST(Schema, ExportJson) {
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_SUCCESS, test_db_open(testdb_name, fpta_weak,
+                                       fpta_regime_default, 1, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("id", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("name", fptu_cstr, fpta_index_none, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("value", fptu_fp64, fpta_index_none, &def));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_validate(&def));
+
+  fpta_txn *txn = (fpta_txn *)&txn;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  EXPECT_EQ(FPTA_OK, fpta_table_create(txn, "export", &def));
+  EXPECT_EQ(FPTA_OK, fpta_table_create(txn, "other", &def));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  txn = nullptr;
+
+  //------------------------------------------------------------------------
+  // заполняем таблицу так, чтобы вывод превышал размер порции
+  fpta_name table, col_id, col_name, col_value;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "export"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_id, "id"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_name, "name"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_value, "value"));
+
+  const unsigned rows = 3000;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+  ASSERT_NE(nullptr, txn);
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &col_id));
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_name));
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_value));
+  fptu_rw *pt = fptu_alloc(3, 128);
+  ASSERT_NE(nullptr, pt);
+  for (unsigned i = 0; i < rows; ++i) {
+    EXPECT_EQ(FPTU_OK, fptu_clear(pt));
+    const std::string name = fptu::format("row-%u-with-some-padding", i);
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_id, fpta_value_uint(i)));
+    EXPECT_EQ(FPTA_OK,
+              fpta_upsert_column(pt, &col_name, fpta_value_str(name)));
+    EXPECT_EQ(FPTA_OK,
+              fpta_upsert_column(pt, &col_value, fpta_value_float(i / 4.0)));
+    ASSERT_EQ(FPTA_OK, fpta_insert_row(txn, &table, fptu_take_noshrink(pt)));
+  }
+  free(pt);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  txn = nullptr;
+
+  //------------------------------------------------------------------------
+  // строим таблицу имен и выгружаем
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  ASSERT_NE(nullptr, txn);
+
+  fpta_name other;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&other, "other"));
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &table));
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &other));
+
+  fpta_schema_info schema_info;
+  EXPECT_EQ(FPTA_OK, fpta_schema_fetch(txn, &schema_info));
+  ASSERT_EQ(2u, schema_info.tables_count);
+  fpta_json_names *right = nullptr, *wrong = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_json_names_build(&schema_info, &table, &right));
+  ASSERT_NE(nullptr, right);
+  EXPECT_EQ(FPTA_OK, fpta_json_names_build(&schema_info, &other, &wrong));
+  ASSERT_NE(nullptr, wrong);
+  EXPECT_EQ(FPTA_OK, fpta_schema_destroy(&schema_info));
+  fpta_name_destroy(&other);
+
+  std::vector<std::string> chunks;
+  size_t count = 0;
+  EXPECT_EQ(FPTA_EINVAL,
+            fpta_table_export_json(txn, &col_id, fpta_value_begin(),
+                                   fpta_value_end(), nullptr, fpta_ascending,
+                                   wrong, export_json_collector, &chunks,
+                                   &count));
+  EXPECT_TRUE(chunks.empty());
+
+  EXPECT_EQ(FPTA_OK,
+            fpta_table_export_json(txn, &col_id, fpta_value_begin(),
+                                   fpta_value_end(), nullptr, fpta_ascending,
+                                   right, export_json_collector, &chunks,
+                                   &count));
+  EXPECT_EQ(rows, count);
+  EXPECT_LT(1u, chunks.size());
+
+  std::string ndjson;
+  for (const auto &chunk : chunks) {
+    EXPECT_EQ('\n', chunk.back());
+    ndjson += chunk;
+  }
+  EXPECT_EQ(rows, (size_t)std::count(ndjson.begin(), ndjson.end(), '\n'));
+
+  // сверяем построчно с результатом сериализации через tag2name
+  std::istringstream lines(ndjson);
+  std::string line;
+  fpta_cursor *cursor = nullptr;
+  EXPECT_EQ(FPTA_OK,
+            fpta_cursor_open(txn, &col_id, fpta_value_begin(),
+                             fpta_value_end(), nullptr, fpta_ascending,
+                             &cursor));
+  ASSERT_NE(nullptr, cursor);
+  for (unsigned i = 0; i < rows; ++i) {
+    ASSERT_TRUE(bool(std::getline(lines, line)));
+    fptu_ro row;
+    ASSERT_EQ(FPTA_OK, fpta_cursor_get(cursor, &row));
+    const std::string reference = fptu::tuple2json(
+        row, nullptr, 0, nullptr,
+        [](const void *, unsigned tag) -> const char * {
+          static const char *const names[] = {"id", "name", "value"};
+          return names[fptu_get_colnum(tag)];
+        },
+        nullptr);
+    ASSERT_EQ(reference, line);
+    const int move_rc = fpta_cursor_move(cursor, fpta_next);
+    ASSERT_EQ((i + 1 < rows) ? FPTA_OK : FPTA_NODATA, move_rc);
+  }
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+
+  // пустой диапазон
+  chunks.clear();
+  EXPECT_EQ(FPTA_OK,
+            fpta_table_export_json(txn, &col_id, fpta_value_uint(rows),
+                                   fpta_value_end(), nullptr, fpta_ascending,
+                                   right, export_json_collector, &chunks,
+                                   &count));
+  EXPECT_EQ(0u, count);
+  EXPECT_TRUE(chunks.empty());
+
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  txn = nullptr;
+
+  //------------------------------------------------------------------------
+  // после пересоздания таблицы имена должны считаться устаревшими
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  EXPECT_EQ(FPTA_OK, fpta_table_drop(txn, "export"));
+  EXPECT_EQ(FPTA_OK, fpta_table_create(txn, "export", &def));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  txn = nullptr;
+
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  ASSERT_NE(nullptr, txn);
+  EXPECT_EQ(FPTA_SCHEMA_CHANGED,
+            fpta_table_export_json(txn, &col_id, fpta_value_begin(),
+                                   fpta_value_end(), nullptr, fpta_ascending,
+                                   right, export_json_collector, &chunks,
+                                   &count));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  txn = nullptr;
+
+  EXPECT_EQ(FPTA_OK, fpta_json_names_destroy(right));
+  EXPECT_EQ(FPTA_OK, fpta_json_names_destroy(wrong));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+  fpta_name_destroy(&table);
+  fpta_name_destroy(&col_id);
+  fpta_name_destroy(&col_name);
+  fpta_name_destroy(&col_value);
+  EXPECT_EQ(FPTA_SUCCESS, fpta_db_close(db));
+}
+
+//----------------------------------------------------------------------------
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -22,6 +22,7 @@
 #include "fpta_test.h"
 #include "tools.hpp"
 #include <chrono>
+#include <thread>
 
 static const char testdb_name[] = TEST_DB_DIR "ut_smoke.fpta";
 static const char testdb_name_lck[] =
@@ -6080,6 +6081,3354 @@ TEST(Smoke, DISABLED_IndexCosts) {
 
 //----------------------------------------------------------------------------
 
+TEST(Smoke, RowCache) {
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime_default,
+                                  1, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("pk", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("code", fptu_cstr,
+                                 fpta_secondary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("value", fptu_int64, fpta_index_none, &def));
+  ASSERT_EQ(FPTA_OK, fpta_column_set_validate(&def));
+
+  fpta_txn *txn = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+  txn = nullptr;
+
+  fpta_db_stat_t stat;
+  EXPECT_EQ(FPTA_OK, fpta_db_info(db, nullptr, &stat));
+  EXPECT_EQ(0u, stat.row_cache.capacity);
+  EXPECT_EQ(FPTA_EINVAL, fpta_db_row_cache(nullptr, 42));
+  EXPECT_EQ(FPTA_OK, fpta_db_row_cache(db, 100));
+  EXPECT_EQ(FPTA_OK, fpta_db_info(db, nullptr, &stat));
+  EXPECT_EQ(128u, stat.row_cache.capacity);
+  EXPECT_EQ(0u, stat.row_cache.hits + stat.row_cache.misses);
+
+  fpta_name table, col_pk, col_code, col_value;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_pk, "pk"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_code, "code"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_value, "value"));
+
+  const unsigned rows = 10;
+  fptu_rw *pt = fptu_alloc(3, 64);
+  ASSERT_NE(nullptr, pt);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+  ASSERT_NE(nullptr, txn);
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &col_pk));
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_code));
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_value));
+  for (unsigned i = 0; i < rows; ++i) {
+    EXPECT_EQ(FPTU_OK, fptu_clear(pt));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_pk, fpta_value_uint(i)));
+    EXPECT_EQ(FPTA_OK,
+              fpta_upsert_column(pt, &col_code,
+                                 fpta_value_str(fptu::format("code-%u", i))));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_value, fpta_value_sint(i)));
+    EXPECT_EQ(FPTA_OK, fpta_insert_row(txn, &table, fptu_take_noshrink(pt)));
+  }
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  txn = nullptr;
+
+  auto fetch_value = [&](fpta_txn *txn, fpta_name *column,
+                         const fpta_value &key) -> int64_t {
+    fptu_ro row;
+    int rc = fpta_get(txn, column, &key, &row);
+    EXPECT_EQ(FPTA_OK, rc);
+    if (rc != FPTA_OK)
+      return -1;
+    fpta_value value;
+    EXPECT_EQ(FPTA_OK, fpta_get_column(row, &col_value, &value));
+    return value.sint;
+  };
+
+  // первое чтение заполняет кэш, повторное должно попадать в кэш
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  ASSERT_NE(nullptr, txn);
+  for (int pass = 0; pass < 2; ++pass)
+    for (unsigned i = 0; i < rows; ++i)
+      EXPECT_EQ(int64_t(i), fetch_value(txn, &col_pk, fpta_value_uint(i)));
+  EXPECT_EQ(FPTA_OK, fpta_db_info(nullptr, txn, &stat));
+  EXPECT_EQ(rows, stat.row_cache.misses);
+  EXPECT_EQ(rows, stat.row_cache.hits);
+
+  // чтение по уникальному вторичному индексу использует кэш для PK
+  EXPECT_EQ(3, fetch_value(txn, &col_code, fpta_value_cstr("code-3")));
+  EXPECT_EQ(FPTA_OK, fpta_db_info(db, nullptr, &stat));
+  EXPECT_EQ(rows + 1, stat.row_cache.hits);
+
+  // оставляем читателя со старым снимком и изменяем строку в другом потоке,
+  // так как libmdbx не допускает пересечения транзакций в одном потоке
+  fpta_txn *old_reader = txn;
+  txn = nullptr;
+  std::thread([&]() {
+    fpta_txn *txn = nullptr;
+    EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+    ASSERT_NE(nullptr, txn);
+    EXPECT_EQ(FPTU_OK, fptu_clear(pt));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_pk, fpta_value_uint(5)));
+    EXPECT_EQ(FPTA_OK,
+              fpta_upsert_column(pt, &col_code, fpta_value_cstr("code-5")));
+    EXPECT_EQ(FPTA_OK,
+              fpta_upsert_column(pt, &col_value, fpta_value_sint(42)));
+    EXPECT_EQ(FPTA_OK, fpta_update_row(txn, &table, fptu_take_noshrink(pt)));
+    // пишущие транзакции не используют кэш
+    EXPECT_EQ(42, fetch_value(txn, &col_pk, fpta_value_uint(5)));
+    EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  }).join();
+  EXPECT_EQ(FPTA_OK, fpta_db_info(db, nullptr, &stat));
+  EXPECT_EQ(rows + 1, stat.row_cache.hits);
+  EXPECT_EQ(rows, stat.row_cache.misses);
+
+  // новый читатель должен видеть новое значение, а старый - прежнее
+  auto new_reader = [&]() {
+    fpta_txn *txn = nullptr;
+    EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+    ASSERT_NE(nullptr, txn);
+    EXPECT_EQ(42, fetch_value(txn, &col_pk, fpta_value_uint(5)));
+    EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  };
+  std::thread(new_reader).join();
+  EXPECT_EQ(5, fetch_value(old_reader, &col_pk, fpta_value_uint(5)));
+  std::thread(new_reader).join();
+  EXPECT_EQ(FPTA_OK, fpta_db_info(db, nullptr, &stat));
+  EXPECT_EQ(rows + 2, stat.row_cache.hits);
+  EXPECT_EQ(rows + 2, stat.row_cache.misses);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(old_reader, false));
+
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  ASSERT_NE(nullptr, txn);
+  EXPECT_EQ(1, fetch_value(txn, &col_pk, fpta_value_uint(1)));
+  fptu_ro row;
+  const fpta_value absent = fpta_value_uint(rows);
+  EXPECT_EQ(FPTA_NOTFOUND, fpta_get(txn, &col_pk, &absent, &row));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  txn = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_db_info(db, nullptr, &stat));
+  EXPECT_EQ(rows + 2, stat.row_cache.hits);
+  EXPECT_EQ(rows + 4, stat.row_cache.misses);
+
+  // выключаем кэш
+  EXPECT_EQ(FPTA_OK, fpta_db_row_cache(db, 0));
+  EXPECT_EQ(FPTA_OK, fpta_db_info(db, nullptr, &stat));
+  EXPECT_EQ(0u, stat.row_cache.capacity);
+  EXPECT_EQ(0u, stat.row_cache.hits);
+  EXPECT_EQ(FPTA_OK, fpta_db_row_cache(db, 1));
+
+  free(pt);
+  fpta_name_destroy(&table);
+  fpta_name_destroy(&col_pk);
+  fpta_name_destroy(&col_code);
+  fpta_name_destroy(&col_value);
+  EXPECT_EQ(FPTA_SUCCESS, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+TEST(Smoke, PreparedGet) {
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime_default,
+                                  1, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("pk", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("code", fptu_cstr,
+                                 fpta_secondary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("value", fptu_int64, fpta_index_none, &def));
+  ASSERT_EQ(FPTA_OK, fpta_column_set_validate(&def));
+
+  fpta_txn *txn = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  txn = nullptr;
+
+  fpta_name table, col_pk, col_code, col_value;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_pk, "pk"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_code, "code"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_value, "value"));
+
+  const unsigned rows = 10;
+  fptu_rw *pt = fptu_alloc(3, 64);
+  ASSERT_NE(nullptr, pt);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+  ASSERT_NE(nullptr, txn);
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &col_pk));
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_code));
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_value));
+  for (unsigned i = 0; i < rows; ++i) {
+    EXPECT_EQ(FPTU_OK, fptu_clear(pt));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_pk, fpta_value_uint(i)));
+    EXPECT_EQ(FPTA_OK,
+              fpta_upsert_column(pt, &col_code,
+                                 fpta_value_str(fptu::format("code-%u", i))));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_value, fpta_value_sint(i)));
+    EXPECT_EQ(FPTA_OK, fpta_insert_row(txn, &table, fptu_take_noshrink(pt)));
+  }
+
+  // подготовка для неуникального и неиндексированного столбца невозможна
+  fpta_prepared_get *by_pk = nullptr, *by_code = nullptr;
+  EXPECT_EQ(FPTA_EINVAL, fpta_prepare_get(txn, &col_pk, nullptr));
+  EXPECT_EQ(FPTA_NO_INDEX, fpta_prepare_get(txn, &col_value, &by_pk));
+  EXPECT_EQ(nullptr, by_pk);
+  EXPECT_EQ(FPTA_OK, fpta_prepare_get(txn, &col_pk, &by_pk));
+  ASSERT_NE(nullptr, by_pk);
+  EXPECT_EQ(FPTA_OK, fpta_prepare_get(txn, &col_code, &by_code));
+  ASSERT_NE(nullptr, by_code);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  txn = nullptr;
+
+  auto fetch_value = [&](fpta_txn *txn, fpta_prepared_get *prepared,
+                         const fpta_value &key) -> int64_t {
+    fptu_ro row;
+    int rc = fpta_get_prepared(txn, prepared, &key, &row);
+    EXPECT_EQ(FPTA_OK, rc);
+    if (rc != FPTA_OK)
+      return -1;
+    fpta_value value;
+    EXPECT_EQ(FPTA_OK, fpta_get_column(row, &col_value, &value));
+    return value.sint;
+  };
+
+  // подготовленные дескрипторы используются в последующих транзакциях
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  ASSERT_NE(nullptr, txn);
+  for (unsigned i = 0; i < rows; ++i) {
+    EXPECT_EQ(int64_t(i), fetch_value(txn, by_pk, fpta_value_uint(i)));
+    EXPECT_EQ(int64_t(i),
+              fetch_value(txn, by_code,
+                          fpta_value_str(fptu::format("code-%u", i))));
+  }
+  fptu_ro row;
+  const fpta_value absent = fpta_value_uint(rows);
+  EXPECT_EQ(FPTA_NOTFOUND, fpta_get_prepared(txn, by_pk, &absent, &row));
+  const fpta_value mistype = fpta_value_cstr("42");
+  EXPECT_EQ(FPTA_ETYPE, fpta_get_prepared(txn, by_pk, &mistype, &row));
+  EXPECT_EQ(FPTA_EINVAL, fpta_get_prepared(txn, nullptr, &absent, &row));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  txn = nullptr;
+
+  // изменение схемы требует перепривязки, которая выполняется автоматически
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("id", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "other", &def));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+  txn = nullptr;
+
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  ASSERT_NE(nullptr, txn);
+  EXPECT_EQ(7, fetch_value(txn, by_pk, fpta_value_uint(7)));
+  EXPECT_EQ(3, fetch_value(txn, by_code, fpta_value_cstr("code-3")));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  txn = nullptr;
+
+  // после удаления таблицы дескрипторы возвращают ошибку
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  EXPECT_EQ(FPTA_OK, fpta_table_drop(txn, "table"));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  txn = nullptr;
+
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  ASSERT_NE(nullptr, txn);
+  const fpta_value key = fpta_value_uint(1);
+  EXPECT_EQ(FPTA_NOTFOUND, fpta_get_prepared(txn, by_pk, &key, &row));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  txn = nullptr;
+
+  EXPECT_EQ(FPTA_OK, fpta_prepared_get_destroy(by_pk));
+  EXPECT_EQ(FPTA_OK, fpta_prepared_get_destroy(by_code));
+  EXPECT_EQ(FPTA_EINVAL, fpta_prepared_get_destroy(nullptr));
+
+  free(pt);
+  fpta_name_destroy(&table);
+  fpta_name_destroy(&col_pk);
+  fpta_name_destroy(&col_code);
+  fpta_name_destroy(&col_value);
+  EXPECT_EQ(FPTA_SUCCESS, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+TEST(Smoke, GetMany) {
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime_default,
+                                  1, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("pk", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("code", fptu_cstr,
+                                 fpta_secondary_unique_unordered, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("value", fptu_int64, fpta_index_none, &def));
+  ASSERT_EQ(FPTA_OK, fpta_column_set_validate(&def));
+
+  fpta_txn *txn = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+  txn = nullptr;
+
+  fpta_name table, col_pk, col_code, col_value;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_pk, "pk"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_code, "code"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_value, "value"));
+
+  // вставляем только четные ключи, нечетные используются для промахов
+  const unsigned rows = 1000;
+  fptu_rw *pt = fptu_alloc(3, 64);
+  ASSERT_NE(nullptr, pt);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+  ASSERT_NE(nullptr, txn);
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &col_pk));
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_code));
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_value));
+  for (unsigned i = 0; i < rows; i += 2) {
+    EXPECT_EQ(FPTU_OK, fptu_clear(pt));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_pk, fpta_value_uint(i)));
+    EXPECT_EQ(FPTA_OK,
+              fpta_upsert_column(pt, &col_code,
+                                 fpta_value_str(fptu::format("code-%u", i))));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_value, fpta_value_sint(i)));
+    EXPECT_EQ(FPTA_OK, fpta_insert_row(txn, &table, fptu_take_noshrink(pt)));
+  }
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  txn = nullptr;
+
+  // ключи в произвольном порядке, включая повторы и промахи
+  std::vector<unsigned> order;
+  for (unsigned i = 0; i < rows; ++i)
+    order.push_back((i * 7919u + 13) % rows);
+  order.push_back(order.front());
+  order.push_back(order.back());
+  const size_t n = order.size();
+
+  std::vector<std::string> codes(n);
+  std::vector<fpta_value> by_pk(n), by_code(n);
+  for (size_t i = 0; i < n; ++i) {
+    codes[i] = fptu::format("code-%u", order[i]);
+    by_pk[i] = fpta_value_uint(order[i]);
+    by_code[i] = fpta_value_str(codes[i]);
+  }
+
+  std::vector<fptu_ro> got(n);
+  std::vector<int> errors(n);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  ASSERT_NE(nullptr, txn);
+  EXPECT_EQ(FPTA_EINVAL,
+            fpta_get_many(txn, &col_pk, by_pk.data(), n, nullptr, nullptr));
+  EXPECT_EQ(FPTA_OK,
+            fpta_get_many(txn, &col_pk, nullptr, 0, nullptr, nullptr));
+  EXPECT_EQ(FPTA_NO_INDEX, fpta_get_many(txn, &col_value, by_pk.data(), n,
+                                         got.data(), errors.data()));
+
+  for (fpta_name *column : {&col_pk, &col_code}) {
+    const std::vector<fpta_value> &keys = (column == &col_pk) ? by_pk : by_code;
+    int first_error = FPTA_OK;
+    for (size_t i = 0; i < n && first_error == FPTA_OK; ++i)
+      if (order[i] & 1)
+        first_error = FPTA_NOTFOUND;
+    EXPECT_EQ(first_error, fpta_get_many(txn, column, keys.data(), n,
+                                         got.data(), errors.data()));
+    for (size_t i = 0; i < n; ++i) {
+      fptu_ro row;
+      const int rc = fpta_get(txn, column, &keys[i], &row);
+      EXPECT_EQ(rc, errors[i]);
+      if (order[i] & 1) {
+        EXPECT_EQ(FPTA_NOTFOUND, errors[i]);
+        EXPECT_EQ(nullptr, got[i].units);
+        continue;
+      }
+      ASSERT_EQ(FPTA_OK, errors[i]);
+      EXPECT_EQ(row.units, got[i].units);
+      EXPECT_EQ(row.total_bytes, got[i].total_bytes);
+      fpta_value value;
+      EXPECT_EQ(FPTA_OK, fpta_get_column(got[i], &col_value, &value));
+      EXPECT_EQ(int64_t(order[i]), value.sint);
+    }
+  }
+
+  // ошибка в отдельном значении не прерывает обработку остальных
+  by_pk[1] = fpta_value_sint(-1);
+  EXPECT_EQ(order[0] & 1 ? FPTA_NOTFOUND : FPTA_EVALUE,
+            fpta_get_many(txn, &col_pk, by_pk.data(), n, got.data(),
+                          errors.data()));
+  EXPECT_EQ(FPTA_EVALUE, errors[1]);
+  EXPECT_EQ(order[2] & 1 ? FPTA_NOTFOUND : FPTA_OK, errors[2]);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  txn = nullptr;
+
+  free(pt);
+  fpta_name_destroy(&table);
+  fpta_name_destroy(&col_pk);
+  fpta_name_destroy(&col_code);
+  fpta_name_destroy(&col_value);
+  EXPECT_EQ(FPTA_SUCCESS, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+TEST(Smoke, Metrics) {
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime_default,
+                                  4, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  size_t count = 0;
+  EXPECT_EQ(FPTA_EINVAL, fpta_db_metrics(nullptr, nullptr, &count));
+  EXPECT_EQ(FPTA_EINVAL, fpta_db_metrics(db, nullptr, nullptr));
+  EXPECT_EQ(FPTA_OK, fpta_db_metrics(db, nullptr, &count));
+  EXPECT_EQ(0u, count);
+
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("pk", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("code", fptu_cstr,
+                                 fpta_secondary_unique_ordered_obverse, &def));
+  ASSERT_EQ(FPTA_OK, fpta_column_set_validate(&def));
+
+  fpta_txn *txn = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+  txn = nullptr;
+
+  fpta_name table, col_pk, col_code;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_pk, "pk"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_code, "code"));
+
+  const unsigned rows = 10;
+  fptu_rw *pt = fptu_alloc(2, 64);
+  ASSERT_NE(nullptr, pt);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+  ASSERT_NE(nullptr, txn);
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &col_pk));
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_code));
+  for (unsigned i = 0; i < rows; ++i) {
+    EXPECT_EQ(FPTU_OK, fptu_clear(pt));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_pk, fpta_value_uint(i)));
+    EXPECT_EQ(FPTA_OK,
+              fpta_upsert_column(pt, &col_code,
+                                 fpta_value_str(fptu::format("code-%u", i))));
+    EXPECT_EQ(FPTA_OK, fpta_insert_row(txn, &table, fptu_take_noshrink(pt)));
+  }
+  fptu_ro row;
+  const fpta_value key = fpta_value_uint(0);
+  EXPECT_EQ(FPTA_OK, fpta_get(txn, &col_pk, &key, &row));
+  EXPECT_EQ(FPTA_OK, fpta_delete(txn, &table, row));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  txn = nullptr;
+
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  ASSERT_NE(nullptr, txn);
+  const fpta_value code = fpta_value_cstr("code-5");
+  EXPECT_EQ(FPTA_OK, fpta_get(txn, &col_code, &code, &row));
+  EXPECT_EQ(FPTA_NOTFOUND, fpta_get(txn, &col_pk, &key, &row));
+
+  fpta_cursor *cursor = nullptr;
+  EXPECT_EQ(FPTA_OK,
+            fpta_cursor_open(txn, &col_code, fpta_value_begin(),
+                             fpta_value_end(), nullptr,
+                             fpta_unsorted_dont_fetch, &cursor));
+  ASSERT_NE(nullptr, cursor);
+  size_t cursor_rows = 0;
+  for (int rc = fpta_cursor_move(cursor, fpta_first); rc == FPTA_OK;
+       rc = fpta_cursor_move(cursor, fpta_next))
+    ++cursor_rows;
+  EXPECT_EQ(rows - 1, cursor_rows);
+  fpta_cursor_stat cursor_stat;
+  EXPECT_EQ(FPTA_OK, fpta_cursor_info(cursor, &cursor_stat));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  txn = nullptr;
+
+  // снимок: по одному элементу для первичного и вторичного индексов
+  count = 0;
+  EXPECT_EQ(FPTA_DATALEN_MISMATCH, fpta_db_metrics(db, nullptr, &count));
+  EXPECT_EQ(2u, count);
+  fpta_metrics_item items[4];
+  count = 4;
+  EXPECT_EQ(FPTA_OK, fpta_db_metrics(db, items, &count));
+  ASSERT_EQ(2u, count);
+  const fpta_metrics_item *by_pk = nullptr, *by_code = nullptr;
+  for (size_t i = 0; i < count; ++i) {
+    EXPECT_EQ(table.shove, items[i].table_shove);
+    if (items[i].index_shove == col_pk.shove)
+      by_pk = &items[i];
+    if (items[i].index_shove == col_code.shove)
+      by_code = &items[i];
+  }
+  ASSERT_NE(nullptr, by_pk);
+  ASSERT_NE(nullptr, by_code);
+
+  EXPECT_EQ(rows, by_pk->stat.upserts);
+  EXPECT_EQ(1u, by_pk->stat.deletions);
+  EXPECT_EQ(2u, by_pk->stat.index_searches);
+  EXPECT_EQ(1u, by_pk->stat.results);
+
+  EXPECT_EQ(0u, by_code->stat.upserts);
+  EXPECT_EQ(1u + cursor_stat.index_searches, by_code->stat.index_searches);
+  EXPECT_EQ(cursor_stat.index_scans, by_code->stat.index_scans);
+  EXPECT_EQ(1u + cursor_stat.pk_lookups, by_code->stat.pk_lookups);
+  EXPECT_EQ(1u + cursor_stat.results, by_code->stat.results);
+
+  EXPECT_EQ(FPTA_OK, fpta_db_metrics_reset(db));
+  count = 4;
+  EXPECT_EQ(FPTA_OK, fpta_db_metrics(db, items, &count));
+  EXPECT_EQ(2u, count);
+  EXPECT_EQ(0u, items[0].stat.upserts + items[0].stat.index_searches +
+                    items[1].stat.upserts + items[1].stat.index_searches);
+
+  // создаем и наполняем множество таблиц, не помещающихся в каталог
+  const unsigned many = 300;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("pk", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  ASSERT_EQ(FPTA_OK, fpta_column_set_validate(&def));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  for (unsigned i = 0; i < many; ++i)
+    ASSERT_EQ(FPTA_OK,
+              fpta_table_create(txn, fptu::format("t%u", i).c_str(), &def));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+  ASSERT_NE(nullptr, txn);
+  for (unsigned i = 0; i < many; ++i) {
+    fpta_name many_table, many_pk;
+    EXPECT_EQ(FPTA_OK,
+              fpta_table_init(&many_table, fptu::format("t%u", i).c_str()));
+    EXPECT_EQ(FPTA_OK, fpta_column_init(&many_table, &many_pk, "pk"));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &many_table, &many_pk));
+    EXPECT_EQ(FPTU_OK, fptu_clear(pt));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &many_pk, fpta_value_uint(i)));
+    EXPECT_EQ(FPTA_OK,
+              fpta_insert_row(txn, &many_table, fptu_take_noshrink(pt)));
+    fpta_name_destroy(&many_table);
+    fpta_name_destroy(&many_pk);
+  }
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  txn = nullptr;
+
+  // при переполнении каталога счетчики учитываются в элементе "прочие"
+  std::vector<fpta_metrics_item> snapshot(many + 8);
+  count = snapshot.size();
+  EXPECT_EQ(FPTA_OK, fpta_db_metrics(db, snapshot.data(), &count));
+  EXPECT_GT(many + 2, count);
+  size_t upserts = 0;
+  bool other = false;
+  for (size_t i = 0; i < count; ++i) {
+    upserts += snapshot[i].stat.upserts;
+    if (snapshot[i].table_shove == 0 && snapshot[i].index_shove == 0)
+      other = true;
+  }
+  EXPECT_TRUE(other);
+  EXPECT_EQ(many, upserts);
+
+  // удаление таблиц освобождает слоты каталога
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  for (unsigned i = 0; i < many; ++i)
+    ASSERT_EQ(FPTA_OK, fpta_table_drop(txn, fptu::format("t%u", i).c_str()));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  txn = nullptr;
+  count = snapshot.size();
+  EXPECT_EQ(FPTA_OK, fpta_db_metrics(db, snapshot.data(), &count));
+  EXPECT_EQ(3u, count);
+  EXPECT_EQ(FPTA_OK, fpta_db_metrics_reset(db));
+  count = snapshot.size();
+  EXPECT_EQ(FPTA_OK, fpta_db_metrics(db, snapshot.data(), &count));
+  EXPECT_EQ(2u, count);
+
+  free(pt);
+  fpta_name_destroy(&table);
+  fpta_name_destroy(&col_pk);
+  fpta_name_destroy(&col_code);
+  EXPECT_EQ(FPTA_SUCCESS, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+TEST(Smoke, Latency) {
+  // проверяем шкалу гистограммы
+  for (unsigned i = 0; i < 8; ++i)
+    EXPECT_EQ(i, fpta_latency_bucket_lower(i));
+  EXPECT_EQ(8u, fpta_latency_bucket_lower(8));
+  EXPECT_EQ(15u, fpta_latency_bucket_lower(15));
+  EXPECT_EQ(16u, fpta_latency_bucket_lower(16));
+  EXPECT_EQ(18u, fpta_latency_bucket_lower(17));
+  for (unsigned i = 1; i < fpta_latency_buckets; ++i)
+    EXPECT_LT(fpta_latency_bucket_lower(i - 1), fpta_latency_bucket_lower(i));
+
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_sync, fpta_regime_default,
+                                  1, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  fpta_latency_histogram histogram;
+  EXPECT_EQ(FPTA_EINVAL,
+            fpta_db_latency_histogram(db, fpta_latency_points_count,
+                                      &histogram));
+  EXPECT_EQ(FPTA_OK,
+            fpta_db_latency_histogram(db, fpta_latency_begin, &histogram));
+  EXPECT_EQ(0u, histogram.count);
+  EXPECT_EQ(0u, fpta_latency_quantile(&histogram, 0.99));
+
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("pk", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  ASSERT_EQ(FPTA_OK, fpta_column_set_validate(&def));
+
+  fpta_txn *txn = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+  txn = nullptr;
+
+  fpta_name table, col_pk;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_pk, "pk"));
+  fptu_rw *pt = fptu_alloc(1, 16);
+  ASSERT_NE(nullptr, pt);
+
+  EXPECT_EQ(FPTA_EINVAL, fpta_db_latency(nullptr, true));
+  EXPECT_EQ(FPTA_OK, fpta_db_latency(db, true));
+
+  const unsigned txns = 5, rows = 10;
+  for (unsigned n = 0; n < txns; ++n) {
+    EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+    ASSERT_NE(nullptr, txn);
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &col_pk));
+    for (unsigned i = 0; i < rows; ++i) {
+      EXPECT_EQ(FPTU_OK, fptu_clear(pt));
+      EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_pk,
+                                            fpta_value_uint(n * rows + i)));
+      EXPECT_EQ(FPTA_OK, fpta_insert_row(txn, &table, fptu_take_noshrink(pt)));
+    }
+    EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+    txn = nullptr;
+  }
+
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  ASSERT_NE(nullptr, txn);
+  fptu_ro row;
+  const fpta_value key = fpta_value_uint(7);
+  EXPECT_EQ(FPTA_OK, fpta_get(txn, &col_pk, &key, &row));
+  fpta_cursor *cursor = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_cursor_open(txn, &col_pk, fpta_value_begin(),
+                                      fpta_value_end(), nullptr,
+                                      fpta_unsorted_dont_fetch, &cursor));
+  ASSERT_NE(nullptr, cursor);
+  EXPECT_EQ(FPTA_OK, fpta_cursor_move(cursor, fpta_first));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_move(cursor, fpta_next));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  txn = nullptr;
+
+  EXPECT_EQ(FPTA_OK,
+            fpta_db_latency_histogram(db, fpta_latency_begin, &histogram));
+  EXPECT_EQ(txns + 1, histogram.count);
+  EXPECT_EQ(FPTA_OK,
+            fpta_db_latency_histogram(db, fpta_latency_commit, &histogram));
+  EXPECT_EQ(txns, histogram.count);
+  // время синхронизации измеряется libmdbx в ходе фиксации
+  EXPECT_EQ(FPTA_OK,
+            fpta_db_latency_histogram(db, fpta_latency_sync, &histogram));
+  EXPECT_EQ(txns, histogram.count);
+  EXPECT_EQ(FPTA_OK,
+            fpta_db_latency_histogram(db, fpta_latency_put, &histogram));
+  EXPECT_EQ(txns * rows, histogram.count);
+  uint64_t sum = 0;
+  for (const uint64_t n : histogram.buckets)
+    sum += n;
+  EXPECT_EQ(histogram.count, sum);
+  EXPECT_LE(fpta_latency_quantile(&histogram, 0.5),
+            fpta_latency_quantile(&histogram, 0.99));
+  EXPECT_LE(fpta_latency_quantile(&histogram, 0.99), histogram.max_ns);
+  EXPECT_EQ(histogram.max_ns, fpta_latency_quantile(&histogram, 1));
+  EXPECT_EQ(FPTA_OK,
+            fpta_db_latency_histogram(db, fpta_latency_get, &histogram));
+  EXPECT_EQ(1u, histogram.count);
+  EXPECT_EQ(FPTA_OK, fpta_db_latency_histogram(db, fpta_latency_cursor_open,
+                                               &histogram));
+  EXPECT_EQ(1u, histogram.count);
+  EXPECT_EQ(FPTA_OK, fpta_db_latency_histogram(db, fpta_latency_cursor_move,
+                                               &histogram));
+  EXPECT_EQ(2u, histogram.count);
+
+  std::string text;
+  EXPECT_EQ(FPTA_OK, fpta::latency2text(db, text));
+  EXPECT_NE(std::string::npos, text.find("put         count 50,"));
+  EXPECT_NE(std::string::npos, text.find("cursor_move count 2,"));
+
+  // после выключения измерения не ведутся, но накопленное сохраняется
+  EXPECT_EQ(FPTA_OK, fpta_db_latency(db, false));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  ASSERT_NE(nullptr, txn);
+  EXPECT_EQ(FPTA_OK, fpta_get(txn, &col_pk, &key, &row));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  txn = nullptr;
+  EXPECT_EQ(FPTA_OK,
+            fpta_db_latency_histogram(db, fpta_latency_get, &histogram));
+  EXPECT_EQ(1u, histogram.count);
+
+  EXPECT_EQ(FPTA_OK, fpta_db_latency_reset(db));
+  EXPECT_EQ(FPTA_OK,
+            fpta_db_latency_histogram(db, fpta_latency_put, &histogram));
+  EXPECT_EQ(0u, histogram.count);
+
+  free(pt);
+  fpta_name_destroy(&table);
+  fpta_name_destroy(&col_pk);
+  EXPECT_EQ(FPTA_SUCCESS, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+//----------------------------------------------------------------------------
+
+TEST(Smoke, ChangeLog) {
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime_default,
+                                  1, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("pk", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK, fpta_column_describe(
+                         "val", fptu_uint64,
+                         fpta_secondary_withdups_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("cnt", fptu_uint16, fpta_index_none, &def));
+  ASSERT_EQ(FPTA_OK, fpta_column_set_validate(&def));
+
+  fpta_txn *txn = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+
+  fpta_name table, col_pk, col_val, col_cnt;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_pk, "pk"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_val, "val"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_cnt, "cnt"));
+  fptu_rw *pt = fptu_alloc(3, 32);
+  ASSERT_NE(nullptr, pt);
+
+  auto put = [&](unsigned pk) {
+    EXPECT_EQ(FPTU_OK, fptu_clear(pt));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_pk, fpta_value_uint(pk)));
+    EXPECT_EQ(FPTA_OK,
+              fpta_upsert_column(pt, &col_val, fpta_value_uint(pk * 10)));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_cnt, fpta_value_uint(0)));
+    EXPECT_EQ(FPTA_OK, fpta_insert_row(txn, &table, fptu_take_noshrink(pt)));
+  };
+  auto begin = [&](fpta_level level) {
+    txn = nullptr;
+    EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, level, &txn));
+    ASSERT_NE(nullptr, txn);
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &col_pk));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_val));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_cnt));
+  };
+  auto read = [&](uint64_t after, std::vector<fpta_change> &changes) {
+    changes.clear();
+    fpta_changelog_cursor *cursor = nullptr;
+    ASSERT_EQ(FPTA_OK, fpta_changelog_open(txn, after, &cursor));
+    ASSERT_NE(nullptr, cursor);
+    fpta_change change;
+    int rc;
+    while ((rc = fpta_changelog_next(cursor, &change)) == FPTA_OK)
+      changes.push_back(change);
+    EXPECT_EQ(FPTA_NODATA, rc);
+    EXPECT_EQ(FPTA_OK, fpta_changelog_close(cursor));
+  };
+
+  // пока журнал выключен изменения не фиксируются
+  std::vector<fpta_change> changes;
+  begin(fpta_write);
+  put(42);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  begin(fpta_read);
+  read(0, changes);
+  EXPECT_TRUE(changes.empty());
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  EXPECT_EQ(FPTA_EINVAL, fpta_db_changelog(nullptr, 100, true));
+  EXPECT_EQ(FPTA_OK, fpta_db_changelog(db, 1000, true));
+
+  // вставки
+  uint64_t version_a = 0, version_b = 0;
+  begin(fpta_write);
+  for (unsigned pk = 1; pk <= 3; ++pk)
+    put(pk);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end_ex(txn, false, &version_a));
+
+  // удаление, обновление через курсор и inplace-изменение
+  begin(fpta_write);
+  EXPECT_EQ(FPTU_OK, fptu_clear(pt));
+  EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_pk, fpta_value_uint(2)));
+  EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_val, fpta_value_uint(20)));
+  EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_cnt, fpta_value_uint(0)));
+  EXPECT_EQ(FPTA_OK, fpta_delete(txn, &table, fptu_take_noshrink(pt)));
+
+  fpta_cursor *cursor = nullptr;
+  EXPECT_EQ(FPTA_OK,
+            fpta_cursor_open(txn, &col_pk, fpta_value_begin(),
+                             fpta_value_end(), nullptr,
+                             fpta_unsorted_dont_fetch, &cursor));
+  ASSERT_NE(nullptr, cursor);
+  fpta_value key = fpta_value_uint(3);
+  EXPECT_EQ(FPTA_OK, fpta_cursor_locate(cursor, true, &key, nullptr));
+  EXPECT_EQ(FPTU_OK, fptu_clear(pt));
+  EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_pk, fpta_value_uint(3)));
+  EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_val, fpta_value_uint(33)));
+  EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_cnt, fpta_value_uint(0)));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_update(cursor, fptu_take_noshrink(pt)));
+  key = fpta_value_uint(1);
+  EXPECT_EQ(FPTA_OK, fpta_cursor_locate(cursor, true, &key, nullptr));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_inplace(cursor, &col_cnt, fpta_saturated_add,
+                                         fpta_value_uint(5)));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end_ex(txn, false, &version_b));
+  EXPECT_LT(version_a, version_b);
+
+  // отмененные изменения в журнал не попадают
+  begin(fpta_write);
+  put(99);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, true));
+
+  begin(fpta_read);
+  read(0, changes);
+  ASSERT_EQ(6u, changes.size());
+  const fpta_change_kind kinds[6] = {fpta_change_upsert, fpta_change_upsert,
+                                     fpta_change_upsert, fpta_change_delete,
+                                     fpta_change_upsert, fpta_change_upsert};
+  const uint64_t pks[6] = {1, 2, 3, 2, 3, 1};
+  for (size_t i = 0; i < changes.size(); ++i) {
+    SCOPED_TRACE("change #" + std::to_string(i));
+    const fpta_change &change = changes[i];
+    EXPECT_EQ(i < 3 ? version_a : version_b, change.db_version);
+    EXPECT_EQ(i < 3 ? i : i - 3, change.seq);
+    EXPECT_EQ(kinds[i], change.kind);
+    EXPECT_EQ(table.shove, change.table_shove);
+    EXPECT_EQ(fpta_unsigned_int, change.pk.type);
+    EXPECT_EQ(pks[i], change.pk.uint);
+    if (change.kind == fpta_change_delete) {
+      EXPECT_EQ(0u, change.row.sys.iov_len);
+      continue;
+    }
+    ASSERT_NE(0u, change.row.sys.iov_len);
+    fpta_value value;
+    EXPECT_EQ(FPTA_OK, fpta_get_column(change.row, &col_pk, &value));
+    EXPECT_EQ(pks[i], value.uint);
+    EXPECT_EQ(FPTA_OK, fpta_get_column(change.row, &col_val, &value));
+    EXPECT_EQ(i == 4 ? 33u : pks[i] * 10, value.uint);
+    EXPECT_EQ(FPTA_OK, fpta_get_column(change.row, &col_cnt, &value));
+    EXPECT_EQ(i == 5 ? 5u : 0u, value.uint);
+  }
+
+  // чтение "хвоста" после заданной версии
+  read(version_a, changes);
+  ASSERT_EQ(3u, changes.size());
+  EXPECT_EQ(version_b, changes.front().db_version);
+  read(version_b, changes);
+  EXPECT_TRUE(changes.empty());
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  // очистка таблицы и явное усечение журнала
+  uint64_t version_c = 0;
+  begin(fpta_write);
+  EXPECT_EQ(FPTA_OK, fpta_table_clear(txn, &table, true));
+  EXPECT_EQ(FPTA_OK, fpta_changelog_truncate(txn, version_a));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end_ex(txn, false, &version_c));
+  begin(fpta_read);
+  read(0, changes);
+  ASSERT_EQ(4u, changes.size());
+  EXPECT_EQ(version_b, changes.front().db_version);
+  EXPECT_EQ(fpta_change_clear, changes.back().kind);
+  EXPECT_EQ(version_c, changes.back().db_version);
+  EXPECT_EQ(fpta_null, changes.back().pk.type);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  // ограничение размера журнала и запись без строк
+  EXPECT_EQ(FPTA_OK, fpta_db_changelog(db, 8, false));
+  begin(fpta_write);
+  for (unsigned pk = 100; pk < 164; ++pk)
+    put(pk);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  begin(fpta_read);
+  read(0, changes);
+  EXPECT_GE(8u, changes.size());
+  ASSERT_FALSE(changes.empty());
+  EXPECT_EQ(163u, changes.back().pk.uint);
+  EXPECT_EQ(0u, changes.back().row.sys.iov_len);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  // выключение
+  const size_t before = changes.size();
+  EXPECT_EQ(FPTA_OK, fpta_db_changelog(db, 0, false));
+  begin(fpta_write);
+  put(500);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  begin(fpta_read);
+  read(0, changes);
+  EXPECT_EQ(before, changes.size());
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  free(pt);
+  fpta_name_destroy(&col_cnt);
+  fpta_name_destroy(&col_val);
+  fpta_name_destroy(&col_pk);
+  fpta_name_destroy(&table);
+  EXPECT_EQ(FPTA_SUCCESS, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+static int changes_visitor(const fptu_ro *row, void *context, void *arg) {
+  const fpta_name *col_pk = static_cast<const fpta_name *>(arg);
+  fpta_value value;
+  int rc = fpta_get_column(*row, col_pk, &value);
+  if (rc == FPTA_OK)
+    static_cast<std::set<uint64_t> *>(context)->insert(value.uint);
+  return rc;
+}
+
+TEST(Smoke, ChangesSince) {
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime_default,
+                                  8, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("pk", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("val", fptu_uint64, fpta_index_none, &def));
+  ASSERT_EQ(FPTA_OK, fpta_column_set_validate(&def));
+
+  fpta_txn *txn = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+
+  fpta_name table, col_pk, col_val;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_pk, "pk"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_val, "val"));
+  fptu_rw *pt = fptu_alloc(2, 16);
+  ASSERT_NE(nullptr, pt);
+
+  auto begin = [&](fpta_level level) {
+    txn = nullptr;
+    EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, level, &txn));
+    ASSERT_NE(nullptr, txn);
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &col_pk));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_val));
+  };
+  auto put = [&](unsigned pk, unsigned val) {
+    EXPECT_EQ(FPTU_OK, fptu_clear(pt));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_pk, fpta_value_uint(pk)));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_val, fpta_value_uint(val)));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_row(txn, &table, fptu_take_noshrink(pt)));
+  };
+
+  const unsigned n = 10000;
+  uint64_t version_a = 0, version_b = 0;
+  begin(fpta_write);
+  for (unsigned pk = 0; pk < n; ++pk)
+    put(pk, pk);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end_ex(txn, false, &version_a));
+
+  std::set<uint64_t> seen;
+  size_t count = 0;
+  begin(fpta_read);
+  EXPECT_EQ(FPTA_EINVAL,
+            fpta_table_changes_since(txn, &table, 0, &count, nullptr, nullptr,
+                                     nullptr));
+  EXPECT_EQ(FPTA_OK,
+            fpta_table_changes_since(txn, &table, 0, &count, changes_visitor,
+                                     &seen, &col_pk));
+  EXPECT_EQ(n, count);
+  EXPECT_EQ(n, seen.size());
+  seen.clear();
+  EXPECT_EQ(FPTA_OK,
+            fpta_table_changes_since(txn, &table, version_a, &count,
+                                     changes_visitor, &seen, &col_pk));
+  EXPECT_EQ(0u, count);
+  EXPECT_TRUE(seen.empty());
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  // изменяем несколько строк в разных частях таблицы
+  const unsigned modified[3] = {7, n / 2, n - 3};
+  begin(fpta_write);
+  for (const unsigned pk : modified)
+    put(pk, pk + n);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end_ex(txn, false, &version_b));
+  EXPECT_LT(version_a, version_b);
+
+  begin(fpta_read);
+  EXPECT_EQ(FPTA_OK,
+            fpta_table_changes_since(txn, &table, version_a, &count,
+                                     changes_visitor, &seen, &col_pk));
+  EXPECT_EQ(count, seen.size());
+  for (const unsigned pk : modified)
+    EXPECT_EQ(1u, seen.count(pk));
+  // затронуты только листовые страницы с измененными строками
+  EXPECT_LT(count, n / 10);
+
+  seen.clear();
+  EXPECT_EQ(FPTA_OK,
+            fpta_table_changes_since(txn, &table, version_b, &count,
+                                     changes_visitor, &seen, &col_pk));
+  EXPECT_EQ(0u, count);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  // изменения внутри пишущей транзакции также видны
+  begin(fpta_write);
+  put(n + 1, 0);
+  EXPECT_EQ(FPTA_OK,
+            fpta_table_changes_since(txn, &table, version_b, &count,
+                                     changes_visitor, &seen, &col_pk));
+  EXPECT_LT(0u, count);
+  EXPECT_EQ(1u, seen.count(n + 1));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, true));
+
+  free(pt);
+  fpta_name_destroy(&col_val);
+  fpta_name_destroy(&col_pk);
+  fpta_name_destroy(&table);
+  EXPECT_EQ(FPTA_SUCCESS, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+static int dump_output(void *ctx, const char *data, size_t length) {
+  static_cast<std::string *>(ctx)->append(data, length);
+  return FPTA_OK;
+}
+
+struct dump_input_ctx {
+  const std::string *dump;
+  size_t offset;
+};
+
+static int dump_input(void *ctx, void *buffer, size_t length) {
+  dump_input_ctx *input = static_cast<dump_input_ctx *>(ctx);
+  if (input->offset + length > input->dump->size())
+    return FPTA_NODATA;
+  memcpy(buffer, input->dump->data() + input->offset, length);
+  input->offset += length;
+  return FPTA_OK;
+}
+
+TEST(Smoke, DumpRestore) {
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime_default,
+                                  16, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  fpta_column_set def, other;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("pk", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK, fpta_column_describe(
+                         "uniq", fptu_uint64,
+                         fpta_secondary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK, fpta_column_describe(
+                         "grp", fptu_cstr,
+                         fpta_secondary_withdups_ordered_obverse, &def));
+  ASSERT_EQ(FPTA_OK, fpta_column_set_validate(&def));
+  fpta_column_set_init(&other);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("pk", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &other));
+  ASSERT_EQ(FPTA_OK, fpta_column_set_validate(&other));
+  // те же колонки, но со словарем префиксов у индекса grp
+  fpta_column_set opts;
+  fpta_column_set_init(&opts);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("pk", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &opts));
+  EXPECT_EQ(FPTA_OK, fpta_column_describe(
+                         "uniq", fptu_uint64,
+                         fpta_secondary_unique_ordered_obverse, &opts));
+  EXPECT_EQ(FPTA_OK, fpta_column_describe(
+                         "grp", fptu_cstr,
+                         fpta_secondary_withdups_ordered_obverse, &opts));
+  const char *const prefixes[] = {"group-"};
+  EXPECT_EQ(FPTA_OK, fpta_describe_key_prefixes("grp", &opts, prefixes, 1));
+  ASSERT_EQ(FPTA_OK, fpta_column_set_validate(&opts));
+
+  fpta_txn *txn = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "src", &def));
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "dst", &def));
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "other", &other));
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "opts", &opts));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&other));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&opts));
+
+  fpta_name src, dst, tbl_other, col_pk, col_uniq, col_grp, dst_pk, dst_uniq,
+      dst_grp;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&src, "src"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&src, &col_pk, "pk"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&src, &col_uniq, "uniq"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&src, &col_grp, "grp"));
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&dst, "dst"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&dst, &dst_pk, "pk"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&dst, &dst_uniq, "uniq"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&dst, &dst_grp, "grp"));
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&tbl_other, "other"));
+  fpta_name tbl_opts;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&tbl_opts, "opts"));
+  fptu_rw *pt = fptu_alloc(3, 64);
+  ASSERT_NE(nullptr, pt);
+
+  // заполняем исходную таблицу
+  const unsigned n = 5000;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &src, &col_pk));
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_uniq));
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_grp));
+  for (unsigned i = 0; i < n; ++i) {
+    EXPECT_EQ(FPTU_OK, fptu_clear(pt));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_pk, fpta_value_uint(i)));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_uniq,
+                                          fpta_value_uint((i * 7919) % n)));
+    const std::string grp = "group-" + std::to_string(i % 17);
+    EXPECT_EQ(FPTA_OK,
+              fpta_upsert_column(pt, &col_grp, fpta_value_cstr(grp.c_str())));
+    ASSERT_EQ(FPTA_OK, fpta_insert_row(txn, &src, fptu_take_noshrink(pt)));
+  }
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  // выгрузка
+  std::string dump;
+  size_t count = 0;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  EXPECT_EQ(FPTA_EINVAL, fpta_table_dump(txn, &src, nullptr, nullptr, &count));
+  EXPECT_EQ(FPTA_OK, fpta_table_dump(txn, &src, dump_output, &dump, &count));
+  EXPECT_EQ(n, count);
+  // сигнатура записана в порядке little-endian на любой платформе
+  EXPECT_EQ(0, memcmp(dump.data(), "FaDp", 4));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  // загрузка в другую таблицу
+  dump_input_ctx input = {&dump, 0};
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+  EXPECT_EQ(FPTA_SCHEMA_CHANGED,
+            fpta_table_restore(txn, &tbl_other, dump_input, &input, &count));
+  // опции индексов отличаются, выгрузка отвергается до записи строк
+  input.offset = 0;
+  EXPECT_EQ(FPTA_SCHEMA_CHANGED,
+            fpta_table_restore(txn, &tbl_opts, dump_input, &input, &count));
+  EXPECT_EQ(0u, count);
+  size_t opts_rows = ~size_t(0);
+  EXPECT_EQ(FPTA_OK, fpta_table_info(txn, &tbl_opts, &opts_rows, nullptr));
+  EXPECT_EQ(0u, opts_rows);
+  input.offset = 0;
+  EXPECT_EQ(FPTA_OK,
+            fpta_table_restore(txn, &dst, dump_input, &input, &count));
+  EXPECT_EQ(n, count);
+  EXPECT_EQ(dump.size(), input.offset);
+  input.offset = 0;
+  EXPECT_EQ(FPTA_EEXIST,
+            fpta_table_restore(txn, &dst, dump_input, &input, &count));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  // проверяем строки и вторичные индексы
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  size_t rows = 0;
+  EXPECT_EQ(FPTA_OK, fpta_table_info(txn, &dst, &rows, nullptr));
+  EXPECT_EQ(n, rows);
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &dst, &dst_pk));
+  for (unsigned i = 0; i < n; i += 97) {
+    SCOPED_TRACE("row #" + std::to_string(i));
+    fptu_ro row;
+    fpta_value key = fpta_value_uint((i * 7919) % n);
+    ASSERT_EQ(FPTA_OK, fpta_get(txn, &dst_uniq, &key, &row));
+    fpta_value value;
+    EXPECT_EQ(FPTA_OK, fpta_get_column(row, &dst_pk, &value));
+    EXPECT_EQ(i, value.uint);
+  }
+  fpta_cursor *cursor = nullptr;
+  const std::string grp = "group-3";
+  EXPECT_EQ(FPTA_OK, fpta_cursor_open(txn, &dst_grp,
+                                      fpta_value_cstr(grp.c_str()),
+                                      fpta_value_cstr(grp.c_str()), nullptr,
+                                      (fpta_cursor_options)(
+                                          fpta_unsorted_dont_fetch |
+                                          fpta_zeroed_range_is_point),
+                                      &cursor));
+  ASSERT_NE(nullptr, cursor);
+  size_t dups = 0;
+  EXPECT_EQ(FPTA_OK, fpta_cursor_count(cursor, &dups, INT_MAX));
+  EXPECT_EQ((n - 3 + 16) / 17, dups);
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  // поврежденная выгрузка
+  dump[0] ^= 1;
+  input.offset = 0;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+  EXPECT_EQ(FPTA_OK, fpta_table_clear(txn, &dst, true));
+  EXPECT_EQ(FPTA_EVALUE,
+            fpta_table_restore(txn, &dst, dump_input, &input, &count));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, true));
+
+  free(pt);
+  fpta_name_destroy(&dst_grp);
+  fpta_name_destroy(&dst_uniq);
+  fpta_name_destroy(&dst_pk);
+  fpta_name_destroy(&dst);
+  fpta_name_destroy(&tbl_opts);
+  fpta_name_destroy(&tbl_other);
+  fpta_name_destroy(&col_grp);
+  fpta_name_destroy(&col_uniq);
+  fpta_name_destroy(&col_pk);
+  fpta_name_destroy(&src);
+  EXPECT_EQ(FPTA_SUCCESS, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+TEST(Smoke, InplaceRange) {
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime_default,
+                                  4, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("pk", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK, fpta_column_describe(
+                         "rank", fptu_int64,
+                         fpta_secondary_withdups_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("cnt", fptu_uint32, fpta_index_none, &def));
+  EXPECT_EQ(FPTA_OK, fpta_column_describe("opt", fptu_uint64,
+                                          fpta_noindex_nullable, &def));
+  ASSERT_EQ(FPTA_OK, fpta_column_set_validate(&def));
+
+  fpta_txn *txn = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+
+  fpta_name table, col_pk, col_rank, col_cnt, col_opt;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_pk, "pk"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_rank, "rank"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_cnt, "cnt"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_opt, "opt"));
+  fptu_rw *pt = fptu_alloc(4, 32);
+  ASSERT_NE(nullptr, pt);
+
+  auto begin = [&](fpta_level level) {
+    txn = nullptr;
+    EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, level, &txn));
+    ASSERT_NE(nullptr, txn);
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &col_pk));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_rank));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_cnt));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_opt));
+  };
+  auto column = [&](unsigned pk, fpta_name *col, fpta_value &value) {
+    fptu_ro row;
+    fpta_value key = fpta_value_uint(pk);
+    int rc = fpta_get(txn, &col_pk, &key, &row);
+    return (rc != FPTA_OK) ? rc : fpta_get_column(row, col, &value);
+  };
+
+  const unsigned n = 1000;
+  begin(fpta_write);
+  for (unsigned pk = 0; pk < n; ++pk) {
+    EXPECT_EQ(FPTU_OK, fptu_clear(pt));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_pk, fpta_value_uint(pk)));
+    EXPECT_EQ(FPTA_OK,
+              fpta_upsert_column(pt, &col_rank, fpta_value_sint(pk % 10)));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_cnt, fpta_value_uint(pk)));
+    if (pk % 2) {
+      EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_opt, fpta_value_uint(1)));
+    }
+    ASSERT_EQ(FPTA_OK, fpta_insert_row(txn, &table, fptu_take_noshrink(pt)));
+  }
+
+  size_t count = 0;
+  EXPECT_EQ(FPTA_EINVAL,
+            fpta_inplace_range(txn, &col_pk, fpta_value_begin(),
+                               fpta_value_end(), nullptr, &col_pk,
+                               fpta_saturated_add, fpta_value_uint(1), &count));
+  EXPECT_EQ(FPTA_EFLAG,
+            fpta_inplace_range(txn, &col_pk, fpta_value_begin(),
+                               fpta_value_end(), nullptr, &col_cnt,
+                               fpta_inplace(42), fpta_value_uint(1), &count));
+
+  // неиндексированная колонка, изменение по месту
+  EXPECT_EQ(FPTA_OK,
+            fpta_inplace_range(txn, &col_pk, fpta_value_uint(100),
+                               fpta_value_uint(200), nullptr, &col_cnt,
+                               fpta_saturated_add, fpta_value_uint(5000),
+                               &count));
+  EXPECT_EQ(100u, count);
+  // отсутствующая в части строк колонка, через вторичный индекс
+  EXPECT_EQ(FPTA_OK,
+            fpta_inplace_range(txn, &col_rank, fpta_value_sint(0),
+                               fpta_value_sint(5), nullptr, &col_opt, fpta_max,
+                               fpta_value_uint(7), &count));
+  EXPECT_EQ(n / 2, count);
+  // индексированная колонка
+  EXPECT_EQ(FPTA_OK,
+            fpta_inplace_range(txn, &col_pk, fpta_value_uint(0),
+                               fpta_value_uint(n / 2), nullptr, &col_rank,
+                               fpta_saturated_sub, fpta_value_sint(100),
+                               &count));
+  EXPECT_EQ(n / 2, count);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  begin(fpta_read);
+  for (unsigned pk = 0; pk < n; ++pk) {
+    SCOPED_TRACE("pk " + std::to_string(pk));
+    fpta_value value;
+    ASSERT_EQ(FPTA_OK, column(pk, &col_cnt, value));
+    EXPECT_EQ((pk >= 100 && pk < 200) ? pk + 5000 : pk, value.uint);
+    ASSERT_EQ(FPTA_OK, column(pk, &col_rank, value));
+    EXPECT_EQ(int64_t(pk % 10) - ((pk < n / 2) ? 100 : 0), value.sint);
+    if (pk % 10 < 5) {
+      ASSERT_EQ(FPTA_OK, column(pk, &col_opt, value));
+      EXPECT_EQ(7u, value.uint);
+    } else if (pk % 2) {
+      ASSERT_EQ(FPTA_OK, column(pk, &col_opt, value));
+      EXPECT_EQ(1u, value.uint);
+    } else {
+      EXPECT_EQ(FPTA_NODATA, column(pk, &col_opt, value));
+    }
+  }
+
+  // вторичный индекс должен отражать изменения
+  fpta_cursor *cursor = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_cursor_open(txn, &col_rank, fpta_value_sint(-100),
+                                      fpta_value_sint(-90), nullptr,
+                                      fpta_unsorted_dont_fetch, &cursor));
+  ASSERT_NE(nullptr, cursor);
+  EXPECT_EQ(FPTA_OK, fpta_cursor_count(cursor, &count, INT_MAX));
+  EXPECT_EQ(n / 2, count);
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  // fpta_cursor_inplace() для колонок не-uint16 типов
+  begin(fpta_write);
+  EXPECT_EQ(FPTA_OK, fpta_cursor_open(txn, &col_pk, fpta_value_begin(),
+                                      fpta_value_end(), nullptr,
+                                      fpta_unsorted_dont_fetch, &cursor));
+  ASSERT_NE(nullptr, cursor);
+  fpta_value key = fpta_value_uint(3);
+  EXPECT_EQ(FPTA_OK, fpta_cursor_locate(cursor, true, &key, nullptr));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_inplace(cursor, &col_cnt, fpta_saturated_add,
+                                         fpta_value_uint(70000)));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+  fpta_value value;
+  ASSERT_EQ(FPTA_OK, column(3, &col_cnt, value));
+  EXPECT_EQ(70003u, value.uint);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  free(pt);
+  fpta_name_destroy(&col_opt);
+  fpta_name_destroy(&col_cnt);
+  fpta_name_destroy(&col_rank);
+  fpta_name_destroy(&col_pk);
+  fpta_name_destroy(&table);
+  EXPECT_EQ(FPTA_SUCCESS, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+TEST(Smoke, InplaceRangeDups) {
+  /* Smoke-проверка fpta_inplace_range() для индексов с дубликатами, когда
+   * обновление перемещает строку внутри multi-value: каждая строка должна
+   * быть изменена ровно один раз. */
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime_default,
+                                  4, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  // таблица с первичным индексом с дубликатами
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("grp", fptu_uint64,
+                                 fpta_primary_withdups_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("id", fptu_uint64, fpta_index_none, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("cnt", fptu_uint64, fpta_index_none, &def));
+  ASSERT_EQ(FPTA_OK, fpta_column_set_validate(&def));
+
+  // таблица со вторичным индексом с дубликатами, изменяется PK
+  fpta_column_set def2;
+  fpta_column_set_init(&def2);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("pk", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def2));
+  EXPECT_EQ(FPTA_OK, fpta_column_describe(
+                         "tag", fptu_uint64,
+                         fpta_secondary_withdups_ordered_obverse, &def2));
+  ASSERT_EQ(FPTA_OK, fpta_column_set_validate(&def2));
+
+  fpta_txn *txn = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "dups", &def));
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "tags", &def2));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def2));
+
+  fpta_name dups, col_grp, col_id, col_cnt, tags, col_pk, col_tag;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&dups, "dups"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&dups, &col_grp, "grp"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&dups, &col_id, "id"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&dups, &col_cnt, "cnt"));
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&tags, "tags"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&tags, &col_pk, "pk"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&tags, &col_tag, "tag"));
+  fptu_rw *pt = fptu_alloc(3, 32);
+  ASSERT_NE(nullptr, pt);
+
+  auto begin = [&](fpta_level level) {
+    txn = nullptr;
+    EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, level, &txn));
+    ASSERT_NE(nullptr, txn);
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &dups, &col_grp));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_id));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_cnt));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &tags, &col_pk));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_tag));
+  };
+
+  // по 20 строк на ключ, порядок значений cnt перемешан
+  const unsigned n = 200, groups = 10;
+  begin(fpta_write);
+  for (unsigned id = 0; id < n; ++id) {
+    EXPECT_EQ(FPTU_OK, fptu_clear(pt));
+    EXPECT_EQ(FPTA_OK,
+              fpta_upsert_column(pt, &col_grp, fpta_value_uint(id % groups)));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_id, fpta_value_uint(id)));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_cnt,
+                                          fpta_value_uint(id * 7919 % n)));
+    ASSERT_EQ(FPTA_OK, fpta_insert_row(txn, &dups, fptu_take_noshrink(pt)));
+
+    EXPECT_EQ(FPTU_OK, fptu_clear(pt));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_pk, fpta_value_uint(id)));
+    EXPECT_EQ(FPTA_OK,
+              fpta_upsert_column(pt, &col_tag, fpta_value_uint(id % groups)));
+    ASSERT_EQ(FPTA_OK, fpta_insert_row(txn, &tags, fptu_take_noshrink(pt)));
+  }
+
+  size_t count = 0;
+  EXPECT_EQ(FPTA_OK,
+            fpta_inplace_range(txn, &col_grp, fpta_value_begin(),
+                               fpta_value_end(), nullptr, &col_cnt,
+                               fpta_saturated_add, fpta_value_uint(1000),
+                               &count));
+  EXPECT_EQ(n, count);
+  EXPECT_EQ(FPTA_OK,
+            fpta_inplace_range(txn, &col_tag, fpta_value_begin(),
+                               fpta_value_end(), nullptr, &col_pk,
+                               fpta_saturated_add, fpta_value_uint(1000),
+                               &count));
+  EXPECT_EQ(n, count);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  begin(fpta_read);
+  std::vector<unsigned> seen(n);
+  fpta_cursor *cursor = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_cursor_open(txn, &col_grp, fpta_value_begin(),
+                                      fpta_value_end(), nullptr,
+                                      fpta_unsorted, &cursor));
+  ASSERT_NE(nullptr, cursor);
+  do {
+    fptu_ro row;
+    fpta_value id, cnt;
+    ASSERT_EQ(FPTA_OK, fpta_cursor_get(cursor, &row));
+    ASSERT_EQ(FPTA_OK, fpta_get_column(row, &col_id, &id));
+    ASSERT_EQ(FPTA_OK, fpta_get_column(row, &col_cnt, &cnt));
+    ASSERT_GT(n, id.uint);
+    EXPECT_EQ(id.uint * 7919 % n + 1000, cnt.uint);
+    seen[id.uint] += 1;
+  } while (fpta_cursor_move(cursor, fpta_next) == FPTA_OK);
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+  EXPECT_EQ(std::vector<unsigned>(n, 1), seen);
+
+  for (unsigned id = 0; id < n; ++id) {
+    fptu_ro row;
+    fpta_value key = fpta_value_uint(id);
+    EXPECT_EQ(FPTA_NOTFOUND, fpta_get(txn, &col_pk, &key, &row));
+    key = fpta_value_uint(id + 1000);
+    EXPECT_EQ(FPTA_OK, fpta_get(txn, &col_pk, &key, &row));
+  }
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  free(pt);
+  fpta_name_destroy(&col_tag);
+  fpta_name_destroy(&col_pk);
+  fpta_name_destroy(&tags);
+  fpta_name_destroy(&col_cnt);
+  fpta_name_destroy(&col_id);
+  fpta_name_destroy(&col_grp);
+  fpta_name_destroy(&dups);
+  EXPECT_EQ(FPTA_SUCCESS, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+TEST(Smoke, InplaceArithmetics) {
+  /* Smoke-проверка насыщающих fpta_saturated_mul, fpta_saturated_div
+   * и экспоненциального сглаживания fpta_bes для колонок разных типов,
+   * в том числе с учетом designated empty в nullable-индексах. */
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime_default,
+                                  4, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("pk", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe(
+                "u16", fptu_uint16,
+                fpta_secondary_withdups_ordered_obverse_nullable, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe(
+                "i32", fptu_int32,
+                fpta_secondary_withdups_ordered_obverse_nullable, &def));
+  EXPECT_EQ(FPTA_OK, fpta_column_describe("u64", fptu_uint64,
+                                          fpta_noindex_nullable, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("i64", fptu_int64, fpta_index_none, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("f64", fptu_fp64, fpta_index_none, &def));
+  ASSERT_EQ(FPTA_OK, fpta_column_set_validate(&def));
+
+  fpta_txn *txn = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+
+  fpta_name table, col_pk, col_u16, col_i32, col_u64, col_i64, col_f64;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_pk, "pk"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_u16, "u16"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_i32, "i32"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_u64, "u64"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_i64, "i64"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_f64, "f64"));
+
+  txn = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_write, &txn));
+  ASSERT_NE(nullptr, txn);
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &col_pk));
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_u16));
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_i32));
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_u64));
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_i64));
+  EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_f64));
+
+  fptu_rw *pt = fptu_alloc(6, 64);
+  ASSERT_NE(nullptr, pt);
+  EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_pk, fpta_value_uint(42)));
+  EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_u16, fpta_value_uint(300)));
+  EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_i32, fpta_value_sint(-5)));
+  EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_i64, fpta_value_sint(10)));
+  EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_f64, fpta_value_float(1.5)));
+
+  auto get = [&](const fpta_name *col) {
+    fpta_value value;
+    EXPECT_EQ(FPTA_OK, fpta_get_column(fptu_take_noshrink(pt), col, &value));
+    return value;
+  };
+
+  // uint16 с DENIL = 0 во вторичном nullable-индексе
+  EXPECT_EQ(FPTA_OK, fpta_column_inplace(pt, &col_u16, fpta_saturated_mul,
+                                         fpta_value_uint(1000)));
+  EXPECT_EQ(UINT16_MAX, get(&col_u16).uint);
+  EXPECT_EQ(FPTA_NODATA, fpta_column_inplace(pt, &col_u16, fpta_saturated_mul,
+                                             fpta_value_uint(2)));
+  EXPECT_EQ(FPTA_OK, fpta_column_inplace(pt, &col_u16, fpta_saturated_div,
+                                         fpta_value_uint(7)));
+  EXPECT_EQ(UINT16_MAX / 7, get(&col_u16).uint);
+  EXPECT_EQ(FPTA_EVALUE, fpta_column_inplace(pt, &col_u16, fpta_saturated_div,
+                                             fpta_value_uint(0)));
+  EXPECT_EQ(FPTA_EVALUE, fpta_column_inplace(pt, &col_u16, fpta_saturated_div,
+                                             fpta_value_float(0.0)));
+  EXPECT_EQ(FPTA_OK, fpta_column_inplace(pt, &col_u16, fpta_saturated_mul,
+                                         fpta_value_sint(0)));
+  EXPECT_EQ(1u, get(&col_u16).uint);
+
+  // int32 с DENIL = INT32_MIN во вторичном nullable-индексе
+  EXPECT_EQ(FPTA_OK, fpta_column_inplace(pt, &col_i32, fpta_saturated_mul,
+                                         fpta_value_sint(INT64_MAX)));
+  EXPECT_EQ(INT32_MIN + 1, get(&col_i32).sint);
+  EXPECT_EQ(FPTA_OK, fpta_column_inplace(pt, &col_i32, fpta_saturated_mul,
+                                         fpta_value_sint(-1)));
+  EXPECT_EQ(INT32_MAX, get(&col_i32).sint);
+  EXPECT_EQ(FPTA_OK, fpta_column_inplace(pt, &col_i32, fpta_saturated_div,
+                                         fpta_value_sint(-2)));
+  EXPECT_EQ(-(INT32_MAX / 2), get(&col_i32).sint);
+
+  // отсутствующее значение
+  EXPECT_EQ(FPTA_NODATA, fpta_column_inplace(pt, &col_u64, fpta_saturated_mul,
+                                             fpta_value_uint(2)));
+  EXPECT_EQ(FPTA_NODATA, fpta_column_inplace(pt, &col_u64, fpta_saturated_div,
+                                             fpta_value_uint(2)));
+  EXPECT_EQ(FPTA_OK, fpta_column_inplace(pt, &col_u64, fpta_bes,
+                                         fpta_value_uint(100),
+                                         fpta_value_sint(-1)));
+  EXPECT_EQ(100u, get(&col_u64).uint);
+
+  // сглаживание с коэффициентом 2^N и явно заданным
+  EXPECT_EQ(FPTA_OK, fpta_column_inplace(pt, &col_u64, fpta_bes,
+                                         fpta_value_uint(200),
+                                         fpta_value_sint(-1)));
+  EXPECT_EQ(150u, get(&col_u64).uint);
+  EXPECT_EQ(FPTA_OK, fpta_column_inplace(pt, &col_u64, fpta_bes,
+                                         fpta_value_uint(0),
+                                         fpta_value_sint(-2)));
+  EXPECT_EQ(112u, get(&col_u64).uint);
+  EXPECT_EQ(FPTA_OK, fpta_column_inplace(pt, &col_u64, fpta_bes,
+                                         fpta_value_uint(0),
+                                         fpta_value_float(0.25)));
+  EXPECT_EQ(84u, get(&col_u64).uint);
+  EXPECT_EQ(FPTA_NODATA, fpta_column_inplace(pt, &col_u64, fpta_bes,
+                                             fpta_value_uint(84),
+                                             fpta_value_sint(-3)));
+
+  // дробный коэффициент не искажает значения больше 2^53
+  const uint64_t huge = (UINT64_C(1) << 60) + 1;
+  EXPECT_EQ(FPTA_OK, fpta_column_inplace(pt, &col_u64, fpta_max,
+                                         fpta_value_uint(huge)));
+  EXPECT_EQ(FPTA_NODATA, fpta_column_inplace(pt, &col_u64, fpta_bes,
+                                             fpta_value_uint(huge),
+                                             fpta_value_float(0.3)));
+  EXPECT_EQ(huge, get(&col_u64).uint);
+  EXPECT_EQ(FPTA_OK, fpta_column_inplace(pt, &col_u64, fpta_bes,
+                                         fpta_value_uint(huge + 10),
+                                         fpta_value_float(0.3)));
+  EXPECT_EQ(huge + 3, get(&col_u64).uint);
+  EXPECT_EQ(FPTA_OK, fpta_column_inplace(pt, &col_u64, fpta_min,
+                                         fpta_value_uint(84)));
+  EXPECT_EQ(FPTA_EVALUE, fpta_column_inplace(pt, &col_u64, fpta_bes,
+                                             fpta_value_uint(0),
+                                             fpta_value_sint(-24)));
+  EXPECT_EQ(FPTA_EVALUE, fpta_column_inplace(pt, &col_u64, fpta_bes,
+                                             fpta_value_uint(0),
+                                             fpta_value_float(1.0)));
+  EXPECT_EQ(FPTA_EVALUE, fpta_column_inplace(pt, &col_u64, fpta_bes,
+                                             fpta_value_uint(0),
+                                             fpta_value_uint(1)));
+
+  // int64 без индекса, смешанная арифметика
+  EXPECT_EQ(FPTA_OK, fpta_column_inplace(pt, &col_i64, fpta_saturated_mul,
+                                         fpta_value_float(2.5)));
+  EXPECT_EQ(25, get(&col_i64).sint);
+  EXPECT_EQ(FPTA_OK, fpta_column_inplace(pt, &col_i64, fpta_saturated_div,
+                                         fpta_value_sint(-4)));
+  EXPECT_EQ(-6, get(&col_i64).sint);
+  EXPECT_EQ(FPTA_OK, fpta_column_inplace(pt, &col_i64, fpta_saturated_mul,
+                                         fpta_value_uint(UINT64_MAX)));
+  EXPECT_EQ(INT64_MIN, get(&col_i64).sint);
+
+  // плавающая точка
+  EXPECT_EQ(FPTA_OK, fpta_column_inplace(pt, &col_f64, fpta_saturated_mul,
+                                         fpta_value_uint(4)));
+  EXPECT_EQ(6.0, get(&col_f64).fp);
+  EXPECT_EQ(FPTA_OK, fpta_column_inplace(pt, &col_f64, fpta_saturated_div,
+                                         fpta_value_sint(-4)));
+  EXPECT_EQ(-1.5, get(&col_f64).fp);
+  EXPECT_EQ(FPTA_OK, fpta_column_inplace(pt, &col_f64, fpta_bes,
+                                         fpta_value_float(2.5),
+                                         fpta_value_float(0.5)));
+  EXPECT_EQ(0.5, get(&col_f64).fp);
+  // плавающая точка насыщается до бесконечности, как и в fpta_saturated_add
+  EXPECT_EQ(FPTA_OK, fpta_column_inplace(pt, &col_f64, fpta_saturated_mul,
+                                         fpta_value_float(1e308)));
+  EXPECT_EQ(FPTA_OK, fpta_column_inplace(pt, &col_f64, fpta_saturated_mul,
+                                         fpta_value_float(1e308)));
+  EXPECT_EQ(FPTA_NODATA, fpta_column_inplace(pt, &col_f64, fpta_saturated_mul,
+                                             fpta_value_float(1e308)));
+  EXPECT_TRUE(std::isinf(get(&col_f64).fp));
+
+  // коэффициент сглаживания передается и через fpta_inplace_range()
+  EXPECT_EQ(FPTA_OK, fpta_insert_row(txn, &table, fptu_take_noshrink(pt)));
+  size_t count = 0;
+  EXPECT_EQ(FPTA_OK, fpta_inplace_range(txn, &col_pk, fpta_value_begin(),
+                                        fpta_value_end(), nullptr, &col_u64,
+                                        fpta_bes, fpta_value_uint(0), &count,
+                                        fpta_value_sint(-2)));
+  EXPECT_EQ(1u, count);
+  fptu_ro row;
+  fpta_value key = fpta_value_uint(42), value;
+  ASSERT_EQ(FPTA_OK, fpta_get(txn, &col_pk, &key, &row));
+  ASSERT_EQ(FPTA_OK, fpta_get_column(row, &col_u64, &value));
+  EXPECT_EQ(63u, value.uint);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  free(pt);
+  fpta_name_destroy(&col_f64);
+  fpta_name_destroy(&col_i64);
+  fpta_name_destroy(&col_u64);
+  fpta_name_destroy(&col_i32);
+  fpta_name_destroy(&col_u16);
+  fpta_name_destroy(&col_pk);
+  fpta_name_destroy(&table);
+  EXPECT_EQ(FPTA_SUCCESS, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+TEST(Smoke, InplaceByKey) {
+  /* Smoke-проверка fpta_inplace_by_key(): изменение значения в грязной
+   * странице, в том числе для большой строки на overflow-страницах, а также
+   * обновление отсутствующей и индексированной колонки. */
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime_default,
+                                  4, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("pk", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK, fpta_column_describe(
+                         "rank", fptu_int64,
+                         fpta_secondary_withdups_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("cnt", fptu_uint32, fpta_index_none, &def));
+  EXPECT_EQ(FPTA_OK, fpta_column_describe("opt", fptu_uint64,
+                                          fpta_noindex_nullable, &def));
+  EXPECT_EQ(FPTA_OK, fpta_column_describe("blob", fptu_cstr,
+                                          fpta_noindex_nullable, &def));
+  ASSERT_EQ(FPTA_OK, fpta_column_set_validate(&def));
+
+  fpta_txn *txn = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+
+  fpta_name table, col_pk, col_rank, col_cnt, col_opt, col_blob;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_pk, "pk"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_rank, "rank"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_cnt, "cnt"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_opt, "opt"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_blob, "blob"));
+  const std::string blob(16384, 'x');
+  fptu_rw *pt = fptu_alloc(5, 32 + blob.size());
+  ASSERT_NE(nullptr, pt);
+
+  auto begin = [&](fpta_level level) {
+    txn = nullptr;
+    EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, level, &txn));
+    ASSERT_NE(nullptr, txn);
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &col_pk));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_rank));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_cnt));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_opt));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_blob));
+  };
+  auto column = [&](unsigned pk, fpta_name *col, fpta_value &value) {
+    fptu_ro row;
+    fpta_value key = fpta_value_uint(pk);
+    int rc = fpta_get(txn, &col_pk, &key, &row);
+    return (rc != FPTA_OK) ? rc : fpta_get_column(row, col, &value);
+  };
+
+  const unsigned n = 100;
+  begin(fpta_write);
+  for (unsigned pk = 0; pk < n; ++pk) {
+    EXPECT_EQ(FPTU_OK, fptu_clear(pt));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_pk, fpta_value_uint(pk)));
+    EXPECT_EQ(FPTA_OK,
+              fpta_upsert_column(pt, &col_rank, fpta_value_sint(pk % 10)));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_cnt, fpta_value_uint(pk)));
+    if (pk == 42) {
+      EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_blob,
+                                            fpta_value_str(blob)));
+    }
+    ASSERT_EQ(FPTA_OK, fpta_insert_row(txn, &table, fptu_take_noshrink(pt)));
+  }
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  begin(fpta_read);
+  fpta_value key = fpta_value_uint(7), value;
+  EXPECT_EQ(FPTA_EPERM,
+            fpta_inplace_by_key(txn, &col_pk, &key, &col_cnt,
+                                fpta_saturated_add, fpta_value_uint(1)));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  begin(fpta_write);
+  EXPECT_EQ(FPTA_NO_INDEX,
+            fpta_inplace_by_key(txn, &col_rank, &key, &col_cnt,
+                                fpta_saturated_add, fpta_value_uint(1)));
+  EXPECT_EQ(FPTA_EINVAL,
+            fpta_inplace_by_key(txn, &col_pk, &key, &col_pk,
+                                fpta_saturated_add, fpta_value_uint(1)));
+  EXPECT_EQ(FPTA_EINVAL,
+            fpta_inplace_by_key(txn, &col_pk, nullptr, &col_cnt,
+                                fpta_saturated_add, fpta_value_uint(1)));
+
+  // неиндексированная колонка фиксированного размера
+  EXPECT_EQ(FPTA_OK,
+            fpta_inplace_by_key(txn, &col_pk, &key, &col_cnt,
+                                fpta_saturated_add, fpta_value_uint(5)));
+  EXPECT_EQ(FPTA_OK, column(7, &col_cnt, value));
+  EXPECT_EQ(12u, value.uint);
+  EXPECT_EQ(FPTA_NODATA,
+            fpta_inplace_by_key(txn, &col_pk, &key, &col_cnt, fpta_max,
+                                fpta_value_uint(3)));
+  EXPECT_EQ(FPTA_OK,
+            fpta_inplace_by_key(txn, &col_pk, &key, &col_cnt, fpta_bes,
+                                fpta_value_uint(20), fpta_value_sint(-1)));
+  EXPECT_EQ(FPTA_OK, column(7, &col_cnt, value));
+  EXPECT_EQ(16u, value.uint);
+
+  // отсутствующая колонка добавляется с пересборкой строки, при этом
+  // операция учитывается в счетчиках только однократно
+  const auto pk_searches = [&]() {
+    fpta_metrics_item items[8];
+    size_t count = 8, searches = 0;
+    EXPECT_EQ(FPTA_OK, fpta_db_metrics(db, items, &count));
+    for (size_t i = 0; i < count; ++i)
+      if (items[i].index_shove == col_pk.shove)
+        searches += items[i].stat.index_searches;
+    return searches;
+  };
+  key = fpta_value_uint(11);
+  EXPECT_EQ(FPTA_OK, fpta_db_metrics_reset(db));
+  EXPECT_EQ(FPTA_OK,
+            fpta_inplace_by_key(txn, &col_pk, &key, &col_opt,
+                                fpta_saturated_add, fpta_value_uint(1)));
+  EXPECT_EQ(1u, pk_searches());
+  EXPECT_EQ(FPTA_OK, fpta_db_metrics_reset(db));
+  EXPECT_EQ(FPTA_OK,
+            fpta_inplace_by_key(txn, &col_pk, &key, &col_cnt,
+                                fpta_saturated_add, fpta_value_uint(1)));
+  EXPECT_EQ(1u, pk_searches());
+  EXPECT_EQ(FPTA_OK, column(11, &col_opt, value));
+  EXPECT_EQ(1u, value.uint);
+  key = fpta_value_uint(7);
+  EXPECT_EQ(FPTA_NODATA,
+            fpta_inplace_by_key(txn, &col_pk, &key, &col_opt,
+                                fpta_saturated_mul, fpta_value_uint(3)));
+  EXPECT_EQ(FPTA_OK,
+            fpta_inplace_by_key(txn, &col_pk, &key, &col_opt,
+                                fpta_saturated_add, fpta_value_uint(3)));
+  EXPECT_EQ(FPTA_OK, column(7, &col_opt, value));
+  EXPECT_EQ(3u, value.uint);
+
+  // индексированная колонка обновляется с сопровождением индекса
+  EXPECT_EQ(FPTA_OK,
+            fpta_inplace_by_key(txn, &col_pk, &key, &col_rank,
+                                fpta_saturated_sub, fpta_value_sint(100)));
+  EXPECT_EQ(FPTA_OK, column(7, &col_rank, value));
+  EXPECT_EQ(-93, value.sint);
+  fpta_cursor *cursor = nullptr;
+  EXPECT_EQ(FPTA_OK,
+            fpta_cursor_open(txn, &col_rank, fpta_value_sint(-93),
+                             fpta_value_sint(-93), nullptr,
+                             fpta_unsorted | fpta_zeroed_range_is_point,
+                             &cursor));
+  size_t dups = 0;
+  EXPECT_EQ(FPTA_OK, fpta_cursor_count(cursor, &dups, INT_MAX));
+  EXPECT_EQ(1u, dups);
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+
+  // большая строка на overflow-страницах
+  key = fpta_value_uint(42);
+  EXPECT_EQ(FPTA_OK,
+            fpta_inplace_by_key(txn, &col_pk, &key, &col_cnt,
+                                fpta_saturated_add, fpta_value_uint(1)));
+  EXPECT_EQ(FPTA_OK, column(42, &col_cnt, value));
+  EXPECT_EQ(43u, value.uint);
+  EXPECT_EQ(FPTA_OK, column(42, &col_blob, value));
+  EXPECT_EQ(blob.size(), value.binary_length);
+
+  key = fpta_value_uint(n);
+  EXPECT_EQ(FPTA_NOTFOUND,
+            fpta_inplace_by_key(txn, &col_pk, &key, &col_cnt,
+                                fpta_saturated_add, fpta_value_uint(1)));
+  EXPECT_EQ(FPTA_NOTFOUND,
+            fpta_inplace_by_key(txn, &col_pk, &key, &col_rank,
+                                fpta_saturated_add, fpta_value_sint(1)));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  // изменения сохраняются после фиксации транзакции
+  begin(fpta_read);
+  EXPECT_EQ(FPTA_OK, column(7, &col_cnt, value));
+  EXPECT_EQ(16u, value.uint);
+  EXPECT_EQ(FPTA_OK, column(42, &col_cnt, value));
+  EXPECT_EQ(43u, value.uint);
+  EXPECT_EQ(FPTA_OK, column(8, &col_cnt, value));
+  EXPECT_EQ(8u, value.uint);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  free(pt);
+  fpta_name_destroy(&col_blob);
+  fpta_name_destroy(&col_opt);
+  fpta_name_destroy(&col_cnt);
+  fpta_name_destroy(&col_rank);
+  fpta_name_destroy(&col_pk);
+  fpta_name_destroy(&table);
+  EXPECT_EQ(FPTA_SUCCESS, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+TEST(Smoke, CompositeKeyLegacy) {
+  /* Сверка составных ключей, формируемых подготовленными кодировщиками,
+   * с прежней реализацией для разных типов колонок и видов индексов,
+   * в том числе при отсутствии значений и превышении fpta_max_keylen. */
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime_default,
+                                  4, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("pk", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("i64", fptu_int64, fpta_index_none, &def));
+  EXPECT_EQ(FPTA_OK, fpta_column_describe("i32", fptu_int32,
+                                          fpta_noindex_nullable, &def));
+  EXPECT_EQ(FPTA_OK, fpta_column_describe("u16", fptu_uint16,
+                                          fpta_noindex_nullable, &def));
+  EXPECT_EQ(FPTA_OK, fpta_column_describe("f64", fptu_fp64,
+                                          fpta_noindex_nullable, &def));
+  EXPECT_EQ(FPTA_OK, fpta_column_describe("b128", fptu_128,
+                                          fpta_noindex_nullable, &def));
+  EXPECT_EQ(FPTA_OK, fpta_column_describe("str", fptu_cstr,
+                                          fpta_noindex_nullable, &def));
+  const fpta_index_type kinds[] = {
+      fpta_secondary_withdups_ordered_obverse,
+      fpta_secondary_withdups_ordered_reverse,
+      fpta_index_type(fpta_secondary_withdups_ordered_obverse |
+                      fpta_tersely_composite),
+      fpta_index_type(fpta_secondary_withdups_ordered_reverse |
+                      fpta_tersely_composite),
+      fpta_secondary_withdups_unordered};
+  const char *const composite_names[] = {"obverse", "reverse", "tersely",
+                                         "tersely_reverse", "unordered"};
+  const size_t composite_count = sizeof(kinds) / sizeof(kinds[0]);
+  /* составные индексы по одинаковым наборам колонок недопустимы,
+   * поэтому в каждый не входит одна из колонок */
+  const char *const items[] = {"str", "i32", "u16", "f64", "b128", "i64"};
+  for (size_t i = 0; i < composite_count; ++i) {
+    const char *list[5];
+    for (size_t n = 0, k = 0; n < 6; ++n)
+      if (n != i)
+        list[k++] = items[n];
+    EXPECT_EQ(FPTA_OK, fpta_describe_composite_index(
+                           composite_names[i], kinds[i], &def, list, 5));
+  }
+  ASSERT_EQ(FPTA_OK, fpta_column_set_validate(&def));
+
+  fpta_txn *txn = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+
+  const char *const names[] = {"pk", "i64", "i32", "u16", "f64", "b128",
+                               "str"};
+  const size_t column_count = sizeof(names) / sizeof(names[0]);
+  fpta_name table, columns[column_count], composites[composite_count];
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+  for (size_t i = 0; i < column_count; ++i)
+    EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &columns[i], names[i]));
+  for (size_t i = 0; i < composite_count; ++i)
+    EXPECT_EQ(FPTA_OK,
+              fpta_column_init(&table, &composites[i], composite_names[i]));
+
+  txn = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  ASSERT_NE(nullptr, txn);
+  for (size_t i = 0; i < column_count; ++i)
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &columns[i]));
+  for (size_t i = 0; i < composite_count; ++i)
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &composites[i]));
+
+  fptu_rw *pt = fptu_alloc(column_count, 1024);
+  ASSERT_NE(nullptr, pt);
+  uint64_t seed = 42;
+  auto rng = [&seed]() {
+    seed = seed * UINT64_C(6364136223846793005) + UINT64_C(1442695040888963407);
+    return uint32_t(seed >> 33);
+  };
+  for (unsigned n = 0; n < 1000; ++n) {
+    EXPECT_EQ(FPTU_OK, fptu_clear(pt));
+    const unsigned present = unsigned(rng());
+    const int64_t value = int32_t(rng());
+    uint8_t bin[16];
+    for (auto &byte : bin)
+      byte = uint8_t(rng());
+    const std::string str(rng() % 100, char('a' + n % 26));
+    EXPECT_EQ(FPTA_OK,
+              fpta_upsert_column(pt, &columns[0], fpta_value_uint(n)));
+    EXPECT_EQ(FPTA_OK,
+              fpta_upsert_column(pt, &columns[1], fpta_value_sint(value)));
+    if (present & 1) {
+      EXPECT_EQ(FPTA_OK,
+                fpta_upsert_column(pt, &columns[2], fpta_value_sint(value)));
+    }
+    if (present & 2) {
+      EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &columns[3],
+                                            fpta_value_uint(n % 65000 + 1)));
+    }
+    if (present & 4) {
+      EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &columns[4],
+                                            fpta_value_float(value / 3.0)));
+    }
+    if (present & 8) {
+      EXPECT_EQ(FPTA_OK, fpta_upsert_column(
+                             pt, &columns[5], fpta_value_binary(bin, 16)));
+    }
+    if (present & 16) {
+      EXPECT_EQ(FPTA_OK,
+                fpta_upsert_column(pt, &columns[6], fpta_value_str(str)));
+    }
+    const fptu_ro row = fptu_take_noshrink(pt);
+
+    for (size_t i = 0; i < composite_count; ++i) {
+      fpta_value4key key, legacy;
+      ASSERT_EQ(FPTA_OK, fpta_get_column4key(row, &composites[i], &key));
+      ASSERT_EQ(FPTA_OK,
+                __fpta_composite_row2key_legacy(row, &composites[i], &legacy));
+      ASSERT_EQ(legacy.value.binary_length, key.value.binary_length);
+      EXPECT_EQ(0, memcmp(legacy.value.binary_data, key.value.binary_data,
+                          key.value.binary_length));
+    }
+  }
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  free(pt);
+  for (size_t i = 0; i < composite_count; ++i)
+    fpta_name_destroy(&composites[i]);
+  for (size_t i = 0; i < column_count; ++i)
+    fpta_name_destroy(&columns[i]);
+  fpta_name_destroy(&table);
+  EXPECT_EQ(FPTA_SUCCESS, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+TEST(Smoke, KeyPrefixes) {
+  /* Smoke-проверка сжатия ключей словарем префиксов: порядок строк
+   * в первичном и составном индексах, поиск по значению и диапазону,
+   * а также загрузка схемы со словарями после повторного открытия БД. */
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime_default,
+                                  4, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("url", fptu_cstr,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("tenant", fptu_cstr, fpta_index_none, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("name", fptu_cstr, fpta_index_none, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("n", fptu_uint64, fpta_index_none, &def));
+  EXPECT_EQ(FPTA_OK, fpta_describe_composite_index_va(
+                         "tn", fpta_secondary_unique_ordered_obverse, &def,
+                         "tenant", "name", nullptr));
+
+  const char *const url_prefixes[] = {"https://example.com/static/",
+                                      "http://", "https://example.com/api/"};
+  const char *const nested[] = {"http://", "http://x"};
+  const char *const twins[] = {"abc", "abc"};
+  const char *const tenant_prefixes[] = {"tenant-00"};
+  const std::string too_long(fpta_max_key_prefix_length + 1, 'x');
+  const char *const long_prefix[] = {too_long.c_str()};
+  EXPECT_EQ(FPTA_NO_INDEX,
+            fpta_describe_key_prefixes("n", &def, url_prefixes, 3));
+  EXPECT_EQ(FPTA_COLUMN_MISSING,
+            fpta_describe_key_prefixes("none", &def, url_prefixes, 3));
+  EXPECT_EQ(FPTA_EINVAL, fpta_describe_key_prefixes("url", &def, nested, 2));
+  EXPECT_EQ(FPTA_EEXIST, fpta_describe_key_prefixes("url", &def, twins, 2));
+  EXPECT_EQ(FPTA_DATALEN_MISMATCH,
+            fpta_describe_key_prefixes("url", &def, long_prefix, 1));
+  EXPECT_EQ(FPTA_OK,
+            fpta_describe_key_prefixes("url", &def, url_prefixes, 3));
+  EXPECT_EQ(FPTA_EEXIST,
+            fpta_describe_key_prefixes("url", &def, url_prefixes, 3));
+  EXPECT_EQ(FPTA_OK,
+            fpta_describe_key_prefixes("tn", &def, tenant_prefixes, 1));
+  ASSERT_EQ(FPTA_OK, fpta_column_set_validate(&def));
+
+  fpta_txn *txn = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+
+  /* ключи до, между, внутри и после префиксов, а также длинные */
+  std::vector<std::string> urls = {
+      "", "a", "ftp://host/", "http:/", "http://", "http://a/b",
+      "http://z", "http;", "https://example.com/", "https://example.com/api",
+      "https://example.com/api/", "https://example.com/api/v1/users",
+      "https://example.com/api/v2/", "https://example.com/api0",
+      "https://example.com/static/css/site.css",
+      "https://example.com/static/img/logo.png", "https://example.com/stat",
+      "zzz"};
+  for (char c = 'a'; c < 'e'; ++c)
+    urls.push_back("https://example.com/static/" + std::string(1, c) +
+                   std::string(60, 'x'));
+  for (char c = 'a'; c < 'e'; ++c)
+    urls.push_back("http://" + std::string(1, c) + std::string(70, 'y'));
+
+  fpta_name table, col_url, col_tenant, col_name, col_n, col_tn;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_url, "url"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_tenant, "tenant"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_name, "name"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_n, "n"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_tn, "tn"));
+  fptu_rw *pt = fptu_alloc(8, 512);
+  ASSERT_NE(nullptr, pt);
+
+  auto begin = [&](fpta_level level) {
+    txn = nullptr;
+    EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, level, &txn));
+    ASSERT_NE(nullptr, txn);
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &col_url));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_tenant));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_name));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_n));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_tn));
+  };
+  auto tenant = [](size_t i) {
+    return (i % 3) ? "tenant-00" + std::to_string(i % 5) : "acme";
+  };
+
+  begin(fpta_write);
+  for (size_t i = 0; i < urls.size(); ++i) {
+    EXPECT_EQ(FPTU_OK, fptu_clear(pt));
+    EXPECT_EQ(FPTA_OK,
+              fpta_upsert_column(pt, &col_url, fpta_value_str(urls[i])));
+    EXPECT_EQ(FPTA_OK,
+              fpta_upsert_column(pt, &col_tenant, fpta_value_str(tenant(i))));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_name,
+                                          fpta_value_str(urls[i])));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_n, fpta_value_uint(i)));
+    ASSERT_EQ(FPTA_OK, fpta_insert_row(txn, &table, fptu_take_noshrink(pt)));
+  }
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  /* контроль уникальности по сжатому составному ключу */
+  begin(fpta_write);
+  EXPECT_EQ(FPTA_OK,
+            fpta_upsert_column(pt, &col_url, fpta_value_cstr("unique")));
+  EXPECT_EQ(FPTA_KEYEXIST,
+            fpta_insert_row(txn, &table, fptu_take_noshrink(pt)));
+  EXPECT_EQ(FPTA_TXN_CANCELLED, fpta_transaction_end(txn, true));
+
+  /* схема со словарями должна загружаться после повторного открытия */
+  EXPECT_EQ(FPTA_SUCCESS, fpta_db_close(db));
+  db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime_default,
+                                  4, false, &db));
+  ASSERT_NE(nullptr, db);
+
+  std::vector<std::string> expected(urls);
+  std::sort(expected.begin(), expected.end());
+  std::vector<std::pair<std::string, std::string>> expected_tn;
+  for (size_t i = 0; i < urls.size(); ++i)
+    expected_tn.emplace_back(tenant(i), urls[i]);
+  std::sort(expected_tn.begin(), expected_tn.end());
+
+  begin(fpta_read);
+  fpta_cursor *cursor = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_cursor_open(txn, &col_url, fpta_value_begin(),
+                                      fpta_value_end(), nullptr,
+                                      fpta_ascending, &cursor));
+  std::vector<std::string> scanned;
+  fptu_ro row;
+  fpta_value value;
+  while (fpta_cursor_eof(cursor) == FPTA_OK) {
+    ASSERT_EQ(FPTA_OK, fpta_cursor_get(cursor, &row));
+    ASSERT_EQ(FPTA_OK, fpta_get_column(row, &col_url, &value));
+    scanned.emplace_back(value.str, value.binary_length);
+    ASSERT_EQ(FPTA_OK, fpta_cursor_key(cursor, &value));
+    EXPECT_EQ(fpta_shoved, value.type);
+    EXPECT_EQ(FPTA_OK, fpta_cursor_locate(cursor, true, &value, nullptr));
+    ASSERT_EQ(FPTA_OK, fpta_get_column(row, &col_url, &value));
+    EXPECT_EQ(scanned.back(), std::string(value.str, value.binary_length));
+    int rc = fpta_cursor_move(cursor, fpta_next);
+    ASSERT_TRUE(rc == FPTA_OK || rc == FPTA_NODATA);
+  }
+  EXPECT_EQ(expected, scanned);
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+
+  cursor = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_cursor_open(txn, &col_tn, fpta_value_begin(),
+                                      fpta_value_end(), nullptr,
+                                      fpta_ascending, &cursor));
+  std::vector<std::pair<std::string, std::string>> scanned_tn;
+  while (fpta_cursor_eof(cursor) == FPTA_OK) {
+    ASSERT_EQ(FPTA_OK, fpta_cursor_get(cursor, &row));
+    fpta_value tenant_value, name_value;
+    ASSERT_EQ(FPTA_OK, fpta_get_column(row, &col_tenant, &tenant_value));
+    ASSERT_EQ(FPTA_OK, fpta_get_column(row, &col_name, &name_value));
+    scanned_tn.emplace_back(
+        std::string(tenant_value.str, tenant_value.binary_length),
+        std::string(name_value.str, name_value.binary_length));
+    int rc = fpta_cursor_move(cursor, fpta_next);
+    ASSERT_TRUE(rc == FPTA_OK || rc == FPTA_NODATA);
+  }
+  EXPECT_EQ(expected_tn, scanned_tn);
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+
+  /* поиск по значению и по диапазону, границы которого попадают в разные
+   * области словаря */
+  for (const auto &url : urls) {
+    fpta_value key = fpta_value_str(url);
+    EXPECT_EQ(FPTA_OK, fpta_get(txn, &col_url, &key, &row));
+  }
+  fpta_value key = fpta_value_cstr("https://example.com/api/v3");
+  EXPECT_EQ(FPTA_NOTFOUND, fpta_get(txn, &col_url, &key, &row));
+
+  auto count = [&](const char *from, const char *to) {
+    fpta_cursor *range = nullptr;
+    size_t n = ~size_t(0);
+    EXPECT_EQ(FPTA_OK, fpta_cursor_open(txn, &col_url, fpta_value_cstr(from),
+                                        fpta_value_cstr(to), nullptr,
+                                        fpta_ascending, &range));
+    if (range) {
+      EXPECT_EQ(FPTA_OK, fpta_cursor_count(range, &n, INT_MAX));
+      EXPECT_EQ(FPTA_OK, fpta_cursor_close(range));
+    }
+    return n;
+  };
+  auto expect = [&](const char *from, const char *to) {
+    return size_t(std::count_if(
+        expected.begin(), expected.end(),
+        [&](const std::string &url) { return url >= from && url < to; }));
+  };
+  for (const auto &range :
+       std::vector<std::pair<const char *, const char *>>{
+           {"https://example.com/api/", "https://example.com/api0"},
+           {"http://", "http:/~"},
+           {"http", "https://example.com/static/c"},
+           {"a", "https://example.com/apj"},
+           {"https://example.com/static/b", "zz"}})
+    EXPECT_EQ(expect(range.first, range.second),
+              count(range.first, range.second));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  free(pt);
+  fpta_name_destroy(&col_tn);
+  fpta_name_destroy(&col_n);
+  fpta_name_destroy(&col_name);
+  fpta_name_destroy(&col_tenant);
+  fpta_name_destroy(&col_url);
+  fpta_name_destroy(&table);
+  EXPECT_EQ(FPTA_SUCCESS, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+TEST(Smoke, KeyLength) {
+  /* Smoke-проверка индексов с увеличенным ограничением длины ключей:
+   * длинные ключи с общим началом должны сохраняться точно, с правильным
+   * порядком строк, поиском по значению и по диапазону. */
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime_default,
+                                  4, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("path", fptu_cstr,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("title", fptu_cstr,
+                                 fpta_secondary_withdups_ordered_obverse,
+                                 &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("note", fptu_cstr,
+                                 fpta_secondary_withdups_ordered_obverse |
+                                     fpta_index_fnullable,
+                                 &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("n", fptu_uint64, fpta_index_none, &def));
+
+  const char *const prefixes[] = {"/usr/"};
+  EXPECT_EQ(FPTA_EINVAL, fpta_describe_key_length("path", &def, 56));
+  EXPECT_EQ(FPTA_NO_INDEX, fpta_describe_key_length("n", &def, 300));
+  EXPECT_EQ(FPTA_EFLAG, fpta_describe_key_length("note", &def, 300));
+  EXPECT_EQ(FPTA_COLUMN_MISSING, fpta_describe_key_length("none", &def, 300));
+  EXPECT_EQ(FPTA_OK, fpta_describe_key_length("path", &def, 300));
+  EXPECT_EQ(FPTA_EEXIST, fpta_describe_key_length("path", &def, 300));
+  EXPECT_EQ(FPTA_EFLAG, fpta_describe_key_prefixes("path", &def, prefixes, 1));
+  EXPECT_EQ(FPTA_OK, fpta_describe_key_length("title", &def, 200));
+  ASSERT_EQ(FPTA_OK, fpta_column_set_validate(&def));
+
+  /* ограничение больше допустимого libmdbx размера ключа */
+  EXPECT_EQ(FPTA_OK, fpta_column_set_reset(&def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("path", fptu_cstr,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK, fpta_describe_key_length("path", &def, 65000));
+  fpta_txn *txn = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  EXPECT_EQ(FPTA_DATALEN_MISMATCH, fpta_table_create(txn, "table", &def));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, true));
+
+  EXPECT_EQ(FPTA_OK, fpta_column_set_reset(&def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("path", fptu_cstr,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("title", fptu_cstr,
+                                 fpta_secondary_withdups_ordered_obverse,
+                                 &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("n", fptu_uint64, fpta_index_none, &def));
+  EXPECT_EQ(FPTA_OK, fpta_describe_key_length("path", &def, 300));
+  EXPECT_EQ(FPTA_OK, fpta_describe_key_length("title", &def, 200));
+
+  txn = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+
+  /* ключи различаются только после fpta_max_keylen байт, в том числе
+   * длиной равной размеру подрезанного ключа с хэшем */
+  const std::string common(fpta_max_keylen + 20, '/');
+  std::vector<std::string> paths = {"", "a", "b/c", common,
+                                    common.substr(0, fpta_max_keylen + 8)};
+  for (char c = 'a'; c < 'k'; ++c) {
+    paths.push_back(common + std::string(1, c));
+    paths.push_back(common + std::string(1, c) + std::string(150, c));
+    paths.push_back(common.substr(0, fpta_max_keylen + 1) + c);
+  }
+
+  fpta_name table, col_path, col_title, col_n;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_path, "path"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_title, "title"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_n, "n"));
+  fptu_rw *pt = fptu_alloc(8, 1024);
+  ASSERT_NE(nullptr, pt);
+
+  auto begin = [&](fpta_level level) {
+    txn = nullptr;
+    EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, level, &txn));
+    ASSERT_NE(nullptr, txn);
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &col_path));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_title));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_n));
+  };
+  auto title = [&](size_t i) { return common + std::to_string(i % 7); };
+  auto make_row = [&](const std::string &path, size_t i) {
+    EXPECT_EQ(FPTU_OK, fptu_clear(pt));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_path, fpta_value_str(path)));
+    EXPECT_EQ(FPTA_OK,
+              fpta_upsert_column(pt, &col_title, fpta_value_str(title(i))));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_n, fpta_value_uint(i)));
+    return fptu_take_noshrink(pt);
+  };
+
+  begin(fpta_write);
+  for (size_t i = 0; i < paths.size(); ++i)
+    ASSERT_EQ(FPTA_OK, fpta_insert_row(txn, &table, make_row(paths[i], i)));
+  EXPECT_EQ(FPTA_DATALEN_MISMATCH,
+            fpta_insert_row(txn, &table, make_row(std::string(301, 'z'), 0)));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  std::vector<std::string> expected(paths);
+  std::sort(expected.begin(), expected.end());
+
+  begin(fpta_read);
+  fpta_cursor *cursor = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_cursor_open(txn, &col_path, fpta_value_begin(),
+                                      fpta_value_end(), nullptr,
+                                      fpta_ascending, &cursor));
+  std::vector<std::string> scanned;
+  fptu_ro row;
+  fpta_value value;
+  while (fpta_cursor_eof(cursor) == FPTA_OK) {
+    ASSERT_EQ(FPTA_OK, fpta_cursor_key(cursor, &value));
+    ASSERT_EQ(fpta_string, value.type);
+    scanned.emplace_back(value.str, value.binary_length);
+    ASSERT_EQ(FPTA_OK, fpta_cursor_get(cursor, &row));
+    ASSERT_EQ(FPTA_OK, fpta_get_column(row, &col_path, &value));
+    EXPECT_EQ(scanned.back(), std::string(value.str, value.binary_length));
+    int rc = fpta_cursor_move(cursor, fpta_next);
+    ASSERT_TRUE(rc == FPTA_OK || rc == FPTA_NODATA);
+  }
+  EXPECT_EQ(expected, scanned);
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+
+  for (const auto &path : paths) {
+    fpta_value key = fpta_value_str(path);
+    EXPECT_EQ(FPTA_OK, fpta_get(txn, &col_path, &key, &row));
+  }
+  fpta_value key = fpta_value_str(common + "k");
+  EXPECT_EQ(FPTA_NOTFOUND, fpta_get(txn, &col_path, &key, &row));
+  const std::string too_long(301, 'z');
+  key = fpta_value_str(too_long);
+  EXPECT_EQ(FPTA_DATALEN_MISMATCH, fpta_get(txn, &col_path, &key, &row));
+
+  /* границы диапазонов длиннее fpta_key::place хранятся в курсоре */
+  auto count = [&](fpta_name *column, const std::string &from,
+                   const std::string &to) {
+    fpta_cursor *range = nullptr;
+    size_t n = ~size_t(0);
+    EXPECT_EQ(FPTA_OK, fpta_cursor_open(txn, column, fpta_value_str(from),
+                                        fpta_value_str(to), nullptr,
+                                        fpta_ascending, &range));
+    if (range) {
+      EXPECT_EQ(FPTA_OK, fpta_cursor_count(range, &n, INT_MAX));
+      EXPECT_EQ(FPTA_OK, fpta_cursor_close(range));
+    }
+    return n;
+  };
+  for (const auto &range : std::vector<std::pair<std::string, std::string>>{
+           {common + "b", common + "f"},
+           {common + "b" + std::string(150, 'b'), common + "c"},
+           {"", common + "a"},
+           {common.substr(0, fpta_max_keylen + 1) + "c", "b"}})
+    EXPECT_EQ(size_t(std::count_if(expected.begin(), expected.end(),
+                                   [&](const std::string &path) {
+                                     return path >= range.first &&
+                                            path < range.second;
+                                   })),
+              count(&col_path, range.first, range.second));
+
+  size_t titles = 0;
+  for (size_t i = 0; i < paths.size(); ++i)
+    titles += (title(i) >= title(2) && title(i) < title(5)) ? 1 : 0;
+  EXPECT_EQ(titles, count(&col_title, title(2), title(5)));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  free(pt);
+  fpta_name_destroy(&col_n);
+  fpta_name_destroy(&col_title);
+  fpta_name_destroy(&col_path);
+  fpta_name_destroy(&table);
+  EXPECT_EQ(FPTA_SUCCESS, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+TEST(Smoke, HashIndex) {
+  /* Smoke-проверка хэш-индексов: вставка с расщеплением корзин, поиск,
+   * изменение ключей и PK, удаление, пакетная вставка, выгрузка и загрузка,
+   * очистка таблицы и повторное открытие БД. */
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime_default,
+                                  32, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("pk", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("name", fptu_cstr,
+                                 fpta_secondary_unique_unordered, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("code", fptu_uint64,
+                                 fpta_secondary_unique_unordered, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("grp", fptu_uint64,
+                                 fpta_secondary_withdups_ordered_obverse,
+                                 &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("note", fptu_cstr, fpta_noindex_nullable,
+                                 &def));
+
+  EXPECT_EQ(FPTA_EFLAG, fpta_describe_hash_index("pk", &def));
+  EXPECT_EQ(FPTA_EFLAG, fpta_describe_hash_index("grp", &def));
+  EXPECT_EQ(FPTA_NO_INDEX, fpta_describe_hash_index("note", &def));
+  EXPECT_EQ(FPTA_COLUMN_MISSING, fpta_describe_hash_index("none", &def));
+  EXPECT_EQ(FPTA_OK, fpta_describe_hash_index("name", &def));
+  EXPECT_EQ(FPTA_EEXIST, fpta_describe_hash_index("name", &def));
+  EXPECT_EQ(FPTA_OK, fpta_describe_hash_index("code", &def));
+  ASSERT_EQ(FPTA_OK, fpta_column_set_validate(&def));
+
+  fpta_txn *txn = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "copy", &def));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+
+  fpta_name table, copy, col_pk, col_name, col_code, col_grp, copy_pk,
+      copy_name, copy_code;
+  auto init = [&]() {
+    EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+    EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_pk, "pk"));
+    EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_name, "name"));
+    EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_code, "code"));
+    EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_grp, "grp"));
+    EXPECT_EQ(FPTA_OK, fpta_table_init(&copy, "copy"));
+    EXPECT_EQ(FPTA_OK, fpta_column_init(&copy, &copy_pk, "pk"));
+    EXPECT_EQ(FPTA_OK, fpta_column_init(&copy, &copy_name, "name"));
+    EXPECT_EQ(FPTA_OK, fpta_column_init(&copy, &copy_code, "code"));
+  };
+  auto destroy = [&]() {
+    fpta_name_destroy(&copy_code);
+    fpta_name_destroy(&copy_name);
+    fpta_name_destroy(&copy_pk);
+    fpta_name_destroy(&copy);
+    fpta_name_destroy(&col_grp);
+    fpta_name_destroy(&col_code);
+    fpta_name_destroy(&col_name);
+    fpta_name_destroy(&col_pk);
+    fpta_name_destroy(&table);
+  };
+  init();
+  fptu_rw *pt = fptu_alloc(8, 256);
+  ASSERT_NE(nullptr, pt);
+
+  auto begin = [&](fpta_level level) {
+    txn = nullptr;
+    EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, level, &txn));
+    ASSERT_NE(nullptr, txn);
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &col_pk));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_name));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_code));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_grp));
+  };
+  auto make_row = [&](uint64_t pk, const std::string &name, uint64_t code) {
+    EXPECT_EQ(FPTU_OK, fptu_clear(pt));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_pk, fpta_value_uint(pk)));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_name, fpta_value_str(name)));
+    EXPECT_EQ(FPTA_OK,
+              fpta_upsert_column(pt, &col_code, fpta_value_uint(code)));
+    EXPECT_EQ(FPTA_OK,
+              fpta_upsert_column(pt, &col_grp, fpta_value_uint(pk % 13)));
+    return fptu_take_noshrink(pt);
+  };
+
+  /* модель содержимого таблицы: pk -> <name, code> */
+  std::map<uint64_t, std::pair<std::string, uint64_t>> model;
+  auto verify = [&](fpta_name *table_id, fpta_name *by_pk, fpta_name *by_name,
+                    fpta_name *by_code) {
+    SCOPED_TRACE("verify " + std::to_string(model.size()));
+    txn = nullptr;
+    ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+    ASSERT_NE(nullptr, txn);
+    size_t rows = 0;
+    EXPECT_EQ(FPTA_OK, fpta_table_info(txn, table_id, &rows, nullptr));
+    EXPECT_EQ(model.size(), rows);
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, table_id, by_pk));
+    fptu_ro row;
+    fpta_value value;
+    for (const auto &entry : model) {
+      fpta_value key = fpta_value_str(entry.second.first);
+      ASSERT_EQ(FPTA_OK, fpta_get(txn, by_name, &key, &row));
+      EXPECT_EQ(FPTA_OK, fpta_get_column(row, by_pk, &value));
+      EXPECT_EQ(entry.first, value.uint);
+      key = fpta_value_uint(entry.second.second);
+      ASSERT_EQ(FPTA_OK, fpta_get(txn, by_code, &key, &row));
+      EXPECT_EQ(FPTA_OK, fpta_get_column(row, by_pk, &value));
+      EXPECT_EQ(entry.first, value.uint);
+    }
+    fpta_value key = fpta_value_cstr("missing");
+    EXPECT_EQ(FPTA_NOTFOUND, fpta_get(txn, by_name, &key, &row));
+    key = fpta_value_uint(UINT64_MAX);
+    EXPECT_EQ(FPTA_NOTFOUND, fpta_get(txn, by_code, &key, &row));
+    EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  };
+
+  /* вставка с многократным расщеплением корзин */
+  const uint64_t n = 20000;
+  for (uint64_t i = 0; i < n;) {
+    begin(fpta_write);
+    for (const uint64_t end = i + n / 4; i < end; ++i) {
+      const std::string name = "name-" + std::to_string(i);
+      const uint64_t code = i * 7919 % n;
+      ASSERT_EQ(FPTA_OK, fpta_insert_row(txn, &table, make_row(i, name, code)));
+      model[i] = std::make_pair(name, code);
+    }
+    EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  }
+  verify(&table, &col_pk, &col_name, &col_code);
+
+  /* нарушения уникальности обнаруживаются предварительной проверкой */
+  begin(fpta_write);
+  EXPECT_EQ(FPTA_KEYEXIST,
+            fpta_validate_insert_row(txn, &table, make_row(n, "name-42", n)));
+  EXPECT_EQ(FPTA_KEYEXIST,
+            fpta_validate_insert_row(txn, &table, make_row(n, "unique", 42)));
+  EXPECT_EQ(FPTA_OK,
+            fpta_validate_insert_row(txn, &table, make_row(n, "unique", n)));
+
+  /* курсоры и оценки по хэш-индексу выполняются по первичному индексу */
+  fpta_cursor *cursor = nullptr;
+  EXPECT_EQ(FPTA_NO_INDEX,
+            fpta_cursor_open(txn, &col_name, fpta_value_begin(),
+                             fpta_value_end(), nullptr, fpta_ascending,
+                             &cursor));
+  EXPECT_EQ(nullptr, cursor);
+  ASSERT_EQ(FPTA_OK, fpta_cursor_open(txn, &col_name, fpta_value_begin(),
+                                      fpta_value_end(), nullptr,
+                                      fpta_unsorted_dont_fetch, &cursor));
+  size_t rows_count = 0;
+  EXPECT_EQ(FPTA_OK, fpta_cursor_count(cursor, &rows_count, INT_MAX));
+  EXPECT_EQ(model.size(), rows_count);
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+  ASSERT_EQ(FPTA_OK,
+            fpta_cursor_open(txn, &col_name, fpta_value_cstr("name-42"),
+                             fpta_value_cstr("name-42"), nullptr,
+                             (fpta_cursor_options)(fpta_unsorted |
+                                                   fpta_zeroed_range_is_point),
+                             &cursor));
+  fpta_value cursor_key;
+  EXPECT_EQ(FPTA_OK, fpta_cursor_key(cursor, &cursor_key));
+  EXPECT_EQ(42u, cursor_key.uint);
+  EXPECT_EQ(FPTA_NODATA, fpta_cursor_move(cursor, fpta_next));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+  ASSERT_EQ(FPTA_OK, fpta_cursor_open(txn, &col_code, fpta_value_uint(n),
+                                      fpta_value_epsilon(), nullptr,
+                                      fpta_unsorted_dont_fetch, &cursor));
+  EXPECT_EQ(FPTA_NODATA, fpta_cursor_eof(cursor));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+  EXPECT_EQ(FPTA_NO_INDEX,
+            fpta_cursor_open(txn, &col_code, fpta_value_uint(1),
+                             fpta_value_uint(2), nullptr, fpta_unsorted,
+                             &cursor));
+  fpta_estimate_item estimate[3];
+  memset(estimate, 0, sizeof(estimate));
+  estimate[0].column_id = estimate[1].column_id = &col_code;
+  estimate[0].range_from = estimate[0].range_to = fpta_value_uint(42);
+  estimate[1].range_from = estimate[1].range_to = fpta_value_uint(n);
+  estimate[2].column_id = &col_name;
+  estimate[2].range_from = fpta_value_begin();
+  estimate[2].range_to = fpta_value_end();
+  EXPECT_EQ(FPTA_OK, fpta_estimate(txn, 3, estimate,
+                                   (fpta_cursor_options)(
+                                       fpta_unsorted |
+                                       fpta_zeroed_range_is_point)));
+  EXPECT_EQ(FPTA_OK, estimate[0].error);
+  EXPECT_EQ(1, estimate[0].estimated_rows);
+  EXPECT_EQ(FPTA_OK, estimate[1].error);
+  EXPECT_EQ(0, estimate[1].estimated_rows);
+  EXPECT_EQ(FPTA_OK, estimate[2].error);
+  EXPECT_LT(0, estimate[2].estimated_rows);
+
+  /* изменение ключей индекса и удаление строк */
+  for (uint64_t i = 0; i < n; i += 3) {
+    auto &entry = model[i];
+    entry.first = "renamed-" + std::to_string(i);
+    if (i % 2)
+      entry.second += n;
+    ASSERT_EQ(FPTA_OK,
+              fpta_update_row(txn, &table,
+                              make_row(i, entry.first, entry.second)));
+  }
+  for (uint64_t i = 1; i < n; i += 5) {
+    const auto &entry = model[i];
+    ASSERT_EQ(FPTA_OK, fpta_delete(txn, &table,
+                                   make_row(i, entry.first, entry.second)));
+    model.erase(i);
+  }
+
+  /* изменение PK с прежними ключами хэш-индексов через курсор */
+  ASSERT_EQ(FPTA_OK,
+            fpta_cursor_open(txn, &col_grp, fpta_value_uint(7),
+                             fpta_value_uint(7), nullptr,
+                             (fpta_cursor_options)(fpta_unsorted |
+                                                   fpta_zeroed_range_is_point),
+                             &cursor));
+  ASSERT_NE(nullptr, cursor);
+  size_t moved = 0;
+  for (int rc = fpta_cursor_eof(cursor); rc == FPTA_OK;
+       rc = fpta_cursor_move(cursor, fpta_next)) {
+    fptu_ro row;
+    ASSERT_EQ(FPTA_OK, fpta_cursor_get(cursor, &row));
+    fpta_value value;
+    ASSERT_EQ(FPTA_OK, fpta_get_column(row, &col_pk, &value));
+    const uint64_t pk = value.uint;
+    if (pk >= n)
+      continue;
+    /* новый PK дает тот же остаток от деления на 13 */
+    const uint64_t new_pk = pk + n * 13;
+    const auto entry = model[pk];
+    ASSERT_EQ(FPTA_OK,
+              fpta_cursor_update(cursor, make_row(new_pk, entry.first,
+                                                  entry.second)));
+    model.erase(pk);
+    model[new_pk] = entry;
+    ++moved;
+  }
+  EXPECT_LT(0u, moved);
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  verify(&table, &col_pk, &col_name, &col_code);
+
+  /* пакетная вставка и обновление */
+  std::vector<std::string> batch_rows;
+  std::vector<fptu_ro> batch;
+  auto batch_add = [&](uint64_t pk, const std::string &name, uint64_t code) {
+    const fptu_ro row = make_row(pk, name, code);
+    batch_rows.emplace_back((const char *)row.sys.iov_base, row.sys.iov_len);
+  };
+  auto batch_put = [&]() {
+    batch.clear();
+    for (const auto &bytes : batch_rows) {
+      fptu_ro row;
+      row.sys.iov_base = (void *)bytes.data();
+      row.sys.iov_len = bytes.size();
+      batch.push_back(row);
+    }
+    return fpta_put_batch(txn, &table, batch.data(), batch.size(),
+                          fpta_upsert, 1);
+  };
+  for (uint64_t i = 2 * n; i < 2 * n + 5000; ++i) {
+    const std::string name = "batch-" + std::to_string(i);
+    batch_add(i, name, i);
+    model[i] = std::make_pair(name, i);
+  }
+  for (uint64_t i = 2; i < n; i += 5) {
+    const auto it = model.find(i);
+    if (it == model.end())
+      continue;
+    it->second.first = "batch-renamed-" + std::to_string(i);
+    batch_add(i, it->second.first, it->second.second);
+  }
+  begin(fpta_write);
+  ASSERT_EQ(FPTA_OK, batch_put());
+  /* ключ уже имеющийся в БД */
+  batch_rows.clear();
+  for (uint64_t i = 3 * n; i < 3 * n + 5000; ++i)
+    batch_add(i, "unique-" + std::to_string(i), i);
+  batch_add(4 * n, model.begin()->second.first, 4 * n);
+  EXPECT_EQ(FPTA_KEYEXIST, batch_put());
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  batch_rows.clear();
+  verify(&table, &col_pk, &col_name, &col_code);
+
+  /* пакетное чтение */
+  begin(fpta_read);
+  std::vector<fpta_value> keys;
+  for (const auto &entry : model)
+    keys.push_back(fpta_value_str(entry.second.first));
+  keys.push_back(fpta_value_cstr("missing"));
+  std::vector<fptu_ro> rows(keys.size());
+  std::vector<int> errors(keys.size());
+  EXPECT_EQ(FPTA_NOTFOUND, fpta_get_many(txn, &col_name, keys.data(),
+                                         keys.size(), rows.data(),
+                                         errors.data()));
+  size_t i = 0;
+  for (const auto &entry : model) {
+    ASSERT_EQ(FPTA_OK, errors[i]);
+    fpta_value value;
+    EXPECT_EQ(FPTA_OK, fpta_get_column(rows[i], &col_pk, &value));
+    EXPECT_EQ(entry.first, value.uint);
+    ++i;
+  }
+  EXPECT_EQ(FPTA_NOTFOUND, errors[i]);
+
+  /* выгрузка и загрузка в другую таблицу */
+  std::string dump;
+  size_t count = 0;
+  EXPECT_EQ(FPTA_OK, fpta_table_dump(txn, &table, dump_output, &dump, &count));
+  EXPECT_EQ(model.size(), count);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  dump_input_ctx input = {&dump, 0};
+  begin(fpta_write);
+  EXPECT_EQ(FPTA_OK,
+            fpta_table_restore(txn, &copy, dump_input, &input, &count));
+  EXPECT_EQ(model.size(), count);
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  verify(&copy, &copy_pk, &copy_name, &copy_code);
+
+  /* повторное открытие БД */
+  destroy();
+  EXPECT_EQ(FPTA_SUCCESS, fpta_db_close(db));
+  db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime_default,
+                                  32, false, &db));
+  ASSERT_NE(nullptr, db);
+  init();
+  verify(&table, &col_pk, &col_name, &col_code);
+
+  /* очистка таблицы сбрасывает и хэш-таблицу */
+  begin(fpta_write);
+  EXPECT_EQ(FPTA_OK, fpta_table_clear(txn, &table, true));
+  model.clear();
+  for (uint64_t i = 0; i < 1000; ++i) {
+    const std::string name = "again-" + std::to_string(i);
+    ASSERT_EQ(FPTA_OK, fpta_insert_row(txn, &table, make_row(i, name, i)));
+    model[i] = std::make_pair(name, i);
+  }
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  verify(&table, &col_pk, &col_name, &col_code);
+
+  free(pt);
+  destroy();
+  EXPECT_EQ(FPTA_SUCCESS, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+TEST(Smoke, UpdateUnchangedIndexes) {
+  /* Smoke-проверка пропуска вторичных индексов при обновлении строк:
+   * индексы, исходные колонки которых не изменились, не должны обновляться,
+   * а затронутые изменением (в том числе составные) должны оставаться
+   * согласованными с таблицей. */
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime_default,
+                                  4, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("id", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("a", fptu_uint64,
+                                 fpta_secondary_withdups_ordered_obverse,
+                                 &def));
+  EXPECT_EQ(FPTA_OK, fpta_column_describe("b", fptu_int32, fpta_index_none,
+                                          &def));
+  EXPECT_EQ(FPTA_OK, fpta_column_describe("n", fptu_uint64, fpta_index_none,
+                                          &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("note", fptu_cstr,
+                                 fpta_index_none | fpta_index_fnullable,
+                                 &def));
+  EXPECT_EQ(FPTA_OK, fpta_describe_composite_index_va(
+                         "bn", fpta_secondary_withdups_ordered_obverse, &def,
+                         "b", "n", nullptr));
+  ASSERT_EQ(FPTA_OK, fpta_column_set_validate(&def));
+
+  fpta_txn *txn = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+
+  fpta_name table, col_id, col_a, col_b, col_n, col_note, col_bn;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_id, "id"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_a, "a"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_b, "b"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_n, "n"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_note, "note"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_bn, "bn"));
+  fptu_rw *pt = fptu_alloc(8, 256);
+  ASSERT_NE(nullptr, pt);
+
+  auto begin = [&](fpta_level level) {
+    txn = nullptr;
+    EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, level, &txn));
+    ASSERT_NE(nullptr, txn);
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &col_id));
+    for (fpta_name *column : {&col_a, &col_b, &col_n, &col_note, &col_bn})
+      EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, column));
+  };
+  auto make_row = [&](unsigned id, unsigned a, int b, const char *note) {
+    EXPECT_EQ(FPTU_OK, fptu_clear(pt));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_id, fpta_value_uint(id)));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_a, fpta_value_uint(a)));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_b, fpta_value_sint(b)));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_n, fpta_value_uint(id)));
+    if (note) {
+      EXPECT_EQ(FPTA_OK,
+                fpta_upsert_column(pt, &col_note, fpta_value_cstr(note)));
+    }
+    return fptu_take_noshrink(pt);
+  };
+  /* номера строк в порядке индекса */
+  auto scan = [&](fpta_name *column) {
+    std::vector<unsigned> ids;
+    fpta_cursor *cursor = nullptr;
+    EXPECT_EQ(FPTA_OK, fpta_cursor_open(txn, column, fpta_value_begin(),
+                                        fpta_value_end(), nullptr,
+                                        fpta_ascending, &cursor));
+    fptu_ro row;
+    fpta_value value;
+    while (cursor && fpta_cursor_eof(cursor) == FPTA_OK) {
+      EXPECT_EQ(FPTA_OK, fpta_cursor_get(cursor, &row));
+      EXPECT_EQ(FPTA_OK, fpta_get_column(row, &col_id, &value));
+      ids.push_back(unsigned(value.uint));
+      int rc = fpta_cursor_move(cursor, fpta_next);
+      EXPECT_TRUE(rc == FPTA_OK || rc == FPTA_NODATA);
+    }
+    if (cursor) {
+      EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+    }
+    return ids;
+  };
+
+  begin(fpta_write);
+  for (unsigned id = 0; id < 6; ++id)
+    ASSERT_EQ(FPTA_OK,
+              fpta_insert_row(txn, &table, make_row(id, id % 3, -int(id), "")));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  const std::vector<unsigned> by_a = {0, 3, 1, 4, 2, 5};
+  const std::vector<unsigned> by_bn = {5, 4, 3, 2, 1, 0};
+
+  /* изменение только неиндексированной колонки */
+  begin(fpta_write);
+  for (unsigned id = 0; id < 6; ++id)
+    EXPECT_EQ(FPTA_OK, fpta_update_row(txn, &table,
+                                       make_row(id, id % 3, -int(id),
+                                                id & 1 ? "odd" : nullptr)));
+  EXPECT_EQ(by_a, scan(&col_a));
+  EXPECT_EQ(by_bn, scan(&col_bn));
+
+  /* изменение колонки составного индекса */
+  EXPECT_EQ(FPTA_OK,
+            fpta_update_row(txn, &table, make_row(2, 2, -10, "changed")));
+  EXPECT_EQ(by_a, scan(&col_a));
+  EXPECT_EQ(std::vector<unsigned>({2, 5, 4, 3, 1, 0}), scan(&col_bn));
+
+  /* изменение колонки обычного вторичного индекса */
+  EXPECT_EQ(FPTA_OK, fpta_update_row(txn, &table, make_row(0, 7, 0, "")));
+  EXPECT_EQ(std::vector<unsigned>({3, 1, 4, 2, 5, 0}), scan(&col_a));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  /* обновление через курсор вторичного индекса */
+  begin(fpta_write);
+  fpta_cursor *cursor = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_cursor_open(txn, &col_a, fpta_value_begin(),
+                                      fpta_value_end(), nullptr,
+                                      fpta_ascending, &cursor));
+  ASSERT_NE(nullptr, cursor);
+  EXPECT_EQ(FPTA_OK, fpta_cursor_update(cursor, make_row(3, 0, -3, "cursor")));
+  EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+  EXPECT_EQ(std::vector<unsigned>({3, 1, 4, 2, 5, 0}), scan(&col_a));
+  EXPECT_EQ(std::vector<unsigned>({2, 5, 4, 3, 1, 0}), scan(&col_bn));
+
+  fptu_ro row;
+  fpta_value value, key = fpta_value_uint(3);
+  EXPECT_EQ(FPTA_OK, fpta_get(txn, &col_id, &key, &row));
+  EXPECT_EQ(FPTA_OK, fpta_get_column(row, &col_note, &value));
+  EXPECT_EQ(std::string("cursor"), std::string(value.str));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  free(pt);
+  for (fpta_name *column :
+       {&col_bn, &col_note, &col_n, &col_b, &col_a, &col_id})
+    fpta_name_destroy(column);
+  fpta_name_destroy(&table);
+  EXPECT_EQ(FPTA_SUCCESS, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+TEST(Smoke, PutBatch) {
+  /* Smoke-проверка пакетной вставки/обновления строк: вторичные индексы
+   * должны оставаться согласованными с таблицей, а нарушения ограничений
+   * должны обнаруживаться до внесения изменений. */
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_weak, fpta_regime_default,
+                                  16, true, &db));
+  ASSERT_NE(nullptr, db);
+
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("id", fptu_uint64,
+                                 fpta_primary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("u", fptu_uint64,
+                                 fpta_secondary_unique_ordered_obverse, &def));
+  EXPECT_EQ(FPTA_OK,
+            fpta_column_describe("a", fptu_uint64,
+                                 fpta_secondary_withdups_ordered_obverse,
+                                 &def));
+  ASSERT_EQ(FPTA_OK, fpta_column_set_validate(&def));
+
+  fpta_txn *txn = nullptr;
+  EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+  ASSERT_NE(nullptr, txn);
+  ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+  EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+
+  fpta_name table, col_id, col_u, col_a;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_id, "id"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_u, "u"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_a, "a"));
+  fptu_rw *pt = fptu_alloc(3, 64);
+  ASSERT_NE(nullptr, pt);
+
+  auto begin = [&](fpta_level level) {
+    txn = nullptr;
+    EXPECT_EQ(FPTA_OK, fpta_transaction_begin(db, level, &txn));
+    ASSERT_NE(nullptr, txn);
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh_couple(txn, &table, &col_id));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_u));
+    EXPECT_EQ(FPTA_OK, fpta_name_refresh(txn, &col_a));
+  };
+  /* пакет строк, каждая в собственном буфере */
+  std::vector<std::vector<uint64_t>> buffers;
+  std::vector<fptu_ro> batch;
+  auto add_row = [&](unsigned id, unsigned u, unsigned a) {
+    EXPECT_EQ(FPTU_OK, fptu_clear(pt));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_id, fpta_value_uint(id)));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_u, fpta_value_uint(u)));
+    EXPECT_EQ(FPTA_OK, fpta_upsert_column(pt, &col_a, fpta_value_uint(a)));
+    const fptu_ro row = fptu_take_noshrink(pt);
+    buffers.emplace_back((row.total_bytes + 7) / 8);
+    memcpy(buffers.back().data(), row.units, row.total_bytes);
+    batch.push_back(row);
+  };
+  unsigned threads = 4;
+  auto put = [&](fpta_put_options op) {
+    for (size_t i = 0; i < batch.size(); ++i)
+      batch[i].units = (const fptu_unit *)buffers[i].data();
+    const int rc =
+        fpta_put_batch(txn, &table, batch.data(), batch.size(), op, threads);
+    buffers.clear();
+    batch.clear();
+    return rc;
+  };
+  /* пары <значение колонки, id> в порядке индекса */
+  auto scan = [&](fpta_name *column) {
+    std::vector<std::pair<unsigned, unsigned>> pairs;
+    fpta_cursor *cursor = nullptr;
+    EXPECT_EQ(FPTA_OK, fpta_cursor_open(txn, column, fpta_value_begin(),
+                                        fpta_value_end(), nullptr,
+                                        fpta_ascending, &cursor));
+    fptu_ro row;
+    fpta_value id, value;
+    while (cursor && fpta_cursor_eof(cursor) == FPTA_OK) {
+      EXPECT_EQ(FPTA_OK, fpta_cursor_get(cursor, &row));
+      EXPECT_EQ(FPTA_OK, fpta_get_column(row, &col_id, &id));
+      EXPECT_EQ(FPTA_OK, fpta_get_column(row, column, &value));
+      pairs.emplace_back(unsigned(value.uint), unsigned(id.uint));
+      int rc = fpta_cursor_move(cursor, fpta_next);
+      EXPECT_TRUE(rc == FPTA_OK || rc == FPTA_NODATA);
+    }
+    if (cursor) {
+      EXPECT_EQ(FPTA_OK, fpta_cursor_close(cursor));
+    }
+    return pairs;
+  };
+  /* ожидаемое содержимое индекса по значениям колонок строк */
+  auto expect = [&](const std::vector<unsigned> &values) {
+    std::vector<std::pair<unsigned, unsigned>> pairs;
+    for (unsigned id = 0; id < values.size(); ++id)
+      pairs.emplace_back(values[id], id);
+    std::sort(pairs.begin(), pairs.end());
+    return pairs;
+  };
+
+  /* достаточно большой пакет для задействования рабочих потоков */
+  const unsigned count = 5000;
+  std::vector<unsigned> u(count), a(count);
+  begin(fpta_write);
+  for (unsigned id = 0; id < count; ++id) {
+    u[id] = count - id;
+    a[id] = id % 7;
+    add_row(id, u[id], a[id]);
+  }
+  EXPECT_EQ(FPTA_OK, put(fpta_insert));
+  EXPECT_EQ(expect(u), scan(&col_u));
+  EXPECT_EQ(expect(a), scan(&col_a));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  /* Нарушения ограничений не прерывают транзакцию. Пакеты дополняются
+   * неизменными строками, чтобы они не обрабатывались последовательно. */
+  auto pad = [&](unsigned first, unsigned last) {
+    for (unsigned id = 0; id < count; ++id)
+      if (id < first || id > last)
+        add_row(id, u[id], a[id]);
+  };
+  begin(fpta_write);
+  for (unsigned id = 1; id < count; ++id)
+    add_row(count + id, count * 3 + id, 0);
+  add_row(1, count * 2 + 1, 0);
+  EXPECT_EQ(FPTA_KEYEXIST, put(fpta_insert));
+  pad(count, count);
+  add_row(count, count * 2, 0);
+  EXPECT_EQ(FPTA_NOTFOUND, put(fpta_update));
+  /* дубликат внутри пакета */
+  pad(1, 2);
+  add_row(1, count * 2, 1);
+  add_row(2, count * 2, 2);
+  EXPECT_EQ(FPTA_KEYEXIST, put(fpta_upsert));
+  /* дубликат с не затронутой пакетом строкой */
+  pad(1, 3);
+  add_row(1, u[1], 1);
+  add_row(2, u[3], 2);
+  EXPECT_EQ(FPTA_KEYEXIST, put(fpta_upsert));
+  EXPECT_EQ(expect(u), scan(&col_u));
+  EXPECT_EQ(expect(a), scan(&col_a));
+
+  /* обмен значениями уникальной колонки, недопустимый для fpta_put() */
+  for (unsigned id = 0; id < count; ++id) {
+    std::swap(u[id], u[count - 1 - id]);
+    if (id % 3 == 0)
+      a[id] += 1;
+  }
+  for (unsigned id = 0; id < count; ++id)
+    add_row(id, u[id], a[id]);
+  /* ключи всех индексов формируются в одном проходе по строкам */
+  threads = 1;
+  EXPECT_EQ(FPTA_OK, put(fpta_update));
+  threads = 4;
+  EXPECT_EQ(expect(u), scan(&col_u));
+  EXPECT_EQ(expect(a), scan(&col_a));
+
+  /* повторы PK применяются последовательно */
+  add_row(count, count * 2, 1);
+  add_row(count, count * 2 + 1, 2);
+  EXPECT_EQ(FPTA_OK, put(fpta_upsert));
+  u.push_back(count * 2 + 1);
+  a.push_back(2);
+  EXPECT_EQ(expect(u), scan(&col_u));
+  EXPECT_EQ(expect(a), scan(&col_a));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  /* небольшой пакет обрабатывается последовательно, при этом ошибка
+   * после внесения части строк прерывает транзакцию */
+  begin(fpta_write);
+  add_row(1, count * 3, 0);
+  add_row(count + 1, count * 3 + 1, 0);
+  EXPECT_EQ(FPTA_KEYEXIST, put(fpta_insert));
+  add_row(count + 1, count * 3 + 1, 0);
+  add_row(1, count * 3, 0);
+  EXPECT_EQ(FPTA_KEYEXIST, put(fpta_insert));
+  EXPECT_EQ(FPTA_TXN_CANCELLED, fpta_transaction_end(txn, false));
+
+  begin(fpta_read);
+  EXPECT_EQ(expect(u), scan(&col_u));
+  EXPECT_EQ(expect(a), scan(&col_a));
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  free(pt);
+  fpta_name_destroy(&col_a);
+  fpta_name_destroy(&col_u);
+  fpta_name_destroy(&col_id);
+  fpta_name_destroy(&table);
+  EXPECT_EQ(FPTA_SUCCESS, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   mdbx_setup_debug(MDBX_LOG_WARN,
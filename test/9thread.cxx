@@ -897,6 +897,164 @@ TEST(Threaded, AsyncSchemaChange) {
 
 //------------------------------------------------------------------------------
 
+struct group_commit_item {
+  fpta_name *table, *col_num, *col_thread;
+  fptu_rw *pt;
+  uint64_t num;
+  int thread_num;
+  unsigned calls;
+  bool fail;
+};
+
+static int group_commit_insert(fpta_txn *txn, void *arg) {
+  group_commit_item *item = static_cast<group_commit_item *>(arg);
+  item->calls += 1;
+  int rc = fpta_name_refresh_couple(txn, item->table, item->col_num);
+  if (rc == FPTA_OK)
+    rc = fpta_name_refresh(txn, item->col_thread);
+  if (rc != FPTA_OK)
+    return rc;
+
+  // все функции выполняются одним потоком-писателем
+  rc = fptu_clear(item->pt);
+  if (rc == FPTU_OK)
+    rc = fpta_upsert_column(item->pt, item->col_num,
+                            fpta_value_uint(item->num));
+  if (rc == FPTA_OK)
+    rc = fpta_upsert_column(item->pt, item->col_thread,
+                            fpta_value_sint(item->thread_num));
+  if (rc == FPTA_OK)
+    rc = fpta_insert_row(txn, item->table, fptu_take_noshrink(item->pt));
+
+  // строка вставлена, но функция сообщает об ошибке и вставка должна быть
+  // отменена без влияния на остальные функции группы
+  if (rc == FPTA_OK && item->fail)
+    rc = FPTA_EVALUE;
+  return rc;
+}
+
+static void group_commit_thread_proc(fpta_group_commit *gc,
+                                     group_commit_item *items, size_t count,
+                                     size_t *succeeded) {
+  // часть функций передается асинхронно, часть с ожиданием результата
+  std::vector<fpta_commit_ticket *> tickets(count, nullptr);
+  for (size_t i = 0; i < count; i += 2)
+    EXPECT_EQ(FPTA_OK, fpta_group_commit_submit(gc, group_commit_insert,
+                                                &items[i], &tickets[i]));
+
+  *succeeded = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const int rc =
+        tickets[i] ? fpta_group_commit_wait(tickets[i])
+                   : fpta_group_commit_execute(gc, group_commit_insert,
+                                               &items[i]);
+    EXPECT_EQ(items[i].fail ? FPTA_EVALUE : FPTA_OK, rc);
+    *succeeded += (rc == FPTA_OK) ? 1 : 0;
+  }
+}
+
+TEST(Threaded, GroupCommit) {
+  // чистим
+  if (REMOVE_FILE(testdb_name) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+  if (REMOVE_FILE(testdb_name_lck) != 0) {
+    ASSERT_EQ(ENOENT, errno);
+  }
+
+  fpta_db *db = nullptr;
+  ASSERT_EQ(FPTA_OK, test_db_open(testdb_name, fpta_sync, fpta_saferam, 8,
+                                  true, &db));
+  ASSERT_NE(nullptr, db);
+
+  { // create table
+    fpta_column_set def;
+    fpta_column_set_init(&def);
+    EXPECT_EQ(FPTA_OK,
+              fpta_column_describe("num", fptu_uint64,
+                                   fpta_primary_unique_ordered_obverse, &def));
+    EXPECT_EQ(FPTA_OK, fpta_column_describe("thread", fptu_int64,
+                                            fpta_index_none, &def));
+
+    fpta_txn *txn = nullptr;
+    ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_schema, &txn));
+    ASSERT_EQ(FPTA_OK, fpta_table_create(txn, "table", &def));
+    ASSERT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+    EXPECT_EQ(FPTA_OK, fpta_column_set_destroy(&def));
+  }
+
+  fpta_name table, col_num, col_thread;
+  EXPECT_EQ(FPTA_OK, fpta_table_init(&table, "table"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_num, "num"));
+  EXPECT_EQ(FPTA_OK, fpta_column_init(&table, &col_thread, "thread"));
+  fptu_rw *pt = fptu_alloc(2, 16);
+  ASSERT_NE(nullptr, pt);
+
+  fpta_group_commit *gc = nullptr;
+  EXPECT_EQ(FPTA_EINVAL, fpta_group_commit_open(nullptr, 0, &gc));
+  ASSERT_EQ(FPTA_OK, fpta_group_commit_open(db, 64, &gc));
+  ASSERT_NE(nullptr, gc);
+
+  const int threadNum = 8;
+  const size_t reps = 500;
+  std::vector<group_commit_item> items(threadNum * reps);
+  for (size_t i = 0; i < items.size(); ++i) {
+    group_commit_item &item = items[i];
+    item.table = &table;
+    item.col_num = &col_num;
+    item.col_thread = &col_thread;
+    item.pt = pt;
+    item.num = i;
+    item.thread_num = int(i / reps);
+    item.calls = 0;
+    item.fail = (i % 7) == 3;
+  }
+
+  std::vector<size_t> succeeded(threadNum);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < threadNum; ++i)
+    threads.push_back(std::thread(group_commit_thread_proc, gc,
+                                  &items[i * reps], reps, &succeeded[i]));
+  for (auto &it : threads)
+    it.join();
+
+  // повторные выполнения ограничены, даже при множестве неудач в группе
+  for (const group_commit_item &item : items)
+    EXPECT_GE(5u, item.calls);
+
+  // повторная вставка тех же ключей должна быть отвергнута
+  EXPECT_EQ(FPTA_KEYEXIST,
+            fpta_group_commit_execute(gc, group_commit_insert, &items[0]));
+  EXPECT_EQ(FPTA_OK, fpta_group_commit_close(gc));
+
+  size_t expected = 0;
+  for (size_t n : succeeded)
+    expected += n;
+  size_t row_count = 0;
+  fpta_txn *txn = nullptr;
+  ASSERT_EQ(FPTA_OK, fpta_transaction_begin(db, fpta_read, &txn));
+  EXPECT_EQ(FPTA_OK, fpta_table_info(txn, &table, &row_count, nullptr));
+  EXPECT_EQ(expected, row_count);
+  EXPECT_EQ(items.size() - (items.size() + 3) / 7, row_count);
+  for (const group_commit_item &item : items) {
+    fptu_ro row;
+    const fpta_value key = fpta_value_uint(item.num);
+    EXPECT_EQ(item.fail ? FPTA_NOTFOUND : FPTA_OK,
+              fpta_get(txn, &col_num, &key, &row));
+  }
+  EXPECT_EQ(FPTA_OK, fpta_transaction_end(txn, false));
+
+  free(pt);
+  fpta_name_destroy(&table);
+  fpta_name_destroy(&col_num);
+  fpta_name_destroy(&col_thread);
+  EXPECT_EQ(FPTA_OK, fpta_db_close(db));
+  ASSERT_TRUE(REMOVE_FILE(testdb_name) == 0);
+  ASSERT_TRUE(REMOVE_FILE(testdb_name_lck) == 0);
+}
+
+//------------------------------------------------------------------------------
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   mdbx_setup_debug(MDBX_LOG_WARN,
@@ -0,0 +1,858 @@
+/*
+ *  Fast Positive Tables (libfpta), aka Позитивные Таблицы.
+ *  Copyright 2016-2020 Leonid Yuriev <leo@yuriev.ru>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/* Тест производительности с итеративным усложнением схемы.
+ *
+ * Для каждого сочетания кол-ва колонок, кол-ва вторичных индексов, типа
+ * первичного ключа и режима durability создается новая БД, после чего
+ * последовательно выполняются сценарии: insert, upsert, upsert_batch, get,
+ * scan, secondary_scan и cursor_update. При наличии неиндексированных колонок
+ * дополнительно сравниваются экспоненциальное сглаживание посредством
+ * fpta_cursor_inplace() (inplace_bes) и аналогичный расчет на стороне
+ * приложения с обновлением всей строки (rmw_bes), а также инкремент
+ * счетчика по ключу посредством fpta_inplace_by_key(). Изменения
+ * группируются в транзакции по --batch операций, а сценарий upsert_batch
+ * передает все изменения транзакции единым пакетом в fpta_put_batch()
+ * с использованием --threads потоков.
+ *
+ * Помимо uint64 и коротких строк, первичный ключ может быть URL-подобной
+ * строкой с длинными общими префиксами, в том числе со словарем префиксов
+ * (см. fpta_describe_key_prefixes()). Для сравнения эффекта от сжатия ключей
+ * после вставки строк выводятся высота B-дерева первичного индекса,
+ * количество страниц и занимаемое место (сценарий btree), а сценарий get
+ * показывает задержку поиска по ключу.
+ *
+ * Дополнительно в таблицу может быть добавлен составной вторичный индекс
+ * по последним --composite неиндексированным колонкам, что позволяет оценить
+ * затраты на формирование составных ключей при вставке и обновлении строк.
+ * Сценарии composite_key и composite_key_legacy отдельно от операций с БД
+ * сравнивают формирование составного ключа подготовленными кодировщиками
+ * и прежней реализацией с поиском каждого элемента в строке.
+ *
+ * С опцией --unordered в таблицу добавляется уникальный неупорядоченный
+ * вторичный индекс по строковому представлению ключа, а сценарий
+ * get_unordered показывает задержку поиска по нему. При включенном
+ * посредством --row-cache кэше строк сценарии get и get_unordered
+ * повторяются (get_cached и get_unordered_cached) с заполненным кэшем,
+ * что позволяет сравнить их с get и get_unordered без кэша. С опцией
+ * --hashed этот индекс хранится расширяемой хэш-таблицей
+ * (см. fpta_describe_hash_index()), а сценарий btree_uk
+ * в обоих случаях выводит параметры дерева индекса для их сравнения.
+ *
+ * Ключи и порядок обращений определяются только параметром --seed, поэтому
+ * прогоны воспроизводимы. Результаты выводятся в stdout в формате JSON:
+ * пропускная способность (с учетом фиксации транзакций) и перцентили
+ * задержки отдельных операций, а для пишущих сценариев также задержки
+ * фиксации транзакций. */
+
+#include <fast_positive/tables.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <io.h>
+#define unlink _unlink
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+/* Вид первичного ключа. */
+struct key_kind {
+  const char *name;
+  fptu_type type;
+  bool url /* URL-подобные строки с длинными общими префиксами */;
+  bool prefixed /* со словарем префиксов */;
+};
+
+static const key_kind key_kinds[] = {{"uint64", fptu_uint64, false, false},
+                                     {"string", fptu_cstr, false, false},
+                                     {"url", fptu_cstr, true, false},
+                                     {"url_prefixed", fptu_cstr, true, true}};
+
+/* Общие префиксы URL-подобных ключей, упорядоченные для словаря. */
+static const char *const url_prefixes[] = {
+    "https://api.example.com/v1/", "https://cdn.example.com/img/",
+    "https://www.example.com/catalog/", "https://www.example.com/static/"};
+
+struct options {
+  size_t rows = 100000;
+  size_t batch = 100;
+  unsigned threads = 0;
+  size_t row_cache = 0;
+  bool unordered = false;
+  bool hashed = false;
+  uint64_t seed = 42;
+  std::string path = "fpta_bench.fpta";
+  std::vector<unsigned> columns = {4, 16, 64};
+  std::vector<unsigned> indexes = {0, 1, 3};
+  std::vector<unsigned> composites = {0};
+  std::vector<const key_kind *> keys = {&key_kinds[0], &key_kinds[1]};
+  std::vector<fpta_durability> durability = {fpta_weak, fpta_lazy, fpta_sync};
+};
+
+struct config {
+  unsigned columns, indexes, composite;
+  const key_kind *key;
+  fpta_durability durability;
+};
+
+static const char *durability2str(fpta_durability durability) {
+  switch (durability) {
+  case fpta_sync:
+    return "sync";
+  case fpta_lazy:
+    return "lazy";
+  case fpta_weak:
+    return "weak";
+  default:
+    return "readonly";
+  }
+}
+
+static void check(int rc, const char *what) {
+  if (rc != FPTA_SUCCESS) {
+    fprintf(stderr, "fpta_bench: %s failed: %d, %s\n", what, rc,
+            fpta_strerror(rc));
+    exit(EXIT_FAILURE);
+  }
+}
+
+static uint64_t now_ns() {
+  return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now().time_since_epoch())
+                      .count());
+}
+
+/* Задержки отдельных операций, перцентили вычисляются по полной выборке. */
+class samples {
+  std::vector<uint64_t> values;
+
+public:
+  void reserve(size_t n) { values.reserve(n); }
+  void add(uint64_t ns) { values.push_back(ns); }
+  bool empty() const { return values.empty(); }
+
+  void json(FILE *out, const char *name) {
+    assert(!values.empty());
+    std::sort(values.begin(), values.end());
+    const auto quantile = [this](double q) {
+      return values[std::min(values.size() - 1, size_t(q * values.size()))];
+    };
+    fprintf(out,
+            "\"%s\": {\"p50\": %" PRIu64 ", \"p90\": %" PRIu64
+            ", \"p99\": %" PRIu64 ", \"p999\": %" PRIu64 ", \"max\": %" PRIu64
+            "}",
+            name, quantile(0.5), quantile(0.9), quantile(0.99),
+            quantile(0.999), values.back());
+  }
+};
+
+class bench {
+  const options &opt;
+  const config cfg;
+  fpta_db *db = nullptr;
+  fpta_name table, col_pk, col_uk, col_cx, col[fpta_max_cols];
+  fptu_rw *pt = nullptr;
+  char keybuf[64], ukbuf[24];
+  std::vector<uint64_t> order;
+  std::vector<uint64_t> scratch;
+  FILE *const out;
+  bool &first_result;
+
+  /* Биективное перемешивание номера строки в значение ключа. */
+  uint64_t key4row(size_t n) const {
+    return (uint64_t(n) ^ opt.seed) * UINT64_C(0x9E3779B97F4A7C15);
+  }
+
+  fpta_value key2value(uint64_t key) {
+    if (cfg.key->type == fptu_uint64)
+      return fpta_value_uint(key);
+    if (cfg.key->url)
+      snprintf(keybuf, sizeof(keybuf), "%s%016" PRIx64,
+               url_prefixes[key >> 62], key);
+    else
+      snprintf(keybuf, sizeof(keybuf), "%016" PRIx64, key);
+    return fpta_value_cstr(keybuf);
+  }
+
+  fpta_value uk2value(uint64_t key) {
+    snprintf(ukbuf, sizeof(ukbuf), "%016" PRIx64, key);
+    return fpta_value_cstr(ukbuf);
+  }
+
+  uint64_t value2key(const fpta_value &value) const {
+    if (cfg.key->type == fptu_uint64)
+      return value.uint;
+    return strtoull(value.str + value.binary_length - 16, nullptr, 16);
+  }
+
+  fptu_ro make_row(uint64_t key, uint64_t generation) {
+    check(fptu_clear(pt), "fptu_clear");
+    check(fpta_upsert_column(pt, &col_pk, key2value(key)), "upsert_column");
+    if (opt.unordered)
+      check(fpta_upsert_column(pt, &col_uk, uk2value(key)), "upsert_column");
+    for (unsigned i = 1; i < cfg.columns; ++i) {
+      /* у индексированных колонок около 16K различных значений */
+      const uint64_t value =
+          (i <= cfg.indexes ? key >> 50 : key + i) + generation;
+      check(fpta_upsert_column(pt, &col[i], fpta_value_uint(value)),
+            "upsert_column");
+    }
+    return fptu_take_noshrink(pt);
+  }
+
+  void refresh(fpta_txn *txn) {
+    check(fpta_name_refresh_couple(txn, &table, &col_pk),
+          "fpta_name_refresh_couple");
+    if (opt.unordered)
+      check(fpta_name_refresh_couple(txn, &table, &col_uk),
+            "fpta_name_refresh_couple");
+    for (unsigned i = 1; i < cfg.columns; ++i)
+      check(fpta_name_refresh_couple(txn, &table, &col[i]),
+            "fpta_name_refresh_couple");
+    if (cfg.composite)
+      check(fpta_name_refresh_couple(txn, &table, &col_cx),
+            "fpta_name_refresh_couple");
+  }
+
+  void remove_files() {
+    unlink(opt.path.c_str());
+    unlink((opt.path + "-lck").c_str());
+  }
+
+  void open() {
+    remove_files();
+    fpta_db_creation_params_t creation_params;
+    memset(&creation_params, 0, sizeof(creation_params));
+    creation_params.params_size = sizeof(creation_params);
+    creation_params.file_mode = 0640;
+    creation_params.size_lower = -1;
+    creation_params.size_upper = intptr_t(1)
+                                 << (sizeof(intptr_t) > 4 ? 36 : 30);
+    creation_params.pagesize = -1;
+    creation_params.growth_step = 16 << 20;
+    creation_params.shrink_threshold = -1;
+    check(fpta_db_create_or_open(opt.path.c_str(), cfg.durability,
+                                 fpta_regime_default, true, &db,
+                                 &creation_params),
+          "fpta_db_create_or_open");
+    if (opt.row_cache)
+      check(fpta_db_row_cache(db, opt.row_cache), "fpta_db_row_cache");
+
+    fpta_column_set def;
+    fpta_column_set_init(&def);
+    check(fpta_column_describe("pk", cfg.key->type,
+                               fpta_primary_unique_ordered_obverse, &def),
+          "fpta_column_describe");
+    if (cfg.key->prefixed)
+      check(fpta_describe_key_prefixes("pk", &def, url_prefixes,
+                                       sizeof(url_prefixes) /
+                                           sizeof(url_prefixes[0])),
+            "fpta_describe_key_prefixes");
+    if (opt.unordered)
+      check(fpta_column_describe("uk", fptu_cstr,
+                                 fpta_secondary_unique_unordered, &def),
+            "fpta_column_describe");
+    if (opt.hashed)
+      check(fpta_describe_hash_index("uk", &def), "fpta_describe_hash_index");
+    for (unsigned i = 1; i < cfg.columns; ++i) {
+      const std::string name = "c" + std::to_string(i);
+      check(fpta_column_describe(name.c_str(), fptu_uint64,
+                                 i <= cfg.indexes
+                                     ? fpta_secondary_withdups_ordered_obverse
+                                     : fpta_noindex_nullable,
+                                 &def),
+            "fpta_column_describe");
+    }
+    if (cfg.composite) {
+      std::vector<std::string> names;
+      for (unsigned i = cfg.columns - cfg.composite; i < cfg.columns; ++i)
+        names.push_back("c" + std::to_string(i));
+      std::vector<const char *> items;
+      for (const auto &name : names)
+        items.push_back(name.c_str());
+      check(fpta_describe_composite_index(
+                "cx", fpta_secondary_withdups_ordered_obverse, &def,
+                items.data(), items.size()),
+            "fpta_describe_composite_index");
+    }
+
+    fpta_txn *txn = nullptr;
+    check(fpta_transaction_begin(db, fpta_schema, &txn), "transaction_begin");
+    check(fpta_table_create(txn, "bench", &def), "fpta_table_create");
+    check(fpta_transaction_end(txn, false), "transaction_end");
+    check(fpta_column_set_destroy(&def), "fpta_column_set_destroy");
+
+    check(fpta_table_init(&table, "bench"), "fpta_table_init");
+    check(fpta_column_init(&table, &col_pk, "pk"), "fpta_column_init");
+    if (opt.unordered)
+      check(fpta_column_init(&table, &col_uk, "uk"), "fpta_column_init");
+    for (unsigned i = 1; i < cfg.columns; ++i) {
+      const std::string name = "c" + std::to_string(i);
+      check(fpta_column_init(&table, &col[i], name.c_str()),
+            "fpta_column_init");
+    }
+    if (cfg.composite)
+      check(fpta_column_init(&table, &col_cx, "cx"), "fpta_column_init");
+
+    pt = fptu_alloc(cfg.columns + 1,
+                    cfg.columns * 8 + sizeof(keybuf) + sizeof(ukbuf));
+    if (!pt)
+      check(FPTA_ENOMEM, "fptu_alloc");
+  }
+
+  void close() {
+    free(pt);
+    pt = nullptr;
+    fpta_name_destroy(&table);
+    fpta_name_destroy(&col_pk);
+    if (opt.unordered)
+      fpta_name_destroy(&col_uk);
+    for (unsigned i = 1; i < cfg.columns; ++i)
+      fpta_name_destroy(&col[i]);
+    if (cfg.composite)
+      fpta_name_destroy(&col_cx);
+    check(fpta_db_close(db), "fpta_db_close");
+    db = nullptr;
+    remove_files();
+  }
+
+  void report(const char *scenario, size_t ops, uint64_t elapsed_ns,
+              samples &latency, samples &commit) {
+    const double seconds = elapsed_ns / 1e9;
+    fprintf(out,
+            "%s\n    {\"columns\": %u, \"indexes\": %u, \"composite\": %u, "
+            "\"key\": \"%s\", \"durability\": \"%s\", \"scenario\": \"%s\", "
+            "\"ops\": %zu, \"seconds\": %.6f, \"ops_per_sec\": %.1f",
+            first_result ? "" : ",", cfg.columns, cfg.indexes, cfg.composite,
+            cfg.key->name, durability2str(cfg.durability), scenario, ops,
+            seconds,
+            seconds > 0 ? ops / seconds : 0.0);
+    if (!latency.empty()) {
+      fprintf(out, ", ");
+      latency.json(out, "latency_ns");
+    }
+    if (!commit.empty()) {
+      fprintf(out, ", ");
+      commit.json(out, "commit_latency_ns");
+    }
+    fprintf(out, "}");
+    fflush(out);
+    first_result = false;
+  }
+
+  /* Выводит параметры B-дерева первичного индекса, а также индекса uk. */
+  void report_btree() {
+    fpta_txn *txn = nullptr;
+    check(fpta_transaction_begin(db, fpta_read, &txn), "transaction_begin");
+    refresh(txn);
+    /* с запасом для индексов uk и cx */
+    const size_t bytes = sizeof(fpta_table_stat) +
+                         sizeof(fpta_table_stat::index_cost_info) *
+                             (cfg.columns + 2);
+    std::vector<uint64_t> buffer((bytes + 7) / 8);
+    fpta_table_stat &stat = *reinterpret_cast<fpta_table_stat *>(&buffer[0]);
+    size_t row_count;
+    check(fpta_table_info_ex(txn, &table, &row_count, &stat, bytes),
+          "fpta_table_info_ex");
+    check(fpta_transaction_end(txn, false), "transaction_end");
+
+    for (unsigned i = 0; i < stat.index_costs_provided; ++i) {
+      const fpta_table_stat::index_cost_info &index = stat.index_costs[i];
+      if (i > 0 && (!opt.unordered || index.column_shove != col_uk.shove))
+        continue;
+      fprintf(out,
+              "%s\n    {\"columns\": %u, \"indexes\": %u, \"composite\": %u, "
+              "\"key\": \"%s\", \"durability\": \"%s\", "
+              "\"scenario\": \"%s\", \"rows\": %zu, \"btree_depth\": %u, "
+              "\"branch_pages\": %zu, \"leaf_pages\": %zu, "
+              "\"large_pages\": %zu, \"bytes\": %zu}",
+              first_result ? "" : ",", cfg.columns, cfg.indexes, cfg.composite,
+              cfg.key->name, durability2str(cfg.durability),
+              i ? "btree_uk" : "btree", row_count, index.btree_depth,
+              index.branch_pages, index.leaf_pages, index.large_pages,
+              index.bytes);
+      first_result = false;
+    }
+    fflush(out);
+  }
+
+  void report_row_cache() {
+    fpta_db_stat_t stat;
+    check(fpta_db_info(db, nullptr, &stat), "fpta_db_info");
+    fprintf(out,
+            "%s\n    {\"columns\": %u, \"indexes\": %u, \"composite\": %u, "
+            "\"key\": \"%s\", \"durability\": \"%s\", "
+            "\"scenario\": \"row_cache\", \"capacity\": %" PRIu64 ", "
+            "\"hits\": %" PRIu64 ", \"misses\": %" PRIu64 ", "
+            "\"evictions\": %" PRIu64 "}",
+            first_result ? "" : ",", cfg.columns, cfg.indexes, cfg.composite,
+            cfg.key->name, durability2str(cfg.durability),
+            stat.row_cache.capacity, stat.row_cache.hits,
+            stat.row_cache.misses, stat.row_cache.evictions);
+    fflush(out);
+    first_result = false;
+  }
+
+  /* Выполняет op() для каждой строки в порядке order, группируя операции
+   * в транзакции по opt.batch штук. */
+  template <typename OP>
+  void run(const char *scenario, fpta_level level, OP op) {
+    samples latency, commit;
+    latency.reserve(order.size());
+    const uint64_t start = now_ns();
+    for (size_t i = 0; i < order.size();) {
+      fpta_txn *txn = nullptr;
+      check(fpta_transaction_begin(db, level, &txn), "transaction_begin");
+      refresh(txn);
+      for (size_t n = 0; n < opt.batch && i < order.size(); ++n, ++i) {
+        const uint64_t t = now_ns();
+        op(txn, order[i]);
+        latency.add(now_ns() - t);
+      }
+      const uint64_t t = now_ns();
+      check(fpta_transaction_end(txn, false), "transaction_end");
+      if (level != fpta_read)
+        commit.add(now_ns() - t);
+    }
+    report(scenario, order.size(), now_ns() - start, latency, commit);
+  }
+
+  /* Обновляет все строки в порядке order посредством fpta_put_batch(),
+   * передавая по opt.batch строк за транзакцию. Задержка учитывается
+   * для пакета целиком, а кол-во операций - по строкам. */
+  void run_batch(const char *scenario, uint64_t generation) {
+    samples latency, commit;
+    std::vector<std::vector<uint64_t>> buffers(opt.batch);
+    std::vector<fptu_ro> rows(opt.batch);
+    const uint64_t start = now_ns();
+    for (size_t i = 0; i < order.size();) {
+      size_t n = 0;
+      for (; n < opt.batch && i < order.size(); ++n, ++i) {
+        rows[n] = make_row(order[i], generation);
+        buffers[n].resize((rows[n].total_bytes + 7) / 8);
+        rows[n].units = (const fptu_unit *)memcpy(
+            buffers[n].data(), rows[n].units, rows[n].total_bytes);
+      }
+      fpta_txn *txn = nullptr;
+      check(fpta_transaction_begin(db, fpta_write, &txn), "transaction_begin");
+      refresh(txn);
+      uint64_t t = now_ns();
+      check(fpta_put_batch(txn, &table, rows.data(), n, fpta_upsert,
+                           opt.threads),
+            "fpta_put_batch");
+      latency.add(now_ns() - t);
+      t = now_ns();
+      check(fpta_transaction_end(txn, false), "transaction_end");
+      commit.add(now_ns() - t);
+    }
+    report(scenario, order.size(), now_ns() - start, latency, commit);
+  }
+
+  /* Формирует составной ключ для заранее подготовленных строк посредством
+   * fpta_get_column4key() (composite_key), а затем прежней реализацией
+   * с поиском каждого элемента в строке (composite_key_legacy). Ключи
+   * сверяются, после чего реализации поочередно выполняются в нескольких
+   * раундах и для каждой выводится пропускная способность лучшего из них.
+   * Задержки отдельных вызовов сопоставимы с накладными расходами на их
+   * измерение и не учитываются. */
+  void run_composite_key() {
+    std::vector<std::vector<uint64_t>> buffers(order.size());
+    std::vector<fptu_ro> rows(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+      rows[i] = make_row(order[i], 0);
+      buffers[i].resize((rows[i].total_bytes + 7) / 8);
+      rows[i].units = (const fptu_unit *)memcpy(
+          buffers[i].data(), rows[i].units, rows[i].total_bytes);
+    }
+
+    fpta_txn *txn = nullptr;
+    check(fpta_transaction_begin(db, fpta_read, &txn), "transaction_begin");
+    refresh(txn);
+    fpta_value4key key, legacy;
+    for (const fptu_ro &row : rows) {
+      check(fpta_get_column4key(row, &col_cx, &key), "fpta_get_column4key");
+      check(__fpta_composite_row2key_legacy(row, &col_cx, &legacy),
+            "__fpta_composite_row2key_legacy");
+      if (key.value.binary_length != legacy.value.binary_length ||
+          memcmp(key.value.binary_data, legacy.value.binary_data,
+                 key.value.binary_length) != 0)
+        check(FPTA_EOOPS, "composite key mismatch");
+    }
+
+    /* реализации чередуются, для каждой выводится лучший из раундов */
+    const size_t passes =
+        rows.empty() ? 0 : std::max<size_t>(1, 200000 / rows.size());
+    uint64_t best = UINT64_MAX, best_legacy = UINT64_MAX;
+    for (unsigned round = 0; round < 5; ++round) {
+      uint64_t start = now_ns();
+      for (size_t n = 0; n < passes; ++n)
+        for (const fptu_ro &row : rows)
+          check(fpta_get_column4key(row, &col_cx, &key),
+                "fpta_get_column4key");
+      best = std::min(best, now_ns() - start);
+
+      start = now_ns();
+      for (size_t n = 0; n < passes; ++n)
+        for (const fptu_ro &row : rows)
+          check(__fpta_composite_row2key_legacy(row, &col_cx, &legacy),
+                "__fpta_composite_row2key_legacy");
+      best_legacy = std::min(best_legacy, now_ns() - start);
+    }
+    samples none;
+    report("composite_key", passes * rows.size(), best, none, none);
+    report("composite_key_legacy", passes * rows.size(), best_legacy, none,
+           none);
+    check(fpta_transaction_end(txn, false), "transaction_end");
+  }
+
+  /* Проход курсором по всем строкам таблицы посредством заданного индекса,
+   * при обновлении с фиксацией транзакции через каждые opt.batch строк. */
+  void scan(const char *scenario, fpta_name *column) {
+    scan(scenario, column, false, [](fpta_cursor *, fptu_ro, uint64_t) {});
+  }
+
+  template <typename OP>
+  void scan(const char *scenario, fpta_name *column, bool update, OP op) {
+    samples latency, commit;
+    latency.reserve(order.size());
+    const fpta_level level = update ? fpta_write : fpta_read;
+    size_t ops = 0;
+    bool resume = false;
+    uint64_t resume_key = 0;
+    const uint64_t start = now_ns();
+    for (;;) {
+      fpta_txn *txn = nullptr;
+      check(fpta_transaction_begin(db, level, &txn), "transaction_begin");
+      refresh(txn);
+      const fpta_value from =
+          resume ? key2value(resume_key) : fpta_value_begin();
+      fpta_cursor *cursor = nullptr;
+      int rc = fpta_cursor_open(txn, column, from, fpta_value_end(), nullptr,
+                                fpta_ascending, &cursor);
+      if (rc == FPTA_NODATA) {
+        /* таблица пуста */
+        check(fpta_transaction_end(txn, false), "transaction_end");
+        break;
+      }
+      check(rc, "fpta_cursor_open");
+      if (resume)
+        rc = fpta_cursor_move(cursor, fpta_next);
+      size_t n = 0;
+      while (rc == FPTA_SUCCESS && (!update || n < opt.batch)) {
+        const uint64_t t = now_ns();
+        fptu_ro row;
+        check(fpta_cursor_get(cursor, &row), "fpta_cursor_get");
+        if (update) {
+          fpta_value pk;
+          check(fpta_get_column(row, &col_pk, &pk), "fpta_get_column");
+          resume_key = value2key(pk);
+          op(cursor, row, resume_key);
+        }
+        rc = fpta_cursor_move(cursor, fpta_next);
+        latency.add(now_ns() - t);
+        ++n;
+      }
+      if (rc != FPTA_NODATA)
+        check(rc, "fpta_cursor_move");
+      check(fpta_cursor_close(cursor), "fpta_cursor_close");
+      const uint64_t t = now_ns();
+      check(fpta_transaction_end(txn, false), "transaction_end");
+      if (update)
+        commit.add(now_ns() - t);
+      ops += n;
+      if (rc == FPTA_NODATA)
+        break;
+      resume = true;
+    }
+    report(scenario, ops, now_ns() - start, latency, commit);
+  }
+
+public:
+  bench(const options &opt, const config &cfg, FILE *out, bool &first_result)
+      : opt(opt), cfg(cfg), out(out), first_result(first_result) {
+    memset(&table, 0, sizeof(table));
+    memset(&col_pk, 0, sizeof(col_pk));
+    memset(&col_uk, 0, sizeof(col_uk));
+    memset(&col_cx, 0, sizeof(col_cx));
+    memset(col, 0, sizeof(col));
+  }
+
+  void execute() {
+    open();
+
+    order.resize(opt.rows);
+    for (size_t i = 0; i < order.size(); ++i)
+      order[i] = key4row(i);
+
+    run("insert", fpta_write, [this](fpta_txn *txn, uint64_t key) {
+      check(fpta_insert_row(txn, &table, make_row(key, 0)), "fpta_insert_row");
+    });
+    report_btree();
+    if (cfg.composite)
+      run_composite_key();
+
+    std::mt19937_64 rng(opt.seed);
+    std::shuffle(order.begin(), order.end(), rng);
+    run("upsert", fpta_write, [this](fpta_txn *txn, uint64_t key) {
+      check(fpta_upsert_row(txn, &table, make_row(key, 1)), "fpta_upsert_row");
+    });
+    std::shuffle(order.begin(), order.end(), rng);
+    run_batch("upsert_batch", 3);
+
+    std::shuffle(order.begin(), order.end(), rng);
+    const auto get = [this](fpta_txn *txn, uint64_t key) {
+      const fpta_value value = key2value(key);
+      fptu_ro row;
+      check(fpta_get(txn, &col_pk, &value, &row), "fpta_get");
+    };
+    run("get", fpta_read, get);
+    if (opt.row_cache) {
+      /* повтор с заполненным кэшем, сравнивается с get без --row-cache */
+      run("get_cached", fpta_read, get);
+      report_row_cache();
+    }
+    if (opt.unordered) {
+      const auto get_unordered = [this](fpta_txn *txn, uint64_t key) {
+        const fpta_value value = uk2value(key);
+        fptu_ro row;
+        check(fpta_get(txn, &col_uk, &value, &row), "fpta_get");
+      };
+      run("get_unordered", fpta_read, get_unordered);
+      if (opt.row_cache) {
+        run("get_unordered_cached", fpta_read, get_unordered);
+        report_row_cache();
+      }
+    }
+
+    scan("scan", &col_pk);
+    if (cfg.indexes > 0)
+      scan("secondary_scan", &col[1]);
+    scan("cursor_update", &col_pk, true,
+         [this](fpta_cursor *cursor, fptu_ro, uint64_t key) {
+           check(fpta_cursor_update(cursor, make_row(key, 2)),
+                 "fpta_cursor_update");
+         });
+
+    if (cfg.columns > cfg.indexes + 1) {
+      /* сглаживание первой неиндексированной колонки с коэффициентом 2^-3 */
+      fpta_name *const target = &col[cfg.indexes + 1];
+      scan("inplace_bes", &col_pk, true,
+           [this, target](fpta_cursor *cursor, fptu_ro, uint64_t key) {
+             const int rc =
+                 fpta_cursor_inplace(cursor, target, fpta_bes,
+                                     fpta_value_uint(key >> 8),
+                                     fpta_value_sint(-3));
+             if (rc != FPTA_NODATA)
+               check(rc, "fpta_cursor_inplace");
+           });
+      scan("rmw_bes", &col_pk, true,
+           [this, target](fpta_cursor *cursor, fptu_ro row, uint64_t key) {
+             fpta_value present;
+             check(fpta_get_column(row, target, &present), "fpta_get_column");
+             const uint64_t sample = key >> 8;
+             const uint64_t distance = (sample > present.uint)
+                                           ? sample - present.uint
+                                           : present.uint - sample;
+             const uint64_t step = (distance >> 3) + ((distance >> 2) & 1);
+             if (step == 0)
+               return;
+
+             const size_t bytes = fptu_get_buffer_size(row, 0, 0);
+             scratch.resize((bytes + 7) / 8);
+             fptu_rw *rw = fptu_fetch(row, scratch.data(), bytes, 0);
+             if (!rw)
+               check(FPTA_EOOPS, "fptu_fetch");
+             check(fpta_upsert_column(
+                       rw, target,
+                       fpta_value_uint(sample > present.uint
+                                           ? present.uint + step
+                                           : present.uint - step)),
+                   "upsert_column");
+             check(fpta_cursor_update(cursor, fptu_take_noshrink(rw)),
+                   "fpta_cursor_update");
+           });
+
+      std::shuffle(order.begin(), order.end(), rng);
+      run("inplace_by_key", fpta_write,
+          [this, target](fpta_txn *txn, uint64_t key) {
+            const fpta_value value = key2value(key);
+            check(fpta_inplace_by_key(txn, &col_pk, &value, target,
+                                      fpta_saturated_add, fpta_value_uint(1)),
+                  "fpta_inplace_by_key");
+          });
+    }
+
+    close();
+  }
+};
+
+static bool parse_list(const char *arg, std::vector<unsigned> &list) {
+  list.clear();
+  for (char *end; *arg; arg = (*end == ',') ? end + 1 : end) {
+    const unsigned long value = strtoul(arg, &end, 10);
+    if (end == arg || (*end != ',' && *end != '\0'))
+      return false;
+    list.push_back(unsigned(value));
+  }
+  return !list.empty();
+}
+
+static bool parse_keys(const char *arg, std::vector<const key_kind *> &list) {
+  list.clear();
+  for (const char *end; *arg; arg = (*end == ',') ? end + 1 : end) {
+    end = arg + strcspn(arg, ",");
+    const key_kind *kind = nullptr;
+    for (const key_kind &k : key_kinds)
+      if (strlen(k.name) == size_t(end - arg) &&
+          memcmp(k.name, arg, end - arg) == 0)
+        kind = &k;
+    if (!kind)
+      return false;
+    list.push_back(kind);
+  }
+  return !list.empty();
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: fpta_bench [options]\n"
+          "  --rows N           rows per table (default 100000)\n"
+          "  --batch N          operations per write transaction (100)\n"
+          "  --threads N        threads for fpta_put_batch(), 0 for all (0)\n"
+          "  --row-cache N      row cache capacity, see fpta_db_row_cache()\n"
+          "  --unordered        extra unique unordered index for lookups\n"
+          "  --hashed           same index stored as an extendible hash table\n"
+          "  --seed N           seed for keys and access order (42)\n"
+          "  --path FILE        database pathname (fpta_bench.fpta)\n"
+          "  --columns LIST     columns per table, e.g. 4,16,64\n"
+          "  --indexes LIST     secondary indexes per table, e.g. 0,1,3\n"
+          "  --composite LIST   columns in an extra composite index, e.g. 0,4\n"
+          "  --keys LIST        primary key types: uint64,string,url,\n"
+          "                     url_prefixed\n"
+          "  --durability LIST  durability modes: weak,lazy,sync\n"
+          "  --quick            short run for a smoke check\n");
+}
+
+} // namespace
+
+int main(int argc, const char *argv[]) {
+  options opt;
+  for (int i = 1; i < argc; ++i) {
+    const char *const arg = argv[i];
+    const char *const value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    bool ok = true;
+    if (strcmp(arg, "--quick") == 0) {
+      opt.rows = 1000;
+      opt.columns = {4, 16};
+      opt.indexes = {0, 1};
+      opt.durability = {fpta_weak};
+      continue;
+    } else if (strcmp(arg, "--unordered") == 0) {
+      opt.unordered = true;
+      continue;
+    } else if (strcmp(arg, "--hashed") == 0) {
+      opt.unordered = opt.hashed = true;
+      continue;
+    } else if (!value) {
+      ok = false;
+    } else if (strcmp(arg, "--rows") == 0) {
+      opt.rows = strtoull(value, nullptr, 10);
+    } else if (strcmp(arg, "--batch") == 0) {
+      opt.batch = std::max<size_t>(1, strtoull(value, nullptr, 10));
+    } else if (strcmp(arg, "--row-cache") == 0) {
+      opt.row_cache = strtoull(value, nullptr, 10);
+    } else if (strcmp(arg, "--threads") == 0) {
+      opt.threads = unsigned(strtoul(value, nullptr, 10));
+    } else if (strcmp(arg, "--seed") == 0) {
+      opt.seed = strtoull(value, nullptr, 0);
+    } else if (strcmp(arg, "--path") == 0) {
+      opt.path = value;
+    } else if (strcmp(arg, "--columns") == 0) {
+      ok = parse_list(value, opt.columns);
+    } else if (strcmp(arg, "--indexes") == 0) {
+      ok = parse_list(value, opt.indexes);
+    } else if (strcmp(arg, "--composite") == 0) {
+      ok = parse_list(value, opt.composites);
+    } else if (strcmp(arg, "--keys") == 0) {
+      ok = parse_keys(value, opt.keys);
+    } else if (strcmp(arg, "--durability") == 0) {
+      opt.durability.clear();
+      if (strstr(value, "weak"))
+        opt.durability.push_back(fpta_weak);
+      if (strstr(value, "lazy"))
+        opt.durability.push_back(fpta_lazy);
+      if (strstr(value, "sync"))
+        opt.durability.push_back(fpta_sync);
+      ok = !opt.durability.empty();
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      usage();
+      return EXIT_FAILURE;
+    }
+    ++i;
+  }
+
+  FILE *const out = stdout;
+  fprintf(out,
+          "{\n  \"benchmark\": \"fpta_bench\",\n"
+          "  \"build\": {\"target\": \"%s\", \"compiler\": \"%s\"},\n"
+          "  \"params\": {\"rows\": %zu, \"batch\": %zu, \"seed\": %" PRIu64
+          "},\n  \"results\": [",
+          fpta_build.target, fpta_build.compiler, opt.rows, opt.batch,
+          opt.seed);
+
+  bool first_result = true;
+  for (const fpta_durability durability : opt.durability)
+    for (const key_kind *key : opt.keys)
+      for (const unsigned columns : opt.columns)
+        for (const unsigned indexes : opt.indexes)
+          for (const unsigned composite : opt.composites) {
+            if (columns < 1 || columns > fpta_max_cols || indexes >= columns ||
+                indexes >= fpta_max_indexes)
+              continue;
+            /* составной индекс только по неиндексированным колонкам,
+             * не затрагивая колонку для сценариев inplace */
+            if (composite &&
+                (composite < 2 || indexes + composite + 2 > columns ||
+                 indexes + 1 >= fpta_max_indexes))
+              continue;
+            const config cfg = {columns, indexes, composite, key, durability};
+            fprintf(stderr,
+                    "fpta_bench: %s, %s key, %u columns, %u indexes, "
+                    "%u composite\n",
+                    durability2str(durability), key->name, columns, indexes,
+                    composite);
+            bench(opt, cfg, out, first_result).execute();
+          }
+
+  fprintf(out, "\n  ]\n}\n");
+  return EXIT_SUCCESS;
+}
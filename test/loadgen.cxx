@@ -0,0 +1,690 @@
+/*
+ *  Fast Positive Tables (libfpta), aka Позитивные Таблицы.
+ *  Copyright 2016-2020 Leonid Yuriev <leo@yuriev.ru>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/* Длительный нагрузочный тест со смешанной нагрузкой: стохастический сценарий
+ * конкурирующих читателей, писателей и "изменятелей" схемы.
+ *
+ * Каждый из --threads потоков в цикле выбирает тип очередной транзакции
+ * согласно пропорциям --mix (чтение:запись:схема):
+ *  - читающая транзакция выполняет --reads выборок, после чего посредством
+ *    fpta_transaction_lag_ex() замеряет отставание от последней
+ *    зафиксированной версии;
+ *  - пишущая транзакция выполняет --writes обновлений (upsert) строк,
+ *    включая изменение проиндексированных вторичными индексами колонок;
+ *  - транзакция изменения схемы создает или удаляет вспомогательную таблицу
+ *    потока, что вынуждает остальных обновлять закэшированную схему.
+ *
+ * Схема нагрузочной таблицы и вид выборок задаются вариантом --schema:
+ *  - kv: целочисленный PK, один вторичный индекс с дубликатами и строковая
+ *    колонка, точечные выборки по PK;
+ *  - string: то же, но со строковым PK;
+ *  - wide: целочисленный PK, четыре вторичных индекса и восемь
+ *    неиндексированных числовых колонок, точечные выборки по PK;
+ *  - unique: как kv, плюс уникальный неупорядоченный вторичный индекс,
+ *    по которому и выполняются точечные выборки;
+ *  - range: как kv, но вместо точечных выборок выполняется проход курсором
+ *    по диапазону из --reads последовательных значений PK.
+ *
+ * Ключи выбираются согласно распределению --distribution: uniform, zipf
+ * (с параметром --zipf-theta) или hotspot (доля --hot-ops обращений
+ * к доле --hot-keys ключей).
+ *
+ * Раз в --interval секунд в stdout выводится строка JSON с пропускной
+ * способностью, распределением задержек транзакций каждого типа и
+ * отставанием читателей за прошедший интервал, а в конце итоговая строка
+ * со сводными данными за весь прогон. */
+
+#include <fast_positive/tables.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <io.h>
+#define unlink _unlink
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+enum kind { kind_read, kind_write, kind_schema, kinds_count };
+static const char *const kind_names[kinds_count] = {"read", "write", "schema"};
+
+enum distribution { uniform, zipf, hotspot };
+
+enum read_kind { read_pk, read_unique, read_range };
+
+/* Вариант схемы нагрузочной таблицы и выборок. */
+struct variant {
+  const char *name;
+  bool string_pk;
+  unsigned secondary /* количество вторичных индексов с дубликатами */;
+  unsigned values /* количество неиндексированных числовых колонок */;
+  bool unique /* наличие уникального неупорядоченного индекса */;
+  read_kind read;
+};
+
+enum { max_secondary = 4, max_values = 8 };
+
+static const variant variants[] = {
+    {"kv", false, 1, 0, false, read_pk},
+    {"string", true, 1, 0, false, read_pk},
+    {"wide", false, max_secondary, max_values, false, read_pk},
+    {"unique", false, 1, 0, true, read_unique},
+    {"range", false, 1, 0, false, read_range}};
+
+struct options {
+  unsigned threads = 4;
+  unsigned mix[kinds_count] = {90, 9, 1};
+  size_t keys = 100000;
+  size_t reads = 100, writes = 10;
+  distribution dist = uniform;
+  double zipf_theta = 0.99;
+  double hot_keys = 0.01, hot_ops = 0.9;
+  double duration = 60, interval = 1;
+  uint64_t seed = 42;
+  fpta_durability durability = fpta_weak;
+  const variant *schema = &variants[0];
+  std::string path;
+};
+
+static uint64_t now_ns() {
+  return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now().time_since_epoch())
+                      .count());
+}
+
+static void check(int rc, const char *what) {
+  if (rc != FPTA_SUCCESS) {
+    fprintf(stderr, "fpta_loadgen: %s failed: %d, %s\n", what, rc,
+            fpta_strerror(rc));
+    exit(EXIT_FAILURE);
+  }
+}
+
+/* Генератор номеров ключей согласно выбранному распределению. Для zipf
+ * используется заранее вычисленная функция распределения, общая для всех
+ * потоков. */
+class keygen {
+  const options &opt;
+  std::vector<double> zipf_cdf;
+
+public:
+  explicit keygen(const options &opt) : opt(opt) {
+    if (opt.dist == zipf) {
+      zipf_cdf.resize(opt.keys);
+      double sum = 0;
+      for (size_t i = 0; i < opt.keys; ++i)
+        zipf_cdf[i] = sum += 1 / std::pow(double(i + 1), opt.zipf_theta);
+      for (double &value : zipf_cdf)
+        value /= sum;
+    }
+  }
+
+  uint64_t operator()(std::mt19937_64 &rng) const {
+    std::uniform_real_distribution<double> unit(0, 1);
+    switch (opt.dist) {
+    default:
+      return rng() % opt.keys;
+    case zipf:
+      return std::min(size_t(std::lower_bound(zipf_cdf.begin(), zipf_cdf.end(),
+                                              unit(rng)) -
+                             zipf_cdf.begin()),
+                      opt.keys - 1);
+    case hotspot: {
+      const size_t hot = std::max<size_t>(1, size_t(opt.keys * opt.hot_keys));
+      return (unit(rng) < opt.hot_ops) ? rng() % hot
+                                       : hot + rng() % (opt.keys - hot);
+    }
+    }
+  }
+};
+
+/* Накопленная статистика, сбрасываемая при каждом отчете. */
+struct stats {
+  std::vector<uint64_t> latency[kinds_count];
+  size_t lag_max = 0, lag_sum = 0, lag_count = 0, retired_max = 0;
+  std::map<int, size_t> errors;
+
+  void merge(stats &other) {
+    for (unsigned k = 0; k < kinds_count; ++k) {
+      latency[k].insert(latency[k].end(), other.latency[k].begin(),
+                        other.latency[k].end());
+      other.latency[k].clear();
+    }
+    lag_max = std::max(lag_max, other.lag_max);
+    lag_sum += other.lag_sum;
+    lag_count += other.lag_count;
+    retired_max = std::max(retired_max, other.retired_max);
+    for (const auto &pair : other.errors)
+      errors[pair.first] += pair.second;
+    other.lag_max = other.lag_sum = other.lag_count = other.retired_max = 0;
+    other.errors.clear();
+  }
+
+  void json(FILE *out, double seconds) {
+    for (unsigned k = 0; k < kinds_count; ++k) {
+      std::vector<uint64_t> &values = latency[k];
+      std::sort(values.begin(), values.end());
+      fprintf(out, "\"%s\": {\"txns\": %zu, \"txns_per_sec\": %.1f",
+              kind_names[k], values.size(),
+              seconds > 0 ? values.size() / seconds : 0.0);
+      if (!values.empty()) {
+        const auto quantile = [&values](double q) {
+          return values[std::min(values.size() - 1,
+                                 size_t(q * values.size()))];
+        };
+        fprintf(out,
+                ", \"latency_ns\": {\"p50\": %" PRIu64 ", \"p90\": %" PRIu64
+                ", \"p99\": %" PRIu64 ", \"p999\": %" PRIu64
+                ", \"max\": %" PRIu64 "}",
+                quantile(0.5), quantile(0.9), quantile(0.99), quantile(0.999),
+                values.back());
+      }
+      fprintf(out, "}, ");
+    }
+    fprintf(out,
+            "\"reader_lag\": {\"max\": %zu, \"avg\": %.2f, "
+            "\"retired_max\": %zu}, \"errors\": {",
+            lag_max, lag_count ? double(lag_sum) / lag_count : 0.0,
+            retired_max);
+    bool first = true;
+    for (const auto &pair : errors) {
+      fprintf(out, "%s\"%d\": %zu", first ? "" : ", ", pair.first,
+              pair.second);
+      first = false;
+    }
+    fprintf(out, "}");
+  }
+};
+
+/* Имена таблицы и колонок согласно варианту схемы, а также формирование
+ * значений ключей и строк. */
+class load_table {
+  char keybuf[24];
+
+public:
+  const variant &var;
+  fpta_name table, col_pk, col_uk, col_payload;
+  fpta_name col_se[max_secondary], col_value[max_values];
+
+  explicit load_table(const variant &var) : var(var) {
+    check(fpta_table_init(&table, "load"), "fpta_table_init");
+    check(fpta_column_init(&table, &col_pk, "pk"), "fpta_column_init");
+    if (var.unique)
+      check(fpta_column_init(&table, &col_uk, "uk"), "fpta_column_init");
+    check(fpta_column_init(&table, &col_payload, "payload"),
+          "fpta_column_init");
+    for (unsigned i = 0; i < var.secondary; ++i)
+      check(fpta_column_init(&table, &col_se[i], column_name("se", i).c_str()),
+            "fpta_column_init");
+    for (unsigned i = 0; i < var.values; ++i)
+      check(fpta_column_init(&table, &col_value[i],
+                             column_name("v", i).c_str()),
+            "fpta_column_init");
+  }
+
+  ~load_table() {
+    fpta_name_destroy(&table);
+    fpta_name_destroy(&col_pk);
+    if (var.unique)
+      fpta_name_destroy(&col_uk);
+    fpta_name_destroy(&col_payload);
+    for (unsigned i = 0; i < var.secondary; ++i)
+      fpta_name_destroy(&col_se[i]);
+    for (unsigned i = 0; i < var.values; ++i)
+      fpta_name_destroy(&col_value[i]);
+  }
+
+  static std::string column_name(const char *prefix, unsigned i) {
+    return prefix + std::to_string(i);
+  }
+
+  size_t fields() const { return 3 + var.secondary + var.values; }
+
+  static int describe(const variant &var, fpta_column_set *def) {
+    int rc = fpta_column_describe("pk", var.string_pk ? fptu_cstr : fptu_uint64,
+                                  fpta_primary_unique_ordered_obverse, def);
+    if (rc == FPTA_SUCCESS && var.unique)
+      rc = fpta_column_describe("uk", fptu_uint64,
+                                fpta_secondary_unique_unordered, def);
+    if (rc == FPTA_SUCCESS)
+      rc = fpta_column_describe("payload", fptu_cstr, fpta_noindex_nullable,
+                                def);
+    for (unsigned i = 0; rc == FPTA_SUCCESS && i < var.secondary; ++i)
+      rc = fpta_column_describe(column_name("se", i).c_str(), fptu_uint64,
+                                fpta_secondary_withdups_ordered_obverse, def);
+    for (unsigned i = 0; rc == FPTA_SUCCESS && i < var.values; ++i)
+      rc = fpta_column_describe(column_name("v", i).c_str(), fptu_uint64,
+                                fpta_noindex_nullable, def);
+    return rc;
+  }
+
+  int refresh(fpta_txn *txn) {
+    int rc = fpta_name_refresh_couple(txn, &table, &col_pk);
+    if (rc == FPTA_SUCCESS && var.unique)
+      rc = fpta_name_refresh_couple(txn, &table, &col_uk);
+    if (rc == FPTA_SUCCESS)
+      rc = fpta_name_refresh_couple(txn, &table, &col_payload);
+    for (unsigned i = 0; rc == FPTA_SUCCESS && i < var.secondary; ++i)
+      rc = fpta_name_refresh_couple(txn, &table, &col_se[i]);
+    for (unsigned i = 0; rc == FPTA_SUCCESS && i < var.values; ++i)
+      rc = fpta_name_refresh_couple(txn, &table, &col_value[i]);
+    return rc;
+  }
+
+  fpta_value key2value(uint64_t key) {
+    if (!var.string_pk)
+      return fpta_value_uint(key);
+    snprintf(keybuf, sizeof(keybuf), "%016" PRIx64, key);
+    return fpta_value_cstr(keybuf);
+  }
+
+  /* Умножение на нечетную константу взаимно-однозначно, поэтому значения
+   * уникального индекса не повторяются. */
+  static uint64_t unique4key(uint64_t key) {
+    return key * UINT64_C(0x9E3779B97F4A7C15);
+  }
+
+  int fill(fptu_rw *pt, uint64_t key, std::mt19937_64 &rng,
+           const char *payload) {
+    int rc = fptu_clear(pt);
+    if (rc == FPTA_SUCCESS)
+      rc = fpta_upsert_column(pt, &col_pk, key2value(key));
+    if (rc == FPTA_SUCCESS && var.unique)
+      rc = fpta_upsert_column(pt, &col_uk, fpta_value_uint(unique4key(key)));
+    if (rc == FPTA_SUCCESS && payload)
+      rc = fpta_upsert_column(pt, &col_payload, fpta_value_cstr(payload));
+    for (unsigned i = 0; rc == FPTA_SUCCESS && i < var.secondary; ++i)
+      rc = fpta_upsert_column(pt, &col_se[i], fpta_value_uint(rng() % 1024));
+    for (unsigned i = 0; rc == FPTA_SUCCESS && i < var.values; ++i)
+      rc = fpta_upsert_column(pt, &col_value[i], fpta_value_uint(rng()));
+    return rc;
+  }
+};
+
+class worker {
+  const options &opt;
+  const keygen &keys;
+  fpta_db *const db;
+  const unsigned ordinal;
+  std::mt19937_64 rng;
+  load_table names;
+  fptu_rw *pt;
+  std::string aux_name;
+  bool aux_exists = false;
+  std::mutex mutex;
+  stats local;
+
+  int scan(fpta_txn *txn, uint64_t key) {
+    fpta_cursor *cursor = nullptr;
+    int rc = fpta_cursor_open(txn, &names.col_pk, fpta_value_uint(key),
+                              fpta_value_uint(key + opt.reads), nullptr,
+                              fpta_ascending, &cursor);
+    while (rc == FPTA_SUCCESS) {
+      fptu_ro row;
+      rc = fpta_cursor_get(cursor, &row);
+      if (rc == FPTA_SUCCESS)
+        rc = fpta_cursor_move(cursor, fpta_next);
+    }
+    if (cursor) {
+      const int err = fpta_cursor_close(cursor);
+      if (rc == FPTA_NODATA)
+        rc = err;
+    }
+    if (rc == FPTA_NODATA)
+      rc = FPTA_SUCCESS;
+    return rc;
+  }
+
+  int read(fpta_txn *txn, size_t &lag, size_t &retired) {
+    int rc = names.refresh(txn);
+    if (rc == FPTA_SUCCESS && names.var.read == read_range)
+      rc = scan(txn, keys(rng));
+    else
+      for (size_t i = 0; rc == FPTA_SUCCESS && i < opt.reads; ++i) {
+        const uint64_t key = keys(rng);
+        fptu_ro row;
+        if (names.var.read == read_unique) {
+          const fpta_value value =
+              fpta_value_uint(load_table::unique4key(key));
+          rc = fpta_get(txn, &names.col_uk, &value, &row);
+        } else {
+          const fpta_value value = names.key2value(key);
+          rc = fpta_get(txn, &names.col_pk, &value, &row);
+        }
+      }
+    if (rc == FPTA_SUCCESS)
+      rc = fpta_transaction_lag_ex(txn, &lag, &retired, nullptr);
+    return rc;
+  }
+
+  int write(fpta_txn *txn) {
+    int rc = names.refresh(txn);
+    for (size_t i = 0; rc == FPTA_SUCCESS && i < opt.writes; ++i) {
+      const uint64_t key = keys(rng);
+      char payload[64];
+      snprintf(payload, sizeof(payload), "%u/%" PRIx64, ordinal,
+               uint64_t(rng()));
+      rc = names.fill(pt, key, rng, payload);
+      if (rc == FPTA_SUCCESS)
+        rc = fpta_upsert_row(txn, &names.table, fptu_take_noshrink(pt));
+    }
+    return rc;
+  }
+
+  int alter(fpta_txn *txn) {
+    if (aux_exists)
+      return fpta_table_drop(txn, aux_name.c_str());
+
+    fpta_column_set def;
+    fpta_column_set_init(&def);
+    int rc = fpta_column_describe("id", fptu_uint64,
+                                  fpta_primary_unique_ordered_obverse, &def);
+    if (rc == FPTA_SUCCESS)
+      rc = fpta_table_create(txn, aux_name.c_str(), &def);
+    fpta_column_set_destroy(&def);
+    return rc;
+  }
+
+  kind choose() {
+    const unsigned total = opt.mix[0] + opt.mix[1] + opt.mix[2];
+    unsigned dice = unsigned(rng() % total);
+    for (unsigned k = 0; k < kinds_count - 1; ++k) {
+      if (dice < opt.mix[k])
+        return kind(k);
+      dice -= opt.mix[k];
+    }
+    return kind_schema;
+  }
+
+public:
+  worker(const options &opt, const keygen &keys, fpta_db *db,
+         unsigned ordinal)
+      : opt(opt), keys(keys), db(db), ordinal(ordinal),
+        rng(opt.seed + ordinal), names(*opt.schema),
+        aux_name("aux" + std::to_string(ordinal)) {
+    pt = fptu_alloc(names.fields(), names.fields() * 8 + 128);
+    if (!pt)
+      check(FPTA_ENOMEM, "fptu_alloc");
+  }
+
+  ~worker() { free(pt); }
+
+  void run(const std::atomic<bool> &stop) {
+    static const fpta_level levels[kinds_count] = {fpta_read, fpta_write,
+                                                   fpta_schema};
+    while (!stop.load(std::memory_order_relaxed)) {
+      const kind k = choose();
+      size_t lag = 0, retired = 0;
+      const uint64_t start = now_ns();
+      fpta_txn *txn = nullptr;
+      int rc = fpta_transaction_begin(db, levels[k], &txn);
+      if (rc == FPTA_SUCCESS) {
+        rc = (k == kind_read) ? read(txn, lag, retired)
+                              : (k == kind_write) ? write(txn) : alter(txn);
+        const int err = fpta_transaction_end(txn, rc != FPTA_SUCCESS);
+        if (rc == FPTA_SUCCESS)
+          rc = err;
+      }
+      const uint64_t elapsed = now_ns() - start;
+      if (k == kind_schema && rc == FPTA_SUCCESS)
+        aux_exists = !aux_exists;
+
+      std::lock_guard<std::mutex> guard(mutex);
+      if (rc != FPTA_SUCCESS) {
+        local.errors[rc] += 1;
+        continue;
+      }
+      local.latency[k].push_back(elapsed);
+      if (k == kind_read) {
+        local.lag_max = std::max(local.lag_max, lag);
+        local.lag_sum += lag;
+        local.lag_count += 1;
+        local.retired_max = std::max(local.retired_max, retired);
+      }
+    }
+  }
+
+  void collect(stats &into) {
+    std::lock_guard<std::mutex> guard(mutex);
+    into.merge(local);
+  }
+};
+
+static void prepare(const options &opt, fpta_db *db) {
+  fpta_column_set def;
+  fpta_column_set_init(&def);
+  check(load_table::describe(*opt.schema, &def), "fpta_column_describe");
+
+  fpta_txn *txn = nullptr;
+  check(fpta_transaction_begin(db, fpta_schema, &txn), "transaction_begin");
+  check(fpta_table_create(txn, "load", &def), "fpta_table_create");
+  check(fpta_transaction_end(txn, false), "transaction_end");
+  check(fpta_column_set_destroy(&def), "fpta_column_set_destroy");
+
+  load_table names(*opt.schema);
+  fptu_rw *pt = fptu_alloc(names.fields(), names.fields() * 8 + 128);
+  if (!pt)
+    check(FPTA_ENOMEM, "fptu_alloc");
+
+  std::mt19937_64 rng(opt.seed);
+  const size_t batch = 10000;
+  for (size_t key = 0; key < opt.keys;) {
+    check(fpta_transaction_begin(db, fpta_write, &txn), "transaction_begin");
+    check(names.refresh(txn), "fpta_name_refresh_couple");
+    for (size_t n = 0; n < batch && key < opt.keys; ++n, ++key) {
+      check(names.fill(pt, key, rng, nullptr), "fpta_upsert_column");
+      check(fpta_insert_row(txn, &names.table, fptu_take_noshrink(pt)),
+            "fpta_insert_row");
+    }
+    check(fpta_transaction_end(txn, false), "transaction_end");
+  }
+
+  free(pt);
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: fpta_loadgen [options]\n"
+          "  --threads N          worker threads (default 4)\n"
+          "  --mix R:W:S          read/write/schema-change ratio (90:9:1)\n"
+          "  --schema S           kv, string, wide, unique or range (kv)\n"
+          "  --keys N             rows in the table (100000)\n"
+          "  --reads N            lookups or scanned keys per read txn (100)\n"
+          "  --writes N           upserts per write transaction (10)\n"
+          "  --distribution D     uniform, zipf or hotspot (uniform)\n"
+          "  --zipf-theta X       skew for zipf (0.99)\n"
+          "  --hot-keys X         share of hot keys for hotspot (0.01)\n"
+          "  --hot-ops X          share of accesses to hot keys (0.9)\n"
+          "  --duration SEC       run time (60)\n"
+          "  --interval SEC       report interval (1)\n"
+          "  --durability D       weak, lazy or sync (weak)\n"
+          "  --seed N             random seed (42)\n"
+          "  --path FILE          database pathname (in the temp directory)\n");
+}
+
+static std::string default_path() {
+  const char *dir = getenv("TMPDIR");
+#if defined(_WIN32) || defined(_WIN64)
+  if (!dir)
+    dir = getenv("TEMP");
+  if (!dir)
+    dir = ".";
+  return std::string(dir) + "\\fpta_loadgen.fpta";
+#else
+  if (!dir)
+    dir = "/tmp";
+  return std::string(dir) + "/fpta_loadgen.fpta";
+#endif
+}
+
+} // namespace
+
+int main(int argc, const char *argv[]) {
+  options opt;
+  for (int i = 1; i < argc; ++i) {
+    const char *const arg = argv[i];
+    const char *const value = (i + 1 < argc) ? argv[++i] : "";
+    bool ok = *value != '\0';
+    if (strcmp(arg, "--threads") == 0)
+      ok &= (opt.threads = unsigned(strtoul(value, nullptr, 10))) > 0;
+    else if (strcmp(arg, "--mix") == 0)
+      ok &= sscanf(value, "%u:%u:%u", &opt.mix[0], &opt.mix[1], &opt.mix[2]) ==
+                3 &&
+            opt.mix[0] + opt.mix[1] + opt.mix[2] > 0;
+    else if (strcmp(arg, "--schema") == 0) {
+      opt.schema = nullptr;
+      for (const variant &var : variants)
+        if (strcmp(value, var.name) == 0)
+          opt.schema = &var;
+      ok &= opt.schema != nullptr;
+    } else if (strcmp(arg, "--keys") == 0)
+      ok &= (opt.keys = strtoull(value, nullptr, 10)) > 1;
+    else if (strcmp(arg, "--reads") == 0)
+      opt.reads = strtoull(value, nullptr, 10);
+    else if (strcmp(arg, "--writes") == 0)
+      opt.writes = strtoull(value, nullptr, 10);
+    else if (strcmp(arg, "--distribution") == 0) {
+      if (strcmp(value, "uniform") == 0)
+        opt.dist = uniform;
+      else if (strcmp(value, "zipf") == 0)
+        opt.dist = zipf;
+      else if (strcmp(value, "hotspot") == 0)
+        opt.dist = hotspot;
+      else
+        ok = false;
+    } else if (strcmp(arg, "--zipf-theta") == 0)
+      opt.zipf_theta = atof(value);
+    else if (strcmp(arg, "--hot-keys") == 0)
+      ok &= (opt.hot_keys = atof(value)) > 0 && opt.hot_keys < 1;
+    else if (strcmp(arg, "--hot-ops") == 0)
+      ok &= (opt.hot_ops = atof(value)) >= 0 && opt.hot_ops <= 1;
+    else if (strcmp(arg, "--duration") == 0)
+      ok &= (opt.duration = atof(value)) > 0;
+    else if (strcmp(arg, "--interval") == 0)
+      ok &= (opt.interval = atof(value)) > 0;
+    else if (strcmp(arg, "--seed") == 0)
+      opt.seed = strtoull(value, nullptr, 0);
+    else if (strcmp(arg, "--path") == 0)
+      opt.path = value;
+    else if (strcmp(arg, "--durability") == 0) {
+      if (strcmp(value, "weak") == 0)
+        opt.durability = fpta_weak;
+      else if (strcmp(value, "lazy") == 0)
+        opt.durability = fpta_lazy;
+      else if (strcmp(value, "sync") == 0)
+        opt.durability = fpta_sync;
+      else
+        ok = false;
+    } else
+      ok = false;
+    if (!ok) {
+      usage();
+      return EXIT_FAILURE;
+    }
+  }
+  if (opt.path.empty())
+    opt.path = default_path();
+  const std::string lck_path = opt.path + "-lck";
+  unlink(opt.path.c_str());
+  unlink(lck_path.c_str());
+
+  fpta_db_creation_params_t creation_params;
+  memset(&creation_params, 0, sizeof(creation_params));
+  creation_params.params_size = sizeof(creation_params);
+  creation_params.file_mode = 0640;
+  creation_params.size_lower = -1;
+  creation_params.size_upper = intptr_t(1) << (sizeof(intptr_t) > 4 ? 36 : 30);
+  creation_params.pagesize = -1;
+  creation_params.growth_step = 16 << 20;
+  creation_params.shrink_threshold = -1;
+  fpta_db *db = nullptr;
+  check(fpta_db_create_or_open(opt.path.c_str(), opt.durability,
+                               fpta_regime_default, true, &db,
+                               &creation_params),
+        "fpta_db_create_or_open");
+  prepare(opt, db);
+
+  const keygen keys(opt);
+  std::vector<std::unique_ptr<worker>> workers;
+  for (unsigned i = 0; i < opt.threads; ++i)
+    workers.emplace_back(new worker(opt, keys, db, i));
+
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> threads;
+  for (auto &w : workers)
+    threads.emplace_back(&worker::run, w.get(), std::cref(stop));
+
+  FILE *const out = stdout;
+  stats total;
+  const uint64_t start = now_ns();
+  uint64_t last = start;
+  for (;;) {
+    std::this_thread::sleep_for(
+        std::chrono::microseconds(uint64_t(opt.interval * 1e6)));
+    const uint64_t now = now_ns();
+    const bool done = now - start >= uint64_t(opt.duration * 1e9);
+    if (done)
+      stop.store(true, std::memory_order_relaxed);
+
+    stats interval;
+    for (auto &w : workers)
+      w->collect(interval);
+    fprintf(out, "{\"t\": %.3f, ", (now - start) / 1e9);
+    interval.json(out, (now - last) / 1e9);
+    fprintf(out, "}\n");
+    fflush(out);
+    total.merge(interval);
+    last = now;
+    if (done)
+      break;
+  }
+
+  for (auto &thread : threads)
+    thread.join();
+  for (auto &w : workers)
+    w->collect(total);
+  workers.clear();
+
+  const double seconds = (now_ns() - start) / 1e9;
+  fprintf(out,
+          "{\"summary\": true, \"schema\": \"%s\", \"seconds\": %.3f, "
+          "\"threads\": %u, ",
+          opt.schema->name, seconds, opt.threads);
+  total.json(out, seconds);
+  fprintf(out, "}\n");
+
+  check(fpta_db_close(db), "fpta_db_close");
+  unlink(opt.path.c_str());
+  unlink(lck_path.c_str());
+  return total.errors.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}